@@ -0,0 +1,324 @@
+// Headless benchmark for the PLY query engine. Drives the query worker pool directly, without Lumberyard, EBuses or the
+// TickBus, against a PostgreSQL server, or against fake in process connections to measure PLY's own overhead. Runs one query
+// from the command line, or the scenarios in a benchmark scenario file, through the same benchmark runner as the PLY system
+// component, and reports throughput, latency and errors as text, and optionally as JSON.
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <fstream>
+#include <iostream>
+
+#include <PLY/PLYConfiguration.hpp>
+#include <QueryEngine.h>
+#include <FakeConnection.h>
+#include <BenchmarkRunner.h>
+#include <BenchmarkScenario.h>
+#include <StatsCollector.h>
+#include <PLYLog.h>
+
+namespace
+{
+	//Benchmark options, set from the command line.
+	struct Options
+	{
+		Options() :
+			scenarioFileName(""),
+			passes(0),
+			jsonFileName(""),
+			logLevel(PLY::Log::PLY_WARNING),
+			fake(false)
+		{
+			base.name = "bench";
+			base.query = "SELECT 1";
+			base.queries = 10000;
+			base.warmup = 100;
+			base.inFlight = 64;
+			base.pool.minPoolSize = 8;
+			base.pool.maxPoolSize = 8;
+
+			//Default to the standard libpq environment variables, so the benchmark can be pointed at a server the same way as psql.
+			if (getenv("PGHOST") != nullptr) base.connection.host = getenv("PGHOST");
+			if (getenv("PGPORT") != nullptr) base.connection.port = atoi(getenv("PGPORT"));
+			if (getenv("PGDATABASE") != nullptr) base.connection.database = getenv("PGDATABASE");
+			if (getenv("PGUSER") != nullptr) base.connection.username = getenv("PGUSER");
+			if (getenv("PGPASSWORD") != nullptr) base.connection.password = getenv("PGPASSWORD");
+			base.connection.connectTimeout = 5;
+		};
+
+		//Settings from the command line. Used as is without a scenario file, and for anything a scenario file doesn't set.
+		PLY::BenchmarkScenario base;
+		//Scenario file name. Blank means run the base scenario.
+		std::string scenarioFileName;
+		//Passes for every scenario. 0 = use each scenario's.
+		int passes;
+		//JSON report file name. "-" writes it to stdout instead of the text report. Blank means no JSON report.
+		std::string jsonFileName;
+		PLY::Log::LogLevel logLevel;
+		//Use fake connections instead of a PostgreSQL server?
+		bool fake;
+		PLY::FakeConnectionSettings fakeSettings;
+	};
+
+	void PrintUsage()
+	{
+		fprintf(stderr, "%s",
+			"Usage: ply_bench [options]\n"
+			"\n"
+			"Runs queries against PostgreSQL through the PLY query engine and reports throughput and latency.\n"
+			"Connection options default to the PGHOST, PGPORT, PGDATABASE, PGUSER and PGPASSWORD environment variables.\n"
+			"\n"
+			"  --scenario FILE        Run the scenarios in a benchmark scenario file. The other options are used for\n"
+			"                         anything the file doesn't set.\n"
+			"  --host HOST            Database host name, or Unix socket directory. Default localhost.\n"
+			"  --port PORT            Database port. Default 5432.\n"
+			"  --dbname NAME          Database name.\n"
+			"  --user NAME            Database user name.\n"
+			"  --password PASSWORD    Database password.\n"
+			"  --query SQL            Query to run. Default \"SELECT 1\".\n"
+			"  --queries N            Number of queries to time in each pass. Default 10000.\n"
+			"  --passes N             Number of timed passes. Overrides the scenario file. Default 1.\n"
+			"  --warmup N             Number of queries to run before timing starts. Default 100.\n"
+			"  --pool N               Number of query workers. Default 8.\n"
+			"  --max-pool N           Most query workers, if more than --pool. Workers are added while queries wait.\n"
+			"  --in-flight N          Most queries sent but not yet finished. Default 64.\n"
+			"  --rate N               Open loop: send N queries per second for --duration seconds, however many are in\n"
+			"                         flight, and measure latency from each query's intended send time.\n"
+			"  --arrival PATTERN      Open loop arrival pattern, fixed or poisson. Default fixed.\n"
+			"  --duration SECONDS     Open loop seconds per pass. Default 10.\n"
+			"  --wait-mode MODE       Worker wait mode, yield or sleep. Default sleep.\n"
+			"  --no-transaction       Run each query outside of a transaction.\n"
+			"  --timeout SECONDS      Give up after this long without a result. Default 30.\n"
+			"  --json FILE            Also write the report as JSON. Use - to write only JSON, to stdout.\n"
+			"  --log-level LEVEL      PLY log level: error, warning, info or debug. Default warning.\n"
+			"\n"
+			"Fake connections answer every query in process, without a server. Any --fake option turns them on.\n"
+			"\n"
+			"  --fake                 Use fake connections.\n"
+			"  --fake-latency US      Average query latency in microseconds. Default 0.\n"
+			"  --fake-distribution D  Latency distribution: fixed, uniform, exponential or lognormal. Default fixed.\n"
+			"  --fake-sigma N         Standard deviation of the log of the latency, for lognormal. Default 1.\n"
+			"  --fake-rows N          Rows in each result set. Default 1.\n"
+			"  --fake-columns N       Columns in each result set. Default 1.\n"
+			"  --fake-field-size N    Bytes in each field. Default 8.\n"
+			"  --fake-error-rate P    Chance of each query failing with an SQL error, from 0 to 1. Default 0.\n"
+			"  --fake-disconnect-rate P\n"
+			"                         Chance of each query losing the connection, from 0 to 1. Default 0.\n"
+			"  --fake-connect-failure-rate P\n"
+			"                         Chance of each connection attempt failing, from 0 to 1. Default 0.\n"
+			"  --help                 Show this help.\n");
+	}
+
+	//Read the command line into the options.
+	//@return False if the command line is invalid, or help was asked for.
+	bool ParseOptions(int argc, char **argv, Options &o)
+	{
+		bool maxPoolSet = false;
+
+		for (int i = 1; i < argc; ++i)
+		{
+			std::string arg = argv[i];
+
+			if (arg == "--help" || arg == "-h") return false;
+
+			if (arg == "--no-transaction")
+			{
+				o.base.useTransaction = false;
+				continue;
+			}
+
+			if (arg == "--fake")
+			{
+				o.fake = true;
+				continue;
+			}
+
+			if (arg.compare(0, 7, "--fake-") == 0) o.fake = true;
+
+			if (i + 1 >= argc)
+			{
+				fprintf(stderr, "Missing value for %s\n", arg.c_str());
+				return false;
+			}
+			std::string value = argv[++i];
+
+			if (arg == "--scenario") o.scenarioFileName = value;
+			else if (arg == "--host") o.base.connection.host = value.c_str();
+			else if (arg == "--port") o.base.connection.port = atoi(value.c_str());
+			else if (arg == "--dbname") o.base.connection.database = value.c_str();
+			else if (arg == "--user") o.base.connection.username = value.c_str();
+			else if (arg == "--password") o.base.connection.password = value.c_str();
+			else if (arg == "--query") o.base.query = value.c_str();
+			else if (arg == "--queries") o.base.queries = atoll(value.c_str());
+			else if (arg == "--passes") o.passes = atoi(value.c_str());
+			else if (arg == "--warmup") o.base.warmup = atoll(value.c_str());
+			else if (arg == "--pool") o.base.pool.minPoolSize = atoi(value.c_str());
+			else if (arg == "--max-pool")
+			{
+				o.base.pool.maxPoolSize = atoi(value.c_str());
+				maxPoolSet = true;
+			}
+			else if (arg == "--in-flight") o.base.inFlight = atoll(value.c_str());
+			else if (arg == "--rate") o.base.rate = atoll(value.c_str());
+			else if (arg == "--duration") o.base.duration = atoi(value.c_str());
+			else if (arg == "--arrival")
+			{
+				if (value == "fixed") o.base.arrival = PLY::BenchmarkScenario::FIXED;
+				else if (value == "poisson") o.base.arrival = PLY::BenchmarkScenario::POISSON;
+				else
+				{
+					fprintf(stderr, "Unknown arrival pattern %s\n", value.c_str());
+					return false;
+				}
+			}
+			else if (arg == "--wait-mode")
+			{
+				if (value == "yield") o.base.pool.waitMode = PLY::PoolSettings::YIELD;
+				else if (value == "sleep") o.base.pool.waitMode = PLY::PoolSettings::SLEEP;
+				else
+				{
+					fprintf(stderr, "Unknown wait mode %s\n", value.c_str());
+					return false;
+				}
+			}
+			else if (arg == "--timeout") o.base.timeout = atoi(value.c_str());
+			else if (arg == "--fake-latency") o.fakeSettings.latency = atoi(value.c_str());
+			else if (arg == "--fake-distribution")
+			{
+				if (value == "fixed") o.fakeSettings.distribution = PLY::FakeConnectionSettings::FIXED;
+				else if (value == "uniform") o.fakeSettings.distribution = PLY::FakeConnectionSettings::UNIFORM;
+				else if (value == "exponential") o.fakeSettings.distribution = PLY::FakeConnectionSettings::EXPONENTIAL;
+				else if (value == "lognormal") o.fakeSettings.distribution = PLY::FakeConnectionSettings::LOGNORMAL;
+				else
+				{
+					fprintf(stderr, "Unknown latency distribution %s\n", value.c_str());
+					return false;
+				}
+			}
+			else if (arg == "--fake-sigma") o.fakeSettings.latencySigma = atof(value.c_str());
+			else if (arg == "--fake-rows") o.fakeSettings.rows = atoi(value.c_str());
+			else if (arg == "--fake-columns") o.fakeSettings.columns = atoi(value.c_str());
+			else if (arg == "--fake-field-size") o.fakeSettings.fieldSize = atoi(value.c_str());
+			else if (arg == "--fake-error-rate") o.fakeSettings.errorRate = atof(value.c_str());
+			else if (arg == "--fake-disconnect-rate") o.fakeSettings.disconnectRate = atof(value.c_str());
+			else if (arg == "--fake-connect-failure-rate") o.fakeSettings.connectFailureRate = atof(value.c_str());
+			else if (arg == "--json") o.jsonFileName = value;
+			else if (arg == "--log-level")
+			{
+				if (value == "error") o.logLevel = PLY::Log::PLY_ERROR;
+				else if (value == "warning") o.logLevel = PLY::Log::PLY_WARNING;
+				else if (value == "info") o.logLevel = PLY::Log::PLY_INFO;
+				else if (value == "debug") o.logLevel = PLY::Log::PLY_DEBUG;
+				else
+				{
+					fprintf(stderr, "Unknown log level %s\n", value.c_str());
+					return false;
+				}
+			}
+			else
+			{
+				fprintf(stderr, "Unknown option %s\n", arg.c_str());
+				return false;
+			}
+		}
+
+		if (!maxPoolSet) o.base.pool.maxPoolSize = o.base.pool.minPoolSize;
+
+		const PLY::BenchmarkScenario &b = o.base;
+		if (b.queries < 1 || b.warmup < 0 || b.inFlight < 1 || b.timeout < 1 || o.passes < 0 || b.pool.minPoolSize < 1
+			|| b.pool.maxPoolSize < b.pool.minPoolSize || b.rate < 0 || b.duration < 1)
+		{
+			fprintf(stderr, "%s", "--queries, --in-flight, --timeout, --duration and --pool must be at least 1, and --max-pool at least --pool.\n");
+			return false;
+		}
+
+		const PLY::FakeConnectionSettings &f = o.fakeSettings;
+		if (f.latency < 0 || f.latencySigma < 0 || f.rows < 0 || f.columns < 0 || f.fieldSize < 0 || f.errorRate < 0 || f.errorRate > 1
+			|| f.disconnectRate < 0 || f.disconnectRate > 1 || f.connectFailureRate < 0 || f.connectFailureRate >= 1)
+		{
+			fprintf(stderr, "%s", "--fake sizes and latency can't be negative, rates must be from 0 to 1, and --fake-connect-failure-rate less than 1.\n");
+			return false;
+		}
+
+		return true;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	Options o;
+	if (!ParseOptions(argc, argv, o))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	PLYCONF->SetLogLevel(o.logLevel);
+
+	std::vector<PLY::BenchmarkScenario> scenarios;
+	if (o.scenarioFileName != "")
+	{
+		std::string error;
+		if (!PLY::BenchmarkScenario::Load(o.scenarioFileName, o.base, scenarios, error))
+		{
+			fprintf(stderr, "%s\n", error.c_str());
+			return 1;
+		}
+	}
+	else
+	{
+		scenarios.push_back(o.base);
+	}
+
+	PLY::QueryEngine engine;
+	if (o.fake) engine.SetConnectionFactory(PLY::FakeConnection::GetFactory(o.fakeSettings));
+	PLY::BenchmarkRunner runner(&engine, scenarios, o.passes);
+
+	while (!runner.IsFinished())
+	{
+		runner.Update();
+
+		//Restart the work manager if it died, as the PLY system component's tick does.
+		if (engine.IsStarted()) engine.CheckWorkManager();
+
+		if (o.base.pool.waitMode == PLY::PoolSettings::YIELD) std::this_thread::yield();
+		else std::this_thread::sleep_for(std::chrono::microseconds(50));
+	}
+
+	bool failed = false;
+	for (const PLY::BenchmarkScenarioResult &r : runner.GetResults())
+	{
+		if (r.failure != "" || r.GetErrors() > 0) failed = true;
+	}
+
+	if (o.jsonFileName != "-")
+	{
+		for (const std::string &line : runner.GetReportLines()) printf("%s\n", line.c_str());
+		printf("PLY BENCHMARK: %lld connection failures, %lld bytes received.\n", STATS->GetCount(PLY::StatsCollector::CONNECTION_FAILURES),
+			STATS->GetCount(PLY::StatsCollector::BYTES_RECEIVED));
+
+#ifdef PLY_LOCK_PROFILING
+		fflush(stdout);
+		STATS->PrintLockStats();
+#endif
+	}
+
+	if (o.jsonFileName == "-")
+	{
+		runner.WriteReport(std::cout);
+	}
+	else if (o.jsonFileName != "")
+	{
+		std::ofstream file(o.jsonFileName, std::ios::trunc);
+		if (!file)
+		{
+			fprintf(stderr, "Couldn't write JSON report %s\n", o.jsonFileName.c_str());
+			return 1;
+		}
+		runner.WriteReport(file);
+	}
+
+	return failed ? 2 : 0;
+}
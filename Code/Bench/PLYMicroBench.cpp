@@ -0,0 +1,428 @@
+// Microbenchmarks for the overhead the PLY query engine adds on top of the database. Each benchmark runs one of the engine's
+// internal operations in isolation, without a database or the worker and work manager threads: the query queue, the
+// results store, the work manager's TTL sweeps and query dispatch, and PLYLOG and PLYCONF access. Benchmarks are
+// parameterised by queue size, and by the number of threads using the engine at once. A round trip benchmark runs the
+// whole scheduler, threads and all, against fake connections.
+// Built with Google Benchmark, so the usual --benchmark_filter, --benchmark_repetitions and --benchmark_format options apply.
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <PLY/PLYConfiguration.hpp>
+#include <QueryEngine.h>
+#include <FakeConnection.h>
+#include <WorkManager.h>
+#include <Worker.h>
+#include <PLYLog.h>
+
+//Access to the engine's internals. Friend of the query engine, the work manager and the worker.
+class PLYMicroBench
+{
+public:
+
+	//Stop a work manager's thread, so its steps can be run one at a time.
+	static void StopThread(PLY::WorkManager &wm)
+	{
+		wm.m_shutdownThread = true;
+		if (wm.m_workManagerThread.joinable()) wm.m_workManagerThread.join();
+	}
+
+	//Add idle workers to the engine, with their threads stopped, so giving them queries doesn't run the queries.
+	//@param engine The query engine.
+	//@param count The number of workers.
+	static void AddWorkers(PLY::QueryEngine &engine, int count)
+	{
+		std::unique_lock<PLY::PLYMutex> lock(engine.m_workersMutex);
+		for (int i = 0; i < count; ++i)
+		{
+			std::shared_ptr<PLY::Worker> w = std::make_shared<PLY::Worker>(&engine, engine.GetNextWorkerID(), PLY::PoolSettings::NORMAL,
+				PLY::PoolSettings::SLEEP, 0, "");
+			w->m_shutdownThread = true;
+			if (w->m_workerThread.joinable()) w->m_workerThread.join();
+			engine.m_workers.push_back(w);
+		}
+	}
+
+	//Make every worker idle, and every query in the query queue unassigned.
+	static void ResetDispatch(PLY::QueryEngine &engine)
+	{
+		for (std::shared_ptr<PLY::Worker> &w : engine.m_workers)
+		{
+			w->m_busy = false;
+			w->m_runQuery = false;
+			w->m_query = nullptr;
+		}
+		for (std::shared_ptr<PLY::PLYQuery> &q : engine.m_queryQueue) q->workerID = 0;
+	}
+
+	//Mark every query in the query queue as given to a worker.
+	static void AssignAll(PLY::QueryEngine &engine)
+	{
+		for (std::shared_ptr<PLY::PLYQuery> &q : engine.m_queryQueue) q->workerID = 1;
+	}
+
+	//Remove the oldest query from the query queue, as the work manager does once a query has finished.
+	static void PopQuery(PLY::QueryEngine &engine)
+	{
+		std::unique_lock<PLY::PLYMutex> lock(engine.m_queryQueueMutex);
+		if (!engine.m_queryQueue.empty()) engine.m_queryQueue.pop_front();
+	}
+
+	static bool AddResult(PLY::QueryEngine &engine, const std::shared_ptr<PLY::PLYResult> &result)
+	{
+		return engine.AddResult(result);
+	}
+
+	static void ClearQueues(PLY::QueryEngine &engine)
+	{
+		std::unique_lock<PLY::PLYMutex> lockQ(engine.m_queryQueueMutex);
+		engine.m_queryQueue.clear();
+		lockQ.unlock();
+
+		std::unique_lock<PLY::PLYMutex> lockR(engine.m_resultsQueueMutex);
+		engine.m_resultsQueue.clear();
+	}
+
+	static void ExpireQueries(PLY::WorkManager &wm) { wm.ExpireQueries(); }
+	static void ExpireResults(PLY::WorkManager &wm) { wm.ExpireResults(); }
+	static void AssignQueries(PLY::WorkManager &wm) { wm.AssignQueries(); }
+};
+
+namespace
+{
+	//Query settings for benchmark queries. TTLs are set, so the TTL sweeps compare times, but are too long to expire.
+	PLY::QuerySettings GetQuerySettings()
+	{
+		PLY::QuerySettings qs;
+		qs.advertiseResult = false;
+		qs.queryTTL = 3600000;
+		qs.resultTTL = 3600000;
+		return qs;
+	}
+
+	//Queue sizes to benchmark with.
+	const std::vector<long long> QUEUE_SIZES = { 0, 64, 1024, 16384 };
+
+	//Engine shared by the threads of a multi-threaded benchmark. Created and destroyed by thread 0.
+	std::unique_ptr<PLY::QueryEngine> g_engine;
+
+	//Work manager with its thread stopped.
+	std::unique_ptr<PLY::WorkManager> g_workManager;
+
+	//Quiet logging and small pool settings, so no benchmark starts real workers.
+	void Configure(int poolSize)
+	{
+		PLYCONF->SetLogLevel(PLY::Log::PLY_WARNING);
+		PLY::PoolSettings p = PLYCONF->GetPoolSettings();
+		p.minPoolSize = poolSize;
+		p.maxPoolSize = poolSize;
+		PLYCONF->SetPoolSettings(p);
+	}
+
+	void CreateEngine(long long queries, long long results)
+	{
+		Configure(1);
+		g_engine = std::make_unique<PLY::QueryEngine>();
+		//A worker thread may open a connection before it sees its shutdown flag.
+		g_engine->SetConnectionFactory(PLY::FakeConnection::GetFactory(PLY::FakeConnectionSettings()));
+		g_workManager = std::make_unique<PLY::WorkManager>(g_engine.get());
+		PLYMicroBench::StopThread(*g_workManager);
+
+		PLY::QuerySettings qs = GetQuerySettings();
+		for (long long i = 0; i < queries; ++i) g_engine->SendQuery("SELECT 1", std::vector<std::string>(), qs);
+
+		for (long long i = 0; i < results; ++i)
+		{
+			std::shared_ptr<PLY::PLYResult> r = std::make_shared<PLY::PLYResult>();
+			r->queryID = g_engine->SendQuery("SELECT 1", std::vector<std::string>(), qs);
+			r->settings = qs;
+			r->resultCreationTime = AZ::ScriptTimePoint(AZStd::chrono::system_clock::now());
+			PLYMicroBench::PopQuery(*g_engine);
+			PLYMicroBench::AddResult(*g_engine, r);
+		}
+	}
+
+	void DestroyEngine()
+	{
+		PLYMicroBench::ClearQueues(*g_engine);
+		g_workManager = nullptr;
+		g_engine = nullptr;
+	}
+
+	//Threads that send and collect queries for as long as they exist, to contend for the queue locks with a benchmark.
+	class Contenders
+	{
+	public:
+
+		Contenders(PLY::QueryEngine &engine, int count) :
+			m_stop(false)
+		{
+			for (int i = 0; i < count; ++i)
+			{
+				m_threads.push_back(std::thread([this, &engine]
+				{
+					PLY::QuerySettings qs = GetQuerySettings();
+					while (!m_stop)
+					{
+						unsigned long long queryID = engine.SendQuery("SELECT 1", std::vector<std::string>(), qs);
+						PLYMicroBench::PopQuery(engine);
+						engine.GetResult(queryID);
+					}
+				}));
+			}
+		};
+
+		~Contenders()
+		{
+			m_stop = true;
+			for (std::thread &t : m_threads) t.join();
+		};
+
+	private:
+
+		std::atomic<bool> m_stop;
+		std::vector<std::thread> m_threads;
+	};
+
+	//Send a query and remove it from the front of the query queue, on a queue of range(0) queries.
+	void BM_QueryQueue_EnqueueDequeue(benchmark::State &state)
+	{
+		if (state.thread_index() == 0) CreateEngine(state.range(0), 0);
+
+		PLY::QuerySettings qs = GetQuerySettings();
+		AZStd::string query = "SELECT 1";
+		std::vector<std::string> noParams;
+
+		for (auto _ : state)
+		{
+			benchmark::DoNotOptimize(g_engine->SendQuery(query, noParams, qs));
+			PLYMicroBench::PopQuery(*g_engine);
+		}
+
+		state.SetItemsProcessed(state.iterations());
+
+		if (state.thread_index() == 0) DestroyEngine();
+	}
+
+	//Add a result, get it and remove it, on a results store of range(0) results.
+	void BM_ResultsStore_AddGetRemove(benchmark::State &state)
+	{
+		if (state.thread_index() == 0) CreateEngine(0, state.range(0));
+
+		//Give each thread its own range of query IDs, above those already in the store.
+		unsigned long long queryID = (static_cast<unsigned long long>(state.thread_index()) + 1) << 40;
+		std::shared_ptr<PLY::PLYResult> result = std::make_shared<PLY::PLYResult>();
+
+		for (auto _ : state)
+		{
+			result->queryID = ++queryID;
+			PLYMicroBench::AddResult(*g_engine, result);
+			benchmark::DoNotOptimize(g_engine->GetResult(queryID));
+			g_engine->RemoveResult(queryID);
+		}
+
+		state.SetItemsProcessed(state.iterations());
+
+		if (state.thread_index() == 0) DestroyEngine();
+	}
+
+	//One work manager query TTL sweep over range(0) queries, none of which expire, with range(1) threads using the queue.
+	void BM_WorkManager_ExpireQueries(benchmark::State &state)
+	{
+		CreateEngine(state.range(0), 0);
+		std::unique_ptr<Contenders> contenders = std::make_unique<Contenders>(*g_engine, static_cast<int>(state.range(1)));
+
+		for (auto _ : state) PLYMicroBench::ExpireQueries(*g_workManager);
+
+		state.SetItemsProcessed(state.iterations() * state.range(0));
+
+		contenders = nullptr;
+		DestroyEngine();
+	}
+
+	//One work manager result TTL sweep over range(0) results, none of which expire, with range(1) threads using the queues.
+	void BM_WorkManager_ExpireResults(benchmark::State &state)
+	{
+		CreateEngine(0, state.range(0));
+		std::unique_ptr<Contenders> contenders = std::make_unique<Contenders>(*g_engine, static_cast<int>(state.range(1)));
+
+		for (auto _ : state) PLYMicroBench::ExpireResults(*g_workManager);
+
+		state.SetItemsProcessed(state.iterations() * state.range(0));
+
+		contenders = nullptr;
+		DestroyEngine();
+	}
+
+	//One work manager dispatch of range(0) waiting queries to range(1) idle workers. Gives min(range(0), range(1)) queries.
+	void BM_WorkManager_AssignQueries(benchmark::State &state)
+	{
+		CreateEngine(state.range(0), 0);
+		Configure(static_cast<int>(state.range(1)));
+		PLYMicroBench::AddWorkers(*g_engine, static_cast<int>(state.range(1)));
+
+		for (auto _ : state)
+		{
+			state.PauseTiming();
+			PLYMicroBench::ResetDispatch(*g_engine);
+			state.ResumeTiming();
+
+			PLYMicroBench::AssignQueries(*g_workManager);
+		}
+
+		state.SetItemsProcessed(state.iterations() * std::min(state.range(0), state.range(1)));
+
+		DestroyEngine();
+	}
+
+	//One work manager dispatch pass over range(0) queries that are all already running, with range(1) busy workers. This is
+	//what the work manager pays every loop while the pool is saturated.
+	void BM_WorkManager_AssignQueriesBusy(benchmark::State &state)
+	{
+		CreateEngine(state.range(0), 0);
+		Configure(static_cast<int>(state.range(1)));
+		PLYMicroBench::AddWorkers(*g_engine, static_cast<int>(state.range(1)));
+		PLYMicroBench::AssignAll(*g_engine);
+
+		for (auto _ : state) PLYMicroBench::AssignQueries(*g_workManager);
+
+		state.SetItemsProcessed(state.iterations() * state.range(0));
+
+		DestroyEngine();
+	}
+
+	//A debug message below the log level, as the work manager logs for every query it dispatches.
+	void BM_PLYLOG_Filtered(benchmark::State &state)
+	{
+		if (state.thread_index() == 0) Configure(1);
+
+		unsigned long long queryID = 0;
+		for (auto _ : state)
+		{
+			PLYLOG(PLY::PLYLog::PLY_DEBUG, "Query removing ID " + AZStd::string::format("%u", ++queryID));
+		}
+
+		state.SetItemsProcessed(state.iterations());
+	}
+
+	//The log level check alone, without building the message.
+	void BM_PLYLOG_GetLevel(benchmark::State &state)
+	{
+		if (state.thread_index() == 0) Configure(1);
+
+		for (auto _ : state) benchmark::DoNotOptimize(PLYLOG_GET_LEVEL);
+
+		state.SetItemsProcessed(state.iterations());
+	}
+
+	//Read the pool settings, as the work manager does whenever it has to start a worker.
+	void BM_PLYCONF_GetPoolSettings(benchmark::State &state)
+	{
+		for (auto _ : state) benchmark::DoNotOptimize(PLYCONF->GetPoolSettings());
+
+		state.SetItemsProcessed(state.iterations());
+	}
+
+	//Read the query settings, as callers do for every query sent with default settings.
+	void BM_PLYCONF_GetQuerySettings(benchmark::State &state)
+	{
+		for (auto _ : state) benchmark::DoNotOptimize(PLYCONF->GetQuerySettings());
+
+		state.SetItemsProcessed(state.iterations());
+	}
+
+	//Build the connection string, as the work manager does whenever it starts a worker.
+	void BM_PLYCONF_GetConnectionString(benchmark::State &state)
+	{
+		for (auto _ : state) benchmark::DoNotOptimize(PLYCONF->GetConnectionString());
+
+		state.SetItemsProcessed(state.iterations());
+	}
+
+	//Send range(1) queries through a started engine with range(0) workers and fake connections that answer instantly, and
+	//wait for every result. This is PLY's whole round trip overhead: the query queue, work manager dispatch, the worker
+	//loop and the results queue.
+	void BM_QueryEngine_FakeRoundTrip(benchmark::State &state)
+	{
+		Configure(static_cast<int>(state.range(0)));
+		PLY::PoolSettings p = PLYCONF->GetPoolSettings();
+		p.waitMode = PLY::PoolSettings::YIELD;
+		PLYCONF->SetPoolSettings(p);
+
+		PLY::QueryEngine engine;
+		engine.SetConnectionFactory(PLY::FakeConnection::GetFactory(PLY::FakeConnectionSettings()));
+		engine.Start();
+
+		PLY::QuerySettings qs = GetQuerySettings();
+		std::vector<unsigned long long> ids;
+
+		for (auto _ : state)
+		{
+			ids.clear();
+			for (long long i = 0; i < state.range(1); ++i) ids.push_back(engine.SendQuery("SELECT 1", std::vector<std::string>(), qs));
+
+			while (!ids.empty())
+			{
+				for (const std::shared_ptr<PLY::PLYResult> &r : engine.GetResultsFrom(ids.front()))
+				{
+					engine.RemoveResult(r->queryID);
+					ids.erase(std::find(ids.begin(), ids.end(), r->queryID));
+				}
+				std::this_thread::yield();
+			}
+		}
+
+		state.SetItemsProcessed(state.iterations() * state.range(1));
+
+		engine.Stop();
+		Configure(1);
+	}
+
+	//Add queue size arguments.
+	void QueueSizes(benchmark::internal::Benchmark *b)
+	{
+		for (long long size : QUEUE_SIZES) b->Arg(size);
+	}
+
+	//Add queue size and contending thread count arguments.
+	void QueueSizesAndContenders(benchmark::internal::Benchmark *b)
+	{
+		b->ArgNames({ "size", "contenders" });
+		for (long long size : QUEUE_SIZES)
+		{
+			for (long long contenders : { 0, 1, 4 }) b->Args({ size, contenders });
+		}
+	}
+
+	//Add queue size and worker count arguments.
+	void QueueSizesAndWorkers(benchmark::internal::Benchmark *b)
+	{
+		b->ArgNames({ "size", "workers" });
+		for (long long size : QUEUE_SIZES)
+		{
+			if (size == 0) continue;
+			for (long long workers : { 1, 8, 32 }) b->Args({ size, workers });
+		}
+	}
+}
+
+BENCHMARK(BM_QueryQueue_EnqueueDequeue)->Apply(QueueSizes)->ArgName("size")->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_ResultsStore_AddGetRemove)->Apply(QueueSizes)->ArgName("size")->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_WorkManager_ExpireQueries)->Apply(QueueSizesAndContenders)->UseRealTime();
+BENCHMARK(BM_WorkManager_ExpireResults)->Apply(QueueSizesAndContenders)->UseRealTime();
+BENCHMARK(BM_WorkManager_AssignQueries)->Apply(QueueSizesAndWorkers);
+BENCHMARK(BM_WorkManager_AssignQueriesBusy)->Apply(QueueSizesAndWorkers);
+BENCHMARK(BM_QueryEngine_FakeRoundTrip)->ArgNames({ "workers", "queries" })->Args({ 1, 1024 })->Args({ 8, 1024 })
+	->Args({ 64, 1024 })->Args({ 128, 16384 })->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_PLYLOG_Filtered)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_PLYLOG_GetLevel)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_PLYCONF_GetPoolSettings)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_PLYCONF_GetQuerySettings)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_PLYCONF_GetConnectionString)->ThreadRange(1, 8)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,7 @@
+// Stand in for Lumberyard's TickBus header, used by the headless benchmark. The query engine only needs the time point
+// type, as the benchmark has no tick.
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#pragma once
+
+#include <AzCore/Script/ScriptTimePoint.h>
@@ -0,0 +1,12 @@
+// Minimal stand in for Lumberyard's trace macros, used by the headless benchmark. Messages go to stderr, so the benchmark
+// report on stdout can be piped to a file.
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#pragma once
+
+#include <cstdio>
+
+#define AZ_Printf(window, ...) do { fprintf(stderr, "[%s] ", window); fprintf(stderr, __VA_ARGS__); fprintf(stderr, "\n"); } while (0)
+#define AZ_Warning(window, condition, ...) do { if (!(condition)) { AZ_Printf(window, __VA_ARGS__); } } while (0)
+#define AZ_Error(window, condition, ...) do { if (!(condition)) { AZ_Printf(window, __VA_ARGS__); } } while (0)
+#define AZ_Assert(condition, ...) do { if (!(condition)) { AZ_Printf("Assert", __VA_ARGS__); } } while (0)
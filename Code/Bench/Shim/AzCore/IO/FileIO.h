@@ -0,0 +1,22 @@
+// Minimal stand in for Lumberyard's file IO, used by the headless benchmark. There is no file IO instance, so file names
+// are used as given, without resolving aliases such as @user@.
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#pragma once
+
+#include <cstdint>
+
+namespace AZ
+{
+	namespace IO
+	{
+		class FileIOBase
+		{
+		public:
+
+			static FileIOBase *GetInstance() { return nullptr; };
+
+			bool ResolvePath(const char *, char *, uint64_t) { return false; };
+		};
+	}
+}
@@ -0,0 +1,41 @@
+// Minimal stand in for Lumberyard's AZ::ScriptTimePoint and AZStd::chrono, used by the headless benchmark.
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#pragma once
+
+#include <chrono>
+
+namespace AZStd
+{
+	namespace chrono
+	{
+		using namespace std::chrono;
+	}
+}
+
+namespace AZ
+{
+	class ScriptTimePoint
+	{
+	public:
+
+		ScriptTimePoint() : m_timePoint(std::chrono::system_clock::now()) {};
+		explicit ScriptTimePoint(std::chrono::system_clock::time_point timePoint) : m_timePoint(timePoint) {};
+
+		inline std::chrono::system_clock::time_point Get() const { return m_timePoint; };
+
+		inline double GetMilliseconds() const
+		{
+			return std::chrono::duration<double, std::milli>(m_timePoint.time_since_epoch()).count();
+		};
+
+		inline double GetSeconds() const
+		{
+			return std::chrono::duration<double>(m_timePoint.time_since_epoch()).count();
+		};
+
+	private:
+
+		std::chrono::system_clock::time_point m_timePoint;
+	};
+}
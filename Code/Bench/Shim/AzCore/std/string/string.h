@@ -0,0 +1,57 @@
+// Minimal stand in for Lumberyard's AZStd::string, used by the headless benchmark. Only provides what the PLY query engine
+// uses: a std::string with a printf style format function.
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#pragma once
+
+#include <string>
+#include <cstdarg>
+#include <cstdio>
+#include <functional>
+
+namespace AZStd
+{
+	class string : public std::string
+	{
+	public:
+
+		using std::string::string;
+
+		string() {};
+		string(const std::string &s) : std::string(s) {};
+
+		//Create a string from a printf style format string.
+		static string format(const char *format, ...)
+		{
+			va_list args;
+			va_start(args, format);
+			va_list argsCopy;
+			va_copy(argsCopy, args);
+			int size = vsnprintf(nullptr, 0, format, argsCopy);
+			va_end(argsCopy);
+
+			string out;
+			if (size > 0)
+			{
+				out.resize(static_cast<size_t>(size));
+				vsnprintf(&out[0], out.size() + 1, format, args);
+			}
+			va_end(args);
+
+			return out;
+		};
+
+		friend string operator+(const string &a, const string &b) { return string(static_cast<const std::string &>(a) + static_cast<const std::string &>(b)); };
+		friend string operator+(const string &a, const char *b) { return string(static_cast<const std::string &>(a) + b); };
+		friend string operator+(const char *a, const string &b) { return string(a + static_cast<const std::string &>(b)); };
+		friend string operator+(const string &a, char b) { return string(static_cast<const std::string &>(a) + b); };
+	};
+}
+
+namespace std
+{
+	template<> struct hash<AZStd::string>
+	{
+		size_t operator()(const AZStd::string &s) const { return hash<std::string>()(s); };
+	};
+}
@@ -0,0 +1,30 @@
+// Stand in for the Windows process and thread priority functions, used by the headless benchmark on Linux. Priorities are
+// recorded but not applied, so the query engine's priority checks pass and every thread runs at the normal priority.
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#pragma once
+
+typedef void *HANDLE;
+typedef unsigned long DWORD;
+typedef int BOOL;
+
+#define NORMAL_PRIORITY_CLASS 0x00000020
+#define THREAD_PRIORITY_LOWEST (-2)
+
+namespace PLYBench
+{
+	//Priority class last set by the calling thread. Kept per thread, so threads setting different priorities don't see
+	//each other's.
+	inline DWORD &PriorityClass()
+	{
+		static thread_local DWORD priorityClass = NORMAL_PRIORITY_CLASS;
+		return priorityClass;
+	};
+}
+
+inline HANDLE GetCurrentProcess() { return nullptr; }
+inline HANDLE GetCurrentThread() { return nullptr; }
+inline BOOL SetPriorityClass(HANDLE, DWORD priorityClass) { PLYBench::PriorityClass() = priorityClass; return 1; }
+inline DWORD GetPriorityClass(HANDLE) { return PLYBench::PriorityClass(); }
+inline BOOL SetThreadPriority(HANDLE, int) { return 1; }
+inline DWORD GetLastError() { return 0; }
@@ -10,6 +10,7 @@
 #include <PLY/PLYTools.h>
 #include <PLY/PLYTypes.h>
 #include <PLY/Log.hpp>
+#include <PLY/PLYMutex.hpp>
 
 #define PLYCONF PLY::PLYConfiguration::getInstance()
 
@@ -35,7 +36,7 @@ namespace PLY
 			AZ_Error("PLY", d.reconnectWaitTime >= 0, "Reconnect wait time cannot be less than 0");
 			AZ_Error("PLY", d.port >= 0, "Port number cannot be less than 0");
 			
-			std::unique_lock<std::mutex> lock(m_configMutex);
+			std::unique_lock<PLYMutex> lock(m_configMutex);
 			m_d = d;
 
 			//Update connection string from database connection settings.
@@ -49,7 +50,7 @@ namespace PLY
 			AZ_Error("PLY", qs.queryTTL >= 0, "Query TTL cannot be less than 0");
 			AZ_Error("PLY", qs.resultTTL >= 0, "Result TTL cannot be less than 0");
 
-			std::unique_lock<std::mutex> lock(m_configMutex);
+			std::unique_lock<PLYMutex> lock(m_configMutex);
 			m_qs = qs;
 		};
 
@@ -68,43 +69,150 @@ namespace PLY
 				std::swap(p.minPoolSize, p.maxPoolSize);
 			}
 
-			std::unique_lock<std::mutex> lock(m_configMutex);
+			std::unique_lock<PLYMutex> lock(m_configMutex);
 			m_p = p;
 		};
 
+		//Set automatic object and database synchronisation settings.
+		//@param os The object synchronisation settings.
+		void SetObjectSyncSettings(ObjectSyncSettings os)
+		{
+			AZ_Error("PLY", os.saveBatchWindow >= 0, "Save batch window cannot be less than 0");
+			AZ_Error("PLY", os.maxSaveBatchSize >= 1, "Maximum save batch size cannot be less than 1");
+			AZ_Error("PLY", os.maxLoadBatchSize >= 1, "Maximum load batch size cannot be less than 1");
+			AZ_Error("PLY", os.maxAppliesPerFrame >= 0, "Maximum applies per frame cannot be less than 0");
+			AZ_Error("PLY", os.saveJitter >= 0 && os.saveJitter <= 100, "Save jitter must be between 0 and 100");
+			AZ_Error("PLY", os.saveLatencyTarget >= 0, "Save latency target cannot be less than 0");
+			AZ_Error("PLY", os.maxSaveIntervalScale >= 1, "Maximum save interval scale cannot be less than 1");
+			AZ_Error("PLY", os.refreshInterval >= 0, "Refresh interval cannot be less than 0");
+			AZ_Error("PLY", os.refreshOverlap >= 0, "Refresh overlap cannot be less than 0");
+			AZ_Error("PLY", os.streamingCellSize > 0, "Streaming cell size must be greater than 0");
+			AZ_Error("PLY", os.streamingRadius >= 0, "Streaming radius cannot be less than 0");
+			AZ_Error("PLY", os.streamingPrefetchTime >= 0, "Streaming prefetch time cannot be less than 0");
+			AZ_Error("PLY", os.maxStreamedCells >= 1, "Maximum streamed cells cannot be less than 1");
+			AZ_Error("PLY", !os.journalEnabled || os.journalFileName != "", "Journal file name cannot be blank");
+			AZ_Error("PLY", os.journalSizeMB >= 1, "Journal size cannot be less than 1");
+			AZ_Error("PLY", os.journalFlushInterval >= 1, "Journal flush interval cannot be less than 1");
+
+			std::unique_lock<PLYMutex> lock(m_configMutex);
+			m_os = os;
+		};
+
+		//Set metrics export settings. Takes effect the next time the query worker pool is initialised.
+		//@param ms The metrics export settings.
+		void SetMetricsSettings(MetricsSettings ms)
+		{
+			AZ_Error("PLY", ms.exportInterval >= 100, "Metrics export interval cannot be less than 100");
+			AZ_Error("PLY", ms.exportMode != MetricsSettings::TEXT_FILE || ms.fileName != "", "Metrics file name cannot be blank");
+			AZ_Error("PLY", ms.fileHistory >= 0, "Metrics file history cannot be less than 0");
+			AZ_Error("PLY", ms.httpPort >= 1 && ms.httpPort <= 65535, "Metrics port must be between 1 and 65535");
+
+			std::unique_lock<PLYMutex> lock(m_configMutex);
+			m_ms = ms;
+		};
+
+		//Set query timeline trace settings.
+		//@param ts The trace settings.
+		void SetTraceSettings(TraceSettings ts)
+		{
+			AZ_Error("PLY", ts.fileName != "", "Trace file name cannot be blank");
+			AZ_Error("PLY", ts.slowFrameThreshold >= 0, "Trace slow frame threshold cannot be less than 0");
+
+			std::unique_lock<PLYMutex> lock(m_configMutex);
+			m_ts = ts;
+		};
+
+		//Set main thread frame cost profiling settings.
+		//@param fs The frame profiling settings.
+		void SetFrameSettings(FrameSettings fs)
+		{
+			AZ_Error("PLY", fs.budget >= 0, "Frame budget cannot be less than 0");
+			AZ_Error("PLY", fs.window > 0, "Frame profiling window must be greater than 0");
+
+			std::unique_lock<PLYMutex> lock(m_configMutex);
+			m_fs = fs;
+		};
+
+		//Set slow query log settings. Takes effect the next time the query worker pool is initialised.
+		//@param sq The slow query log settings.
+		void SetSlowQuerySettings(SlowQuerySettings sq)
+		{
+			AZ_Error("PLY", sq.threshold >= 0, "Slow query threshold cannot be less than 0");
+			AZ_Error("PLY", sq.threshold == 0 || sq.fileName != "", "Slow query log file name cannot be blank");
+			AZ_Error("PLY", sq.explainInterval >= 0, "Slow query explain interval cannot be less than 0");
+
+			std::unique_lock<PLYMutex> lock(m_configMutex);
+			m_sq = sq;
+		};
+
 		//Set log level.
 		//@param logLevel The chosen log level.
 		void SetLogLevel(Log::LogLevel logLevel)
 		{
-			std::unique_lock<std::mutex> lock(m_configMutex);
+			std::unique_lock<PLYMutex> lock(m_configMutex);
 			m_logLevel = logLevel;
 		};
 
 		//Get current database connection details.
 		DatabaseConnectionDetails GetDatabaseConnectionDetails()
 		{
-			std::unique_lock<std::mutex> lock(m_configMutex);
+			std::unique_lock<PLYMutex> lock(m_configMutex);
 			return m_d;
 		};
 
 		//Get current default query settings.
 		QuerySettings GetQuerySettings()
 		{
-			std::unique_lock<std::mutex> lock(m_configMutex);
+			std::unique_lock<PLYMutex> lock(m_configMutex);
 			return m_qs;
 		};
 
 		//Get current query worker pool settings.
 		PoolSettings GetPoolSettings()
 		{
-			std::unique_lock<std::mutex> lock(m_configMutex);
+			std::unique_lock<PLYMutex> lock(m_configMutex);
 			return m_p;
 		};
 
+		//Get current automatic object and database synchronisation settings.
+		ObjectSyncSettings GetObjectSyncSettings()
+		{
+			std::unique_lock<PLYMutex> lock(m_configMutex);
+			return m_os;
+		};
+
+		//Get current metrics export settings.
+		MetricsSettings GetMetricsSettings()
+		{
+			std::unique_lock<PLYMutex> lock(m_configMutex);
+			return m_ms;
+		};
+
+		//Get current query timeline trace settings.
+		TraceSettings GetTraceSettings()
+		{
+			std::unique_lock<PLYMutex> lock(m_configMutex);
+			return m_ts;
+		};
+
+		//Get current main thread frame cost profiling settings.
+		FrameSettings GetFrameSettings()
+		{
+			std::unique_lock<PLYMutex> lock(m_configMutex);
+			return m_fs;
+		};
+
+		//Get current slow query log settings.
+		SlowQuerySettings GetSlowQuerySettings()
+		{
+			std::unique_lock<PLYMutex> lock(m_configMutex);
+			return m_sq;
+		};
+
 		//Get current log level.
 		Log::LogLevel GetLogLevel()
 		{
-			std::unique_lock<std::mutex> lock(m_configMutex);
+			std::unique_lock<PLYMutex> lock(m_configMutex);
 			return m_logLevel;
 		};
 
@@ -113,14 +221,14 @@ namespace PLY
 		//See https://www.postgresql.org/docs/11/libpq-connect.html
 		AZStd::string GetConnectionString()
 		{
-			std::unique_lock<std::mutex> lock(m_configMutex);
+			std::unique_lock<PLYMutex> lock(m_configMutex);
 			return m_connectionString;
 		};
 
 	private:
 
 		//Mutex used to lock the config class during changes.
-		std::mutex m_configMutex;
+		PLYMutex m_configMutex;
 
 		//Database connection detail settings.
 		DatabaseConnectionDetails m_d;
@@ -131,6 +239,21 @@ namespace PLY
 		//Query worker pool settings.
 		PoolSettings m_p;
 
+		//Automatic object and database synchronisation settings.
+		ObjectSyncSettings m_os;
+
+		//Metrics export settings.
+		MetricsSettings m_ms;
+
+		//Query timeline trace settings.
+		TraceSettings m_ts;
+
+		//Main thread frame cost profiling settings.
+		FrameSettings m_fs;
+
+		//Slow query log settings.
+		SlowQuerySettings m_sq;
+
 		//Log level.
 		Log::LogLevel m_logLevel;
 
@@ -139,7 +262,7 @@ namespace PLY
 		//See https://www.postgresql.org/docs/11/libpq-connect.html
 		AZStd::string m_connectionString;
 
-		PLYConfiguration() : m_logLevel(Log::LogLevel::PLY_ERROR) {};
+		PLYConfiguration() : m_configMutex("config"), m_logLevel(Log::LogLevel::PLY_ERROR) {};
 		~PLYConfiguration() {};
 
 		//Set the internally stored database connection string based on current database connection detail settings.
@@ -149,7 +272,7 @@ namespace PLY
 			//Operate on a copy of the connection details struct for regex replacements.
 			DatabaseConnectionDetails d = m_d;
 
-			//Replace all \ characters with \\
+			//Replace all \ characters with \\.
 			//Replace all ' characters with \'
 			d.host = (std::regex_replace(m_d.host.c_str(), std::regex("\\\\"), "\\\\")).c_str();
 			d.host = (std::regex_replace(m_d.host.c_str(), std::regex("'"), "\\'")).c_str();
@@ -0,0 +1,56 @@
+// Named mutex used for PLY's internal locks. When the gem is built with PLY_LOCK_PROFILING defined, each lock records
+// how often it is taken, how often it had to wait, and how long it waited for and was held, so lock contention can be
+// measured. Otherwise it is a plain std::mutex, and the name is ignored.
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#pragma once
+
+#include <mutex>
+
+#ifdef PLY_LOCK_PROFILING
+#include <chrono>
+#endif
+
+namespace PLY
+{
+#ifdef PLY_LOCK_PROFILING
+
+	class PLYMutex
+	{
+	public:
+
+		//@param name The lock's name in lock statistics. Mutexes with the same name share statistics.
+		explicit PLYMutex(const char *name);
+		~PLYMutex();
+
+		PLYMutex(const PLYMutex &) = delete;
+		PLYMutex &operator=(const PLYMutex &) = delete;
+
+		void lock();
+		bool try_lock();
+		void unlock();
+
+	private:
+
+		std::mutex m_mutex;
+
+		//Index of this lock's statistics in the lock profiler.
+		int m_lockID;
+
+		//Time the lock was acquired. Only used by the thread holding the lock.
+		std::chrono::steady_clock::time_point m_acquired;
+	};
+
+#else
+
+	class PLYMutex : public std::mutex
+	{
+	public:
+
+		//The lock's name is not used without lock profiling.
+		explicit PLYMutex(const char *) {};
+		~PLYMutex() {};
+	};
+
+#endif
+}
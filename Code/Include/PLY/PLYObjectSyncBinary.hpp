@@ -0,0 +1,158 @@
+// Compact binary object state format for automatic object and database synchronisation, as an alternative to JSON strings.
+// A blob is a fixed size header followed by the serialised object state:
+//   4 bytes  Magic "PLYB"
+//   2 bytes  Schema version (unsigned, little endian)
+//   4 bytes  Payload length in bytes (unsigned, little endian)
+//   N bytes  Payload
+// Objects serialise themselves with the Lumberyard SerializeContext, so any reflected class can be stored.
+// Implemeted as a self-contained HPP file so it can be included and called from external projects.
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+#include <AzCore/Serialization/SerializeContext.h>
+#include <AzCore/Serialization/Utils.h>
+#include <AzCore/Component/ComponentApplicationBus.h>
+#include <AzCore/IO/ByteContainerStream.h>
+
+namespace PLY
+{
+	class PLYObjectSyncBinary
+	{
+	public:
+
+		//Size of the blob header, in bytes.
+		static const size_t HEADER_SIZE = 10;
+
+		//Wrap a payload in a blob header.
+		//@param schemaVersion The version of the object layout stored in the payload.
+		//@param payload The serialised object state.
+		//@param length The payload length, in bytes.
+		//@return The blob.
+		static std::string Pack(const uint16_t schemaVersion, const char *payload, const size_t length)
+		{
+			std::string blob;
+			blob.reserve(HEADER_SIZE + length);
+
+			blob.append("PLYB", 4);
+			blob.push_back(static_cast<char>(schemaVersion & 0xFF));
+			blob.push_back(static_cast<char>((schemaVersion >> 8) & 0xFF));
+
+			uint32_t l = static_cast<uint32_t>(length);
+			for (int i = 0; i < 4; ++i) blob.push_back(static_cast<char>((l >> (i * 8)) & 0xFF));
+
+			blob.append(payload, length);
+
+			return blob;
+		};
+
+		//Read the header of a blob.
+		//@param blob The blob.
+		//@param schemaVersion Set to the version of the object layout stored in the payload.
+		//@param payload Set to the start of the payload within the blob.
+		//@param length Set to the payload length, in bytes.
+		//@return True if the blob has a valid header and its length matches.
+		static bool Unpack(const std::string &blob, uint16_t &schemaVersion, const char *&payload, size_t &length)
+		{
+			if (blob.size() < HEADER_SIZE || blob.compare(0, 4, "PLYB") != 0) return false;
+
+			const unsigned char *h = reinterpret_cast<const unsigned char *>(blob.data());
+
+			schemaVersion = static_cast<uint16_t>(h[4] | (h[5] << 8));
+
+			uint32_t l = 0;
+			for (int i = 0; i < 4; ++i) l |= static_cast<uint32_t>(h[6 + i]) << (i * 8);
+
+			if (blob.size() != HEADER_SIZE + l) return false;
+
+			payload = blob.data() + HEADER_SIZE;
+			length = l;
+
+			return true;
+		};
+
+		//Does a blob have a valid header?
+		//@param blob The blob.
+		static bool IsValid(const std::string &blob)
+		{
+			uint16_t schemaVersion = 0;
+			const char *payload = nullptr;
+			size_t length = 0;
+			return Unpack(blob, schemaVersion, payload, length);
+		};
+
+		//Serialise an object to a blob. The object's class must be reflected to the SerializeContext.
+		//@param object The object to serialise.
+		//@param schemaVersion The version of the object layout, stored in the blob header.
+		//@return The blob, or a blank string if the object could not be serialised.
+		template<typename T>
+		static std::string Serialize(const T &object, const uint16_t schemaVersion)
+		{
+			AZ::SerializeContext *serializeContext = GetSerializeContext();
+			if (serializeContext == nullptr) return "";
+
+			AZStd::vector<char> buffer;
+			AZ::IO::ByteContainerStream<AZStd::vector<char>> stream(&buffer);
+
+			if (!AZ::Utils::SaveObjectToStream(stream, AZ::DataStream::ST_BINARY, &object, serializeContext))
+			{
+				AZ_Error("PLY", false, "Couldn't serialise object to binary blob.");
+				return "";
+			}
+
+			return Pack(schemaVersion, buffer.data(), buffer.size());
+		};
+
+		//Deserialise a blob into an existing object. The object's class must be reflected to the SerializeContext.
+		//@param blob The blob.
+		//@param object The object to load into.
+		//@param expectedSchemaVersion The version of the object layout the caller understands. Blobs written with another
+		//version are rejected, so the caller can migrate them using Unpack.
+		//@return True if the object was loaded.
+		template<typename T>
+		static bool Deserialize(const std::string &blob, T &object, const uint16_t expectedSchemaVersion)
+		{
+			uint16_t schemaVersion = 0;
+			const char *payload = nullptr;
+			size_t length = 0;
+
+			if (!Unpack(blob, schemaVersion, payload, length))
+			{
+				AZ_Error("PLY", false, "Binary blob header is invalid.");
+				return false;
+			}
+
+			if (schemaVersion != expectedSchemaVersion)
+			{
+				AZ_Warning("PLY", false, "Binary blob schema version %u does not match expected version %u.",
+					static_cast<unsigned int>(schemaVersion), static_cast<unsigned int>(expectedSchemaVersion));
+				return false;
+			}
+
+			AZ::SerializeContext *serializeContext = GetSerializeContext();
+			if (serializeContext == nullptr) return false;
+
+			if (!AZ::Utils::LoadObjectFromBufferInPlace(payload, length, object, serializeContext))
+			{
+				AZ_Error("PLY", false, "Couldn't deserialise object from binary blob.");
+				return false;
+			}
+
+			return true;
+		};
+
+	private:
+
+		//Get the application's SerializeContext.
+		static AZ::SerializeContext *GetSerializeContext()
+		{
+			AZ::SerializeContext *serializeContext = nullptr;
+			AZ::ComponentApplicationBus::BroadcastResult(serializeContext, &AZ::ComponentApplicationRequests::GetSerializeContext);
+			AZ_Error("PLY", serializeContext != nullptr, "SerializeContext is not available.");
+			return serializeContext;
+		};
+	};
+}
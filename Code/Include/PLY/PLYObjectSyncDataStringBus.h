@@ -7,8 +7,24 @@
 
 #include <AzCore/EBus/EBus.h>
 
+#include <memory>
+#include <functional>
+
 namespace PLY
 {
+	//Ready-to-apply object state, decoded from loaded data on a query worker thread. Derive from this class to hold the
+	//decoded state of your objects.
+	class PLYObjectSyncDecodedState
+	{
+	public:
+		virtual ~PLYObjectSyncDecodedState() {};
+	};
+
+	//Decodes loaded object data into a ready-to-apply state on a query worker thread. Must be thread safe, and must not
+	//touch entities or components. Receives the JSON string, or the binary blob for objects using the BINARY data format.
+	//Returns null if the data could not be decoded, in which case the data is applied on the main thread as usual.
+	using PLYObjectSyncDecoder = std::function<std::shared_ptr<PLYObjectSyncDecodedState>(const std::string &data)>;
+
 	class PLYObjectSyncDataString
 		: public AZ::ComponentBus
 	{
@@ -29,6 +45,20 @@ namespace PLY
 
 		//Reset the object to its starting state.
 		virtual void Reset() = 0;
+
+		//Update the object's state from a binary blob. Only called for objects using the BINARY data format.
+		//See PLYObjectSyncBinary.hpp for deserialising blobs with the SerializeContext.
+		//@param dataBlob The blob to parse.
+		virtual void SetPropertiesFromDataBlob(std::string dataBlob) { AZ_UNUSED(dataBlob); };
+
+		//Create a binary blob from the object's state. Only called for objects using the BINARY data format.
+		//See PLYObjectSyncBinary.hpp for serialising objects with the SerializeContext.
+		virtual std::string GetDataBlob() { return ""; };
+
+		//Update the object's state from state decoded off the main thread. Only called for objects whose table has a decoder
+		//registered on PLYObjectSyncSystemBus. This should be cheap, as the expensive decoding has already been done.
+		//@param state The decoded state, as returned by the table's decoder.
+		virtual void ApplyDecodedState(std::shared_ptr<PLYObjectSyncDecodedState> state) { AZ_UNUSED(state); };
 	};
 	using PLYObjectSyncDataStringBus = AZ::EBus<PLYObjectSyncDataString>;
 } // namespace PLY
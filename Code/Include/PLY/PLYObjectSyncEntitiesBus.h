@@ -1,4 +1,6 @@
 // EBusTraits bus for communicating with all entities in the scene that are enabled for automatic object and database synchronisation.
+// Enumerating entities with this bus returns one result per handler. Prefer the registry methods on PLYObjectSyncSystemBus
+// (GetAllObjectIDs, GetAllEntityIDs, SaveAllEntities, LoadAllEntities, ResetAllEntities), which return whole lists in one call.
 // @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
 
 #pragma once
@@ -0,0 +1,35 @@
+// Component notification bus for the outcome of saves and loads of entities enabled for automatic object and database
+// synchronisation. Any number of handlers can connect to an entity's ID to be told when its state has been saved or loaded.
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#pragma once
+
+#include <AzCore/EBus/EBus.h>
+
+#include <string>
+
+namespace PLY
+{
+	class PLYObjectSyncNotifications
+		: public AZ::ComponentBus
+	{
+	public:
+
+		//////////////////////////////////////////////////////////////////////////
+		// EBusTraits overrides
+		static const AZ::EBusHandlerPolicy HandlerPolicy = AZ::EBusHandlerPolicy::Multiple;
+		//////////////////////////////////////////////////////////////////////////
+
+		//Called when a queued save of the object state has been written to the database, or has failed.
+		//@param success Was the object state saved successfully?
+		virtual void SaveFinished(bool /*success*/) {};
+
+		//Called when the object state has been read from the database, or the load has failed. This includes loads by the
+		//object sync system itself, such as streaming and refreshes. The state is applied to the object on the next frame.
+		//@param success Was the load query successful?
+		//@param dataString The data string read from the database. Blank if no data has been saved for the object yet, or if the
+		//row was decoded by the table's decoder.
+		virtual void LoadFinished(bool /*success*/, std::string /*dataString*/) {};
+	};
+	using PLYObjectSyncNotificationBus = AZ::EBus<PLYObjectSyncNotifications>;
+} // namespace PLY
@@ -1,4 +1,5 @@
 // Component bus for trigger save and load methods for entities enabled for automatic object and database synchronisation.
+// The outcome of saves and loads is sent on PLYObjectSyncNotificationBus.
 // @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
 
 #pragma once
@@ -12,19 +13,31 @@ namespace PLY
 	{
 	public:
 
+		//Format of the serialised object data stored in the database.
+		enum DataFormat
+		{
+			JSON_TEXT, //JSON string from PLYObjectSyncDataStringBus GetDataString, stored in a TEXT column.
+			BINARY //Binary blob from PLYObjectSyncDataStringBus GetDataBlob, stored in a BYTEA column. See PLYObjectSyncBinary.hpp.
+		};
+
 		//Database configuration details.
 		class DataBaseDetails
 		{
 		public:
-			DataBaseDetails() {};
-			DataBaseDetails(AZStd::string n_tableName, AZStd::string n_IDColumnName, AZStd::string n_dataColumnName) :
-				tableName(n_tableName), IDColumnName(n_IDColumnName), dataColumnName(n_dataColumnName) {};
+			DataBaseDetails() : dataFormat(JSON_TEXT) {};
+			DataBaseDetails(AZStd::string n_tableName, AZStd::string n_IDColumnName, AZStd::string n_dataColumnName,
+				DataFormat n_dataFormat = JSON_TEXT, AZStd::string n_positionColumnName = "", AZStd::string n_updatedAtColumnName = "") :
+				tableName(n_tableName), IDColumnName(n_IDColumnName), dataColumnName(n_dataColumnName), dataFormat(n_dataFormat),
+				positionColumnName(n_positionColumnName), updatedAtColumnName(n_updatedAtColumnName) {};
 			~DataBaseDetails() {};
 
 			//Table and column names to use for object data storage and retrieval.
 			AZStd::string tableName; //The table in which object data is stored.
 			AZStd::string IDColumnName; //Unique ID column. Must be an INT and the PRIMARY KEY so as not to allow duplicates.
-			AZStd::string dataColumnName; //The column in which serialised JSON data for the object is stored. Must be of TEXT type.
+			AZStd::string dataColumnName; //The column in which serialised data for the object is stored. TEXT for JSON_TEXT, BYTEA for BINARY.
+			DataFormat dataFormat; //Format of the serialised object data.
+			AZStd::string positionColumnName; //PostGIS GEOMETRY column holding the object's world position. Only used by streamed objects.
+			AZStd::string updatedAtColumnName; //TIMESTAMPTZ column set to the time of each save. Used to refresh changed objects. Blank uses xmin instead.
 		};
 
 		//Save object state to database.
@@ -34,6 +47,10 @@ namespace PLY
 		//@param dataString The data string to save to the database.
 		virtual void Save(std::string dataString) = 0;
 
+		//Flag the object state as changed since it was last saved. Objects that use "Save Only When Dirty" are only saved
+		//automatically after this has been called.
+		virtual void MarkDirty() = 0;
+
 		//Load object state from the database.
 		virtual void Load() = 0;
 
@@ -0,0 +1,144 @@
+// EBusTraits bus for the central object sync system. Entities enabled for automatic object and database synchronisation
+// register with this system, which updates all of them in a single pass each frame, and batches their save and load work
+// into as few database queries as possible.
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#pragma once
+
+#include <AzCore/EBus/EBus.h>
+#include <AzCore/Component/EntityId.h>
+#include <AzCore/Math/Vector3.h>
+
+#include <PLY/PLYObjectSyncSaveLoadBus.h>
+#include <PLY/PLYObjectSyncDataStringBus.h>
+
+namespace PLY
+{
+	class PLYObjectSyncSystem
+		: public AZ::EBusTraits
+	{
+	public:
+		//////////////////////////////////////////////////////////////////////////
+		// EBusTraits overrides
+		static const AZ::EBusHandlerPolicy HandlerPolicy = AZ::EBusHandlerPolicy::Single;
+		static const AZ::EBusAddressPolicy AddressPolicy = AZ::EBusAddressPolicy::Single;
+		//////////////////////////////////////////////////////////////////////////
+
+		//Synchronisation settings for a registered entity.
+		class EntitySettings
+		{
+		public:
+			EntitySettings() :
+				objectID(0),
+				syncOnLoad(true),
+				autoSave(false),
+				saveIntervalMS(1000),
+				saveOnlyWhenDirty(false),
+				streamed(false)
+			{};
+			~EntitySettings() {};
+
+			//Unique object ID.
+			int objectID;
+			//Table and column names to use for object data storage and retrieval.
+			PLYObjectSyncSaveLoad::DataBaseDetails details;
+			//Should the object load its data from the database on start? Only applies if autoSave is set.
+			bool syncOnLoad;
+			//Should the object be saved automatically at a set interval?
+			bool autoSave;
+			//Automatic save interval, in milliseconds. 0 disables automatic saving.
+			int saveIntervalMS;
+			//Should automatic saves only happen after the object has been marked dirty?
+			bool saveOnlyWhenDirty;
+			//Should the object's state be streamed in and out by region around the focus points, instead of loaded on start?
+			//Requires details.positionColumnName to be set.
+			bool streamed;
+		};
+
+		//Register an entity for automatic object and database synchronisation.
+		//@param entityID The entity to register.
+		//@param settings The entity's synchronisation settings.
+		virtual void RegisterEntity(const AZ::EntityId entityID, const EntitySettings settings) = 0;
+
+		//Remove an entity from automatic object and database synchronisation.
+		//@param entityID The entity to remove.
+		virtual void UnregisterEntity(const AZ::EntityId entityID) = 0;
+
+		//Change the unique database ID of a registered entity's object.
+		//@param entityID The registered entity.
+		//@param objectID The new object ID.
+		virtual void SetEntityObjectID(const AZ::EntityId entityID, const int objectID) = 0;
+
+		//Serialise a registered entity's object state via PLYObjectSyncDataStringBus and queue it to be saved.
+		//@param entityID The registered entity.
+		virtual void SaveEntity(const AZ::EntityId entityID) = 0;
+
+		//Queue a data string to be saved for a registered entity's object. Pending saves that share a table, ID column and
+		//data column are written to the database together as one multi-row UPSERT.
+		//@param entityID The registered entity.
+		//@param dataString The data string to save to the database.
+		virtual void SaveEntityDataString(const AZ::EntityId entityID, const std::string dataString) = 0;
+
+		//Queue a registered entity's object state to be loaded. Pending loads that share a table, ID column and data column are
+		//read from the database together, at most "maxLoadBatchSize" objects per query.
+		//@param entityID The registered entity.
+		virtual void LoadEntity(const AZ::EntityId entityID) = 0;
+
+		//Flag a registered entity's object state as changed since it was last saved.
+		//@param entityID The registered entity.
+		virtual void MarkEntityDirty(const AZ::EntityId entityID) = 0;
+
+		//Write all pending saves to the database immediately, without waiting for the save batch window to end.
+		virtual void FlushSaves() = 0;
+
+		//Set the position of a focus point, such as a player or camera, adding it if it doesn't exist. Streamed objects are
+		//loaded for grid cells around each focus point and along its direction of movement, and evicted once far away.
+		//Call this every frame for moving focus points.
+		//@param focusID Unique ID of the focus point.
+		//@param position The focus point's world position.
+		virtual void SetFocusPoint(const int focusID, const AZ::Vector3 position) = 0;
+
+		//Remove a focus point.
+		//@param focusID Unique ID of the focus point.
+		virtual void RemoveFocusPoint(const int focusID) = 0;
+
+		//Get the unique database IDs of all registered entities' objects, in registration order. Returned in one call, rather
+		//than one bus result per entity as with PLYObjectSyncEntitiesBus.
+		virtual std::vector<int> GetAllObjectIDs() = 0;
+
+		//Get all registered entities, in the same order as GetAllObjectIDs.
+		virtual std::vector<AZ::EntityId> GetAllEntityIDs() = 0;
+
+		//Get pairs of entity ID and object ID for all registered entities.
+		virtual std::vector<std::pair<AZ::EntityId, int>> GetAllEntityIDandObjectIDs() = 0;
+
+		//Get the unique database ID of a registered entity's object.
+		//@param entityID The registered entity.
+		//@return The object ID, or 0 if the entity is not registered.
+		virtual int GetEntityObjectID(const AZ::EntityId entityID) = 0;
+
+		//Get the registered entities that use an object ID.
+		//@param objectID The object ID.
+		virtual std::vector<AZ::EntityId> GetEntitiesForObjectID(const int objectID) = 0;
+
+		//Queue every registered entity's object state to be saved. Saves are batched as for SaveEntity.
+		virtual void SaveAllEntities() = 0;
+
+		//Queue every registered entity's object state to be loaded. Loads are batched as for LoadEntity.
+		virtual void LoadAllEntities() = 0;
+
+		//Reset the state of every registered entity's object via PLYObjectSyncDataStringBus.
+		virtual void ResetAllEntities() = 0;
+
+		//Register a decoder for objects loaded from a table. Loaded rows are then decoded on the query worker thread, and
+		//handed to each entity via PLYObjectSyncDataStringBus ApplyDecodedState, instead of being parsed on the main thread.
+		//@param tableName The table the decoder applies to.
+		//@param decoder The decoder. Must be thread safe.
+		virtual void RegisterDecoder(const AZStd::string tableName, const PLYObjectSyncDecoder decoder) = 0;
+
+		//Remove the decoder registered for a table.
+		//@param tableName The table.
+		virtual void UnregisterDecoder(const AZStd::string tableName) = 0;
+	};
+	using PLYObjectSyncSystemBus = AZ::EBus<PLYObjectSyncSystem>;
+} // namespace PLY
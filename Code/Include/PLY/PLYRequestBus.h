@@ -47,6 +47,15 @@ namespace PLY
 		//@param qs The query settings.
 		virtual unsigned long long SendQueryWithOptions(const AZStd::string query, const PLY::QuerySettings qs) = 0;
 
+		//Add a query with binary parameters to the query queue, using custom query options. Each parameter is bound to a
+		//placeholder $1, $2... in the query string and sent in binary format, so binary data such as bytea values needs no
+		//escaping. If the query worker pool is initilised, it will be processed as soon as possible.
+		//@param query The SQL string to use for the query.
+		//@param binaryParams The parameter values, in placeholder order.
+		//@param qs The query settings.
+		virtual unsigned long long SendQueryWithBinaryParams(const AZStd::string query, const std::vector<std::string> binaryParams,
+			const PLY::QuerySettings qs) = 0;
+
 		//Get a query result set from the results queue based on a query ID.
 		//@param queryID The ID of the query used to create the results set.
 		virtual std::shared_ptr<PLY::PLYResult> GetResult(const unsigned long long queryID) = 0;
@@ -64,12 +73,35 @@ namespace PLY
 		//Star a benchmark sequence of multiple test runs using the GAIA STARS dataset.
 		virtual void StartBenchmarkStarsSequence() = 0;
 
+		//Start a benchmark comparing the JSON text and binary object sync data formats.
+		virtual void StartBenchmarkObjectSync() = 0;
+
 		//Stop the benchmark currently in progress.
 		virtual void StopBenchmark() = 0;
 
+		//Start a benchmark run from a benchmark scenario file.
+		//@param fileName The scenario file name. May use file IO aliases such as @user@.
+		virtual void StartBenchmarkScenarios(const AZStd::string &fileName) = 0;
+
 		//Set the number of passes to use for the benchmark process.
-		//@param passes The number of benchmark passes.
+		//@param passes The number of benchmark passes. 0 = use the passes set by each benchmark scenario.
 		virtual void SetBenchmarkPasses(int passes) = 0;
+
+		//Get a snapshot of query latency statistics, for each phase of query processing.
+		virtual PLY::PLYLatencyStats GetLatencyStats() = 0;
+
+		//Reset query latency statistics.
+		virtual void ResetLatencyStats() = 0;
+
+		//Get a snapshot of query counters, such as queries sent, queue depth, connections and errors.
+		virtual PLY::PLYQueryCounters GetQueryCounters() = 0;
+
+		//Get per statement statistics for each query fingerprint, sorted by total time, highest first.
+		//@param limit The most statements to return. 0 = all.
+		virtual std::vector<PLY::PLYStatementStats> GetStatementStats(int limit) = 0;
+
+		//Reset per statement statistics.
+		virtual void ResetStatementStats() = 0;
 	};
 	using PLYRequestBus = AZ::EBus<PLYRequests>;
 } // namespace PLY
@@ -8,12 +8,17 @@
 #include <pqxx/pqxx>
 #endif
 
+#include <functional>
+#include <atomic>
+
 #include <AzCore/std/string/string.h>
 
 #include <AzCore/Script/ScriptTimePoint.h>
 
 namespace PLY
 {
+	//Forward declarations.
+	struct PLYResult;
 
 	//Database connection details.
 	struct DatabaseConnectionDetails
@@ -53,7 +58,9 @@ namespace PLY
 			advertiseResult(true),
 			queryTTL(0), //Milliseconds. 0 means no TTL is enforced.
 			resultTTL(0), //Milliseconds. 0 means no TTL is enforced.
-			useTransaction(true)
+			useTransaction(true),
+			coalesceKey(""), //Blank means the query is never coalesced.
+			resultProcessor(nullptr) //Null means results are not processed by the worker.
 		{};
 		~QuerySettings() {};
 		
@@ -65,6 +72,14 @@ namespace PLY
 		int resultTTL;
 		//Use automatic transaction block for this query?
 		bool useTransaction;
+		//Coalescing key for latest-wins writes. A query sent with a non-blank key replaces any query with the same key that is
+		//still waiting in the query queue and has not yet been given to a worker, and takes its place in the queue. The replaced
+		//query's ID then resolves to the result of the query that replaced it. Blank means the query is never coalesced.
+		AZStd::string coalesceKey;
+		//Function run by the query worker thread on a successful result, before it is added to the results queue.
+		//Used to move expensive result processing, such as decoding rows, off the main thread. It must be thread safe, and
+		//may store its output in the result's processedData. Null means results are not processed by the worker.
+		std::function<void(PLYResult &result)> resultProcessor;
 	};
 
 	//Query worker pool settings.
@@ -102,6 +117,169 @@ namespace PLY
 		Priority workerPriority;
 	};
 
+	//Automatic object and database synchronisation settings.
+	struct ObjectSyncSettings
+	{
+	public:
+
+		ObjectSyncSettings() :
+			saveBatchWindow(0), //Milliseconds. 0 means pending saves are written once per frame.
+			maxSaveBatchSize(500),
+			maxLoadBatchSize(1000),
+			maxAppliesPerFrame(0), //0 means all loaded objects are applied in the frame they arrive.
+			saveJitter(10), //Percent.
+			saveLatencyTarget(250), //Milliseconds. 0 disables adaptive save intervals.
+			maxSaveIntervalScale(4.0f),
+			refreshInterval(0), //Milliseconds. 0 disables refresh.
+			refreshOverlap(1000), //Milliseconds.
+			streamingCellSize(100.0f), //World units.
+			streamingRadius(1),
+			streamingPrefetchTime(2.0f), //Seconds.
+			maxStreamedCells(64),
+			journalEnabled(false),
+			journalFileName("@user@/ply_journal.bin"),
+			journalSizeMB(16),
+			journalFlushInterval(100) //Milliseconds.
+		{};
+		~ObjectSyncSettings() {};
+
+		//Time (milliseconds) to collect pending object saves before writing them to the database as a batch.
+		//0 means pending saves are written once per frame.
+		int saveBatchWindow;
+		//Maximum number of objects to write in a single batched save query.
+		int maxSaveBatchSize;
+		//Maximum number of objects to read in a single batched load query.
+		int maxLoadBatchSize;
+		//Maximum number of loaded objects to apply to their entities each frame. Objects over the limit are applied in later frames.
+		//0 means all loaded objects are applied in the frame they arrive.
+		int maxAppliesPerFrame;
+		//Random variation applied to each automatic save interval, as a percentage of the interval. Stops entities with the
+		//same interval from drifting into step and saving in the same frame.
+		int saveJitter;
+		//Time (milliseconds) save queries should take to complete. While saves take longer, automatic save intervals are
+		//stretched, up to maxSaveIntervalScale times, so the load on the database stays flat. 0 disables adaptive intervals.
+		int saveLatencyTarget;
+		//Maximum multiplier applied to automatic save intervals while saves are slower than saveLatencyTarget.
+		float maxSaveIntervalScale;
+		//Time (milliseconds) between refreshes of objects changed in the database by other processes. Each refresh only
+		//fetches the rows changed since the last one. 0 disables refresh.
+		int refreshInterval;
+		//Time (milliseconds) before the last refresh to fetch again from tables with an updated at column, to catch saves
+		//that committed out of order.
+		int refreshOverlap;
+		//Width of the square grid cells streamed objects are loaded and evicted in, in world units.
+		float streamingCellSize;
+		//Number of cells loaded in each direction around a focus point. 1 loads a 3x3 block of cells.
+		int streamingRadius;
+		//How far ahead to prefetch cells along a focus point's direction of movement, in seconds of movement. 0 disables prefetching.
+		float streamingPrefetchTime;
+		//Maximum number of cells to keep loaded. Cells beyond the cap are evicted, least recently needed first, once they are
+		//no longer near a focus point. The cap is a cell count rather than a memory size, as PLY can't see how much memory an
+		//object's applied state takes. Memory use is roughly the cap times the objects per cell times the size of their state.
+		int maxStreamedCells;
+		//Should saves be written to a local journal file, and drained to the database by a background flusher? Saves are then
+		//acknowledged as soon as they reach the journal, and survive the game crashing before they reach the database.
+		bool journalEnabled;
+		//Journal file name. May use file IO aliases such as @user@.
+		AZStd::string journalFileName;
+		//Size of a new journal file, in megabytes. Saves are sent to the database directly while the journal is full.
+		int journalSizeMB;
+		//Time (milliseconds) between journal flushes to the database.
+		int journalFlushInterval;
+	};
+
+	//Metrics export settings.
+	struct MetricsSettings
+	{
+	public:
+
+		//Where metrics are exported to. TEXT_FILE writes them to a file for a collector to pick up. HTTP serves them on a port
+		//on the loopback interface, for Prometheus to scrape.
+		enum ExportMode { DISABLED = 0, TEXT_FILE = 1, HTTP = 2 };
+
+		MetricsSettings() :
+			exportMode(DISABLED),
+			exportInterval(5000), //Milliseconds.
+			fileName("@user@/ply_metrics.prom"),
+			fileHistory(0),
+			httpPort(9464)
+		{};
+		~MetricsSettings() {};
+
+		ExportMode exportMode;
+		//Time (milliseconds) between writes of the metrics file.
+		int exportInterval;
+		//Metrics file name. May use file IO aliases such as @user@.
+		AZStd::string fileName;
+		//Number of previous metrics files to keep, as fileName.1, fileName.2 and so on. 0 keeps only the latest.
+		int fileHistory;
+		//Loopback port metrics are served on.
+		int httpPort;
+	};
+
+	//Query timeline trace settings.
+	struct TraceSettings
+	{
+	public:
+
+		TraceSettings() :
+			enabled(false),
+			fileName("@user@/ply_trace.json"),
+			slowFrameThreshold(0) //Milliseconds. 0 disables dumps on slow frames.
+		{};
+		~TraceSettings() {};
+
+		//Should spans of query work be recorded to the trace ring buffer?
+		bool enabled;
+		//Trace dump file name. May use file IO aliases such as @user@. Dumps triggered by slow frames add the time to the name.
+		AZStd::string fileName;
+		//Frame time (milliseconds) over which the trace ring buffer is dumped automatically. 0 disables dumps on slow frames.
+		int slowFrameThreshold;
+	};
+
+	//Main thread frame cost profiling settings.
+	struct FrameSettings
+	{
+	public:
+
+		FrameSettings() :
+			enabled(false),
+			budget(2000), //Microseconds. 0 disables budget warnings.
+			window(10) //Seconds.
+		{};
+		~FrameSettings() {};
+
+		//Should the time PLY spends on the main thread each frame be measured?
+		bool enabled;
+		//Time (microseconds) PLY may spend on the main thread each frame before a warning is logged. 0 disables warnings.
+		int budget;
+		//Length (seconds) of the window frame cost statistics are collected over before they are rolled over.
+		int window;
+	};
+
+	//Slow query log settings.
+	struct SlowQuerySettings
+	{
+	public:
+
+		SlowQuerySettings() :
+			threshold(0), //Milliseconds. 0 disables the slow query log.
+			fileName("@user@/ply_slow_queries.log"),
+			explain(true),
+			explainInterval(10000) //Milliseconds.
+		{};
+		~SlowQuerySettings() {};
+
+		//Execution time (milliseconds) over which a query is logged as slow. 0 disables the slow query log.
+		int threshold;
+		//Slow query log file name. May use file IO aliases such as @user@.
+		AZStd::string fileName;
+		//Should read only slow queries be run again with EXPLAIN (ANALYZE, BUFFERS), and their plan added to the log?
+		bool explain;
+		//Minimum time (milliseconds) between EXPLAIN runs. Slow queries logged in between are logged without a plan.
+		int explainInterval;
+	};
+
 	//A query object.
 	struct PLYQuery
 	{
@@ -118,15 +296,187 @@ namespace PLY
 		unsigned long long workerID;
 		unsigned long long queryID;
 		AZStd::string queryString;
+		//Parameters for placeholders $1, $2... in the query string, sent to the database in binary format.
+		//Empty means the query string is sent on its own.
+		std::vector<std::string> binaryParams;
 		AZ::ScriptTimePoint creationTime;	
 		QuerySettings settings;
 		std::atomic<bool> finished;
 	};
 
+	//Latency statistics for one phase of query processing. All times are in microseconds.
+	struct PLYLatencyPhaseStats
+	{
+	public:
+
+		PLYLatencyPhaseStats() :
+			count(0),
+			mean(0),
+			min(0),
+			max(0),
+			p50(0),
+			p90(0),
+			p99(0),
+			p999(0)
+		{};
+		~PLYLatencyPhaseStats() {};
+
+		//Number of queries recorded.
+		unsigned long long count;
+		double mean;
+		unsigned long long min;
+		unsigned long long max;
+		//Percentiles. Accurate to within about 3%.
+		unsigned long long p50;
+		unsigned long long p90;
+		unsigned long long p99;
+		unsigned long long p999;
+	};
+
+	//Snapshot of query latency statistics since the PLY system started, or since they were last reset.
+	struct PLYLatencyStats
+	{
+		//Time from the query being sent to a worker starting it.
+		PLYLatencyPhaseStats queueWait;
+		//Time from a worker starting the query to the result being ready.
+		PLYLatencyPhaseStats execution;
+		//Time from the result being ready to it being advertised on the query results bus. Only advertised results are recorded.
+		PLYLatencyPhaseStats publish;
+		//Time from the query being sent to its result being advertised. Only advertised results are recorded.
+		PLYLatencyPhaseStats total;
+	};
+
+	//Main thread frame cost statistics for one section of PLY's work, over the last complete frame profiling window. Each
+	//frame the section ran in is recorded once, with the total time it took in that frame. Times are in microseconds.
+	struct PLYFrameSectionStats
+	{
+	public:
+
+		PLYFrameSectionStats() :
+			name("")
+		{};
+		~PLYFrameSectionStats() {};
+
+		//Section name. "Frame" is all of PLY's main thread time. "ResultReady: " sections are each type of result handler.
+		AZStd::string name;
+		//Frame counts and times. The count is the number of frames the section ran in.
+		PLYLatencyPhaseStats time;
+	};
+
+	//Statistics for one of PLY's internal locks, since the PLY system started or since they were last reset. Only recorded
+	//when the gem is built with PLY_LOCK_PROFILING defined. Wait and hold times are in nanoseconds.
+	struct PLYLockStats
+	{
+	public:
+
+		PLYLockStats() :
+			name(""),
+			acquisitions(0),
+			contended(0)
+		{};
+		~PLYLockStats() {};
+
+		AZStd::string name;
+		long long acquisitions;
+		//Number of acquisitions that found the lock held by another thread, and had to wait.
+		long long contended;
+		//Time spent waiting to acquire the lock.
+		PLYLatencyPhaseStats wait;
+		//Time the lock was held for.
+		PLYLatencyPhaseStats hold;
+	};
+
+	//Snapshot of query counters since the PLY system started.
+	struct PLYQueryCounters
+	{
+	public:
+
+		PLYQueryCounters() :
+			queriesSent(0),
+			resultsReceived(0),
+			queueDepth(0),
+			maxQueueDepth(0),
+			busyWorkers(0),
+			maxBusyWorkers(0),
+			openConnections(0),
+			connectionsOpened(0),
+			connectionFailures(0),
+			reconnects(0),
+			sqlErrors(0),
+			processorErrors(0),
+			queryTTLExpiries(0),
+			resultTTLExpiries(0),
+			bytesReceived(0)
+		{};
+		~PLYQueryCounters() {};
+
+		long long queriesSent;
+		long long resultsReceived;
+		//Number of queries in the query queue, waiting for or being run by a worker.
+		long long queueDepth;
+		long long maxQueueDepth;
+		//Number of workers running a query.
+		long long busyWorkers;
+		long long maxBusyWorkers;
+		//Number of database connections currently open.
+		long long openConnections;
+		long long connectionsOpened;
+		//Number of failed attempts to open a database connection.
+		long long connectionFailures;
+		//Number of connections opened again after a worker's connection failed or was lost.
+		long long reconnects;
+		long long sqlErrors;
+		long long processorErrors;
+		long long queryTTLExpiries;
+		long long resultTTLExpiries;
+		//Size of all fields in all result sets received.
+		long long bytesReceived;
+	};
+
+	//Statistics for all queries sharing a fingerprint, since the PLY system started or since they were last reset.
+	//Times are measured by the client, in microseconds. Total time runs from the query being sent to its result being
+	//ready, so it includes time spent waiting in the query queue.
+	struct PLYStatementStats
+	{
+	public:
+
+		PLYStatementStats() :
+			fingerprint(0),
+			query(""),
+			calls(0),
+			errors(0),
+			rows(0),
+			bytes(0),
+			totalTime(0),
+			executionTime(0),
+			maxTime(0)
+		{};
+		~PLYStatementStats() {};
+
+		//Fingerprint ID. 0 collects statements that arrived after the fingerprint limit was reached.
+		unsigned long long fingerprint;
+		//Normalised statement text, from the first query seen with this fingerprint.
+		AZStd::string query;
+		long long calls;
+		//Number of calls that failed with an SQL error.
+		long long errors;
+		//Rows returned by calls that succeeded.
+		long long rows;
+		//Size of all fields in all result sets returned.
+		long long bytes;
+		unsigned long long totalTime;
+		//Part of the total time spent executing the query, not waiting for a worker.
+		unsigned long long executionTime;
+		unsigned long long maxTime;
+
+		//Get the mean total time of a call, in microseconds.
+		inline double GetMeanTime() const { return calls > 0 ? static_cast<double>(totalTime) / static_cast<double>(calls) : 0; };
+	};
+
 	//A query results object.
 	struct PLYResult
 	{
-		enum ResultErrorType { NONE = 0, SQL_ERROR = 1, TTL_EXPIRED = 2 };
+		enum ResultErrorType { NONE = 0, SQL_ERROR = 1, TTL_EXPIRED = 2, PROCESSOR_ERROR = 3 };
 
 		PLYResult() :
 			queryID(0),
@@ -149,5 +499,7 @@ namespace PLY
 		QuerySettings settings;
 		ResultErrorType errorType;
 		AZStd::string errorMessage;
+		//Output of the query's result processor, if any. See QuerySettings::resultProcessor.
+		std::shared_ptr<void> processedData;
 	};
 }
\ No newline at end of file
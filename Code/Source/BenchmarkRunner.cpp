@@ -0,0 +1,664 @@
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#include "BenchmarkRunner.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include <AzCore/IO/FileIO.h>
+
+#include <PLY/PLYConfiguration.hpp>
+#include <QueryEngine.h>
+#include <PLYLog.h>
+#include <StatsCollector.h>
+
+using namespace PLY;
+
+namespace
+{
+	//Most open loop queries in flight before a scenario gives up, so a rate far past saturation can't use all the memory.
+	const size_t MAX_OPEN_LOOP_IN_FLIGHT = 100000;
+
+	//Get the time between two time points, in microseconds.
+	unsigned long long GetMicroseconds(const std::chrono::steady_clock::time_point &from, const std::chrono::steady_clock::time_point &to)
+	{
+		return to > from ? static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::microseconds>(to - from).count()) : 0;
+	}
+
+	//Escape a string for use in JSON.
+	std::string Escape(const std::string &s)
+	{
+		std::string out;
+		for (char c : s)
+		{
+			switch (c)
+			{
+			case '"': out += "\\\""; break;
+			case '\\': out += "\\\\"; break;
+			case '\n': out += "\\n"; break;
+			case '\r': out += "\\r"; break;
+			case '\t': out += "\\t"; break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20)
+				{
+					char code[8];
+					snprintf(code, sizeof(code), "\\u%04x", c);
+					out += code;
+				}
+				else
+				{
+					out += c;
+				}
+			}
+		}
+		return out;
+	}
+
+	const char *ToString(DatabaseConnectionDetails::SSLMode mode)
+	{
+		switch (mode)
+		{
+		case DatabaseConnectionDetails::DISABLE: return "disable";
+		case DatabaseConnectionDetails::ALLOW: return "allow";
+		case DatabaseConnectionDetails::PREFER: return "prefer";
+		case DatabaseConnectionDetails::REQUIRE: return "require";
+		case DatabaseConnectionDetails::VERIFY_CA: return "verify_ca";
+		case DatabaseConnectionDetails::VERIFY_FULL: return "verify_full";
+		}
+		return "unknown";
+	}
+
+	const char *ToString(PoolSettings::Priority priority)
+	{
+		switch (priority)
+		{
+		case PoolSettings::NORMAL: return "normal";
+		case PoolSettings::BELOW_NORMAL: return "below_normal";
+		case PoolSettings::IDLE: return "idle";
+		}
+		return "unknown";
+	}
+
+	//Get the name of the curve an open loop scenario belongs to: its name, without the rate. eg: open[pool=4,rate=500]
+	//belongs to open[pool=4].
+	std::string GetCurveName(const std::string &name)
+	{
+		size_t open = name.find('[');
+		if (open == std::string::npos || name.back() != ']') return name;
+
+		std::string values;
+		std::istringstream in(name.substr(open + 1, name.size() - open - 2));
+		std::string part;
+		while (std::getline(in, part, ','))
+		{
+			if (part.compare(0, 5, "rate=") == 0) continue;
+			values += (values.empty() ? "" : ",") + part;
+		}
+
+		return name.substr(0, open) + (values.empty() ? "" : "[" + values + "]");
+	}
+
+	void WriteLatency(std::ostream &out, const char *name, const PLYLatencyPhaseStats &s, bool last)
+	{
+		out << "        \"" << name << "\": {\"count\": " << s.count << ", \"mean\": " << s.mean << ", \"min\": " << s.min
+			<< ", \"max\": " << s.max << ", \"p50\": " << s.p50 << ", \"p90\": " << s.p90 << ", \"p99\": " << s.p99
+			<< ", \"p999\": " << s.p999 << "}" << (last ? "\n" : ",\n");
+	}
+}
+
+double PLY::BenchmarkScenarioResult::GetMedianQueriesPerSecond() const
+{
+	if (passes.empty()) return 0;
+
+	std::vector<double> qps;
+	for (const BenchmarkPassResult &p : passes) qps.push_back(p.GetQueriesPerSecond());
+	std::sort(qps.begin(), qps.end());
+
+	size_t middle = qps.size() / 2;
+	return qps.size() % 2 == 1 ? qps[middle] : (qps[middle - 1] + qps[middle]) / 2;
+}
+
+PLY::BenchmarkRunner::BenchmarkRunner(QueryEngine *engine, const std::vector<BenchmarkScenario> &scenarios, int passes,
+	const std::function<void()> &startPool, const std::function<void()> &stopPool)
+	: m_engine(engine),
+	m_startPool(startPool),
+	m_stopPool(stopPool),
+	m_scenarios(scenarios),
+	m_state(START_SCENARIO),
+	m_index(0),
+	m_pass(0),
+	m_passes(passes),
+	m_setupQueryID(0),
+	m_sent(0),
+	m_completed(0),
+	m_target(0),
+	m_random(std::random_device()()),
+	m_originalPool(PLYCONF->GetPoolSettings()),
+	m_originalConnection(PLYCONF->GetDatabaseConnectionDetails()),
+	m_engineWasStarted(engine->IsStarted())
+{
+	if (m_startPool == nullptr) m_startPool = [engine]() { engine->Start(); };
+	if (m_stopPool == nullptr) m_stopPool = [engine]() { engine->Stop(); };
+}
+
+PLY::BenchmarkRunner::~BenchmarkRunner()
+{
+	if (m_state != FINISHED) Stop();
+}
+
+void PLY::BenchmarkRunner::Update()
+{
+	switch (m_state)
+	{
+	case START_SCENARIO:
+		if (m_index >= m_scenarios.size())
+		{
+			Finish();
+			return;
+		}
+		StartScenario();
+		break;
+
+	case SETUP:
+	{
+		std::shared_ptr<PLYResult> r = m_engine->GetResult(m_setupQueryID);
+		if (r == nullptr)
+		{
+			if (std::chrono::steady_clock::now() - m_lastResult > std::chrono::seconds(m_scenarios[m_index].timeout))
+			{
+				FailScenario("No setup result after " + std::to_string(m_scenarios[m_index].timeout) + " seconds.");
+			}
+			return;
+		}
+
+		m_engine->RemoveResult(m_setupQueryID);
+
+		if (r->errorType != PLYResult::NONE)
+		{
+			std::string message = r->errorMessage.c_str();
+			message.erase(message.find_last_not_of(" \r\n") + 1);
+			FailScenario("Setup failed: " + message);
+			return;
+		}
+
+		StartPhase(m_scenarios[m_index].warmup > 0 ? WARMUP : PASS);
+		break;
+	}
+
+	case WARMUP:
+	case PASS:
+		Pump();
+		break;
+
+	case FINISHED:
+		break;
+	}
+}
+
+void PLY::BenchmarkRunner::Stop()
+{
+	if (m_state == FINISHED) return;
+
+	if (m_state != START_SCENARIO) FailScenario("Stopped.");
+
+	Finish();
+}
+
+std::vector<std::string> PLY::BenchmarkRunner::GetReportLines() const
+{
+	std::vector<std::string> lines;
+
+	char line[512];
+	snprintf(line, sizeof(line), "PLY BENCHMARK: %-32s %6s %12s %12s %12s %10s %10s %10s %8s", "scenario", "passes", "median q/s",
+		"min q/s", "max q/s", "p50 us", "p99 us", "max us", "errors");
+	lines.push_back(line);
+
+	for (const BenchmarkScenarioResult &r : m_results)
+	{
+		double minQPS = 0;
+		double maxQPS = 0;
+		for (size_t i = 0; i < r.passes.size(); ++i)
+		{
+			double qps = r.passes[i].GetQueriesPerSecond();
+			minQPS = i == 0 ? qps : std::min(minQPS, qps);
+			maxQPS = std::max(maxQPS, qps);
+		}
+
+		snprintf(line, sizeof(line), "PLY BENCHMARK: %-32s %6d %12.1f %12.1f %12.1f %10llu %10llu %10llu %8lld", r.scenario.name.c_str(),
+			static_cast<int>(r.passes.size()), r.GetMedianQueriesPerSecond(), minQPS, maxQPS, r.latency.total.p50, r.latency.total.p99,
+			r.latency.total.max, r.GetErrors());
+		lines.push_back(line);
+
+		if (r.failure != "") lines.push_back("PLY BENCHMARK: " + std::string(r.scenario.name.c_str()) + " stopped early. " + r.failure);
+		if (r.firstError != "") lines.push_back("PLY BENCHMARK: " + std::string(r.scenario.name.c_str()) + " first error: " + r.firstError);
+	}
+
+	GetCurveReportLines(lines);
+
+	return lines;
+}
+
+void PLY::BenchmarkRunner::GetCurveReportLines(std::vector<std::string> &lines) const
+{
+	//Group open loop scenarios into curves, by their name without the rate, so each section's curve is reported on its own.
+	std::vector<std::string> curves;
+	std::vector<std::vector<const BenchmarkScenarioResult *>> points;
+	for (const BenchmarkScenarioResult &r : m_results)
+	{
+		if (!r.scenario.IsOpenLoop()) continue;
+
+		std::string curve = GetCurveName(r.scenario.name.c_str());
+		size_t i = std::find(curves.begin(), curves.end(), curve) - curves.begin();
+		if (i == curves.size())
+		{
+			curves.push_back(curve);
+			points.push_back(std::vector<const BenchmarkScenarioResult *>());
+		}
+		points[i].push_back(&r);
+	}
+
+	char line[512];
+	for (size_t c = 0; c < curves.size(); ++c)
+	{
+		//Latency here is from each query's intended send time, so it includes any time the query waited to be sent.
+		lines.push_back("PLY BENCHMARK: Latency versus throughput for " + curves[c] + ". Latency is from the intended send time.");
+		snprintf(line, sizeof(line), "PLY BENCHMARK: %12s %12s %10s %10s %10s %10s %8s", "target q/s", "achieved q/s", "p50 us", "p90 us",
+			"p99 us", "p999 us", "errors");
+		lines.push_back(line);
+
+		std::sort(points[c].begin(), points[c].end(),
+			[](const BenchmarkScenarioResult *a, const BenchmarkScenarioResult *b) { return a->scenario.rate < b->scenario.rate; });
+
+		long long sustained = 0;
+		long long saturated = 0;
+		for (const BenchmarkScenarioResult *r : points[c])
+		{
+			snprintf(line, sizeof(line), "PLY BENCHMARK: %12lld %12.1f %10llu %10llu %10llu %10llu %8lld%s", r->scenario.rate,
+				r->GetMedianQueriesPerSecond(), r->intended.p50, r->intended.p90, r->intended.p99, r->intended.p999, r->GetErrors(),
+				r->IsSaturated() ? "  saturated" : "");
+			lines.push_back(line);
+
+			if (!r->IsSaturated() && saturated == 0) sustained = r->scenario.rate;
+			if (r->IsSaturated() && saturated == 0) saturated = r->scenario.rate;
+		}
+
+		if (saturated == 0)
+		{
+			lines.push_back("PLY BENCHMARK: Every rate was sustained. Saturation is above " + std::to_string(sustained) + " queries/sec.");
+		}
+		else if (sustained == 0)
+		{
+			lines.push_back("PLY BENCHMARK: Saturated at the lowest rate, " + std::to_string(saturated) + " queries/sec.");
+		}
+		else
+		{
+			lines.push_back("PLY BENCHMARK: Sustained " + std::to_string(sustained) + " queries/sec. Saturated at " + std::to_string(saturated)
+				+ " queries/sec.");
+		}
+	}
+}
+
+void PLY::BenchmarkRunner::PrintReport() const
+{
+	for (const std::string &line : GetReportLines()) AZ_Printf("PLY", "%s", line.c_str());
+}
+
+void PLY::BenchmarkRunner::WriteReport(std::ostream &out) const
+{
+	out << "{\n  \"scenarios\": [\n";
+
+	for (size_t i = 0; i < m_results.size(); ++i)
+	{
+		const BenchmarkScenarioResult &r = m_results[i];
+		const BenchmarkScenario &s = r.scenario;
+
+		out << "    {\n";
+		out << "      \"name\": \"" << Escape(s.name.c_str()) << "\",\n";
+		out << "      \"query\": \"" << Escape(s.query.c_str()) << "\",\n";
+		out << "      \"pool\": " << s.pool.minPoolSize << ", \"maxPool\": " << s.pool.maxPoolSize
+			<< ", \"waitMode\": \"" << (s.pool.waitMode == PoolSettings::YIELD ? "yield" : "sleep")
+			<< "\", \"managerPriority\": \"" << ToString(s.pool.managerPriority)
+			<< "\", \"workerPriority\": \"" << ToString(s.pool.workerPriority) << "\",\n";
+		out << "      \"sslMode\": \"" << ToString(s.connection.sslMode) << "\", \"transaction\": " << (s.useTransaction ? "true" : "false")
+			<< ", \"queries\": " << s.queries << ", \"inFlight\": " << s.inFlight << ", \"warmup\": " << s.warmup << ",\n";
+		out << "      \"rate\": " << s.rate << ", \"arrival\": \"" << (s.arrival == BenchmarkScenario::POISSON ? "poisson" : "fixed")
+			<< "\", \"duration\": " << s.duration << ", \"saturated\": " << (r.IsSaturated() ? "true" : "false") << ",\n";
+		out << "      \"failure\": \"" << Escape(r.failure) << "\",\n";
+		out << "      \"errors\": {\"sql\": " << r.sqlErrors << ", \"ttl\": " << r.ttlExpiries << ", \"processor\": " << r.processorErrors
+			<< ", \"first\": \"" << Escape(r.firstError) << "\"},\n";
+		out << "      \"medianQueriesPerSecond\": " << r.GetMedianQueriesPerSecond() << ",\n";
+
+		out << "      \"passes\": [";
+		for (size_t p = 0; p < r.passes.size(); ++p)
+		{
+			const BenchmarkPassResult &pass = r.passes[p];
+			out << (p == 0 ? "\n" : ",\n") << "        {\"completed\": " << pass.completed << ", \"errors\": " << pass.errors
+				<< ", \"rows\": " << pass.rows << ", \"seconds\": " << pass.seconds << ", \"queriesPerSecond\": " << pass.GetQueriesPerSecond() << "}";
+		}
+		out << (r.passes.empty() ? "],\n" : "\n      ],\n");
+
+		out << "      \"latencyMicroseconds\": {\n";
+		WriteLatency(out, "queueWait", r.latency.queueWait, false);
+		WriteLatency(out, "execution", r.latency.execution, false);
+		WriteLatency(out, "publish", r.latency.publish, false);
+		WriteLatency(out, "total", r.latency.total, false);
+		WriteLatency(out, "intended", r.intended, false);
+		WriteLatency(out, "sendLag", r.sendLag, true);
+		out << "      }\n";
+
+		out << (i + 1 < m_results.size() ? "    },\n" : "    }\n");
+	}
+
+	out << "  ]\n}\n";
+}
+
+bool PLY::BenchmarkRunner::SaveReport(const std::string &fileName) const
+{
+	//Resolve aliases such as @user@ to a full path.
+	char resolved[1024] = { 0 };
+	AZ::IO::FileIOBase *f = AZ::IO::FileIOBase::GetInstance();
+	std::string path = (f != nullptr && f->ResolvePath(fileName.c_str(), resolved, sizeof(resolved))) ? resolved : fileName;
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		PLYLOG(PLYLog::PLY_ERROR, "Couldn't write benchmark report " + AZStd::string(path.c_str()));
+		return false;
+	}
+
+	WriteReport(file);
+
+	PLYLOG(PLYLog::PLY_INFO, "Benchmark report written to " + AZStd::string(path.c_str()));
+
+	return true;
+}
+
+void PLY::BenchmarkRunner::StartScenario()
+{
+	const BenchmarkScenario &s = m_scenarios[m_index];
+
+	AZ_Printf("PLY", "PLY BENCHMARK: Starting scenario %s (%d of %d).", s.name.c_str(), static_cast<int>(m_index + 1),
+		static_cast<int>(m_scenarios.size()));
+
+	BenchmarkScenarioResult result;
+	result.scenario = s;
+	m_results.push_back(result);
+
+	m_queueWait.Reset();
+	m_execution.Reset();
+	m_publish.Reset();
+	m_total.Reset();
+	m_intended.Reset();
+	m_sendLag.Reset();
+	m_pass = 0;
+
+	//Restart the engine with the scenario's settings.
+	PLYCONF->SetPoolSettings(s.pool);
+	PLYCONF->SetDatabaseConnectionDetails(s.connection);
+	m_stopPool();
+	m_startPool();
+
+	m_lastResult = std::chrono::steady_clock::now();
+
+	if (s.setup != "")
+	{
+		//Setup runs outside of a transaction, so it can run statements such as VACUUM.
+		QuerySettings qs = GetQuerySettings(s);
+		qs.useTransaction = false;
+		m_setupQueryID = m_engine->SendQuery(s.setup, std::vector<std::string>(), qs);
+		m_state = SETUP;
+	}
+	else
+	{
+		StartPhase(s.warmup > 0 ? WARMUP : PASS);
+	}
+}
+
+void PLY::BenchmarkRunner::StartPhase(State state)
+{
+	const BenchmarkScenario &s = m_scenarios[m_index];
+
+	m_state = state;
+	m_sent = 0;
+	m_completed = 0;
+	m_target = state == WARMUP ? s.warmup : s.queries;
+	m_outstanding.clear();
+	m_intendedTimes.clear();
+
+	if (state == PASS)
+	{
+		m_pass++;
+		m_currentPass = BenchmarkPassResult();
+	}
+
+	m_phaseStart = std::chrono::steady_clock::now();
+	m_lastResult = m_phaseStart;
+	m_nextSend = m_phaseStart;
+	m_sendEnd = m_phaseStart + std::chrono::seconds(s.duration);
+}
+
+void PLY::BenchmarkRunner::Pump()
+{
+	const BenchmarkScenario &s = m_scenarios[m_index];
+	bool openLoop = m_state == PASS && s.IsOpenLoop();
+
+	if (openLoop)
+	{
+		if (!SendOpenLoop(std::chrono::steady_clock::now())) return;
+	}
+	else
+	{
+		//Top up the queries in flight.
+		QuerySettings qs = GetQuerySettings(s);
+		while (m_sent < m_target && m_sent - m_completed < s.inFlight)
+		{
+			AZStd::string query = s.GenerateQuery(m_sent, m_state == PASS ? m_pass : 0, m_random).c_str();
+			m_outstanding.insert(m_engine->SendQuery(query, std::vector<std::string>(), qs));
+			m_sent++;
+		}
+	}
+
+	//Collect finished queries. Only results from the oldest query still in flight onwards are looked at, so the cost
+	//follows the number of results ready, not the number of queries in flight.
+	std::vector<std::shared_ptr<PLYResult>> results;
+	if (!m_outstanding.empty()) results = m_engine->GetResultsFrom(*m_outstanding.begin());
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+	bool collected = false;
+	for (const std::shared_ptr<PLYResult> &r : results)
+	{
+		//Skip results of queries sent by anything else.
+		if (m_outstanding.erase(r->queryID) == 0) continue;
+
+		Collect(*r, now);
+		m_engine->RemoveResult(r->queryID);
+		m_intendedTimes.erase(r->queryID);
+		m_completed++;
+		collected = true;
+	}
+
+	if (collected)
+	{
+		m_lastResult = now;
+	}
+	else if (!m_outstanding.empty() && now - m_lastResult > std::chrono::seconds(s.timeout))
+	{
+		FailScenario("No results for " + std::to_string(s.timeout) + " seconds.");
+		return;
+	}
+
+	if (openLoop ? (now >= m_sendEnd && m_outstanding.empty()) : m_completed >= m_target) EndPhase();
+}
+
+bool PLY::BenchmarkRunner::SendOpenLoop(const std::chrono::steady_clock::time_point &now)
+{
+	const BenchmarkScenario &s = m_scenarios[m_index];
+	QuerySettings qs = GetQuerySettings(s);
+
+	//Send every query that is due, however many are in flight. Each keeps the time it was meant to be sent, so a late
+	//send, from a slow tick or a busy main thread, still counts towards its latency.
+	while (m_nextSend <= now && m_nextSend < m_sendEnd)
+	{
+		if (m_outstanding.size() >= MAX_OPEN_LOOP_IN_FLIGHT)
+		{
+			FailScenario("More than " + std::to_string(MAX_OPEN_LOOP_IN_FLIGHT) + " queries in flight. The rate is far past saturation.");
+			return false;
+		}
+
+		//The timeout counts from the first query sent while none were in flight.
+		if (m_outstanding.empty()) m_lastResult = now;
+
+		AZStd::string query = s.GenerateQuery(m_sent, m_pass, m_random).c_str();
+		unsigned long long queryID = m_engine->SendQuery(query, std::vector<std::string>(), qs);
+		m_outstanding.insert(queryID);
+		m_intendedTimes[queryID] = m_nextSend;
+		m_sendLag.Record(GetMicroseconds(m_nextSend, now));
+		m_sent++;
+
+		m_nextSend += GetNextInterval(s);
+	}
+
+	return true;
+}
+
+std::chrono::steady_clock::duration PLY::BenchmarkRunner::GetNextInterval(const BenchmarkScenario &s)
+{
+	double seconds = s.arrival == BenchmarkScenario::POISSON ? std::exponential_distribution<double>(static_cast<double>(s.rate))(m_random)
+		: 1.0 / s.rate;
+	return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+}
+
+void PLY::BenchmarkRunner::Collect(const PLYResult &result, const std::chrono::steady_clock::time_point &collected)
+{
+	//Warmup queries aren't recorded.
+	if (m_state != PASS) return;
+
+	BenchmarkScenarioResult &r = m_results.back();
+
+	//Failed queries count towards the intended send time latency too, up to when they finished, or a server that fails
+	//queries under load would look faster than one that answers them.
+	std::unordered_map<unsigned long long, std::chrono::steady_clock::time_point>::iterator it = m_intendedTimes.find(result.queryID);
+	if (it != m_intendedTimes.end()) m_intended.Record(GetMicroseconds(it->second, collected));
+
+	if (result.errorType != PLYResult::NONE)
+	{
+		switch (result.errorType)
+		{
+		case PLYResult::SQL_ERROR: r.sqlErrors++; break;
+		case PLYResult::TTL_EXPIRED: r.ttlExpiries++; break;
+		case PLYResult::PROCESSOR_ERROR: r.processorErrors++; break;
+		default: break;
+		}
+
+		m_currentPass.errors++;
+
+		if (r.firstError == "")
+		{
+			r.firstError = result.errorMessage.c_str();
+			r.firstError.erase(r.firstError.find_last_not_of(" \r\n") + 1);
+		}
+
+		return;
+	}
+
+	m_currentPass.rows += static_cast<long long>(result.resultSet.size());
+
+	AZ::ScriptTimePoint now = AZ::ScriptTimePoint(AZStd::chrono::system_clock::now());
+	m_queueWait.Record(StatsCollector::GetMicroseconds(result.queryCreationTime, result.queryStartTime));
+	m_execution.Record(StatsCollector::GetMicroseconds(result.queryStartTime, result.queryEndTime));
+	m_publish.Record(StatsCollector::GetMicroseconds(result.queryEndTime, now));
+	m_total.Record(StatsCollector::GetMicroseconds(result.queryCreationTime, now));
+}
+
+void PLY::BenchmarkRunner::EndPhase()
+{
+	const BenchmarkScenario &s = m_scenarios[m_index];
+
+	if (m_state == WARMUP)
+	{
+		StartPhase(PASS);
+		return;
+	}
+
+	m_currentPass.completed = m_completed;
+	m_currentPass.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_phaseStart).count();
+	m_results.back().passes.push_back(m_currentPass);
+
+	if (s.IsOpenLoop())
+	{
+		AZ_Printf("PLY", "PLY BENCHMARK: %s pass %d of %d: %lld queries in %.3f s, %.1f queries/sec of %lld targeted, %lld failed.",
+			s.name.c_str(), m_pass, GetPasses(s), m_currentPass.completed, m_currentPass.seconds, m_currentPass.GetQueriesPerSecond(),
+			s.rate, m_currentPass.errors);
+	}
+	else
+	{
+		AZ_Printf("PLY", "PLY BENCHMARK: %s pass %d of %d: %lld queries in %.3f s, %.1f queries/sec, %lld failed.", s.name.c_str(), m_pass,
+			GetPasses(s), m_currentPass.completed, m_currentPass.seconds, m_currentPass.GetQueriesPerSecond(), m_currentPass.errors);
+	}
+
+	if (m_pass < GetPasses(s))
+	{
+		StartPhase(PASS);
+		return;
+	}
+
+	EndScenario();
+}
+
+void PLY::BenchmarkRunner::EndScenario()
+{
+	BenchmarkScenarioResult &r = m_results.back();
+	r.latency.queueWait = m_queueWait.GetSnapshot();
+	r.latency.execution = m_execution.GetSnapshot();
+	r.latency.publish = m_publish.GetSnapshot();
+	r.latency.total = m_total.GetSnapshot();
+	r.intended = m_intended.GetSnapshot();
+	r.sendLag = m_sendLag.GetSnapshot();
+
+	m_outstanding.clear();
+	m_intendedTimes.clear();
+	m_index++;
+	m_state = START_SCENARIO;
+}
+
+void PLY::BenchmarkRunner::FailScenario(const std::string &reason)
+{
+	PLYLOG(PLYLog::PLY_ERROR, AZStd::string::format("Benchmark scenario %s stopped. ", m_scenarios[m_index].name.c_str()) + reason.c_str());
+
+	m_results.back().failure = reason;
+
+	//Open loop queries still in flight count towards the intended send time latency up to now, when they are abandoned,
+	//so a scenario that stops because the server fell behind still reports how far behind it fell.
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	for (const std::pair<const unsigned long long, std::chrono::steady_clock::time_point> &intended : m_intendedTimes)
+	{
+		m_intended.Record(GetMicroseconds(intended.second, now));
+	}
+
+	//Queries still in flight are cleared when the engine is restarted.
+	EndScenario();
+}
+
+void PLY::BenchmarkRunner::Finish()
+{
+	//Restore the settings from before the run.
+	PLYCONF->SetPoolSettings(m_originalPool);
+	PLYCONF->SetDatabaseConnectionDetails(m_originalConnection);
+
+	m_stopPool();
+	if (m_engineWasStarted) m_startPool();
+
+	m_state = FINISHED;
+}
+
+QuerySettings PLY::BenchmarkRunner::GetQuerySettings(const BenchmarkScenario &s)
+{
+	//Override all defaults. Results are collected by the runner, so they aren't advertised.
+	QuerySettings qs;
+	qs.advertiseResult = false;
+	qs.useTransaction = s.useTransaction;
+	qs.queryTTL = s.queryTTL;
+	qs.resultTTL = s.resultTTL;
+	return qs;
+}
@@ -0,0 +1,246 @@
+// Benchmark runner for the PLY Gem. Runs a list of benchmark scenarios one after another on a query engine, restarting the
+// engine with each scenario's settings, and reports each scenario's throughput, latency and errors as text and as JSON.
+// It doesn't use EBuses or the TickBus, so the PLY system component and the headless benchmark share it. Update must be
+// called regularly, such as every tick, and never blocks. Open loop scenarios are also reported as a latency versus
+// throughput curve, with latency measured from each query's intended send time so a slow server or a slow tick can't
+// hide queuing delay (coordinated omission).
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <random>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include <PLY/PLYTypes.h>
+
+#include "BenchmarkScenario.h"
+#include "LatencyHistogram.h"
+
+namespace PLY
+{
+	//Forward declarations.
+	class QueryEngine;
+
+	//Outcome of one timed pass of a benchmark scenario.
+	struct BenchmarkPassResult
+	{
+	public:
+
+		BenchmarkPassResult() :
+			completed(0),
+			errors(0),
+			rows(0),
+			seconds(0)
+		{};
+		~BenchmarkPassResult() {};
+
+		long long completed;
+		long long errors;
+		long long rows;
+		double seconds;
+
+		inline double GetQueriesPerSecond() const { return seconds > 0 ? completed / seconds : 0; };
+	};
+
+	//Outcome of a benchmark scenario.
+	struct BenchmarkScenarioResult
+	{
+	public:
+
+		BenchmarkScenarioResult() :
+			sqlErrors(0),
+			ttlExpiries(0),
+			processorErrors(0)
+		{};
+		~BenchmarkScenarioResult() {};
+
+		BenchmarkScenario scenario;
+		std::vector<BenchmarkPassResult> passes;
+		//Latency over all passes, in microseconds. Publish is the time from a result being ready to the runner collecting it.
+		PLYLatencyStats latency;
+		//Open loop only. Latency from each query's intended send time to the runner collecting its result, in microseconds.
+		//Failed queries count too, as do queries still in flight when the scenario stopped early, up to when it stopped.
+		PLYLatencyPhaseStats intended;
+		//Open loop only. Time from each query's intended send time to it actually being sent, in microseconds.
+		PLYLatencyPhaseStats sendLag;
+		long long sqlErrors;
+		long long ttlExpiries;
+		long long processorErrors;
+		std::string firstError;
+		//Why the scenario stopped early. Blank if it finished.
+		std::string failure;
+
+		inline long long GetErrors() const { return sqlErrors + ttlExpiries + processorErrors; };
+
+		//Get the median throughput of the scenario's passes.
+		double GetMedianQueriesPerSecond() const;
+
+		//Did an open loop scenario fail to keep up with its target rate? True if it stopped early, or its median throughput
+		//was less than 95% of the target rate.
+		inline bool IsSaturated() const
+		{
+			return scenario.IsOpenLoop() && (failure != "" || GetMedianQueriesPerSecond() < scenario.rate * 0.95);
+		};
+	};
+
+	class BenchmarkRunner
+	{
+	public:
+
+		//@param engine The query engine to run on. It is restarted with each scenario's settings, and with the original
+		//settings once the run finishes. If it wasn't started, it is left stopped.
+		//@param scenarios The scenarios to run, in order.
+		//@param passes Number of passes for every scenario, in place of each scenario's own. 0 = use each scenario's.
+		//@param startPool Starts the engine with the current PLY configuration. Empty to call the engine's Start directly.
+		//@param stopPool Stops the engine. Empty to call the engine's Stop directly.
+		BenchmarkRunner(QueryEngine *engine, const std::vector<BenchmarkScenario> &scenarios, int passes,
+			const std::function<void()> &startPool = nullptr, const std::function<void()> &stopPool = nullptr);
+		~BenchmarkRunner();
+
+		//Send queries, collect results and move on to the next pass or scenario as needed.
+		void Update();
+
+		//Stop the run. Scenarios that haven't finished are reported as stopped.
+		void Stop();
+
+		//Has every scenario finished, or the run been stopped?
+		inline bool IsFinished() const { return m_state == FINISHED; };
+
+		//Get the results of every scenario started so far.
+		inline const std::vector<BenchmarkScenarioResult> &GetResults() const { return m_results; };
+
+		//Get the text report, one line per scenario plus a header.
+		std::vector<std::string> GetReportLines() const;
+
+		//Print the text report to the game console.
+		void PrintReport() const;
+
+		//Write the report as JSON.
+		//@param out The stream to write to.
+		void WriteReport(std::ostream &out) const;
+
+		//Write the report as JSON to a file.
+		//@param fileName The file name. May use file IO aliases such as @user@.
+		//@return True if the file was written.
+		bool SaveReport(const std::string &fileName) const;
+
+	private:
+
+		enum State { START_SCENARIO, SETUP, WARMUP, PASS, FINISHED };
+
+		QueryEngine *m_engine;
+
+		//Start and stop the engine, such as through the owner's pool initialisation so it can prepare for the restart.
+		std::function<void()> m_startPool;
+		std::function<void()> m_stopPool;
+
+		std::vector<BenchmarkScenario> m_scenarios;
+
+		std::vector<BenchmarkScenarioResult> m_results;
+
+		State m_state;
+
+		//Index of the current scenario.
+		size_t m_index;
+
+		//Current pass, from 1. 0 before the first pass.
+		int m_pass;
+
+		//Passes for every scenario. 0 = use each scenario's.
+		int m_passes;
+
+		//ID of the setup query.
+		unsigned long long m_setupQueryID;
+
+		//Queries sent and finished in the current phase, and the number to run.
+		long long m_sent;
+		long long m_completed;
+		long long m_target;
+
+		//IDs of queries sent but not yet collected, lowest first.
+		std::set<unsigned long long> m_outstanding;
+
+		//Open loop intended send times of queries not yet collected, by query ID.
+		std::unordered_map<unsigned long long, std::chrono::steady_clock::time_point> m_intendedTimes;
+
+		//Open loop intended send time of the next query, and the time sending stops.
+		std::chrono::steady_clock::time_point m_nextSend;
+		std::chrono::steady_clock::time_point m_sendEnd;
+
+		//The current pass.
+		BenchmarkPassResult m_currentPass;
+
+		std::chrono::steady_clock::time_point m_phaseStart;
+		std::chrono::steady_clock::time_point m_lastResult;
+
+		std::mt19937 m_random;
+
+		//Latency of the current scenario.
+		LatencyHistogram m_queueWait;
+		LatencyHistogram m_execution;
+		LatencyHistogram m_publish;
+		LatencyHistogram m_total;
+		LatencyHistogram m_intended;
+		LatencyHistogram m_sendLag;
+
+		//Settings and engine state from before the run, restored once it finishes.
+		PoolSettings m_originalPool;
+		DatabaseConnectionDetails m_originalConnection;
+		bool m_engineWasStarted;
+
+		//Apply the current scenario's settings and send its setup query.
+		void StartScenario();
+
+		//Start a warmup or pass.
+		//@param state WARMUP or PASS.
+		void StartPhase(State state);
+
+		//Send and collect queries for the current warmup or pass.
+		void Pump();
+
+		//Send the open loop queries that are due.
+		//@param now The current time.
+		//@return False if the scenario failed.
+		bool SendOpenLoop(const std::chrono::steady_clock::time_point &now);
+
+		//Get the time until the next open loop query.
+		//@param s The scenario.
+		std::chrono::steady_clock::duration GetNextInterval(const BenchmarkScenario &s);
+
+		//Record a collected result.
+		//@param result The result.
+		//@param collected The time the result was collected.
+		void Collect(const PLYResult &result, const std::chrono::steady_clock::time_point &collected);
+
+		//Finish the current warmup or pass.
+		void EndPhase();
+
+		//Record the current scenario's latency and move on to the next scenario.
+		void EndScenario();
+
+		//Stop the current scenario early.
+		//@param reason Why the scenario stopped.
+		void FailScenario(const std::string &reason);
+
+		//Restore the original settings and engine state.
+		void Finish();
+
+		//Get the query settings for a scenario.
+		//@param s The scenario.
+		static QuerySettings GetQuerySettings(const BenchmarkScenario &s);
+
+		//Add the latency versus throughput curves of open loop scenarios to the text report.
+		//@param lines The report lines.
+		void GetCurveReportLines(std::vector<std::string> &lines) const;
+
+		//Get the number of passes to run for a scenario.
+		//@param s The scenario.
+		inline int GetPasses(const BenchmarkScenario &s) const { return m_passes > 0 ? m_passes : s.passes; };
+	};
+}
@@ -0,0 +1,572 @@
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#include "BenchmarkScenario.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+
+#include <AzCore/IO/FileIO.h>
+
+using namespace PLY;
+
+namespace
+{
+	//Most scenarios one section can expand to, so a typo in a range can't create millions of scenarios.
+	const size_t MAX_EXPANSION = 1000;
+
+	//A "key = value" line.
+	struct Entry
+	{
+		std::string key;
+		std::string value;
+		int line;
+	};
+
+	//A [section], and the entries in it.
+	struct Section
+	{
+		std::string name;
+		std::vector<Entry> entries;
+	};
+
+	std::string Trim(const std::string &s)
+	{
+		size_t start = s.find_first_not_of(" \t\r\n");
+		if (start == std::string::npos) return "";
+		size_t end = s.find_last_not_of(" \t\r\n");
+		return s.substr(start, end - start + 1);
+	}
+
+	std::string ToLower(std::string s)
+	{
+		std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		return s;
+	}
+
+	//Read a whole string as an integer.
+	bool ToInteger(const std::string &s, long long &out)
+	{
+		try
+		{
+			size_t used = 0;
+			out = std::stoll(s, &used);
+			return used == s.size();
+		}
+		catch (const std::exception &)
+		{
+			return false;
+		}
+	}
+
+	//Add an entry to a list, replacing any earlier entry with the same key.
+	void AddEntry(std::vector<Entry> &entries, const Entry &entry)
+	{
+		for (Entry &e : entries)
+		{
+			if (e.key == entry.key)
+			{
+				e = entry;
+				return;
+			}
+		}
+		entries.push_back(entry);
+	}
+}
+
+PLY::BenchmarkScenario::BenchmarkScenario()
+	: name("default"),
+	useTransaction(true),
+	queryTTL(0),
+	resultTTL(0),
+	setup(""),
+	query(""),
+	queries(1000),
+	inFlight(64),
+	passes(1),
+	warmup(0),
+	timeout(30),
+	rate(0),
+	arrival(FIXED),
+	duration(10)
+{
+}
+
+PLY::BenchmarkScenario::~BenchmarkScenario()
+{
+}
+
+std::string PLY::BenchmarkScenario::GenerateQuery(long long index, int pass, std::mt19937 &random) const
+{
+	//Placeholders were checked when the scenario was loaded.
+	std::string out;
+	std::string error;
+	ExpandPlaceholders(query.c_str(), index, GetQueriesPerPass(), pass, random, out, error);
+	return out;
+}
+
+bool PLY::BenchmarkScenario::Load(const std::string &fileName, const BenchmarkScenario &base, std::vector<BenchmarkScenario> &scenarios,
+	std::string &error)
+{
+	//Resolve aliases such as @user@ to a full path.
+	char resolved[1024] = { 0 };
+	AZ::IO::FileIOBase *f = AZ::IO::FileIOBase::GetInstance();
+	std::string path = (f != nullptr && f->ResolvePath(fileName.c_str(), resolved, sizeof(resolved))) ? resolved : fileName;
+
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		error = "Couldn't open scenario file " + path;
+		return false;
+	}
+
+	std::stringstream text;
+	text << file.rdbuf();
+
+	if (!Parse(text.str(), base, scenarios, error))
+	{
+		error = path + ": " + error;
+		return false;
+	}
+
+	return true;
+}
+
+bool PLY::BenchmarkScenario::Parse(const std::string &text, const BenchmarkScenario &base, std::vector<BenchmarkScenario> &scenarios,
+	std::string &error)
+{
+	std::vector<Entry> defaults;
+	std::vector<Section> sections;
+
+	std::istringstream in(text);
+	std::string line;
+	int lineNumber = 0;
+
+	while (std::getline(in, line))
+	{
+		lineNumber++;
+		int startLine = lineNumber;
+
+		//Join continued lines.
+		std::string trimmed = Trim(line);
+		while (!trimmed.empty() && trimmed.back() == '\\')
+		{
+			trimmed.pop_back();
+			std::string next;
+			if (!std::getline(in, next)) break;
+			lineNumber++;
+			trimmed += "\n" + Trim(next);
+		}
+
+		if (trimmed.empty() || trimmed[0] == '#' || trimmed[0] == ';') continue;
+
+		if (trimmed[0] == '[')
+		{
+			if (trimmed.back() != ']' || Trim(trimmed.substr(1, trimmed.size() - 2)).empty())
+			{
+				error = "line " + std::to_string(startLine) + ": Invalid section name " + trimmed;
+				return false;
+			}
+
+			Section s;
+			s.name = Trim(trimmed.substr(1, trimmed.size() - 2));
+			sections.push_back(s);
+			continue;
+		}
+
+		size_t equals = trimmed.find('=');
+		if (equals == std::string::npos)
+		{
+			error = "line " + std::to_string(startLine) + ": Expected key = value";
+			return false;
+		}
+
+		Entry e;
+		e.key = ToLower(Trim(trimmed.substr(0, equals)));
+		e.value = Trim(trimmed.substr(equals + 1));
+		e.line = startLine;
+
+		AddEntry(sections.empty() ? defaults : sections.back().entries, e);
+	}
+
+	//A file without sections is a single scenario.
+	if (sections.empty())
+	{
+		Section s;
+		s.name = base.name.c_str();
+		sections.push_back(s);
+	}
+
+	for (const Section &section : sections)
+	{
+		std::vector<Entry> entries;
+		for (const Entry &e : defaults) AddEntry(entries, e);
+		for (const Entry &e : section.entries) AddEntry(entries, e);
+
+		//The pool size sets the maximum pool size too, so it goes first.
+		std::stable_partition(entries.begin(), entries.end(), [](const Entry &e) { return e.key == "pool"; });
+
+		//Split each setting into its values. Settings with more than one value are matrix dimensions.
+		std::vector<std::vector<std::string>> values(entries.size());
+		size_t combinations = 1;
+		for (size_t i = 0; i < entries.size(); ++i)
+		{
+			if (IsMatrixKey(entries[i].key))
+			{
+				if (!SplitValues(entries[i].value, values[i], error))
+				{
+					error = "line " + std::to_string(entries[i].line) + ": " + error;
+					return false;
+				}
+			}
+			else
+			{
+				values[i].push_back(entries[i].value);
+			}
+
+			combinations *= values[i].size();
+			if (combinations > MAX_EXPANSION)
+			{
+				error = "Scenario " + section.name + " expands to more than " + std::to_string(MAX_EXPANSION) + " scenarios";
+				return false;
+			}
+		}
+
+		//Create a scenario for each combination of values.
+		std::vector<size_t> choice(entries.size(), 0);
+		for (size_t c = 0; c < combinations; ++c)
+		{
+			BenchmarkScenario s = base;
+			std::string suffix;
+
+			for (size_t i = 0; i < entries.size(); ++i)
+			{
+				const std::string &value = values[i][choice[i]];
+
+				if (!s.Set(entries[i].key, value, error))
+				{
+					error = "line " + std::to_string(entries[i].line) + ": " + error;
+					return false;
+				}
+
+				if (values[i].size() > 1) suffix += (suffix.empty() ? "" : ",") + entries[i].key + "=" + value;
+			}
+
+			s.name = (section.name + (suffix.empty() ? "" : "[" + suffix + "]")).c_str();
+
+			if (s.query.empty())
+			{
+				error = "Scenario " + section.name + " has no query";
+				return false;
+			}
+			if (s.pool.maxPoolSize < s.pool.minPoolSize)
+			{
+				error = "Scenario " + std::string(s.name.c_str()) + " has a max_pool smaller than its pool";
+				return false;
+			}
+
+			//Check the query's placeholders now, so bad ones are reported before anything runs.
+			std::mt19937 random;
+			std::string generated;
+			if (!ExpandPlaceholders(s.query.c_str(), 0, s.GetQueriesPerPass(), 0, random, generated, error))
+			{
+				error = "Scenario " + section.name + ": " + error;
+				return false;
+			}
+
+			scenarios.push_back(s);
+
+			//Move to the next combination.
+			for (size_t i = entries.size(); i-- > 0;)
+			{
+				if (++choice[i] < values[i].size()) break;
+				choice[i] = 0;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool PLY::BenchmarkScenario::ExpandPlaceholders(const std::string &sql, long long index, long long count, int pass,
+	std::mt19937 &random, std::string &out, std::string &error)
+{
+	out.clear();
+	out.reserve(sql.size() + 16);
+
+	for (size_t i = 0; i < sql.size(); ++i)
+	{
+		char c = sql[i];
+
+		if ((c == '{' || c == '}') && i + 1 < sql.size() && sql[i + 1] == c)
+		{
+			out += c;
+			++i;
+			continue;
+		}
+
+		if (c != '{')
+		{
+			out += c;
+			continue;
+		}
+
+		size_t end = sql.find('}', i);
+		if (end == std::string::npos)
+		{
+			error = "Unclosed placeholder in query. Use {{ for a literal brace.";
+			return false;
+		}
+
+		std::string placeholder = sql.substr(i + 1, end - i - 1);
+		i = end;
+
+		if (placeholder == "i")
+		{
+			out += std::to_string(index);
+		}
+		else if (placeholder == "n")
+		{
+			out += std::to_string(count);
+		}
+		else if (placeholder == "pass")
+		{
+			out += std::to_string(pass);
+		}
+		else if (placeholder.compare(0, 7, "random:") == 0)
+		{
+			size_t colon = placeholder.find(':', 7);
+			long long min = 0;
+			long long max = 0;
+			if (colon == std::string::npos || !ToInteger(placeholder.substr(7, colon - 7), min) ||
+				!ToInteger(placeholder.substr(colon + 1), max) || max < min)
+			{
+				error = "Invalid placeholder {" + placeholder + "}. Expected {random:MIN:MAX}.";
+				return false;
+			}
+			out += std::to_string(std::uniform_int_distribution<long long>(min, max)(random));
+		}
+		else
+		{
+			error = "Unknown placeholder {" + placeholder + "}. Use {{ for a literal brace.";
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool PLY::BenchmarkScenario::Set(const std::string &key, const std::string &value, std::string &error)
+{
+	std::string v = ToLower(value);
+	long long n = 0;
+	bool isInteger = ToInteger(value, n);
+
+	//Settings that take a whole number of at least a minimum value.
+	auto integer = [&](long long min) -> bool
+	{
+		if (isInteger && n >= min) return true;
+		error = "Setting " + key + " must be a whole number of at least " + std::to_string(min) + ", not " + value;
+		return false;
+	};
+
+	if (key == "host") connection.host = value.c_str();
+	else if (key == "dbname") connection.database = value.c_str();
+	else if (key == "user") connection.username = value.c_str();
+	else if (key == "password") connection.password = value.c_str();
+	else if (key == "port")
+	{
+		if (!integer(1)) return false;
+		connection.port = static_cast<int>(n);
+	}
+	else if (key == "connect_timeout")
+	{
+		if (!integer(0)) return false;
+		connection.connectTimeout = static_cast<int>(n);
+	}
+	else if (key == "sslmode")
+	{
+		if (v == "disable") connection.sslMode = DatabaseConnectionDetails::DISABLE;
+		else if (v == "allow") connection.sslMode = DatabaseConnectionDetails::ALLOW;
+		else if (v == "prefer") connection.sslMode = DatabaseConnectionDetails::PREFER;
+		else if (v == "require") connection.sslMode = DatabaseConnectionDetails::REQUIRE;
+		else if (v == "verify_ca" || v == "verify-ca") connection.sslMode = DatabaseConnectionDetails::VERIFY_CA;
+		else if (v == "verify_full" || v == "verify-full") connection.sslMode = DatabaseConnectionDetails::VERIFY_FULL;
+		else
+		{
+			error = "Unknown sslmode " + value;
+			return false;
+		}
+	}
+	else if (key == "pool")
+	{
+		if (!integer(1)) return false;
+		pool.minPoolSize = static_cast<int>(n);
+		pool.maxPoolSize = static_cast<int>(n);
+	}
+	else if (key == "max_pool")
+	{
+		if (!integer(1)) return false;
+		pool.maxPoolSize = static_cast<int>(n);
+	}
+	else if (key == "wait_mode")
+	{
+		if (v == "sleep") pool.waitMode = PoolSettings::SLEEP;
+		else if (v == "yield") pool.waitMode = PoolSettings::YIELD;
+		else
+		{
+			error = "Unknown wait_mode " + value + ". Expected sleep or yield.";
+			return false;
+		}
+	}
+	else if (key == "manager_priority" || key == "worker_priority")
+	{
+		PoolSettings::Priority priority;
+		if (v == "normal") priority = PoolSettings::NORMAL;
+		else if (v == "below_normal") priority = PoolSettings::BELOW_NORMAL;
+		else if (v == "idle") priority = PoolSettings::IDLE;
+		else
+		{
+			error = "Unknown " + key + " " + value + ". Expected normal, below_normal or idle.";
+			return false;
+		}
+		(key == "manager_priority" ? pool.managerPriority : pool.workerPriority) = priority;
+	}
+	else if (key == "transaction")
+	{
+		if (v == "true" || v == "yes" || v == "on" || v == "1") useTransaction = true;
+		else if (v == "false" || v == "no" || v == "off" || v == "0") useTransaction = false;
+		else
+		{
+			error = "Setting transaction must be true or false, not " + value;
+			return false;
+		}
+	}
+	else if (key == "query_ttl")
+	{
+		if (!integer(0)) return false;
+		queryTTL = static_cast<int>(n);
+	}
+	else if (key == "result_ttl")
+	{
+		if (!integer(0)) return false;
+		resultTTL = static_cast<int>(n);
+	}
+	else if (key == "setup") setup = value.c_str();
+	else if (key == "query") query = value.c_str();
+	else if (key == "queries")
+	{
+		if (!integer(1)) return false;
+		queries = n;
+	}
+	else if (key == "in_flight")
+	{
+		if (!integer(1)) return false;
+		inFlight = n;
+	}
+	else if (key == "passes")
+	{
+		if (!integer(1)) return false;
+		passes = static_cast<int>(n);
+	}
+	else if (key == "warmup")
+	{
+		if (!integer(0)) return false;
+		warmup = n;
+	}
+	else if (key == "timeout")
+	{
+		if (!integer(1)) return false;
+		timeout = static_cast<int>(n);
+	}
+	else if (key == "rate")
+	{
+		if (!integer(0)) return false;
+		rate = n;
+	}
+	else if (key == "arrival")
+	{
+		if (v == "fixed") arrival = FIXED;
+		else if (v == "poisson") arrival = POISSON;
+		else
+		{
+			error = "Unknown arrival " + value + ". Expected fixed or poisson.";
+			return false;
+		}
+	}
+	else if (key == "duration")
+	{
+		if (!integer(1)) return false;
+		duration = static_cast<int>(n);
+	}
+	else
+	{
+		error = "Unknown setting " + key;
+		return false;
+	}
+
+	return true;
+}
+
+bool PLY::BenchmarkScenario::IsMatrixKey(const std::string &key)
+{
+	//Free text settings may contain commas, so they can't be lists.
+	return key != "host" && key != "dbname" && key != "user" && key != "password" && key != "setup" && key != "query";
+}
+
+bool PLY::BenchmarkScenario::SplitValues(const std::string &value, std::vector<std::string> &values, std::string &error)
+{
+	std::istringstream in(value);
+	std::string part;
+
+	while (std::getline(in, part, ','))
+	{
+		part = Trim(part);
+		if (part.empty())
+		{
+			error = "Empty value in list " + value;
+			return false;
+		}
+
+		size_t dots = part.find("..");
+		if (dots == std::string::npos)
+		{
+			values.push_back(part);
+			continue;
+		}
+
+		//An optional step follows the range, eg: 100..1000 step 100.
+		std::string end = Trim(part.substr(dots + 2));
+		long long step = 1;
+		size_t stepAt = ToLower(end).find(" step ");
+		if (stepAt != std::string::npos)
+		{
+			if (!ToInteger(Trim(end.substr(stepAt + 6)), step) || step < 1)
+			{
+				error = "Invalid range step " + part;
+				return false;
+			}
+			end = Trim(end.substr(0, stepAt));
+		}
+
+		long long first = 0;
+		long long last = 0;
+		if (!ToInteger(Trim(part.substr(0, dots)), first) || !ToInteger(end, last) || last < first ||
+			(last - first) / step >= static_cast<long long>(MAX_EXPANSION))
+		{
+			error = "Invalid range " + part;
+			return false;
+		}
+
+		for (long long i = first; i <= last; i += step) values.push_back(std::to_string(i));
+	}
+
+	if (values.empty())
+	{
+		error = "Missing value";
+		return false;
+	}
+
+	return true;
+}
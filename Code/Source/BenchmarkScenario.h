@@ -0,0 +1,147 @@
+// Benchmark scenario for the PLY Gem. A scenario sets the connection, pool and query settings to benchmark with, the SQL to
+// run and how hard to run it. Scenarios are loaded from scenario files, so benchmarks can be added without rebuilding the gem.
+//
+// Scenario files are plain text. Lines starting with # or ; are comments, and a line ending in \ continues on the next line.
+// Each [section] is a scenario, named after the section. "key = value" lines before the first section are defaults for every
+// scenario in the file. Settings a scenario file doesn't give keep the values of the base scenario passed to Load.
+//
+// A setting can be given a list of values separated by commas, or a range of integers such as 1..9. The scenario is then
+// expanded into one scenario for every combination of values, named after the section and the values, eg: threads[pool=4].
+// Queries can use {i} for the index of the query in the pass, {n} for the number of queries per pass, {pass} for the pass
+// number and {random:MIN:MAX} for a random integer from MIN to MAX. Use {{ and }} for literal braces.
+//
+// A scenario with a rate is open loop. Queries are sent at the rate for a set duration, however many are still in flight,
+// and latency is measured from when each query was meant to be sent. A rate range such as 100..1000 step 100 gives a
+// latency versus throughput curve.
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <random>
+
+#include <PLY/PLYTypes.h>
+
+namespace PLY
+{
+	class BenchmarkScenario
+	{
+	public:
+
+		//Open loop arrival patterns. FIXED sends queries evenly spaced. POISSON spaces them randomly, as independent clients would.
+		enum Arrival { FIXED, POISSON };
+
+		BenchmarkScenario();
+		~BenchmarkScenario();
+
+		//Scenario name.
+		AZStd::string name;
+
+		//Connection settings. Key names: host, port, dbname, user, password, sslmode, connect_timeout.
+		DatabaseConnectionDetails connection;
+
+		//Query worker pool settings. Key names: pool (sets the minimum and maximum pool size), max_pool, wait_mode,
+		//manager_priority, worker_priority.
+		PoolSettings pool;
+
+		//Query settings. Key names: transaction, query_ttl, result_ttl.
+		bool useTransaction;
+		int queryTTL;
+		int resultTTL;
+
+		//SQL run once, outside of a transaction, before the scenario's warmup. The scenario fails if it fails. Blank means
+		//no setup. Key name: setup.
+		AZStd::string setup;
+
+		//SQL run for each benchmark query, which may use generator placeholders. Key name: query.
+		AZStd::string query;
+
+		//Number of queries to run in each pass. Key name: queries.
+		long long queries;
+
+		//Most queries sent but not yet finished. Key name: in_flight.
+		long long inFlight;
+
+		//Number of timed passes. Key name: passes.
+		int passes;
+
+		//Number of queries run before the first pass, which aren't timed. Key name: warmup.
+		long long warmup;
+
+		//Seconds without a result before the scenario gives up. Key name: timeout.
+		int timeout;
+
+		//Open loop target rate, in queries per second. 0 = closed loop, which keeps in_flight queries in flight and runs
+		//queries queries per pass. Key name: rate.
+		long long rate;
+
+		//Open loop arrival pattern. Key name: arrival (fixed or poisson).
+		Arrival arrival;
+
+		//Open loop seconds to send queries for, in each pass. Key name: duration.
+		int duration;
+
+		//Is this an open loop scenario?
+		inline bool IsOpenLoop() const { return rate > 0; };
+
+		//Get the number of queries each pass is expected to run.
+		inline long long GetQueriesPerPass() const { return IsOpenLoop() ? rate * duration : queries; };
+
+		//Create the SQL for one benchmark query.
+		//@param index The index of the query in the pass.
+		//@param pass The pass number, from 1. 0 during warmup.
+		//@param random Random number generator for {random:MIN:MAX} placeholders.
+		std::string GenerateQuery(long long index, int pass, std::mt19937 &random) const;
+
+		//Load scenarios from a scenario file.
+		//@param fileName The file name. May use file IO aliases such as @user@.
+		//@param base Settings for anything the file doesn't set.
+		//@param scenarios Loaded scenarios are added to this list, in file order.
+		//@param error Set to a description of the problem if the file can't be loaded.
+		//@return True if the file was loaded.
+		static bool Load(const std::string &fileName, const BenchmarkScenario &base, std::vector<BenchmarkScenario> &scenarios,
+			std::string &error);
+
+		//Load scenarios from the text of a scenario file.
+		//@param text The scenario file text.
+		//@param base Settings for anything the file doesn't set.
+		//@param scenarios Loaded scenarios are added to this list, in file order.
+		//@param error Set to a description of the problem if the text can't be loaded.
+		//@return True if the text was loaded.
+		static bool Parse(const std::string &text, const BenchmarkScenario &base, std::vector<BenchmarkScenario> &scenarios,
+			std::string &error);
+
+	private:
+
+		//Replace the generator placeholders in a query.
+		//@param sql The query, with placeholders.
+		//@param index The index of the query in the pass.
+		//@param count The number of queries per pass.
+		//@param pass The pass number.
+		//@param random Random number generator for {random:MIN:MAX} placeholders.
+		//@param out Set to the query with placeholders replaced.
+		//@param error Set to a description of the problem if a placeholder is invalid.
+		//@return True if every placeholder was replaced.
+		static bool ExpandPlaceholders(const std::string &sql, long long index, long long count, int pass, std::mt19937 &random,
+			std::string &out, std::string &error);
+
+		//Apply one setting.
+		//@param key The setting name.
+		//@param value The setting value.
+		//@param error Set to a description of the problem if the setting is invalid.
+		//@return True if the setting was applied.
+		bool Set(const std::string &key, const std::string &value, std::string &error);
+
+		//Can a setting be given a list of values?
+		//@param key The setting name.
+		static bool IsMatrixKey(const std::string &key);
+
+		//Split a setting value into its list of values, expanding integer ranges. Ranges may have a step, eg: 100..1000 step 100.
+		//@param value The setting value.
+		//@param values The values are added to this list.
+		//@param error Set to a description of the problem if the value is invalid.
+		//@return True if the value was split.
+		static bool SplitValues(const std::string &value, std::vector<std::string> &values, std::string &error);
+	};
+}
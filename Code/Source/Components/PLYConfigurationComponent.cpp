@@ -40,6 +40,53 @@ PLY::PLYConfigurationComponent::PLYConfigurationComponent()
 	m_managerPriority = p.managerPriority;
 	m_workerPriority = p.workerPriority;
 
+	ObjectSyncSettings os;
+
+	m_saveBatchWindow = os.saveBatchWindow;
+	m_maxSaveBatchSize = os.maxSaveBatchSize;
+	m_maxLoadBatchSize = os.maxLoadBatchSize;
+	m_maxAppliesPerFrame = os.maxAppliesPerFrame;
+	m_saveJitter = os.saveJitter;
+	m_saveLatencyTarget = os.saveLatencyTarget;
+	m_maxSaveIntervalScale = os.maxSaveIntervalScale;
+	m_refreshInterval = os.refreshInterval;
+	m_refreshOverlap = os.refreshOverlap;
+	m_streamingCellSize = os.streamingCellSize;
+	m_streamingRadius = os.streamingRadius;
+	m_streamingPrefetchTime = os.streamingPrefetchTime;
+	m_maxStreamedCells = os.maxStreamedCells;
+	m_journalEnabled = os.journalEnabled;
+	m_journalFileName = os.journalFileName;
+	m_journalSizeMB = os.journalSizeMB;
+	m_journalFlushInterval = os.journalFlushInterval;
+
+	MetricsSettings ms;
+
+	m_metricsExportMode = ms.exportMode;
+	m_metricsExportInterval = ms.exportInterval;
+	m_metricsFileName = ms.fileName;
+	m_metricsFileHistory = ms.fileHistory;
+	m_metricsPort = ms.httpPort;
+
+	TraceSettings ts;
+
+	m_traceEnabled = ts.enabled;
+	m_traceFileName = ts.fileName;
+	m_traceSlowFrameThreshold = ts.slowFrameThreshold;
+
+	FrameSettings fs;
+
+	m_frameEnabled = fs.enabled;
+	m_frameBudget = fs.budget;
+	m_frameWindow = fs.window;
+
+	SlowQuerySettings sq;
+
+	m_slowQueryThreshold = sq.threshold;
+	m_slowQueryFileName = sq.fileName;
+	m_slowQueryExplain = sq.explain;
+	m_slowQueryExplainInterval = sq.explainInterval;
+
 }
 
 PLY::PLYConfigurationComponent::~PLYConfigurationComponent()
@@ -55,7 +102,7 @@ void PLY::PLYConfigurationComponent::Reflect(AZ::ReflectContext* context)
 		// Base classes with serialized data should be listed as additional template
 		// arguments to the Class< T, ... >() function.
 		serialize->Class<PLYConfigurationComponent, AZ::Component>()
-			->Version(1)
+			->Version(11)
 			->Field("LogLevel", &PLYConfigurationComponent::m_logLevel)
 			->Field("Port", &PLYConfigurationComponent::m_port)
 			->Field("Host", &PLYConfigurationComponent::m_host)
@@ -70,6 +117,38 @@ void PLY::PLYConfigurationComponent::Reflect(AZ::ReflectContext* context)
 			->Field("ThreadWaitMode", &PLYConfigurationComponent::m_waitMode)
 			->Field("ThreadManagerPriority", &PLYConfigurationComponent::m_managerPriority)
 			->Field("ThreadWorkerPriority", &PLYConfigurationComponent::m_workerPriority)
+			->Field("SaveBatchWindow", &PLYConfigurationComponent::m_saveBatchWindow)
+			->Field("MaxSaveBatchSize", &PLYConfigurationComponent::m_maxSaveBatchSize)
+			->Field("MaxLoadBatchSize", &PLYConfigurationComponent::m_maxLoadBatchSize)
+			->Field("MaxAppliesPerFrame", &PLYConfigurationComponent::m_maxAppliesPerFrame)
+			->Field("SaveJitter", &PLYConfigurationComponent::m_saveJitter)
+			->Field("SaveLatencyTarget", &PLYConfigurationComponent::m_saveLatencyTarget)
+			->Field("MaxSaveIntervalScale", &PLYConfigurationComponent::m_maxSaveIntervalScale)
+			->Field("RefreshInterval", &PLYConfigurationComponent::m_refreshInterval)
+			->Field("RefreshOverlap", &PLYConfigurationComponent::m_refreshOverlap)
+			->Field("StreamingCellSize", &PLYConfigurationComponent::m_streamingCellSize)
+			->Field("StreamingRadius", &PLYConfigurationComponent::m_streamingRadius)
+			->Field("StreamingPrefetchTime", &PLYConfigurationComponent::m_streamingPrefetchTime)
+			->Field("MaxStreamedCells", &PLYConfigurationComponent::m_maxStreamedCells)
+			->Field("JournalEnabled", &PLYConfigurationComponent::m_journalEnabled)
+			->Field("JournalFileName", &PLYConfigurationComponent::m_journalFileName)
+			->Field("JournalSizeMB", &PLYConfigurationComponent::m_journalSizeMB)
+			->Field("JournalFlushInterval", &PLYConfigurationComponent::m_journalFlushInterval)
+			->Field("MetricsExportMode", &PLYConfigurationComponent::m_metricsExportMode)
+			->Field("MetricsExportInterval", &PLYConfigurationComponent::m_metricsExportInterval)
+			->Field("MetricsFileName", &PLYConfigurationComponent::m_metricsFileName)
+			->Field("MetricsFileHistory", &PLYConfigurationComponent::m_metricsFileHistory)
+			->Field("MetricsPort", &PLYConfigurationComponent::m_metricsPort)
+			->Field("TraceEnabled", &PLYConfigurationComponent::m_traceEnabled)
+			->Field("TraceFileName", &PLYConfigurationComponent::m_traceFileName)
+			->Field("TraceSlowFrameThreshold", &PLYConfigurationComponent::m_traceSlowFrameThreshold)
+			->Field("FrameEnabled", &PLYConfigurationComponent::m_frameEnabled)
+			->Field("FrameBudget", &PLYConfigurationComponent::m_frameBudget)
+			->Field("FrameWindow", &PLYConfigurationComponent::m_frameWindow)
+			->Field("SlowQueryThreshold", &PLYConfigurationComponent::m_slowQueryThreshold)
+			->Field("SlowQueryFileName", &PLYConfigurationComponent::m_slowQueryFileName)
+			->Field("SlowQueryExplain", &PLYConfigurationComponent::m_slowQueryExplain)
+			->Field("SlowQueryExplainInterval", &PLYConfigurationComponent::m_slowQueryExplainInterval)
 			;
 
 		AZ::EditContext* edit = serialize->GetEditContext();
@@ -149,6 +228,156 @@ void PLY::PLYConfigurationComponent::Reflect(AZ::ReflectContext* context)
 				->EnumAttribute(PoolSettings::BELOW_NORMAL, "Below Normal")
 				->EnumAttribute(PoolSettings::IDLE, "Idle")
 				->Attribute(AZ::Edit::Attributes::ChangeNotify, &PLYConfigurationComponent::SendConfigChanges)
+
+				->DataElement(AZ::Edit::UIHandlers::Default, &PLYConfigurationComponent::m_saveBatchWindow,
+					"Save Batch Window (ms)", "Time to collect object sync saves before writing them as a batch. 0 = once per frame")
+				->Attribute(AZ::Edit::Attributes::ChangeNotify, &PLYConfigurationComponent::SendConfigChanges)
+				->Attribute(AZ::Edit::Attributes::Min, 0)
+				->Attribute(AZ::Edit::Attributes::Max, 60000)
+				->DataElement(AZ::Edit::UIHandlers::Default, &PLYConfigurationComponent::m_maxSaveBatchSize,
+					"Max Save Batch Size", "Maximum number of objects written by a single batched save query")
+				->Attribute(AZ::Edit::Attributes::ChangeNotify, &PLYConfigurationComponent::SendConfigChanges)
+				->Attribute(AZ::Edit::Attributes::Min, 1)
+				->Attribute(AZ::Edit::Attributes::Max, 10000)
+				->DataElement(AZ::Edit::UIHandlers::Default, &PLYConfigurationComponent::m_maxLoadBatchSize,
+					"Max Load Batch Size", "Maximum number of objects read by a single batched load query")
+				->Attribute(AZ::Edit::Attributes::ChangeNotify, &PLYConfigurationComponent::SendConfigChanges)
+				->Attribute(AZ::Edit::Attributes::Min, 1)
+				->Attribute(AZ::Edit::Attributes::Max, 100000)
+				->DataElement(AZ::Edit::UIHandlers::Default, &PLYConfigurationComponent::m_maxAppliesPerFrame,
+					"Max Applies Per Frame", "Maximum number of loaded objects applied to their entities each frame. 0 = no limit")
+				->Attribute(AZ::Edit::Attributes::ChangeNotify, &PLYConfigurationComponent::SendConfigChanges)
+				->Attribute(AZ::Edit::Attributes::Min, 0)
+				->Attribute(AZ::Edit::Attributes::Max, 100000)
+				->DataElement(AZ::Edit::UIHandlers::Default, &PLYConfigurationComponent::m_saveJitter,
+					"Save Jitter (%)", "Random variation applied to each automatic save interval, as a percentage of the interval")
+				->Attribute(AZ::Edit::Attributes::ChangeNotify, &PLYConfigurationComponent::SendConfigChanges)
+				->Attribute(AZ::Edit::Attributes::Min, 0)
+				->Attribute(AZ::Edit::Attributes::Max, 100)
+				->DataElement(AZ::Edit::UIHandlers::Default, &PLYConfigurationComponent::m_saveLatencyTarget,
+					"Save Latency Target (ms)", "Automatic save intervals are stretched while saves take longer than this. 0 = fixed intervals")
+				->Attribute(AZ::Edit::Attributes::ChangeNotify, &PLYConfigurationComponent::SendConfigChanges)
+				->Attribute(AZ::Edit::Attributes::Min, 0)
+				->Attribute(AZ::Edit::Attributes::Max, 60000)
+				->DataElement(AZ::Edit::UIHandlers::Default, &PLYConfigurationComponent::m_maxSaveIntervalScale,
+					"Max Save Interval Scale", "Maximum multiplier applied to automatic save intervals while saves are slow")
+				->Attribute(AZ::Edit::Attributes::ChangeNotify, &PLYConfigurationComponent::SendConfigChanges)
+				->Attribute(AZ::Edit::Attributes::Min, 1.0f)
+				->Attribute(AZ::Edit::Attributes::Max, 100.0f)
+				->DataElement(AZ::Edit::UIHandlers::Default, &PLYConfigurationComponent::m_refreshInterval,
+					"Refresh Interval (ms)", "Time between refreshes of objects changed in the database by other processes. 0 = no refresh")
+				->Attribute(AZ::Edit::Attributes::ChangeNotify, &PLYConfigurationComponent::SendConfigChanges)
+				->Attribute(AZ::Edit::Attributes::Min, 0)
+				->Attribute(AZ::Edit::Attributes::Max, 3600000)
+				->DataElement(AZ::Edit::UIHandlers::Default, &PLYConfigurationComponent::m_refreshOverlap,
+					"Refresh Overlap (ms)", "Time before the last refresh to fetch again, to catch saves that committed out of order")
+				->Attribute(AZ::Edit::Attributes::ChangeNotify, &PLYConfigurationComponent::SendConfigChanges)
+				->Attribute(AZ::Edit::Attributes::Min, 0)
+				->Attribute(AZ::Edit::Attributes::Max, 60000)
+				->DataElement(AZ::Edit::UIHandlers::Default, &PLYConfigurationComponent::m_streamingCellSize,
+					"Streaming Cell Size", "Width of the grid cells streamed objects are loaded and evicted in, in world units")
+				->Attribute(AZ::Edit::Attributes::ChangeNotify, &PLYConfigurationComponent::SendConfigChanges)
+				->Attribute(AZ::Edit::Attributes::Min, 1.0f)
+				->Attribute(AZ::Edit::Attributes::Max, 100000.0f)
+				->DataElement(AZ::Edit::UIHandlers::Default, &PLYConfigurationComponent::m_streamingRadius,
+					"Streaming Radius", "Number of cells loaded in each direction around a focus point")
+				->Attribute(AZ::Edit::Attributes::ChangeNotify, &PLYConfigurationComponent::SendConfigChanges)
+				->Attribute(AZ::Edit::Attributes::Min, 0)
+				->Attribute(AZ::Edit::Attributes::Max, 100)
+				->DataElement(AZ::Edit::UIHandlers::Default, &PLYConfigurationComponent::m_streamingPrefetchTime,
+					"Streaming Prefetch Time (s)", "Seconds of movement ahead of a focus point to prefetch cells for. 0 = no prefetching")
+				->Attribute(AZ::Edit::Attributes::ChangeNotify, &PLYConfigurationComponent::SendConfigChanges)
+				->Attribute(AZ::Edit::Attributes::Min, 0.0f)
+				->Attribute(AZ::Edit::Attributes::Max, 60.0f)
+				->DataElement(AZ::Edit::UIHandlers::Default, &PLYConfigurationComponent::m_maxStreamedCells,
+					"Max Streamed Cells", "Maximum number of cells to keep loaded before evicting the least recently needed. A cell count, not a memory size")
+				->Attribute(AZ::Edit::Attributes::ChangeNotify, &PLYConfigurationComponent::SendConfigChanges)
+				->Attribute(AZ::Edit::Attributes::Min, 1)
+				->Attribute(AZ::Edit::Attributes::Max, 100000)
+				->DataElement(AZ::Edit::UIHandlers::CheckBox, &PLYConfigurationComponent::m_journalEnabled,
+					"Save Journal", "Write object sync saves to a local journal file, which a background flusher drains to the database")
+				->Attribute(AZ::Edit::Attributes::ChangeNotify, &PLYConfigurationComponent::SendConfigChanges)
+				->DataElement(AZ::Edit::UIHandlers::Default, &PLYConfigurationComponent::m_journalFileName,
+					"Journal File Name", "Save journal file. May use aliases such as @user@")
+				->Attribute(AZ::Edit::Attributes::ChangeNotify, &PLYConfigurationComponent::SendConfigChanges)
+				->DataElement(AZ::Edit::UIHandlers::Default, &PLYConfigurationComponent::m_journalSizeMB,
+					"Journal Size (MB)", "Size of a new save journal file")
+				->Attribute(AZ::Edit::Attributes::ChangeNotify, &PLYConfigurationComponent::SendConfigChanges)
+				->Attribute(AZ::Edit::Attributes::Min, 1)
+				->Attribute(AZ::Edit::Attributes::Max, 4096)
+				->DataElement(AZ::Edit::UIHandlers::Default, &PLYConfigurationComponent::m_journalFlushInterval,
+					"Journal Flush Interval (ms)", "Time between save journal flushes to the database")
+				->Attribute(AZ::Edit::Attributes::ChangeNotify, &PLYConfigurationComponent::SendConfigChanges)
+				->Attribute(AZ::Edit::Attributes::Min, 1)
+				->Attribute(AZ::Edit::Attributes::Max, 60000)
+
+				->DataElement(AZ::Edit::UIHandlers::ComboBox, &PLYConfigurationComponent::m_metricsExportMode,
+					"Metrics Export", "Export query statistics in Prometheus text format to a file, or on a loopback HTTP port")
+				->EnumAttribute(MetricsSettings::DISABLED, "Disabled")
+				->EnumAttribute(MetricsSettings::TEXT_FILE, "File")
+				->EnumAttribute(MetricsSettings::HTTP, "HTTP")
+				->Attribute(AZ::Edit::Attributes::ChangeNotify, &PLYConfigurationComponent::SendConfigChanges)
+				->DataElement(AZ::Edit::UIHandlers::Default, &PLYConfigurationComponent::m_metricsExportInterval,
+					"Metrics Export Interval (ms)", "Time between writes of the metrics file")
+				->Attribute(AZ::Edit::Attributes::ChangeNotify, &PLYConfigurationComponent::SendConfigChanges)
+				->Attribute(AZ::Edit::Attributes::Min, 100)
+				->Attribute(AZ::Edit::Attributes::Max, 3600000)
+				->DataElement(AZ::Edit::UIHandlers::Default, &PLYConfigurationComponent::m_metricsFileName,
+					"Metrics File Name", "Metrics file. May use aliases such as @user@")
+				->Attribute(AZ::Edit::Attributes::ChangeNotify, &PLYConfigurationComponent::SendConfigChanges)
+				->DataElement(AZ::Edit::UIHandlers::Default, &PLYConfigurationComponent::m_metricsFileHistory,
+					"Metrics File History", "Number of previous metrics files to keep. 0 = only the latest")
+				->Attribute(AZ::Edit::Attributes::ChangeNotify, &PLYConfigurationComponent::SendConfigChanges)
+				->Attribute(AZ::Edit::Attributes::Min, 0)
+				->Attribute(AZ::Edit::Attributes::Max, 100)
+				->DataElement(AZ::Edit::UIHandlers::Default, &PLYConfigurationComponent::m_metricsPort,
+					"Metrics Port", "Loopback port metrics are served on in HTTP mode")
+				->Attribute(AZ::Edit::Attributes::ChangeNotify, &PLYConfigurationComponent::SendConfigChanges)
+				->Attribute(AZ::Edit::Attributes::Min, 1)
+				->Attribute(AZ::Edit::Attributes::Max, 65535)
+
+				->DataElement(AZ::Edit::UIHandlers::CheckBox, &PLYConfigurationComponent::m_traceEnabled,
+					"Query Trace", "Record a timeline of query work to a ring buffer, which can be dumped as Chrome trace JSON")
+				->Attribute(AZ::Edit::Attributes::ChangeNotify, &PLYConfigurationComponent::SendConfigChanges)
+				->DataElement(AZ::Edit::UIHandlers::Default, &PLYConfigurationComponent::m_traceFileName,
+					"Trace File Name", "Query trace dump file. May use aliases such as @user@")
+				->Attribute(AZ::Edit::Attributes::ChangeNotify, &PLYConfigurationComponent::SendConfigChanges)
+				->DataElement(AZ::Edit::UIHandlers::Default, &PLYConfigurationComponent::m_traceSlowFrameThreshold,
+					"Trace Slow Frame (ms)", "Frame time over which the query trace is dumped automatically. 0 = never")
+				->Attribute(AZ::Edit::Attributes::ChangeNotify, &PLYConfigurationComponent::SendConfigChanges)
+				->Attribute(AZ::Edit::Attributes::Min, 0)
+				->Attribute(AZ::Edit::Attributes::Max, 60000)
+
+				->DataElement(AZ::Edit::UIHandlers::CheckBox, &PLYConfigurationComponent::m_frameEnabled,
+					"Frame Profiling", "Measure the time PLY spends on the main thread each frame, by section and result handler type")
+				->Attribute(AZ::Edit::Attributes::ChangeNotify, &PLYConfigurationComponent::SendConfigChanges)
+				->DataElement(AZ::Edit::UIHandlers::Default, &PLYConfigurationComponent::m_frameBudget,
+					"Frame Budget (us)", "Main thread time PLY may use each frame before a warning is logged. 0 = no warnings")
+				->Attribute(AZ::Edit::Attributes::ChangeNotify, &PLYConfigurationComponent::SendConfigChanges)
+				->Attribute(AZ::Edit::Attributes::Min, 0)
+				->Attribute(AZ::Edit::Attributes::Max, 1000000)
+				->DataElement(AZ::Edit::UIHandlers::Default, &PLYConfigurationComponent::m_frameWindow,
+					"Frame Profiling Window (s)", "Time frame statistics are collected over before they are rolled over")
+				->Attribute(AZ::Edit::Attributes::ChangeNotify, &PLYConfigurationComponent::SendConfigChanges)
+				->Attribute(AZ::Edit::Attributes::Min, 1)
+				->Attribute(AZ::Edit::Attributes::Max, 3600)
+
+				->DataElement(AZ::Edit::UIHandlers::Default, &PLYConfigurationComponent::m_slowQueryThreshold,
+					"Slow Query Threshold (ms)", "Execution time over which queries are written to the slow query log. 0 = no log")
+				->Attribute(AZ::Edit::Attributes::ChangeNotify, &PLYConfigurationComponent::SendConfigChanges)
+				->Attribute(AZ::Edit::Attributes::Min, 0)
+				->Attribute(AZ::Edit::Attributes::Max, 3600000)
+				->DataElement(AZ::Edit::UIHandlers::Default, &PLYConfigurationComponent::m_slowQueryFileName,
+					"Slow Query Log File Name", "Slow query log file. May use aliases such as @user@")
+				->Attribute(AZ::Edit::Attributes::ChangeNotify, &PLYConfigurationComponent::SendConfigChanges)
+				->DataElement(AZ::Edit::UIHandlers::CheckBox, &PLYConfigurationComponent::m_slowQueryExplain,
+					"Slow Query Explain", "Run read only slow queries again with EXPLAIN (ANALYZE, BUFFERS) and log their plan")
+				->Attribute(AZ::Edit::Attributes::ChangeNotify, &PLYConfigurationComponent::SendConfigChanges)
+				->DataElement(AZ::Edit::UIHandlers::Default, &PLYConfigurationComponent::m_slowQueryExplainInterval,
+					"Slow Query Explain Interval (ms)", "Minimum time between EXPLAIN runs of slow queries")
+				->Attribute(AZ::Edit::Attributes::ChangeNotify, &PLYConfigurationComponent::SendConfigChanges)
+				->Attribute(AZ::Edit::Attributes::Min, 0)
+				->Attribute(AZ::Edit::Attributes::Max, 3600000)
 				;
 		}
 	}
@@ -201,4 +430,61 @@ void PLY::PLYConfigurationComponent::SendConfigChanges() const
 	p.workerPriority = m_workerPriority;
 
 	PLYCONF->SetPoolSettings(p);
+
+	ObjectSyncSettings os;
+
+	os.saveBatchWindow = m_saveBatchWindow;
+	os.maxSaveBatchSize = m_maxSaveBatchSize;
+	os.maxLoadBatchSize = m_maxLoadBatchSize;
+	os.maxAppliesPerFrame = m_maxAppliesPerFrame;
+	os.saveJitter = m_saveJitter;
+	os.saveLatencyTarget = m_saveLatencyTarget;
+	os.maxSaveIntervalScale = m_maxSaveIntervalScale;
+	os.refreshInterval = m_refreshInterval;
+	os.refreshOverlap = m_refreshOverlap;
+	os.streamingCellSize = m_streamingCellSize;
+	os.streamingRadius = m_streamingRadius;
+	os.streamingPrefetchTime = m_streamingPrefetchTime;
+	os.maxStreamedCells = m_maxStreamedCells;
+	os.journalEnabled = m_journalEnabled;
+	os.journalFileName = m_journalFileName;
+	os.journalSizeMB = m_journalSizeMB;
+	os.journalFlushInterval = m_journalFlushInterval;
+
+	PLYCONF->SetObjectSyncSettings(os);
+
+	MetricsSettings ms;
+
+	ms.exportMode = m_metricsExportMode;
+	ms.exportInterval = m_metricsExportInterval;
+	ms.fileName = m_metricsFileName;
+	ms.fileHistory = m_metricsFileHistory;
+	ms.httpPort = m_metricsPort;
+
+	PLYCONF->SetMetricsSettings(ms);
+
+	TraceSettings ts;
+
+	ts.enabled = m_traceEnabled;
+	ts.fileName = m_traceFileName;
+	ts.slowFrameThreshold = m_traceSlowFrameThreshold;
+
+	PLYCONF->SetTraceSettings(ts);
+
+	FrameSettings fs;
+
+	fs.enabled = m_frameEnabled;
+	fs.budget = m_frameBudget;
+	fs.window = m_frameWindow;
+
+	PLYCONF->SetFrameSettings(fs);
+
+	SlowQuerySettings sq;
+
+	sq.threshold = m_slowQueryThreshold;
+	sq.fileName = m_slowQueryFileName;
+	sq.explain = m_slowQueryExplain;
+	sq.explainInterval = m_slowQueryExplainInterval;
+
+	PLYCONF->SetSlowQuerySettings(sq);
 }
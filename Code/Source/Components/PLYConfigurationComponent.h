@@ -49,6 +49,48 @@ namespace PLY
 		PoolSettings::Priority m_managerPriority;
 		PoolSettings::Priority m_workerPriority;
 
+		//Automatic object and database synchronisation settings.
+		int m_saveBatchWindow;
+		int m_maxSaveBatchSize;
+		int m_maxLoadBatchSize;
+		int m_maxAppliesPerFrame;
+		int m_saveJitter;
+		int m_saveLatencyTarget;
+		float m_maxSaveIntervalScale;
+		int m_refreshInterval;
+		int m_refreshOverlap;
+		float m_streamingCellSize;
+		int m_streamingRadius;
+		float m_streamingPrefetchTime;
+		int m_maxStreamedCells;
+		bool m_journalEnabled;
+		AZStd::string m_journalFileName;
+		int m_journalSizeMB;
+		int m_journalFlushInterval;
+
+		//Metrics export settings.
+		MetricsSettings::ExportMode m_metricsExportMode;
+		int m_metricsExportInterval;
+		AZStd::string m_metricsFileName;
+		int m_metricsFileHistory;
+		int m_metricsPort;
+
+		//Query timeline trace settings.
+		bool m_traceEnabled;
+		AZStd::string m_traceFileName;
+		int m_traceSlowFrameThreshold;
+
+		//Main thread frame cost profiling settings.
+		bool m_frameEnabled;
+		int m_frameBudget;
+		int m_frameWindow;
+
+		//Slow query log settings.
+		int m_slowQueryThreshold;
+		AZStd::string m_slowQueryFileName;
+		bool m_slowQueryExplain;
+		int m_slowQueryExplainInterval;
+
 		//AZ::Component interface implementation.
 		void Init() override;
 		void Activate() override;
@@ -4,13 +4,11 @@
 #pragma once
 #include <AzCore/Component/Component.h>
 
-#include <AzCore/Component/TickBus.h>
-
 #include <PLY/PLYObjectSyncSaveLoadBus.h>
+#include <PLY/PLYObjectSyncNotificationBus.h>
 #include <PLY/PLYObjectSyncDataStringBus.h>
 #include <PLY/PLYObjectSyncEntitiesBus.h>
-
-#include <PLY/PLYResultBus.h>
+#include <PLY/PLYObjectSyncSystemBus.h>
 
 #include <PLY/PLYTools.h>
 
@@ -19,9 +17,8 @@ namespace PLY
 
 	class PLYObjectSyncComponent
 		: public AZ::Component,
-		public AZ::TickBus::Handler,
-		public PLY::PLYResultBus::Handler,
 		public PLY::PLYObjectSyncSaveLoadBus::Handler,
+		public PLY::PLYObjectSyncNotificationBus::Handler,
 		public PLY::PLYObjectSyncEntitiesBus::Handler
 	{
 
@@ -51,22 +48,28 @@ namespace PLY
 		void Activate() override;
 		void Deactivate() override;
 
-		//Tick handler.
-		void OnTick(float deltaTime, AZ::ScriptTimePoint time) override;
-
-		//Tick order for tick handler.
-		inline int GetTickOrder() override { return AZ::ComponentTickBus::TICK_GAME; };
-
 		//Save object state to database.
 		void Save() override;
 		
 		//Save object state to database, using the provided data string.
 		//@param dataString The data string to save to the database.
 		void Save(std::string dataString) override;
-		
+
+		//Flag the object state as changed since it was last saved.
+		void MarkDirty() override;
+
+		//Called when a queued save of the object state has been written to the database, or has failed.
+		//@param success Was the object state saved successfully?
+		void SaveFinished(bool success) override;
+
 		//Load object state from the database.
 		void Load() override;
-		
+
+		//Called when the object state has been read from the database, or the load has failed.
+		//@param success Was the load query successful?
+		//@param dataString The data string read from the database.
+		void LoadFinished(bool success, std::string dataString) override;
+
 		//Get the object's unique database ID.
 		inline int GetObjectID() override { return m_objectID; };
 		
@@ -83,7 +86,7 @@ namespace PLY
 		inline std::pair<AZ::EntityId, int> GetAllEntityIDandObjectIDs() override { return std::pair<AZ::EntityId, int>(GetEntityId(), m_objectID); };
 		
 		//Get the database configuration details set on this entity.
-		inline DataBaseDetails GetDatabaseDetails() override { DataBaseDetails d(m_tableName, m_IDColumnName, m_dataColumnName); return d; };
+		inline DataBaseDetails GetDatabaseDetails() override { DataBaseDetails d(m_tableName, m_IDColumnName, m_dataColumnName, m_dataFormat, m_positionColumnName, m_updatedAtColumnName); return d; };
 
 		//Reset the state of all objects with automatic database sync capability.
 		void Reset() override;
@@ -96,44 +99,28 @@ namespace PLY
 		static void GetIncompatibleServices(AZ::ComponentDescriptor::DependencyArrayType& incompatible);
 		*/
 
-		//Has the object loaded data on construction?
-		bool m_hasLoaded;
-
-		//Is the loading process in progress?
-		bool m_isLoading;
-
 		//Unique object ID.
 		int m_objectID;
 
 		//Should the object sync with database on load?
 		bool m_syncOnLoad;
 
-		//Has the entity been set visible once?
-		bool m_setVisibleOnce;
-
-		//Has the object been set invisible once?
-		bool m_setInvisibleOnce;
-
 		//Table and column names to use for object data storage and retrieval.
 		AZStd::string m_tableName; //The table in which object data is stored.
 		AZStd::string m_IDColumnName; //Unique ID column. Must be an INT and the PRIMARY KEY so as not to allow duplicates.
 		AZStd::string m_dataColumnName; //The column in which serialised JSON data for the object is stored. Must be of TEXT type.
 
-		//Mutex to lock the data string while it is being changed.
-		std::mutex m_dataStringMutex;
+		//Format of the serialised object data stored in the database.
+		DataFormat m_dataFormat;
 
-		//Data string that represents the state of this object.
-		std::string m_dataString;
+		//Should the object's state be streamed in and out by region, instead of loaded on start?
+		bool m_streamed;
 
-		//Mutex to lock the load query list while it being changed.
-		std::mutex m_queryIDsLoadMutex;
-		//Query IDs of queries sent to the database to load data for this object.
-		std::vector<unsigned long long> m_queryIDsLoad;
+		//PostGIS GEOMETRY column holding the object's world position. Only used if m_streamed is set.
+		AZStd::string m_positionColumnName;
 
-		//Mutex to lock the save query list while it is being changed.
-		std::mutex m_queryIDsSaveMutex;
-		//Query IDs of queries sent to the database to save data for this object.
-		std::vector<unsigned long long> m_queryIDsSave;
+		//TIMESTAMPTZ column set to the time of each save. Used to refresh objects changed by other processes. Blank uses xmin.
+		AZStd::string m_updatedAtColumnName;
 
 		//When to automatically sync object with database.
 		AutomaticUpdateFrequency m_updateFrequencyMode;
@@ -141,11 +128,7 @@ namespace PLY
 		//User-defined object sync frequency, in milliseconds. Only applies if m_updateFrequency is set to USER_DEFINED.
 		int m_userDefinedFrequencyMS; //Milliseconds. 
 
-		//Time since object was last synced with the database.
-		float m_timer;
-
-		//Advertises a result ID is ready.
-		//@param queryID The ID of the ready result.
-		void ResultReady(const unsigned long long queryID) override;
+		//Should automatic saves only happen after the object has been marked dirty via MarkDirty?
+		bool m_saveOnlyWhenDirty;
 	};
 }
\ No newline at end of file
@@ -11,6 +11,9 @@
 #include <PLY/PLYRequestBus.h>
 
 #include <StatsCollector.h>
+#include <QueryTracer.h>
+#include <FrameProfiler.h>
+#include <PLY/PLYConfiguration.hpp>
 
 #include <ISystem.h>
 #include <IConsole.h>
@@ -93,9 +96,14 @@ void Console::ConsoleCommand(IConsoleCmdArgs *cmdArgs)
 							AZ_Printf("PLY", "%s", ("Benchmark passes set to " + std::to_string(passes)).c_str());
 							PLYRequestBus::Broadcast(&PLYRequestBus::Events::SetBenchmarkPasses, passes);
 						}
+						else if (passes == 0 && c3 == "0")
+						{
+							AZ_Printf("PLY", "%s", "Benchmark passes set by each benchmark scenario");
+							PLYRequestBus::Broadcast(&PLYRequestBus::Events::SetBenchmarkPasses, passes);
+						}
 						else
 						{
-							AZ_Printf("PLY", "%s", "Passes must be more than zero");
+							AZ_Printf("PLY", "%s", "Passes must not be negative");
 						}
 					}
 					else
@@ -135,6 +143,66 @@ void Console::ConsoleCommand(IConsoleCmdArgs *cmdArgs)
 						AZ_Printf("PLY", "%s", "Passes must be more than zero");
 					}
 				}
+				else if (c2 == "trace_slow_frame")
+				{
+					const char* command3 = cmdArgs->GetArg(3);
+					AZStd::string c3 = AZStd::string(command3);
+
+					int threshold = -1;
+
+					try
+					{
+						threshold = std::stoi(c3.c_str());
+					}
+					catch (const std::invalid_argument& ia)
+					{
+						//Use variable to avoid compiler warning.
+						ia.what();
+						AZ_Printf("PLY", "%s", "Argument after trace_slow_frame must be an integer");
+					}
+
+					if (threshold >= 0)
+					{
+						AZ_Printf("PLY", "%s", ("Trace slow frame threshold set to " + std::to_string(threshold) + " ms").c_str());
+						TraceSettings ts = PLYCONF->GetTraceSettings();
+						ts.slowFrameThreshold = threshold;
+						PLYCONF->SetTraceSettings(ts);
+					}
+					else
+					{
+						AZ_Printf("PLY", "%s", "Trace slow frame threshold cannot be less than zero");
+					}
+				}
+				else if (c2 == "frame_budget")
+				{
+					const char* command3 = cmdArgs->GetArg(3);
+					AZStd::string c3 = AZStd::string(command3);
+
+					int budget = -1;
+
+					try
+					{
+						budget = std::stoi(c3.c_str());
+					}
+					catch (const std::invalid_argument& ia)
+					{
+						//Use variable to avoid compiler warning.
+						ia.what();
+						AZ_Printf("PLY", "%s", "Argument after frame_budget must be an integer");
+					}
+
+					if (budget >= 0)
+					{
+						AZ_Printf("PLY", "%s", ("Frame budget set to " + std::to_string(budget) + " us").c_str());
+						FrameSettings fs = PLYCONF->GetFrameSettings();
+						fs.budget = budget;
+						PLYCONF->SetFrameSettings(fs);
+					}
+					else
+					{
+						AZ_Printf("PLY", "%s", "Frame budget cannot be less than zero");
+					}
+				}
 				else
 				{
 					AZ_Printf("PLY", "%s", "Unknown set command");
@@ -178,6 +246,11 @@ void Console::ConsoleCommand(IConsoleCmdArgs *cmdArgs)
 							AZ_Printf("PLY", "%s", "Starting benchmark on Stars Dataset");
 							PLYRequestBus::Broadcast(&PLYRequestBus::Events::StartBenchmarkStars);
 						}
+						else if (c3 == "objectsync")
+						{
+							AZ_Printf("PLY", "%s", "Starting benchmark on Object Sync data formats");
+							PLYRequestBus::Broadcast(&PLYRequestBus::Events::StartBenchmarkObjectSync);
+						}
 						else if (c3 == "stars_sequence")
 						{
 							AZ_Printf("PLY", "%s", "Starting benchmark SEQUENCE on Stars Dataset");
@@ -198,6 +271,21 @@ void Console::ConsoleCommand(IConsoleCmdArgs *cmdArgs)
 					AZ_Printf("PLY", "%s", "Stopping Benchmark");
 					PLYRequestBus::Broadcast(&PLYRequestBus::Events::StopBenchmark);
 				}
+				else if (c2 == "scenario")
+				{
+					if (argCount > 3)
+					{
+						//File names are case sensitive on some platforms, so aren't converted to lowercase.
+						AZStd::string fileName = AZStd::string(cmdArgs->GetArg(3));
+
+						AZ_Printf("PLY", "%s", ("Starting benchmark scenarios from " + fileName).c_str());
+						PLYRequestBus::Broadcast(&PLYRequestBus::Events::StartBenchmarkScenarios, fileName);
+					}
+					else
+					{
+						AZ_Printf("PLY", "%s", "Benchmark scenario requires a scenario file name");
+					}
+				}
 				else
 				{
 					AZ_Printf("PLY", "%s", "Unknown benchmark command");
@@ -229,6 +317,63 @@ void Console::ConsoleCommand(IConsoleCmdArgs *cmdArgs)
 					AZ_Printf("PLY", "%s", "Stopping Statistics Display");
 					STATS->Stop();
 				}
+				else if (c2 == "counters")
+				{
+					STATS->PrintQueryCounters();
+				}
+				else if (c2 == "latency")
+				{
+					STATS->PrintLatencyStats();
+				}
+				else if (c2 == "latency_reset")
+				{
+					AZ_Printf("PLY", "%s", "Resetting Latency Statistics");
+					STATS->ResetLatencyStats();
+				}
+				else if (c2 == "statements")
+				{
+					int limit = 10;
+					if (argCount > 3)
+					{
+						const char* command3 = cmdArgs->GetArg(3);
+						AZStd::string c3 = AZStd::string(command3);
+
+						try
+						{
+							limit = std::stoi(c3.c_str());
+						}
+						catch (const std::invalid_argument& ia)
+						{
+							//Use variable to avoid compiler warning.
+							ia.what();
+							AZ_Printf("PLY", "%s", "Argument after statements must be an integer");
+							limit = 0;
+						}
+					}
+
+					if (limit > 0)
+					{
+						STATS->PrintStatementStats(static_cast<size_t>(limit));
+					}
+					else
+					{
+						AZ_Printf("PLY", "%s", "Statements count must be greater than 0");
+					}
+				}
+				else if (c2 == "locks")
+				{
+					STATS->PrintLockStats();
+				}
+				else if (c2 == "locks_reset")
+				{
+					AZ_Printf("PLY", "%s", "Resetting Lock Statistics");
+					STATS->ResetLockStats();
+				}
+				else if (c2 == "statements_reset")
+				{
+					AZ_Printf("PLY", "%s", "Resetting Statement Statistics");
+					STATS->ResetStatementStats();
+				}
 				else
 				{
 					AZ_Printf("PLY", "%s", "Unknown stats command");
@@ -239,6 +384,100 @@ void Console::ConsoleCommand(IConsoleCmdArgs *cmdArgs)
 				AZ_Printf("PLY", "%s", "Stats requires an additional command");
 			}
 		}
+		else if (c1 == "trace")
+		{
+			if (argCount > 2)
+			{
+				const char* command2 = cmdArgs->GetArg(2);
+				AZStd::string c2 = AZStd::string(command2);
+
+				//Convert argument to lowercase
+				std::transform(c2.begin(), c2.end(), c2.begin(),
+					[](unsigned char c) { return std::tolower(c); });
+
+				TraceSettings ts = PLYCONF->GetTraceSettings();
+
+				if (c2 == "start")
+				{
+					AZ_Printf("PLY", "%s", "Starting Query Trace");
+					ts.enabled = true;
+					PLYCONF->SetTraceSettings(ts);
+				}
+				else if (c2 == "stop")
+				{
+					AZ_Printf("PLY", "%s", "Stopping Query Trace");
+					ts.enabled = false;
+					PLYCONF->SetTraceSettings(ts);
+				}
+				else if (c2 == "dump")
+				{
+					//The file name is optional, and is not lowercased.
+					AZStd::string fileName = argCount > 3 ? AZStd::string(cmdArgs->GetArg(3)) : ts.fileName;
+
+					long long spans = TRACER->Dump(fileName);
+					if (spans >= 0)
+					{
+						AZ_Printf("PLY", "%s", ("Wrote " + std::to_string(spans) + " trace spans to " + std::string(fileName.c_str())).c_str());
+					}
+					else
+					{
+						AZ_Printf("PLY", "%s", ("Couldn't write trace file " + std::string(fileName.c_str())).c_str());
+					}
+				}
+				else
+				{
+					AZ_Printf("PLY", "%s", "Unknown trace command");
+				}
+			}
+			else
+			{
+				AZ_Printf("PLY", "%s", "Trace requires an additional command");
+			}
+		}
+		else if (c1 == "frame")
+		{
+			if (argCount > 2)
+			{
+				const char* command2 = cmdArgs->GetArg(2);
+				AZStd::string c2 = AZStd::string(command2);
+
+				//Convert argument to lowercase
+				std::transform(c2.begin(), c2.end(), c2.begin(),
+					[](unsigned char c) { return std::tolower(c); });
+
+				FrameSettings fs = PLYCONF->GetFrameSettings();
+
+				if (c2 == "start")
+				{
+					AZ_Printf("PLY", "%s", "Starting Frame Profiling");
+					fs.enabled = true;
+					PLYCONF->SetFrameSettings(fs);
+				}
+				else if (c2 == "stop")
+				{
+					AZ_Printf("PLY", "%s", "Stopping Frame Profiling");
+					fs.enabled = false;
+					PLYCONF->SetFrameSettings(fs);
+				}
+				else if (c2 == "stats")
+				{
+					FRAMEPROFILER->Print();
+				}
+				else if (c2 == "reset")
+				{
+					AZ_Printf("PLY", "%s", "Resetting Frame Statistics");
+					FRAMEPROFILER->Reset();
+				}
+				else
+				{
+					AZ_Printf("PLY", "%s", "Unknown frame command");
+				}
+			}
+			else
+			{
+				AZ_Printf("PLY", "%s", "Frame requires an additional command");
+			}
+		}
 		else
 		{
 			AZ_Printf("PLY", "%s", "Unknown PLY command");
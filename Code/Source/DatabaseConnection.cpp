@@ -0,0 +1,36 @@
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#include "DatabaseConnection.h"
+
+using namespace PLY;
+
+PLY::PostgresConnection::PostgresConnection(const AZStd::string &connectionString)
+	: m_c(connectionString.c_str())
+{
+}
+
+PLY::PostgresConnection::~PostgresConnection()
+{
+}
+
+pqxx::result PLY::PostgresConnection::Execute(const std::string &query, const std::vector<std::string> &binaryParams)
+{
+	//AUTOMATIC TRANSACTIONS DISABLED WHILE A LIPQXX LIBRARY BUG IS BEING RESOLVED
+	//See Github ticket #42 https://github.com/ash-j-f/PLY/issues/42
+	/*if (useTransaction)
+	{
+		pqxx::work w(m_c);
+		pqxx::result r = w.exec(query);
+		w.commit();
+		return r;
+	}*/
+
+	pqxx::nontransaction w(m_c);
+	if (binaryParams.empty()) return w.exec(query);
+
+	std::vector<pqxx::binarystring> params;
+	params.reserve(binaryParams.size());
+	for (const std::string &p : binaryParams) params.emplace_back(p);
+
+	return w.exec_params(query, pqxx::prepare::make_dynamic_params(params));
+}
@@ -0,0 +1,52 @@
+// Database connection used by query workers. The query engine opens one for each worker through its connection factory,
+// which opens PostgreSQL connections unless it is replaced, such as with fake connections for benchmarks and tests.
+// Connections report errors with the same pqxx exceptions as a PostgreSQL connection, so workers handle them the same way.
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <PLY/PLYTools.h>
+#include <PLY/PLYTypes.h>
+
+namespace PLY
+{
+	class DatabaseConnection
+	{
+	public:
+
+		virtual ~DatabaseConnection() {};
+
+		//Run a query. Throws pqxx::broken_connection if the connection is lost, in which case the connection is discarded,
+		//or another pqxx::pqxx_exception if the query fails.
+		//@param query The SQL string.
+		//@param binaryParams The parameter values, in placeholder order. Empty for a query without parameters.
+		//@return The result set.
+		virtual pqxx::result Execute(const std::string &query, const std::vector<std::string> &binaryParams) = 0;
+	};
+
+	//Opens a connection. Throws pqxx::failure if the connection can't be established.
+	//@param connectionString The connection string from the PLY configuration.
+	using ConnectionFactory = std::function<std::unique_ptr<DatabaseConnection>(const AZStd::string &connectionString)>;
+
+	//Connection to a PostgreSQL server.
+	class PostgresConnection : public DatabaseConnection
+	{
+	public:
+
+		//Throws pqxx::failure if the connection can't be established.
+		//@param connectionString The connection string.
+		PostgresConnection(const AZStd::string &connectionString);
+		~PostgresConnection();
+
+		pqxx::result Execute(const std::string &query, const std::vector<std::string> &binaryParams) override;
+
+	private:
+
+		pqxx::connection m_c;
+	};
+}
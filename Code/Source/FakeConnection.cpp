@@ -0,0 +1,153 @@
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#include "FakeConnection.h"
+
+#include <cmath>
+#include <new>
+
+#include <libpq-fe.h>
+#include <pqxx/internal/gates/result-creation.hxx>
+
+using namespace PLY;
+
+namespace
+{
+	//libpqxx only wraps libpq results in a pqxx::result inside the library, through its private result_creation gate.
+	//Explicit template instantiations may name private members, which gets the gate's create function here, so synthetic
+	//libpq results can be wrapped like any other.
+	using CreateResultFunction = pqxx::result (*)(pqxx::internal::pq::PGresult *, const std::string &,
+		pqxx::internal::encoding_group);
+
+	struct CreateResultTag
+	{
+		friend CreateResultFunction GetCreateResult(CreateResultTag);
+	};
+
+	template <CreateResultFunction F>
+	struct CreateResultAccess
+	{
+		friend CreateResultFunction GetCreateResult(CreateResultTag) { return F; }
+	};
+
+	template struct CreateResultAccess<&pqxx::internal::gate::result_creation::create>;
+
+	//PostgreSQL type OID of text.
+	const Oid TEXT_OID = 25;
+}
+
+PLY::FakeConnection::FakeConnection(const FakeConnectionSettings &settings)
+	: m_settings(settings)
+{
+	//Give each connection its own random sequence.
+	static std::atomic<unsigned int> connections(0);
+	m_random.seed(m_settings.seed + connections++);
+
+	if (m_settings.connectLatency > 0) std::this_thread::sleep_for(std::chrono::microseconds(m_settings.connectLatency));
+
+	if (Roll(m_settings.connectFailureRate)) throw pqxx::broken_connection("Fake connection failed.");
+
+	m_result = CreateResult(m_settings.rows, m_settings.columns, m_settings.fieldSize);
+}
+
+PLY::FakeConnection::~FakeConnection()
+{
+}
+
+pqxx::result PLY::FakeConnection::Execute(const std::string &query, const std::vector<std::string> &)
+{
+	std::chrono::microseconds latency = GetLatency();
+	if (latency.count() > 0) std::this_thread::sleep_for(latency);
+
+	if (Roll(m_settings.disconnectRate)) throw pqxx::broken_connection("Fake connection lost.");
+
+	if (Roll(m_settings.errorRate)) throw pqxx::sql_error("ERROR:  Fake SQL error.", query, "XX000");
+
+	return m_result;
+}
+
+PLY::ConnectionFactory PLY::FakeConnection::GetFactory(const FakeConnectionSettings &settings)
+{
+	return [settings](const AZStd::string &) -> std::unique_ptr<DatabaseConnection>
+	{
+		return std::make_unique<FakeConnection>(settings);
+	};
+}
+
+pqxx::result PLY::FakeConnection::CreateResult(int rows, int columns, int fieldSize)
+{
+	PGresult *r = PQmakeEmptyPGresult(nullptr, PGRES_TUPLES_OK);
+	if (r == nullptr) throw std::bad_alloc();
+
+	if (columns > 0)
+	{
+		//libpq copies the column names.
+		std::vector<std::string> names;
+		std::vector<PGresAttDesc> attributes(columns);
+		for (int i = 0; i < columns; ++i) names.push_back("c" + std::to_string(i + 1));
+		for (int i = 0; i < columns; ++i)
+		{
+			attributes[i] = PGresAttDesc();
+			attributes[i].name = &names[i][0];
+			attributes[i].typid = TEXT_OID;
+			attributes[i].typlen = -1;
+			attributes[i].atttypmod = -1;
+		}
+
+		if (!PQsetResultAttrs(r, columns, attributes.data()))
+		{
+			PQclear(r);
+			throw std::bad_alloc();
+		}
+
+		//libpq copies the field values too.
+		std::string value(std::max(fieldSize, 0), 'x');
+		for (int row = 0; row < rows; ++row)
+		{
+			for (int col = 0; col < columns; ++col)
+			{
+				if (!PQsetvalue(r, row, col, &value[0], static_cast<int>(value.size())))
+				{
+					PQclear(r);
+					throw std::bad_alloc();
+				}
+			}
+		}
+	}
+
+	return GetCreateResult(CreateResultTag())(r, "", pqxx::internal::encoding_group::MONOBYTE);
+}
+
+std::chrono::microseconds PLY::FakeConnection::GetLatency()
+{
+	if (m_settings.latency <= 0) return std::chrono::microseconds(0);
+
+	double latency = m_settings.latency;
+
+	switch (m_settings.distribution)
+	{
+		case FakeConnectionSettings::UNIFORM:
+			latency = std::uniform_real_distribution<double>(0, 2.0 * latency)(m_random);
+			break;
+		case FakeConnectionSettings::EXPONENTIAL:
+			latency = std::exponential_distribution<double>(1.0 / latency)(m_random);
+			break;
+		case FakeConnectionSettings::LOGNORMAL:
+		{
+			//Choose the log mean so the latency still averages the setting.
+			double sigma = m_settings.latencySigma;
+			latency = std::lognormal_distribution<double>(std::log(latency) - sigma * sigma / 2, sigma)(m_random);
+			break;
+		}
+		default:
+			break;
+	}
+
+	return std::chrono::microseconds(static_cast<long long>(latency));
+}
+
+bool PLY::FakeConnection::Roll(double chance)
+{
+	if (chance <= 0) return false;
+	if (chance >= 1) return true;
+	return std::uniform_real_distribution<double>(0, 1)(m_random) < chance;
+}
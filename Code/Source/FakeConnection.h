@@ -0,0 +1,108 @@
+// Fake database connection for the PLY Gem. Answers every query in process with a synthetic result set after a simulated
+// delay, without a network or a PostgreSQL server, so PLY's own scheduling overhead and concurrency can be measured and
+// tested on their own. Latency, result size, SQL errors, lost connections and connection failures are all configurable.
+// Only the tests and the benchmarks are built with fake connections. The gem and the query engine library aren't.
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#pragma once
+
+#include <chrono>
+#include <random>
+
+#include "DatabaseConnection.h"
+
+namespace PLY
+{
+	struct FakeConnectionSettings
+	{
+	public:
+
+		//Query latency distributions. FIXED always takes the latency. UNIFORM takes from 0 to twice the latency.
+		//EXPONENTIAL and LOGNORMAL average the latency, with LOGNORMAL's long tail set by latencySigma.
+		enum Distribution { FIXED, UNIFORM, EXPONENTIAL, LOGNORMAL };
+
+		FakeConnectionSettings() :
+			distribution(FIXED),
+			latency(0),
+			latencySigma(1.0),
+			connectLatency(0),
+			rows(1),
+			columns(1),
+			fieldSize(8),
+			errorRate(0),
+			disconnectRate(0),
+			connectFailureRate(0),
+			seed(1)
+		{};
+		~FakeConnectionSettings() {};
+
+		Distribution distribution;
+
+		//Average query latency, in microseconds.
+		int latency;
+
+		//Standard deviation of the log of the latency, for LOGNORMAL.
+		double latencySigma;
+
+		//Time to open a connection, in microseconds.
+		int connectLatency;
+
+		//Size of every result set.
+		int rows;
+		int columns;
+		//Bytes in each field.
+		int fieldSize;
+
+		//Chance of each query failing with an SQL error, from 0 to 1.
+		double errorRate;
+
+		//Chance of each query losing the connection, from 0 to 1.
+		double disconnectRate;
+
+		//Chance of each connection attempt failing, from 0 to 1.
+		double connectFailureRate;
+
+		//Random seed. Each connection gets its own sequence, based on the seed and the order connections are opened in.
+		unsigned int seed;
+	};
+
+	class FakeConnection : public DatabaseConnection
+	{
+	public:
+
+		//Throws pqxx::broken_connection if the connection attempt is set to fail.
+		//@param settings The fake connection settings.
+		FakeConnection(const FakeConnectionSettings &settings);
+		~FakeConnection();
+
+		//Wait for the simulated latency, then return the synthetic result set, or throw the injected error.
+		pqxx::result Execute(const std::string &query, const std::vector<std::string> &binaryParams) override;
+
+		//Get a connection factory that opens fake connections. The connection string is ignored.
+		//@param settings The fake connection settings.
+		static ConnectionFactory GetFactory(const FakeConnectionSettings &settings);
+
+		//Build a synthetic result set.
+		//@param rows The number of rows.
+		//@param columns The number of columns, named c1, c2 and so on, of type text.
+		//@param fieldSize Bytes in each field.
+		static pqxx::result CreateResult(int rows, int columns, int fieldSize);
+
+	private:
+
+		FakeConnectionSettings m_settings;
+
+		std::mt19937 m_random;
+
+		//The result set returned by every query. Result sets are read only and share their data, so one is built per connection.
+		pqxx::result m_result;
+
+		//Get the latency of the next query.
+		std::chrono::microseconds GetLatency();
+
+		//Roll against a chance.
+		//@param chance The chance, from 0 to 1.
+		//@return True if the roll succeeds.
+		bool Roll(double chance);
+	};
+}
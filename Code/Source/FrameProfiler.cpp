@@ -0,0 +1,224 @@
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#include "FrameProfiler.h"
+
+#include <algorithm>
+
+#include <PLY/PLYConfiguration.hpp>
+#include <PLYLog.h>
+
+using namespace PLY;
+
+PLY::FrameProfiler::FrameProfiler()
+	: m_enabled(false),
+	m_budget(0),
+	m_window(10),
+	m_tickStart(0),
+	m_lockWait(0),
+	m_windowStart(0),
+	m_overBudgetFrames(0),
+	m_worstFrame(0),
+	m_lastWarning(0)
+{
+}
+
+PLY::FrameProfiler::~FrameProfiler()
+{
+}
+
+FrameProfiler *PLY::FrameProfiler::getInstance()
+{
+	static FrameProfiler instance;
+	return &instance;
+}
+
+void PLY::FrameProfiler::BeginFrame()
+{
+	FrameSettings fs = PLYCONF->GetFrameSettings();
+
+	if (fs.enabled && !m_enabled.load(std::memory_order_relaxed))
+	{
+		//Start from a clean window each time profiling is switched on.
+		m_mainThread = std::this_thread::get_id();
+		Reset();
+		m_windowStart = Now();
+	}
+
+	m_budget = fs.budget;
+	m_window = fs.window;
+	m_enabled.store(fs.enabled, std::memory_order_release);
+
+	m_tickStart = fs.enabled ? Now() : 0;
+}
+
+void PLY::FrameProfiler::EndFrame()
+{
+	if (m_tickStart == 0) return;
+
+	unsigned long long now = Now();
+	unsigned long long tick = now - m_tickStart;
+	unsigned long long frame = tick + m_lockWait;
+	m_tickStart = 0;
+	m_lockWait = 0;
+
+	std::lock_guard<std::mutex> lock(m_sectionsMutex);
+
+	GetSection("Frame").frameTime = frame;
+	GetSection("Frame").ran = true;
+	GetSection("Tick").frameTime = tick;
+	GetSection("Tick").ran = true;
+
+	//The section that took longest this frame, other than the totals, for budget warnings.
+	const Section *worst = nullptr;
+
+	for (std::unique_ptr<Section> &s : m_sections)
+	{
+		if (!s->ran) continue;
+
+		s->window.Record(s->frameTime);
+
+		if (s->name != "Frame" && s->name != "Tick" && (worst == nullptr || s->frameTime > worst->frameTime)) worst = s.get();
+
+		s->frameTime = 0;
+		s->ran = false;
+	}
+
+	if (m_budget > 0 && frame > static_cast<unsigned long long>(m_budget))
+	{
+		m_overBudgetFrames++;
+		if (frame > m_worstFrame)
+		{
+			m_worstFrame = frame;
+			m_worstSection = worst != nullptr ? worst->name : "Tick";
+		}
+
+		if (now - m_lastWarning >= WARNING_INTERVAL)
+		{
+			PLYLOG(PLYLog::PLY_WARNING, AZStd::string::format("PLY went over its frame budget of %d us in %llu frames. Worst frame %llu us, mostly %s.",
+				m_budget, m_overBudgetFrames, m_worstFrame, m_worstSection.c_str()));
+
+			m_lastWarning = now;
+			m_overBudgetFrames = 0;
+			m_worstFrame = 0;
+		}
+	}
+
+	//Roll the window over.
+	if (now - m_windowStart >= static_cast<unsigned long long>(m_window) * 1000000ULL)
+	{
+		for (std::unique_ptr<Section> &s : m_sections)
+		{
+			s->last = s->window.GetSnapshot();
+			s->hasLast = true;
+			s->window.Reset();
+		}
+		m_windowStart = now;
+	}
+}
+
+void PLY::FrameProfiler::Add(const std::string &section, unsigned long long microseconds)
+{
+	std::lock_guard<std::mutex> lock(m_sectionsMutex);
+
+	Section &s = GetSection(section);
+	s.frameTime += microseconds;
+	s.ran = true;
+}
+
+std::unique_lock<PLYMutex> PLY::FrameProfiler::Lock(PLYMutex &mutex)
+{
+	//Only time the wait if there is one, so uncontended locks never read the clock.
+	std::unique_lock<PLYMutex> lock(mutex, std::try_to_lock);
+	if (lock.owns_lock()) return lock;
+
+	if (!IsEnabled() || std::this_thread::get_id() != m_mainThread)
+	{
+		lock.lock();
+		return lock;
+	}
+
+	unsigned long long start = Now();
+	lock.lock();
+	unsigned long long wait = Now() - start;
+
+	Add("Lock wait", wait);
+
+	//Waits inside the tick are already part of the tick time.
+	if (m_tickStart == 0) m_lockWait += wait;
+
+	return lock;
+}
+
+std::vector<PLYFrameSectionStats> PLY::FrameProfiler::GetSnapshot() const
+{
+	std::vector<PLYFrameSectionStats> out;
+
+	std::lock_guard<std::mutex> lock(m_sectionsMutex);
+
+	for (const std::unique_ptr<Section> &s : m_sections)
+	{
+		PLYFrameSectionStats stats;
+		stats.name = s->name.c_str();
+		stats.time = s->hasLast ? s->last : s->window.GetSnapshot();
+		out.push_back(stats);
+	}
+
+	std::sort(out.begin(), out.end(), [](const PLYFrameSectionStats &a, const PLYFrameSectionStats &b)
+	{
+		if (a.name == "Frame" || b.name == "Frame") return a.name == "Frame" && b.name != "Frame";
+		return a.time.mean > b.time.mean;
+	});
+
+	return out;
+}
+
+void PLY::FrameProfiler::Print() const
+{
+	if (!IsEnabled())
+	{
+		AZ_Printf("PLY", "%s", "PLY FRAME: Frame profiling is disabled. Start it with \"ply frame start\".");
+		return;
+	}
+
+	std::vector<PLYFrameSectionStats> stats = GetSnapshot();
+
+	AZ_Printf("PLY", "%s", "PLY FRAME (us): frames      mean       p50       p99      p999       max  section");
+
+	for (const PLYFrameSectionStats &s : stats)
+	{
+		AZ_Printf("PLY", "PLY FRAME (us): %6llu %9.1f %9llu %9llu %9llu %9llu  %s", s.time.count, s.time.mean, s.time.p50,
+			s.time.p99, s.time.p999, s.time.max, s.name.c_str());
+	}
+}
+
+void PLY::FrameProfiler::Reset()
+{
+	std::lock_guard<std::mutex> lock(m_sectionsMutex);
+
+	for (std::unique_ptr<Section> &s : m_sections)
+	{
+		s->frameTime = 0;
+		s->ran = false;
+		s->window.Reset();
+		s->last = PLYLatencyPhaseStats();
+		s->hasLast = false;
+	}
+
+	m_windowStart = Now();
+}
+
+FrameProfiler::Section &PLY::FrameProfiler::GetSection(const std::string &name)
+{
+	for (std::unique_ptr<Section> &s : m_sections)
+	{
+		if (s->name == name) return *s;
+	}
+
+	std::unique_ptr<Section> s = std::make_unique<Section>();
+	s->name = name;
+	s->frameTime = 0;
+	s->ran = false;
+	s->hasLast = false;
+	m_sections.push_back(std::move(s));
+	return *m_sections.back();
+}
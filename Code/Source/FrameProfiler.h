@@ -0,0 +1,155 @@
+// Main thread frame cost profiler for the PLY Gem. Designed to be used as a singleton via the provided macro.
+// Measures how long PLY spends on the main thread each frame: the PLY system component's tick, the object sync tick, each
+// type of ResultReady handler, and main thread waits for PLY's locks. Each section's time is added up over a frame and
+// recorded into a histogram once the frame ends, and the histograms are rolled over every profiling window. A warning is
+// logged when PLY goes over its frame budget. While profiling is disabled, each section costs one branch.
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <memory>
+#include <thread>
+#include <chrono>
+
+#include <PLY/PLYTypes.h>
+#include <PLY/PLYMutex.hpp>
+
+#include "LatencyHistogram.h"
+
+#define FRAMEPROFILER PLY::FrameProfiler::getInstance()
+
+namespace PLY
+{
+	class FrameProfiler
+	{
+	public:
+
+		//Get a singleton instance.
+		static FrameProfiler *getInstance();
+
+		//Is frame profiling enabled?
+		inline bool IsEnabled() const { return m_enabled.load(std::memory_order_acquire); };
+
+		//Get the current time, in microseconds.
+		inline static unsigned long long Now()
+		{
+			return static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()).count());
+		};
+
+		//Start a frame. Called first thing in the PLY system component's tick, on the main thread. Applies the frame
+		//profiling settings.
+		void BeginFrame();
+
+		//End a frame. Called last thing in the PLY system component's tick. Records the frame's section times, checks
+		//the frame budget and rolls over the profiling window.
+		void EndFrame();
+
+		//Add time to a section of the current frame. Main thread only.
+		//@param section The section name.
+		//@param microseconds The time to add.
+		void Add(const std::string &section, unsigned long long microseconds);
+
+		//Lock one of PLY's mutexes. On the main thread, while profiling is enabled, time spent waiting for the lock is
+		//added to the frame's lock wait.
+		//@param mutex The mutex.
+		//@return The lock, which owns the mutex.
+		std::unique_lock<PLYMutex> Lock(PLYMutex &mutex);
+
+		//Get statistics for every section over the last complete profiling window, or the current window if none has
+		//completed yet. "Frame" is first, and the rest are sorted by mean time, highest first.
+		std::vector<PLYFrameSectionStats> GetSnapshot() const;
+
+		//Print the frame statistics to the game console.
+		void Print() const;
+
+		//Remove all recorded statistics.
+		void Reset();
+
+	private:
+
+		//Minimum time between frame budget warnings, in microseconds.
+		static const unsigned long long WARNING_INTERVAL = 1000000;
+
+		struct Section
+		{
+			std::string name;
+
+			//Time added in the current frame.
+			unsigned long long frameTime;
+
+			//Did the section run in the current frame?
+			bool ran;
+
+			//Histogram for the current window.
+			LatencyHistogram window;
+
+			//Statistics for the last complete window.
+			PLYLatencyPhaseStats last;
+			bool hasLast;
+		};
+
+		//Sections, in the order they were first seen. Kept in unique_ptrs as histograms are large and can't be moved.
+		std::vector<std::unique_ptr<Section>> m_sections;
+
+		//Mutex to lock sections while they are added, recorded or read. Only the main thread changes them, so this is
+		//only contended while statistics are read from another thread.
+		mutable std::mutex m_sectionsMutex;
+
+		//Settings, applied at the start of each frame. Enabled is read by any thread that takes a lock through Lock().
+		std::atomic<bool> m_enabled;
+		int m_budget;
+		int m_window;
+
+		//The thread that ticks the PLY system component. Set before profiling is first enabled.
+		std::thread::id m_mainThread;
+
+		//Start time of the current frame's tick. 0 outside of a tick.
+		unsigned long long m_tickStart;
+
+		//Main thread lock waits since the last frame ended.
+		unsigned long long m_lockWait;
+
+		//Start time of the current window.
+		unsigned long long m_windowStart;
+
+		//Frames over budget, and the worst of them, since the last warning.
+		unsigned long long m_overBudgetFrames;
+		unsigned long long m_worstFrame;
+		std::string m_worstSection;
+		unsigned long long m_lastWarning;
+
+		//Get a section, adding it if needed. m_sectionsMutex must be held.
+		//@param name The section name.
+		Section &GetSection(const std::string &name);
+
+		FrameProfiler();
+		~FrameProfiler();
+	};
+
+	//Adds the time from its creation to its destruction to a frame section, while frame profiling is enabled.
+	class FrameSpan
+	{
+	public:
+
+		//@param section The section name.
+		explicit FrameSpan(const char *section)
+			: m_section(section),
+			m_start(FRAMEPROFILER->IsEnabled() ? FrameProfiler::Now() : 0)
+		{};
+
+		~FrameSpan()
+		{
+			if (m_start != 0) FRAMEPROFILER->Add(m_section, FrameProfiler::Now() - m_start);
+		};
+
+	private:
+
+		const char *m_section;
+		unsigned long long m_start;
+	};
+}
@@ -0,0 +1,109 @@
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#include "LatencyHistogram.h"
+
+#include <limits>
+#include <algorithm>
+
+using namespace PLY;
+
+PLY::LatencyHistogram::LatencyHistogram()
+{
+	Reset();
+}
+
+PLY::LatencyHistogram::~LatencyHistogram()
+{
+}
+
+void PLY::LatencyHistogram::Record(unsigned long long microseconds)
+{
+	m_counts[GetBucket(microseconds)].fetch_add(1, std::memory_order_relaxed);
+	m_sum.fetch_add(microseconds, std::memory_order_relaxed);
+
+	unsigned long long current = m_min.load(std::memory_order_relaxed);
+	while (microseconds < current && !m_min.compare_exchange_weak(current, microseconds, std::memory_order_relaxed)) {}
+
+	current = m_max.load(std::memory_order_relaxed);
+	while (microseconds > current && !m_max.compare_exchange_weak(current, microseconds, std::memory_order_relaxed)) {}
+}
+
+PLYLatencyPhaseStats PLY::LatencyHistogram::GetSnapshot() const
+{
+	PLYLatencyPhaseStats stats;
+
+	//Copy the counts first, so the percentiles are worked out from one consistent set.
+	std::array<unsigned long long, BUCKET_COUNT> counts;
+	unsigned long long total = 0;
+	for (size_t i = 0; i < BUCKET_COUNT; ++i)
+	{
+		counts[i] = m_counts[i].load(std::memory_order_relaxed);
+		total += counts[i];
+	}
+
+	if (total == 0) return stats;
+
+	stats.count = total;
+	stats.mean = static_cast<double>(m_sum.load(std::memory_order_relaxed)) / static_cast<double>(total);
+	stats.min = m_min.load(std::memory_order_relaxed);
+	stats.max = m_max.load(std::memory_order_relaxed);
+
+	const double percentiles[4] = { 0.5, 0.9, 0.99, 0.999 };
+	unsigned long long *results[4] = { &stats.p50, &stats.p90, &stats.p99, &stats.p999 };
+
+	unsigned long long seen = 0;
+	size_t p = 0;
+	for (size_t i = 0; i < BUCKET_COUNT && p < 4; ++i)
+	{
+		seen += counts[i];
+
+		//A percentile is the first bucket holding at least that fraction of all values.
+		while (p < 4 && static_cast<double>(seen) >= percentiles[p] * static_cast<double>(total))
+		{
+			//Bucket values are approximate, so keep them within the exact minimum and maximum.
+			*results[p] = std::max(stats.min, std::min(stats.max, GetBucketValue(i)));
+			p++;
+		}
+	}
+
+	return stats;
+}
+
+void PLY::LatencyHistogram::Reset()
+{
+	for (std::atomic<unsigned long long> &c : m_counts) c.store(0, std::memory_order_relaxed);
+	m_sum.store(0, std::memory_order_relaxed);
+	m_min.store(std::numeric_limits<unsigned long long>::max(), std::memory_order_relaxed);
+	m_max.store(0, std::memory_order_relaxed);
+}
+
+size_t PLY::LatencyHistogram::GetBucket(unsigned long long value)
+{
+	if (value < SUB_BUCKET_COUNT) return static_cast<size_t>(value);
+
+	//Position of the highest set bit.
+	int magnitude = 0;
+	for (unsigned long long v = value; v > 1; v >>= 1) magnitude++;
+
+	if (magnitude > MAX_MAGNITUDE) return BUCKET_COUNT - 1;
+
+	//Keep the top SUB_BUCKET_BITS bits of the value. The highest is always set, so only the half below it varies.
+	int shift = magnitude - SUB_BUCKET_BITS + 1;
+	unsigned long long sub = (value >> shift) - SUB_BUCKET_HALF;
+
+	return static_cast<size_t>(SUB_BUCKET_COUNT + (shift - 1) * SUB_BUCKET_HALF + sub);
+}
+
+unsigned long long PLY::LatencyHistogram::GetBucketValue(size_t bucket)
+{
+	if (bucket < SUB_BUCKET_COUNT) return bucket;
+
+	size_t k = bucket - SUB_BUCKET_COUNT;
+	int shift = static_cast<int>(k / SUB_BUCKET_HALF) + 1;
+	unsigned long long sub = k % SUB_BUCKET_HALF + SUB_BUCKET_HALF;
+
+	unsigned long long low = sub << shift;
+	unsigned long long width = 1ULL << shift;
+
+	return low + width / 2;
+}
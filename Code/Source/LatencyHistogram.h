@@ -0,0 +1,62 @@
+// Lock-free latency histogram. Values are recorded into log-linear buckets, as in HDR histograms: each power of two range
+// is split into 32 linear sub-buckets, so percentiles read back within about 3% of the recorded value, from 1 microsecond
+// up to several days, in a fixed amount of memory. Recording is a handful of relaxed atomic operations, so any number of
+// threads can record at once without locks.
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#pragma once
+
+#include <atomic>
+#include <array>
+
+#include <PLY/PLYTypes.h>
+
+class PLYTest_LatencyHistogramBuckets_Test;
+
+namespace PLY
+{
+	class LatencyHistogram
+	{
+
+	friend PLYTest_LatencyHistogramBuckets_Test;
+
+	public:
+
+		LatencyHistogram();
+		~LatencyHistogram();
+
+		//Record a value.
+		//@param microseconds The value, in microseconds.
+		void Record(unsigned long long microseconds);
+
+		//Get the number of values, mean, minimum, maximum and percentiles recorded so far. Values recorded while the
+		//snapshot is taken may or may not be included.
+		PLYLatencyPhaseStats GetSnapshot() const;
+
+		//Remove all recorded values.
+		void Reset();
+
+	private:
+
+		//Number of bits of each value kept in its bucket. Values below 2^SUB_BUCKET_BITS have a bucket each.
+		static const int SUB_BUCKET_BITS = 6;
+		static const unsigned long long SUB_BUCKET_COUNT = 1ULL << SUB_BUCKET_BITS;
+		static const unsigned long long SUB_BUCKET_HALF = SUB_BUCKET_COUNT / 2;
+
+		//Highest power of two range covered. Larger values are recorded in the top bucket.
+		static const int MAX_MAGNITUDE = 40;
+
+		static const size_t BUCKET_COUNT = SUB_BUCKET_COUNT + (MAX_MAGNITUDE - SUB_BUCKET_BITS + 1) * SUB_BUCKET_HALF;
+
+		std::array<std::atomic<unsigned long long>, BUCKET_COUNT> m_counts;
+		std::atomic<unsigned long long> m_sum;
+		std::atomic<unsigned long long> m_min;
+		std::atomic<unsigned long long> m_max;
+
+		//Get the bucket a value is recorded in.
+		static size_t GetBucket(unsigned long long value);
+
+		//Get the value reported for a bucket, which is the middle of the range of values it holds.
+		static unsigned long long GetBucketValue(size_t bucket);
+	};
+}
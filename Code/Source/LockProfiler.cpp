@@ -0,0 +1,135 @@
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#ifdef PLY_LOCK_PROFILING
+
+#include "LockProfiler.h"
+#include <PLY/PLYMutex.hpp>
+
+using namespace PLY;
+
+PLY::LockProfiler::LockProfiler()
+	: m_lockCount(0)
+{
+}
+
+PLY::LockProfiler::~LockProfiler()
+{
+}
+
+LockProfiler *PLY::LockProfiler::getInstance()
+{
+	static LockProfiler instance;
+	return &instance;
+}
+
+int PLY::LockProfiler::Register(const char *name)
+{
+	std::lock_guard<std::mutex> lock(m_registerMutex);
+
+	int count = m_lockCount.load(std::memory_order_relaxed);
+	for (int i = 0; i < count; ++i)
+	{
+		if (m_locks[i].name == name) return i;
+	}
+
+	if (count >= static_cast<int>(MAX_LOCKS)) return -1;
+
+	m_locks[count].name = name;
+	m_lockCount.store(count + 1, std::memory_order_release);
+	return count;
+}
+
+void PLY::LockProfiler::RecordAcquire(int lockID, unsigned long long waitTime, bool contended)
+{
+	if (lockID < 0) return;
+
+	m_locks[lockID].wait.Record(waitTime);
+	if (contended) m_locks[lockID].contended.Add();
+}
+
+void PLY::LockProfiler::RecordRelease(int lockID, unsigned long long holdTime)
+{
+	if (lockID < 0) return;
+
+	m_locks[lockID].hold.Record(holdTime);
+}
+
+std::vector<PLYLockStats> PLY::LockProfiler::GetSnapshot() const
+{
+	std::lock_guard<std::mutex> lock(m_registerMutex);
+
+	std::vector<PLYLockStats> out;
+	int count = m_lockCount.load(std::memory_order_acquire);
+	for (int i = 0; i < count; ++i)
+	{
+		PLYLockStats s;
+		s.name = m_locks[i].name.c_str();
+		s.wait = m_locks[i].wait.GetSnapshot();
+		s.hold = m_locks[i].hold.GetSnapshot();
+		s.acquisitions = static_cast<long long>(s.wait.count);
+		s.contended = m_locks[i].contended.Get();
+		out.push_back(s);
+	}
+	return out;
+}
+
+void PLY::LockProfiler::Reset()
+{
+	std::lock_guard<std::mutex> lock(m_registerMutex);
+
+	for (Lock &l : m_locks)
+	{
+		l.contended.Reset();
+		l.wait.Reset();
+		l.hold.Reset();
+	}
+}
+
+PLY::PLYMutex::PLYMutex(const char *name)
+	: m_lockID(LOCKPROFILER->Register(name))
+{
+}
+
+PLY::PLYMutex::~PLYMutex()
+{
+}
+
+void PLY::PLYMutex::lock()
+{
+	//Try without waiting first, so uncontended locks only read the clock once.
+	if (m_mutex.try_lock())
+	{
+		m_acquired = std::chrono::steady_clock::now();
+		LOCKPROFILER->RecordAcquire(m_lockID, 0, false);
+		return;
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	m_mutex.lock();
+	m_acquired = std::chrono::steady_clock::now();
+
+	LOCKPROFILER->RecordAcquire(m_lockID,
+		static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(m_acquired - start).count()), true);
+}
+
+bool PLY::PLYMutex::try_lock()
+{
+	if (!m_mutex.try_lock()) return false;
+
+	m_acquired = std::chrono::steady_clock::now();
+	LOCKPROFILER->RecordAcquire(m_lockID, 0, false);
+	return true;
+}
+
+void PLY::PLYMutex::unlock()
+{
+	//Read the acquire time before unlocking, as another thread may overwrite it as soon as the lock is released.
+	std::chrono::steady_clock::time_point acquired = m_acquired;
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	m_mutex.unlock();
+
+	LOCKPROFILER->RecordRelease(m_lockID,
+		static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - acquired).count()));
+}
+
+#endif
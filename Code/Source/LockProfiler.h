@@ -0,0 +1,76 @@
+// Lock profiler for the PLY Gem. Designed to be used as a singleton via the provided macro.
+// Keeps acquisition counts and wait and hold time histograms for each named PLYMutex. Only used when the gem is built with
+// PLY_LOCK_PROFILING defined.
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#pragma once
+
+#include <mutex>
+#include <array>
+#include <vector>
+#include <string>
+
+#include <PLY/PLYTypes.h>
+
+#include "LatencyHistogram.h"
+#include "ShardedCounter.h"
+
+#define LOCKPROFILER PLY::LockProfiler::getInstance()
+
+namespace PLY
+{
+	class LockProfiler
+	{
+	public:
+
+		//Get a singleton instance.
+		static LockProfiler *getInstance();
+
+		//Get the ID of a lock's statistics, adding them if the name hasn't been seen before.
+		//@param name The lock's name.
+		//@return The lock ID, or -1 if there are already MAX_LOCKS names.
+		int Register(const char *name);
+
+		//Record a lock being acquired. Safe to call from any thread.
+		//@param lockID The lock ID.
+		//@param waitTime Time spent waiting for the lock, in nanoseconds.
+		//@param contended Was the lock held by another thread when it was asked for?
+		void RecordAcquire(int lockID, unsigned long long waitTime, bool contended);
+
+		//Record a lock being released. Safe to call from any thread.
+		//@param lockID The lock ID.
+		//@param holdTime Time the lock was held, in nanoseconds.
+		void RecordRelease(int lockID, unsigned long long holdTime);
+
+		//Get statistics for every lock.
+		std::vector<PLYLockStats> GetSnapshot() const;
+
+		//Remove all recorded statistics. Lock names are kept.
+		void Reset();
+
+	private:
+
+		//Most lock names tracked.
+		static const size_t MAX_LOCKS = 16;
+
+		struct Lock
+		{
+			std::string name;
+			ShardedCounter contended;
+			LatencyHistogram wait;
+			LatencyHistogram hold;
+		};
+
+		//Statistics for each lock, indexed by lock ID.
+		std::array<Lock, MAX_LOCKS> m_locks;
+
+		//Number of lock IDs given out. Only changed with m_registerMutex held, but read without it.
+		std::atomic<int> m_lockCount;
+
+		//Mutex to lock the lock names while a lock is registered.
+		mutable std::mutex m_registerMutex;
+
+		LockProfiler();
+		~LockProfiler();
+	};
+}
@@ -0,0 +1,389 @@
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+
+#include <AzCore/IO/FileIO.h>
+
+#include "MetricsExporter.h"
+#include "StatsCollector.h"
+#include "QueryTracer.h"
+#include "QueryFingerprint.h"
+#include <PLYLog.h>
+
+using namespace PLY;
+
+namespace
+{
+	//Append a metric's help and type lines.
+	void AddHeader(std::string &out, const char *name, const char *type, const char *help)
+	{
+		out += "# HELP ";
+		out += name;
+		out += " ";
+		out += help;
+		out += "\n# TYPE ";
+		out += name;
+		out += " ";
+		out += type;
+		out += "\n";
+	}
+
+	//Append a sample.
+	void AddSample(std::string &out, const char *name, const char *labels, double value)
+	{
+		char buffer[64];
+		snprintf(buffer, sizeof(buffer), " %.9g\n", value);
+		out += name;
+		out += labels;
+		out += buffer;
+	}
+
+	//Escape a label value. Backslashes, quotes and newlines must be escaped.
+	std::string EscapeLabel(const std::string &value)
+	{
+		std::string out;
+		out.reserve(value.size());
+		for (char c : value)
+		{
+			if (c == '\\' || c == '"') out += '\\';
+			if (c == '\n')
+			{
+				out += "\\n";
+				continue;
+			}
+			out += c;
+		}
+		return out;
+	}
+
+	//Append a metric with a single sample.
+	void AddMetric(std::string &out, const char *name, const char *type, const char *help, long long value)
+	{
+		AddHeader(out, name, type, help);
+		AddSample(out, name, "", static_cast<double>(value));
+	}
+}
+
+PLY::MetricsExporter::MetricsExporter()
+	: m_listenSocket(-1),
+	m_shutdown(false)
+{
+}
+
+PLY::MetricsExporter::~MetricsExporter()
+{
+	Stop();
+}
+
+bool PLY::MetricsExporter::Start(const MetricsSettings &settings)
+{
+	if (IsRunning()) return true;
+
+	m_settings = settings;
+	m_shutdown = false;
+
+	if (m_settings.exportMode == MetricsSettings::TEXT_FILE)
+	{
+		//Resolve aliases such as @user@ to a full path.
+		char resolved[1024] = { 0 };
+		AZ::IO::FileIOBase *f = AZ::IO::FileIOBase::GetInstance();
+		m_path = (f != nullptr && f->ResolvePath(m_settings.fileName.c_str(), resolved, sizeof(resolved))) ? resolved : m_settings.fileName.c_str();
+
+		m_exporterThread = std::thread([this] { FileLoop(); });
+
+		PLYLOG(PLYLog::PLY_INFO, "Exporting metrics to " + AZStd::string(m_path.c_str()));
+	}
+	else if (m_settings.exportMode == MetricsSettings::HTTP)
+	{
+		if (!OpenListenSocket(m_settings.httpPort))
+		{
+			PLYLOG(PLYLog::PLY_ERROR, AZStd::string::format("Couldn't listen for metrics scrapes on port %d.", m_settings.httpPort));
+			return false;
+		}
+
+		m_exporterThread = std::thread([this] { HttpLoop(); });
+
+		PLYLOG(PLYLog::PLY_INFO, AZStd::string::format("Serving metrics on http://127.0.0.1:%d/metrics", m_settings.httpPort));
+	}
+
+	return IsRunning();
+}
+
+void PLY::MetricsExporter::Stop()
+{
+	if (!IsRunning()) return;
+
+	{
+		std::unique_lock<std::mutex> lock(m_exporterMutex);
+		m_shutdown = true;
+	}
+	m_exporterCV.notify_one();
+	m_exporterThread.join();
+
+	if (AZ::AzSock::IsAzSocketValid(m_listenSocket))
+	{
+		AZ::AzSock::CloseSocket(m_listenSocket);
+		AZ::AzSock::Cleanup();
+		m_listenSocket = -1;
+	}
+
+	PLYLOG(PLYLog::PLY_INFO, "Stopped exporting metrics.");
+}
+
+std::string PLY::MetricsExporter::Render()
+{
+	PLYQueryCounters c = STATS->GetQueryCounters();
+	PLYLatencyStats l = STATS->GetLatencyStats();
+
+	std::string out;
+	out.reserve(4096);
+
+	AddMetric(out, "ply_queries_sent_total", "counter", "Queries sent to the query queue.", c.queriesSent);
+	AddMetric(out, "ply_results_received_total", "counter", "Query results taken from the results queue.", c.resultsReceived);
+	AddMetric(out, "ply_result_bytes_received_total", "counter", "Size of all fields in all result sets received.", c.bytesReceived);
+	AddMetric(out, "ply_sql_errors_total", "counter", "Queries that failed with an SQL error.", c.sqlErrors);
+	AddMetric(out, "ply_processor_errors_total", "counter", "Results whose result processor threw an error.", c.processorErrors);
+	AddMetric(out, "ply_query_ttl_expiries_total", "counter", "Queries removed from the query queue by their TTL.", c.queryTTLExpiries);
+	AddMetric(out, "ply_result_ttl_expiries_total", "counter", "Results removed from the results queue by their TTL.", c.resultTTLExpiries);
+	AddMetric(out, "ply_connections_opened_total", "counter", "Database connections opened by query workers.", c.connectionsOpened);
+	AddMetric(out, "ply_connection_failures_total", "counter", "Failed attempts to open a database connection.", c.connectionFailures);
+	AddMetric(out, "ply_reconnects_total", "counter", "Connections opened again after a connection failed or was lost.", c.reconnects);
+	AddMetric(out, "ply_connections_open", "gauge", "Database connections currently open.", c.openConnections);
+	AddMetric(out, "ply_query_queue_depth", "gauge", "Queries in the query queue.", c.queueDepth);
+	AddMetric(out, "ply_query_queue_depth_max", "gauge", "Most queries in the query queue at once.", c.maxQueueDepth);
+	AddMetric(out, "ply_busy_workers", "gauge", "Query workers running a query.", c.busyWorkers);
+	AddMetric(out, "ply_busy_workers_max", "gauge", "Most query workers running a query at once.", c.maxBusyWorkers);
+
+	//Latency is exported as a summary, with quantiles taken from the collector's histograms. Times are in seconds.
+	const std::pair<const char *, const PLYLatencyPhaseStats *> phases[4] = {
+		{ "queue_wait", &l.queueWait },
+		{ "execution", &l.execution },
+		{ "publish", &l.publish },
+		{ "total", &l.total }
+	};
+
+	AddHeader(out, "ply_query_latency_seconds", "summary", "Time spent in each phase of query processing.");
+	for (const std::pair<const char *, const PLYLatencyPhaseStats *> &p : phases)
+	{
+		const PLYLatencyPhaseStats &s = *p.second;
+
+		const std::pair<const char *, unsigned long long> quantiles[4] = {
+			{ "0.5", s.p50 }, { "0.9", s.p90 }, { "0.99", s.p99 }, { "0.999", s.p999 }
+		};
+
+		std::string labels;
+		for (const std::pair<const char *, unsigned long long> &q : quantiles)
+		{
+			labels = std::string("{phase=\"") + p.first + "\",quantile=\"" + q.first + "\"}";
+			AddSample(out, "ply_query_latency_seconds", labels.c_str(), q.second / 1000000.0);
+		}
+
+		labels = std::string("{phase=\"") + p.first + "\"}";
+		AddSample(out, "ply_query_latency_seconds_sum", labels.c_str(), s.mean * s.count / 1000000.0);
+		AddSample(out, "ply_query_latency_seconds_count", labels.c_str(), static_cast<double>(s.count));
+	}
+
+	AddHeader(out, "ply_query_latency_max_seconds", "gauge", "Longest time spent in each phase of query processing.");
+	for (const std::pair<const char *, const PLYLatencyPhaseStats *> &p : phases)
+	{
+		std::string labels = std::string("{phase=\"") + p.first + "\"}";
+		AddSample(out, "ply_query_latency_max_seconds", labels.c_str(), p.second->max / 1000000.0);
+	}
+
+	//Per statement metrics, labelled by fingerprint. Only the statements with the highest total time are exported, to
+	//keep the number of series down. The statement text is only on the info metric, so it is sent once per statement.
+	std::vector<PLYStatementStats> statements = STATS->GetStatementStats(STATEMENT_LIMIT);
+
+	std::vector<std::string> statementLabels;
+	statementLabels.reserve(statements.size());
+	for (const PLYStatementStats &s : statements)
+	{
+		statementLabels.push_back("{fingerprint=\"" + QueryFingerprint::ToHex(s.fingerprint) + "\"}");
+	}
+
+	AddHeader(out, "ply_statement_info", "gauge", "Normalised statement text for each fingerprint.");
+	for (size_t i = 0; i < statements.size(); ++i)
+	{
+		std::string labels = "{fingerprint=\"" + QueryFingerprint::ToHex(statements[i].fingerprint) +
+			"\",query=\"" + EscapeLabel(statements[i].query.c_str()) + "\"}";
+		AddSample(out, "ply_statement_info", labels.c_str(), 1);
+	}
+
+	AddHeader(out, "ply_statement_calls_total", "counter", "Queries run for each fingerprint.");
+	for (size_t i = 0; i < statements.size(); ++i)
+	{
+		AddSample(out, "ply_statement_calls_total", statementLabels[i].c_str(), static_cast<double>(statements[i].calls));
+	}
+
+	AddHeader(out, "ply_statement_errors_total", "counter", "Queries that failed with an SQL error for each fingerprint.");
+	for (size_t i = 0; i < statements.size(); ++i)
+	{
+		AddSample(out, "ply_statement_errors_total", statementLabels[i].c_str(), static_cast<double>(statements[i].errors));
+	}
+
+	AddHeader(out, "ply_statement_rows_total", "counter", "Rows returned for each fingerprint.");
+	for (size_t i = 0; i < statements.size(); ++i)
+	{
+		AddSample(out, "ply_statement_rows_total", statementLabels[i].c_str(), static_cast<double>(statements[i].rows));
+	}
+
+	AddHeader(out, "ply_statement_bytes_total", "counter", "Size of all fields in all result sets returned for each fingerprint.");
+	for (size_t i = 0; i < statements.size(); ++i)
+	{
+		AddSample(out, "ply_statement_bytes_total", statementLabels[i].c_str(), static_cast<double>(statements[i].bytes));
+	}
+
+	AddHeader(out, "ply_statement_seconds_total", "counter", "Time from queries being sent to their results being ready for each fingerprint, including queue wait.");
+	for (size_t i = 0; i < statements.size(); ++i)
+	{
+		AddSample(out, "ply_statement_seconds_total", statementLabels[i].c_str(), statements[i].totalTime / 1000000.0);
+	}
+
+	AddHeader(out, "ply_statement_execution_seconds_total", "counter", "Time spent executing queries for each fingerprint.");
+	for (size_t i = 0; i < statements.size(); ++i)
+	{
+		AddSample(out, "ply_statement_execution_seconds_total", statementLabels[i].c_str(), statements[i].executionTime / 1000000.0);
+	}
+
+	return out;
+}
+
+void PLY::MetricsExporter::FileLoop()
+{
+	TRACER->SetThreadName("Metrics Exporter");
+
+	while (!m_shutdown)
+	{
+		WriteFile();
+
+		std::unique_lock<std::mutex> lock(m_exporterMutex);
+		m_exporterCV.wait_for(lock, std::chrono::milliseconds(std::max(100, m_settings.exportInterval)), [this] { return m_shutdown.load(); });
+	}
+}
+
+bool PLY::MetricsExporter::WriteFile()
+{
+	//Write to a temporary file first, so a collector never reads a half written file.
+	std::string temp = m_path + ".tmp";
+	{
+		std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			PLYLOG(PLYLog::PLY_ERROR, "Couldn't write metrics file " + AZStd::string(temp.c_str()));
+			return false;
+		}
+		file << Render();
+		if (!file) return false;
+	}
+
+	//Shift previous files along, dropping the oldest.
+	std::error_code ec;
+	for (int i = m_settings.fileHistory; i > 0; --i)
+	{
+		std::string from = i > 1 ? m_path + "." + std::to_string(i - 1) : m_path;
+		if (std::filesystem::exists(from, ec)) std::filesystem::rename(from, m_path + "." + std::to_string(i), ec);
+	}
+
+	//Renaming replaces any existing file in one step.
+	std::filesystem::rename(temp, m_path, ec);
+	if (ec)
+	{
+		PLYLOG(PLYLog::PLY_ERROR, "Couldn't replace metrics file " + AZStd::string(m_path.c_str()) + ": " + AZStd::string(ec.message().c_str()));
+		return false;
+	}
+
+	return true;
+}
+
+bool PLY::MetricsExporter::OpenListenSocket(int port)
+{
+	AZ::AzSock::Startup();
+
+	m_listenSocket = AZ::AzSock::Socket();
+	if (!AZ::AzSock::IsAzSocketValid(m_listenSocket))
+	{
+		AZ::AzSock::Cleanup();
+		return false;
+	}
+
+	AZ::AzSock::SetSocketOption(m_listenSocket, AZ::AzSock::AZSocketOption::REUSEADDR, true);
+
+	//Only listen on the loopback interface, so metrics are never exposed to the network.
+	AZ::AzSock::AzSocketAddress address;
+	if (!address.SetAddress("127.0.0.1", static_cast<AZ::u16>(port)) ||
+		AZ::AzSock::Bind(m_listenSocket, address) != 0 ||
+		AZ::AzSock::Listen(m_listenSocket, 8) != 0)
+	{
+		AZ::AzSock::CloseSocket(m_listenSocket);
+		AZ::AzSock::Cleanup();
+		m_listenSocket = -1;
+		return false;
+	}
+
+	return true;
+}
+
+void PLY::MetricsExporter::HttpLoop()
+{
+	TRACER->SetThreadName("Metrics Exporter");
+
+	while (!m_shutdown)
+	{
+		//Wait briefly for a connection, so shutdown is never held up for long.
+		AZTIMEVAL timeout = { 0, 100000 };
+		if (AZ::AzSock::IsRecvPending(m_listenSocket, &timeout) <= 0) continue;
+
+		AZ::AzSock::AzSocketAddress clientAddress;
+		AZSOCKET client = AZ::AzSock::Accept(m_listenSocket, clientAddress);
+		if (!AZ::AzSock::IsAzSocketValid(client)) continue;
+
+		ServeClient(client);
+
+		AZ::AzSock::CloseSocket(client);
+	}
+}
+
+void PLY::MetricsExporter::ServeClient(AZSOCKET client)
+{
+	//Read until the end of the request headers. Requests have no body, and anything past the first line is ignored.
+	std::string request;
+	char buffer[1024];
+	while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192)
+	{
+		AZTIMEVAL timeout = { 1, 0 };
+		if (AZ::AzSock::IsRecvPending(client, &timeout) <= 0) return;
+
+		int received = AZ::AzSock::Recv(client, buffer, sizeof(buffer), 0);
+		if (received <= 0) return;
+		request.append(buffer, received);
+	}
+
+	std::string status = "200 OK";
+	std::string body;
+	if (request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 6, "GET / ") == 0)
+	{
+		body = Render();
+	}
+	else
+	{
+		status = "404 Not Found";
+		body = "Metrics are served at /metrics\n";
+	}
+
+	std::string response = "HTTP/1.0 " + status + "\r\n"
+		"Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+		"Content-Length: " + std::to_string(body.size()) + "\r\n"
+		"Connection: close\r\n\r\n" + body;
+
+	size_t sent = 0;
+	while (sent < response.size() && !m_shutdown)
+	{
+		int n = AZ::AzSock::Send(client, response.data() + sent, static_cast<int>(response.size() - sent), 0);
+		if (n <= 0) return;
+		sent += static_cast<size_t>(n);
+	}
+}
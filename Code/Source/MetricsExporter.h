@@ -0,0 +1,86 @@
+// Exports query statistics from the stats collector in Prometheus text exposition format, from a background thread.
+// Metrics are either written to a file at a fixed interval, for a collector such as the node exporter's textfile
+// collector to pick up, or served over HTTP on a loopback port for Prometheus to scrape directly.
+// The stats collector's counters, gauges, histograms and per statement statistics are all read without locks, so
+// exporting never holds up the query worker threads or the main thread.
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#pragma once
+
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+
+#include <AzCore/Socket/AzSocket.h>
+
+#include <PLY/PLYTypes.h>
+
+namespace PLY
+{
+	class MetricsExporter
+	{
+	public:
+
+		MetricsExporter();
+		~MetricsExporter();
+
+		//Start exporting metrics. Does nothing if the export mode is DISABLED.
+		//@param settings The metrics export settings.
+		//@return True if exporting started.
+		bool Start(const MetricsSettings &settings);
+
+		//Stop exporting metrics, and wait for the exporter thread to finish.
+		void Stop();
+
+		//Is the exporter running?
+		inline bool IsRunning() const { return m_exporterThread.joinable(); };
+
+		//Render the current statistics in Prometheus text exposition format.
+		static std::string Render();
+
+	private:
+
+		//Most statements exported, by total time.
+		static const size_t STATEMENT_LIMIT = 50;
+
+		//The settings the exporter was started with.
+		MetricsSettings m_settings;
+
+		//Metrics file name, with aliases resolved.
+		std::string m_path;
+
+		//Listening socket, in HTTP mode.
+		AZSOCKET m_listenSocket;
+
+		//Exporter thread.
+		std::thread m_exporterThread;
+
+		//Wakes the exporter thread.
+		std::condition_variable m_exporterCV;
+		std::mutex m_exporterMutex;
+
+		//Command the exporter thread to shut down.
+		std::atomic<bool> m_shutdown;
+
+		//File mode thread loop.
+		void FileLoop();
+
+		//HTTP mode thread loop.
+		void HttpLoop();
+
+		//Write the current statistics to the metrics file, rotating previous files.
+		//@return True if the file was written.
+		bool WriteFile();
+
+		//Read a request from a connected client and send the response.
+		//@param client The client socket.
+		void ServeClient(AZSOCKET client);
+
+		//Open a listening socket on the loopback interface.
+		//@param port The port to listen on.
+		//@return True if the socket is listening.
+		bool OpenListenSocket(int port);
+	};
+}
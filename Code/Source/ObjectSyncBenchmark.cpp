@@ -0,0 +1,463 @@
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#include "ObjectSyncBenchmark.h"
+
+#include <AzCore/IO/FileIO.h>
+#include <AzCore/JSON/rapidjson.h>
+#include <AzCore/JSON/document.h>
+#include <AzCore/JSON/stringbuffer.h>
+#include <AzCore/JSON/writer.h>
+
+#include <PLY/PLYRequestBus.h>
+#include <PLY/PLYConfiguration.hpp>
+#include <PLY/PLYObjectSyncBinary.hpp>
+
+using namespace PLY;
+
+void PLY::ObjectSyncBenchmarkState::Reflect(AZ::ReflectContext* context)
+{
+	AZ::SerializeContext* serialize = azrtti_cast<AZ::SerializeContext*>(context);
+	if (serialize)
+	{
+		serialize->Class<ObjectSyncBenchmarkState>()
+			->Version(1)
+			->Field("x", &ObjectSyncBenchmarkState::x)
+			->Field("y", &ObjectSyncBenchmarkState::y)
+			->Field("z", &ObjectSyncBenchmarkState::z)
+			->Field("rx", &ObjectSyncBenchmarkState::rx)
+			->Field("ry", &ObjectSyncBenchmarkState::ry)
+			->Field("rz", &ObjectSyncBenchmarkState::rz)
+			->Field("rw", &ObjectSyncBenchmarkState::rw)
+			->Field("health", &ObjectSyncBenchmarkState::health)
+			->Field("name", &ObjectSyncBenchmarkState::name)
+			->Field("inventory", &ObjectSyncBenchmarkState::inventory)
+			;
+	}
+}
+
+PLY::ObjectSyncBenchmark::ObjectSyncBenchmark(const AZStd::string filenamePrefix)
+	: m_phase(SETUP),
+	m_filenamePrefix(filenamePrefix),
+	m_running(false),
+	m_done(false)
+{
+	//Set Run ID to an integer based on current time in millseconds.
+	AZStd::chrono::system_clock::time_point now = AZStd::chrono::system_clock::now();
+	m_runID = static_cast<int>(AZ::ScriptTimePoint(now).GetMilliseconds());
+
+	PLY::PLYResultBus::Handler::BusConnect();
+}
+
+PLY::ObjectSyncBenchmark::~ObjectSyncBenchmark()
+{
+	PLY::PLYResultBus::Handler::BusDisconnect();
+}
+
+void PLY::ObjectSyncBenchmark::Run()
+{
+	if (m_running)
+	{
+		AZ_Printf("Script", "%s", "Benchmark already running.");
+		return;
+	}
+
+	m_running = true;
+
+	AZ_Printf("Script", "%s", ("Starting OBJECT SYNC Benchmark with " + std::to_string(OBJECT_COUNT) + " objects...").c_str());
+
+	PLY::PLYRequestBus::Broadcast(&PLY::PLYRequestBus::Events::InitialisePool);
+
+	//Generate the same test objects on every run, so runs can be compared.
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> position(-10000.0f, 10000.0f);
+	std::uniform_int_distribution<int> item(0, 1000);
+
+	m_objects.resize(OBJECT_COUNT);
+	for (int i = 0; i < OBJECT_COUNT; ++i)
+	{
+		ObjectSyncBenchmarkState &o = m_objects[i];
+		o.x = position(rng);
+		o.y = position(rng);
+		o.z = position(rng);
+		o.health = item(rng);
+		o.name = AZStd::string::format("Benchmark Object %d", i + 1);
+		o.inventory.resize(16);
+		for (int &n : o.inventory) n = item(rng);
+	}
+
+	m_phase = SETUP;
+
+	PLYLOG(PLY::PLYLog::PLY_INFO, "Creating object sync benchmark tables.");
+
+	AZStd::string qString = "CREATE TABLE IF NOT EXISTS ply_test_objects_json(id integer PRIMARY KEY, data text);"
+		"CREATE TABLE IF NOT EXISTS ply_test_objects_binary(id integer PRIMARY KEY, data bytea);"
+		"TRUNCATE ply_test_objects_json, ply_test_objects_binary;";
+
+	unsigned long long queryID = 0;
+	PLY::PLYRequestBus::BroadcastResult(queryID, &PLY::PLYRequestBus::Events::SendQueryNoTransaction, qString);
+	if (queryID == 0)
+	{
+		PLYLOG(PLY::PLYLog::PLY_ERROR, "Benchmark failed. Couldn't send create test tables query. Stopping.");
+		Stop();
+		return;
+	}
+
+	m_waitingQueryIDs.push_back(queryID);
+}
+
+void PLY::ObjectSyncBenchmark::Stop()
+{
+	if (m_running)
+	{
+		m_running = false;
+		m_waitingQueryIDs.clear();
+		m_loadResults.clear();
+		AZ_Printf("PLY", "%s", "Stopping benchmark.");
+	}
+	else
+	{
+		AZ_Printf("PLY", "%s", "Benchmark is not running.");
+	}
+}
+
+void PLY::ObjectSyncBenchmark::ResultReady(const unsigned long long queryID)
+{
+	if (!m_running) return;
+
+	std::vector<unsigned long long>::iterator it = std::find(m_waitingQueryIDs.begin(), m_waitingQueryIDs.end(), queryID);
+	if (it == m_waitingQueryIDs.end()) return;
+	m_waitingQueryIDs.erase(it);
+
+	std::shared_ptr<PLY::PLYResult> result;
+	PLY::PLYRequestBus::BroadcastResult(result, &PLY::PLYRequestBus::Events::GetResult, queryID);
+	PLY::PLYRequestBus::Broadcast(&PLY::PLYRequestBus::Events::RemoveResult, queryID);
+
+	if (result == nullptr || result->errorType != PLY::PLYResult::NONE || result->errorMessage != "")
+	{
+		PLYLOG(PLY::PLYLog::PLY_ERROR, "Benchmark failed. Query error: " + (result != nullptr ? result->errorMessage : AZStd::string("")));
+		Stop();
+		return;
+	}
+
+	if (m_phase == LOAD_JSON || m_phase == LOAD_BINARY) m_loadResults.push_back(result);
+
+	//Wait for the rest of the phase's queries.
+	if (!m_waitingQueryIDs.empty()) return;
+
+	switch (m_phase)
+	{
+	case SAVE_JSON: m_json.saveMS = ElapsedMS(m_phaseStartTime); break;
+	case SAVE_BINARY: m_binary.saveMS = ElapsedMS(m_phaseStartTime); break;
+	case LOAD_JSON: m_json.loadMS = ElapsedMS(m_phaseStartTime); DecodeLoads(false); break;
+	case LOAD_BINARY: m_binary.loadMS = ElapsedMS(m_phaseStartTime); DecodeLoads(true); break;
+	default: break;
+	}
+
+	NextPhase();
+}
+
+void PLY::ObjectSyncBenchmark::NextPhase()
+{
+	m_phase = static_cast<Phase>(m_phase + 1);
+
+	switch (m_phase)
+	{
+	case SAVE_JSON: SendSaves(false); break;
+	case SAVE_BINARY: SendSaves(true); break;
+	case LOAD_JSON: SendLoads(false); break;
+	case LOAD_BINARY: SendLoads(true); break;
+	default:
+		Report();
+		m_running = false;
+		m_done = true;
+		PLYLOG(PLY::PLYLog::PLY_INFO, "Benchmark finished.");
+		break;
+	}
+}
+
+void PLY::ObjectSyncBenchmark::SendSaves(const bool binary)
+{
+	FormatResults &r = binary ? m_binary : m_json;
+
+	PLYLOG(PLY::PLYLog::PLY_INFO, binary ? "Benchmark saving binary objects." : "Benchmark saving JSON objects.");
+
+	//Serialise all objects, as the object sync system would on the main thread.
+	AZ::ScriptTimePoint encodeStart = AZ::ScriptTimePoint(AZStd::chrono::system_clock::now());
+
+	std::vector<std::string> data(m_objects.size());
+	for (size_t i = 0; i < m_objects.size(); ++i)
+	{
+		data[i] = binary ? PLYObjectSyncBinary::Serialize(m_objects[i], SCHEMA_VERSION) : ToJSON(m_objects[i]);
+	}
+
+	r.encodeMS = ElapsedMS(encodeStart);
+	r.bytes = 0;
+	for (const std::string &d : data) r.bytes += d.size();
+
+	//Write objects in batches, in the same form as the object sync system's batched UPSERTs.
+	const size_t batchSize = static_cast<size_t>(std::max(1, PLYCONF->GetObjectSyncSettings().maxSaveBatchSize));
+
+	m_phaseStartTime = AZ::ScriptTimePoint(AZStd::chrono::system_clock::now());
+
+	for (size_t begin = 0; begin < data.size(); begin += batchSize)
+	{
+		size_t end = std::min(data.size(), begin + batchSize);
+
+		std::string qString = std::string("insert into ") + (binary ? "ply_test_objects_binary" : "ply_test_objects_json") + " (id, data) VALUES ";
+		std::vector<std::string> binaryParams;
+
+		for (size_t i = begin; i < end; ++i)
+		{
+			if (i != begin) qString += ", ";
+			if (binary)
+			{
+				binaryParams.push_back(data[i]);
+				qString += "(" + std::to_string(i + 1) + ", $" + std::to_string(binaryParams.size()) + ")";
+			}
+			else
+			{
+				std::string escaped;
+				escaped.reserve(data[i].size());
+				for (char c : data[i])
+				{
+					if (c == '\'') escaped += '\'';
+					escaped += c;
+				}
+				qString += "(" + std::to_string(i + 1) + ", '" + escaped + "')";
+			}
+		}
+
+		qString += " on conflict (id) do update set data = EXCLUDED.data";
+
+		unsigned long long queryID = 0;
+		if (binary)
+		{
+			PLY::PLYRequestBus::BroadcastResult(queryID, &PLY::PLYRequestBus::Events::SendQueryWithBinaryParams, AZStd::string(qString.c_str()),
+				binaryParams, QuerySettings());
+		}
+		else
+		{
+			PLY::PLYRequestBus::BroadcastResult(queryID, &PLY::PLYRequestBus::Events::SendQuery, AZStd::string(qString.c_str()));
+		}
+
+		if (queryID == 0)
+		{
+			PLYLOG(PLY::PLYLog::PLY_ERROR, "Benchmark failed. Couldn't send save query. Stopping.");
+			Stop();
+			return;
+		}
+
+		m_waitingQueryIDs.push_back(queryID);
+	}
+}
+
+void PLY::ObjectSyncBenchmark::SendLoads(const bool binary)
+{
+	PLYLOG(PLY::PLYLog::PLY_INFO, binary ? "Benchmark loading binary objects." : "Benchmark loading JSON objects.");
+
+	m_loadResults.clear();
+
+	//Read objects in batches, in the same form as the object sync system's batched loads.
+	const size_t batchSize = static_cast<size_t>(std::max(1, PLYCONF->GetObjectSyncSettings().maxLoadBatchSize));
+
+	m_phaseStartTime = AZ::ScriptTimePoint(AZStd::chrono::system_clock::now());
+
+	for (size_t begin = 0; begin < m_objects.size(); begin += batchSize)
+	{
+		size_t end = std::min(m_objects.size(), begin + batchSize);
+
+		std::string qString = std::string("select id, data from ") + (binary ? "ply_test_objects_binary" : "ply_test_objects_json") +
+			" where id = ANY('{";
+
+		for (size_t i = begin; i < end; ++i)
+		{
+			if (i != begin) qString += ",";
+			qString += std::to_string(i + 1);
+		}
+
+		qString += "}'::int[])";
+
+		unsigned long long queryID = 0;
+		PLY::PLYRequestBus::BroadcastResult(queryID, &PLY::PLYRequestBus::Events::SendQuery, AZStd::string(qString.c_str()));
+
+		if (queryID == 0)
+		{
+			PLYLOG(PLY::PLYLog::PLY_ERROR, "Benchmark failed. Couldn't send load query. Stopping.");
+			Stop();
+			return;
+		}
+
+		m_waitingQueryIDs.push_back(queryID);
+	}
+}
+
+void PLY::ObjectSyncBenchmark::DecodeLoads(const bool binary)
+{
+	FormatResults &r = binary ? m_binary : m_json;
+
+	//De-serialise all loaded objects, as the objects themselves would on the main thread.
+	//For the binary format this includes unescaping the BYTEA value from the text result format.
+	AZ::ScriptTimePoint decodeStart = AZ::ScriptTimePoint(AZStd::chrono::system_clock::now());
+
+	r.rows = 0;
+	ObjectSyncBenchmarkState o;
+
+	for (const std::shared_ptr<PLY::PLYResult> &result : m_loadResults)
+	{
+		for (const pqxx::row &row : result->resultSet)
+		{
+			bool ok = binary ? PLYObjectSyncBinary::Deserialize(pqxx::binarystring(row[1]).str(), o, SCHEMA_VERSION) : FromJSON(row[1].c_str(), o);
+			if (ok) r.rows++;
+		}
+	}
+
+	r.decodeMS = ElapsedMS(decodeStart);
+
+	m_loadResults.clear();
+}
+
+std::string PLY::ObjectSyncBenchmark::ToJSON(const ObjectSyncBenchmarkState &o)
+{
+	rapidjson::StringBuffer buffer;
+	rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+
+	writer.StartObject();
+	writer.Key("x"); writer.Double(o.x);
+	writer.Key("y"); writer.Double(o.y);
+	writer.Key("z"); writer.Double(o.z);
+	writer.Key("rx"); writer.Double(o.rx);
+	writer.Key("ry"); writer.Double(o.ry);
+	writer.Key("rz"); writer.Double(o.rz);
+	writer.Key("rw"); writer.Double(o.rw);
+	writer.Key("health"); writer.Int(o.health);
+	writer.Key("name"); writer.String(o.name.c_str());
+	writer.Key("inventory");
+	writer.StartArray();
+	for (int n : o.inventory) writer.Int(n);
+	writer.EndArray();
+	writer.EndObject();
+
+	return buffer.GetString();
+}
+
+bool PLY::ObjectSyncBenchmark::FromJSON(const char *s, ObjectSyncBenchmarkState &o)
+{
+	rapidjson::Document d;
+	d.Parse(s);
+
+	if (d.HasParseError() || !d.IsObject())
+	{
+		AZ_Error("PLY", false, "Object sync benchmark state is not a JSON object.");
+		return false;
+	}
+
+	//Check every member is present and has the right type before reading any of them.
+	static const char *NUMBERS[] = { "x", "y", "z", "rx", "ry", "rz", "rw" };
+	for (const char *key : NUMBERS)
+	{
+		if (!d.HasMember(key) || !d[key].IsNumber())
+		{
+			AZ_Error("PLY", false, "Object sync benchmark state member \"%s\" is missing or not a number.", key);
+			return false;
+		}
+	}
+
+	if (!d.HasMember("health") || !d["health"].IsInt())
+	{
+		AZ_Error("PLY", false, "Object sync benchmark state member \"health\" is missing or not an integer.");
+		return false;
+	}
+
+	if (!d.HasMember("name") || !d["name"].IsString())
+	{
+		AZ_Error("PLY", false, "Object sync benchmark state member \"name\" is missing or not a string.");
+		return false;
+	}
+
+	if (!d.HasMember("inventory") || !d["inventory"].IsArray())
+	{
+		AZ_Error("PLY", false, "Object sync benchmark state member \"inventory\" is missing or not an array.");
+		return false;
+	}
+
+	const rapidjson::Value &inventory = d["inventory"];
+	for (rapidjson::SizeType i = 0; i < inventory.Size(); ++i)
+	{
+		if (!inventory[i].IsInt())
+		{
+			AZ_Error("PLY", false, "Object sync benchmark state member \"inventory\" has an item that is not an integer.");
+			return false;
+		}
+	}
+
+	o.x = static_cast<float>(d["x"].GetDouble());
+	o.y = static_cast<float>(d["y"].GetDouble());
+	o.z = static_cast<float>(d["z"].GetDouble());
+	o.rx = static_cast<float>(d["rx"].GetDouble());
+	o.ry = static_cast<float>(d["ry"].GetDouble());
+	o.rz = static_cast<float>(d["rz"].GetDouble());
+	o.rw = static_cast<float>(d["rw"].GetDouble());
+	o.health = d["health"].GetInt();
+	o.name = d["name"].GetString();
+
+	o.inventory.clear();
+	for (rapidjson::SizeType i = 0; i < inventory.Size(); ++i) o.inventory.push_back(inventory[i].GetInt());
+
+	return true;
+}
+
+double PLY::ObjectSyncBenchmark::ElapsedMS(const AZ::ScriptTimePoint &start)
+{
+	return AZ::ScriptTimePoint(AZStd::chrono::system_clock::now()).GetMilliseconds() - start.GetMilliseconds();
+}
+
+void PLY::ObjectSyncBenchmark::Report()
+{
+	auto line = [](const char *name, const FormatResults &r)
+	{
+		AZ_Printf("Script", "%s", (std::string(name) + ": encode " + std::to_string(r.encodeMS) + " ms, save " + std::to_string(r.saveMS) +
+			" ms, " + std::to_string(r.bytes) + " bytes, load " + std::to_string(r.loadMS) + " ms, decode " + std::to_string(r.decodeMS) +
+			" ms, " + std::to_string(r.rows) + " objects loaded.").c_str());
+
+		return std::string(name) + "," + std::to_string(r.encodeMS) + "," + std::to_string(r.saveMS) + "," + std::to_string(r.bytes) + "," +
+			std::to_string(r.loadMS) + "," + std::to_string(r.decodeMS) + "," + std::to_string(r.rows) + "\n";
+	};
+
+	std::string data = "format,encode_ms,save_ms,bytes,load_ms,decode_ms,rows\n";
+	data += line("json", m_json);
+	data += line("binary", m_binary);
+
+	SaveFileData((std::string(m_filenamePrefix.c_str()) + "." + std::to_string(m_runID) + ".bch").c_str(), data.c_str(), false);
+}
+
+void PLY::ObjectSyncBenchmark::SaveFileData(const AZStd::string fileName, const AZStd::string data, const bool append)
+{
+	using namespace AZ::IO;
+
+	const void* dataBuffer = data.c_str();
+
+	try
+	{
+		HandleType fileHandle = InvalidHandle;
+		FileIOBase *f = FileIOBase::GetInstance();
+		if (
+			(!append && f->Open(("benchmark/" + fileName).c_str(), OpenMode::ModeWrite | OpenMode::ModeBinary, fileHandle))
+			||
+			(append && f->Open(("benchmark/" + fileName).c_str(), OpenMode::ModeAppend | OpenMode::ModeBinary, fileHandle))
+		)
+		{
+			//Save data to the config file.
+			f->Write(fileHandle, dataBuffer, data.size());
+
+			f->Close(fileHandle);
+		}
+		else
+		{
+			PLYLOG(PLYLog::PLY_ERROR, "Couldn't save PLY benchmark results file. Unable to open file for saving.");
+		}
+	}
+	catch (const std::exception &e)
+	{
+		PLYLOG(PLYLog::PLY_ERROR, "Couldn't save PLY benchmark results file. Error: " + AZStd::string(e.what()));
+	}
+}
@@ -0,0 +1,154 @@
+// Benchmark class that compares the JSON text and binary object state formats used for automatic object and database
+// synchronisation. Saves and loads a set of test objects in both formats, timing serialisation, database round trips and
+// de-serialisation separately.
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#pragma once
+
+#include <AzCore/Serialization/SerializeContext.h>
+#include <AzCore/std/containers/vector.h>
+
+#include <PLY/PLYResultBus.h>
+#include <PLY/PLYTools.h>
+#include <PLY/PLYTypes.h>
+#include <PLYLog.h>
+
+namespace PLY
+{
+	//Test object state used by the object sync benchmark. Roughly the size of a typical game object's saved state.
+	class ObjectSyncBenchmarkState
+	{
+	public:
+		AZ_TYPE_INFO(ObjectSyncBenchmarkState, "{3B0F6E8A-7C55-4D0B-9E55-0B1E9B2C4A61}");
+
+		ObjectSyncBenchmarkState() :
+			x(0), y(0), z(0), rx(0), ry(0), rz(0), rw(1), health(0), name("")
+		{};
+		~ObjectSyncBenchmarkState() {};
+
+		//Reflect the state to the SerializeContext, so it can be stored in binary blobs.
+		static void Reflect(AZ::ReflectContext* context);
+
+		float x, y, z;
+		float rx, ry, rz, rw;
+		int health;
+		AZStd::string name;
+		AZStd::vector<int> inventory;
+	};
+
+	class ObjectSyncBenchmark :
+		protected PLY::PLYResultBus::Handler
+	{
+
+	public:
+
+		//Number of test objects to save and load.
+		static const int OBJECT_COUNT = 10000;
+
+		//Schema version stored in binary test object blobs.
+		static const uint16_t SCHEMA_VERSION = 1;
+
+		ObjectSyncBenchmark(const AZStd::string filenamePrefix);
+		~ObjectSyncBenchmark();
+
+		//Run benchmark.
+		void Run();
+
+		//Stop current benchmark.
+		void Stop();
+
+		//Is the current benchmark finished?
+		inline bool IsFinished() { return m_done; };
+
+	private:
+
+		//Benchmark phases, run in order.
+		enum Phase { SETUP, SAVE_JSON, SAVE_BINARY, LOAD_JSON, LOAD_BINARY, DONE };
+
+		//Timings for one data format.
+		struct FormatResults
+		{
+			FormatResults() : encodeMS(0), saveMS(0), bytes(0), loadMS(0), decodeMS(0), rows(0) {};
+			double encodeMS; //Time to serialise all objects on the main thread.
+			double saveMS; //Time from sending the save queries until all results are received.
+			size_t bytes; //Total serialised size of all objects.
+			double loadMS; //Time from sending the load queries until all results are received.
+			double decodeMS; //Time to de-serialise all loaded objects on the main thread.
+			size_t rows; //Number of objects loaded.
+		};
+
+		//Current phase.
+		Phase m_phase;
+
+		//Test objects.
+		std::vector<ObjectSyncBenchmarkState> m_objects;
+
+		//Query IDs the current phase is waiting on.
+		std::vector<unsigned long long> m_waitingQueryIDs;
+
+		//Results of the load queries in the current phase.
+		std::vector<std::shared_ptr<PLY::PLYResult>> m_loadResults;
+
+		//Start time of the current phase's queries.
+		AZ::ScriptTimePoint m_phaseStartTime;
+
+		//Timings for the JSON text format.
+		FormatResults m_json;
+
+		//Timings for the binary format.
+		FormatResults m_binary;
+
+		//ID of the current benchmark run.
+		int m_runID;
+
+		//Prefix for benchmark results filenames.
+		AZStd::string m_filenamePrefix;
+
+		//Is the benchmark process running?
+		bool m_running;
+
+		//Is the benchmark process done?
+		bool m_done;
+
+		//Advertises a result ID is ready.
+		//@param queryID The ID of the ready result.
+		void ResultReady(const unsigned long long queryID) override;
+
+		//Start the next phase of the benchmark.
+		void NextPhase();
+
+		//Serialise all test objects and send them to the database.
+		//@param binary Use the binary format?
+		void SendSaves(const bool binary);
+
+		//Send queries to load all test objects from the database.
+		//@param binary Use the binary format?
+		void SendLoads(const bool binary);
+
+		//De-serialise all loaded test objects.
+		//@param binary Use the binary format?
+		void DecodeLoads(const bool binary);
+
+		//Serialise a test object to a JSON string.
+		//@param o The test object.
+		static std::string ToJSON(const ObjectSyncBenchmarkState &o);
+
+		//De-serialise a test object from a JSON string.
+		//@param s The JSON string.
+		//@param o The test object to load into.
+		//@return True if the string is a valid test object. Otherwise an error is raised, and the test object is unchanged.
+		static bool FromJSON(const char *s, ObjectSyncBenchmarkState &o);
+
+		//Get milliseconds elapsed since a time point.
+		//@param start The time point.
+		static double ElapsedMS(const AZ::ScriptTimePoint &start);
+
+		//Print results and save them to the benchmark results file.
+		void Report();
+
+		//Save benchmark data to a file.
+		//@param fileName The file name to save to.
+		//@param append Should the data be appended to the file if it already exists?
+		void SaveFileData(const AZStd::string fileName, const AZStd::string data, const bool append);
+	};
+}
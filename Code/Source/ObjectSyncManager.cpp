@@ -0,0 +1,1836 @@
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#include "ObjectSyncManager.h"
+
+#include <cmath>
+#include <algorithm>
+#include <iomanip>
+#include <locale>
+#include <sstream>
+
+#include <AzCore/Component/TransformBus.h>
+
+#include <PLY/PLYConfiguration.hpp>
+#include <PLY/PLYRequestBus.h>
+#include <PLY/PLYObjectSyncDataStringBus.h>
+#include <PLY/PLYObjectSyncNotificationBus.h>
+#include <PLY/PLYObjectSyncBinary.hpp>
+#include <PLYLog.h>
+
+using namespace PLY;
+
+PLY::ObjectSyncManager::ObjectSyncManager()
+	: m_journalPrunedSequence(0),
+	m_saveTimer(0),
+	m_time(0),
+	m_saveLatency(0),
+	m_saveIntervalScale(1.0f),
+	m_registrations(0),
+	m_rng(std::random_device()())
+{
+	PLYObjectSyncSystemBus::Handler::BusConnect();
+	PLYResultBus::Handler::BusConnect();
+}
+
+PLY::ObjectSyncManager::~ObjectSyncManager()
+{
+	PLYResultBus::Handler::BusDisconnect();
+	PLYObjectSyncSystemBus::Handler::BusDisconnect();
+}
+
+void PLY::ObjectSyncManager::OnTick(float deltaTime, AZ::ScriptTimePoint time)
+{
+	//Work out what every registered entity needs this frame in a single pass over the state arrays. Calls out to entities
+	//are made afterwards, in batches, as entity handlers may register or unregister entities in response.
+	std::vector<AZ::EntityId> setInvisible;
+	std::vector<std::pair<AZ::EntityId, std::string>> apply;
+	std::vector<std::pair<AZ::EntityId, std::string>> applyBinary;
+	std::vector<std::pair<AZ::EntityId, std::shared_ptr<PLYObjectSyncDecodedState>>> applyDecoded;
+	std::vector<AZ::EntityId> setVisible;
+	std::vector<AZ::EntityId> autoSave;
+
+	//Loaded objects over the per-frame limit stay pending, and are applied in later frames.
+	const size_t maxApplies = static_cast<size_t>(std::max(0, PLYCONF->GetObjectSyncSettings().maxAppliesPerFrame));
+	size_t applies = 0;
+
+	m_time += deltaTime;
+
+	UpdateSaveIntervalScale(deltaTime);
+
+	//Automatic save intervals are stretched while the database is slow to complete saves, and jittered so entities that
+	//happen to line up drift apart again.
+	const float jitter = static_cast<float>(std::max(0, std::min(100, PLYCONF->GetObjectSyncSettings().saveJitter))) / 100.0f;
+	std::uniform_real_distribution<float> jitterDistribution(-jitter, jitter);
+
+	for (size_t i = 0; i < m_entityIDs.size(); ++i)
+	{
+		unsigned short &flags = m_flags[i];
+
+		//Set object invisible on startup.
+		if (!(flags & INVISIBLE_SET))
+		{
+			flags |= INVISIBLE_SET;
+			setInvisible.push_back(m_entityIDs[i]);
+		}
+
+		//Automatically load object data on first frame. Streamed objects are loaded when their cell is.
+		if ((flags & SYNC_ON_LOAD) && (flags & AUTO_SAVE) && !(flags & (LOADING | LOADED | STREAMED)))
+		{
+			LoadEntity(m_entityIDs[i]);
+		}
+
+		//If sync on start is not selected, always assume initial object data is loaded.
+		if (!(flags & (SYNC_ON_LOAD | STREAMED)))
+		{
+			flags |= LOADED;
+
+			if (!(flags & VISIBLE_SET))
+			{
+				flags |= VISIBLE_SET;
+				setVisible.push_back(m_entityIDs[i]);
+			}
+		}
+
+		//Update object if loaded data is waiting.
+		if ((flags & APPLY_PENDING) && (maxApplies == 0 || applies < maxApplies))
+		{
+			flags &= ~APPLY_PENDING;
+			applies++;
+			if (m_decodedStates[i] != nullptr)
+			{
+				applyDecoded.emplace_back(m_entityIDs[i], std::move(m_decodedStates[i]));
+				m_decodedStates[i] = nullptr;
+			}
+			else if (m_tables[m_tableIndices[i]].dataFormat == PLYObjectSyncSaveLoad::BINARY)
+			{
+				applyBinary.emplace_back(m_entityIDs[i], std::move(m_loadedDataStrings[i]));
+			}
+			else
+			{
+				apply.emplace_back(m_entityIDs[i], std::move(m_loadedDataStrings[i]));
+			}
+			m_loadedDataStrings[i].clear();
+		}
+
+		//Automatically save object data at chosen interval, if requested.
+		//Do not do this if object hasn't finished loading its initial data, or hasn't had it applied yet.
+		if ((flags & LOADED) && !(flags & APPLY_PENDING) && (flags & AUTO_SAVE) && m_saveIntervals[i] > 0)
+		{
+			m_timers[i] += deltaTime;
+
+			float interval = m_saveIntervals[i] * m_saveIntervalScale;
+			if (m_timers[i] >= interval)
+			{
+				//Keep the time past the interval, so the entity keeps its place in the schedule.
+				m_timers[i] = std::fmod(m_timers[i], interval);
+				if (jitter > 0) m_timers[i] += jitterDistribution(m_rng) * interval;
+				autoSave.push_back(m_entityIDs[i]);
+			}
+		}
+	}
+
+	float cellSize = PLYCONF->GetObjectSyncSettings().streamingCellSize;
+
+	for (const AZ::EntityId &e : setInvisible)
+	{
+		PLYObjectSyncDataStringBus::Event(e, &PLYObjectSyncDataStringBus::Events::SetObjectInvisible);
+
+		//Streamed objects start in the cell they were placed in, until the database says otherwise.
+		size_t slot = 0;
+		if (GetSlot(e, slot) && (m_flags[slot] & STREAMED) && !(m_flags[slot] & IN_CELL))
+		{
+			AZ::Vector3 position = AZ::Vector3::CreateZero();
+			AZ::TransformBus::EventResult(position, e, &AZ::TransformBus::Events::GetWorldTranslation);
+			m_cellKeys[slot] = RegionStreamer::GetCellKey(position.GetX(), position.GetY(), cellSize);
+			m_flags[slot] |= IN_CELL;
+		}
+	}
+
+	for (const std::pair<AZ::EntityId, std::string> &a : apply)
+	{
+		//Blank data is normal when the object has not been saved yet, and only needs the object made visible.
+		if (a.second != "")
+		{
+			PLYObjectSyncDataStringBus::Event(a.first, &PLYObjectSyncDataStringBus::Events::SetPropertiesFromDataString, a.second);
+		}
+		PLYObjectSyncDataStringBus::Event(a.first, &PLYObjectSyncDataStringBus::Events::SetObjectVisible);
+	}
+
+	for (const std::pair<AZ::EntityId, std::string> &a : applyBinary)
+	{
+		if (a.second != "")
+		{
+			PLYObjectSyncDataStringBus::Event(a.first, &PLYObjectSyncDataStringBus::Events::SetPropertiesFromDataBlob, a.second);
+		}
+		PLYObjectSyncDataStringBus::Event(a.first, &PLYObjectSyncDataStringBus::Events::SetObjectVisible);
+	}
+
+	for (const std::pair<AZ::EntityId, std::shared_ptr<PLYObjectSyncDecodedState>> &a : applyDecoded)
+	{
+		PLYObjectSyncDataStringBus::Event(a.first, &PLYObjectSyncDataStringBus::Events::ApplyDecodedState, a.second);
+		PLYObjectSyncDataStringBus::Event(a.first, &PLYObjectSyncDataStringBus::Events::SetObjectVisible);
+	}
+
+	for (const AZ::EntityId &e : setVisible)
+	{
+		PLYObjectSyncDataStringBus::Event(e, &PLYObjectSyncDataStringBus::Events::SetObjectVisible);
+	}
+
+	for (const AZ::EntityId &e : autoSave)
+	{
+		AutoSaveEntity(e);
+	}
+
+	ReleaseJournalWaits();
+
+	UpdateStreaming(deltaTime);
+
+	UpdateRefresh(deltaTime);
+
+	//Loads are always sent at the end of the frame they were queued in, so objects become visible as soon as possible.
+	FlushLoads();
+
+	m_saveTimer += deltaTime;
+
+	//Convert milliseconds to seconds.
+	float window = static_cast<float>(PLYCONF->GetObjectSyncSettings().saveBatchWindow) / 1000.0f;
+
+	if (m_saveTimer >= window)
+	{
+		m_saveTimer = 0;
+
+		FlushSaves();
+	}
+}
+
+void PLY::ObjectSyncManager::RegisterEntity(const AZ::EntityId entityID, const EntitySettings settings)
+{
+	if (m_entitySlots.find(entityID) != m_entitySlots.end()) UnregisterEntity(entityID);
+
+	//Entities that share a table share its database details.
+	AZStd::string key = GetBatchKey(settings.details);
+	std::map<AZStd::string, size_t>::iterator t = m_tableIndexByKey.find(key);
+	if (t == m_tableIndexByKey.end())
+	{
+		t = m_tableIndexByKey.emplace(key, m_tables.size()).first;
+		m_tables.push_back(settings.details);
+		m_refreshes.emplace_back();
+	}
+
+	unsigned short flags = 0;
+	if (settings.syncOnLoad) flags |= SYNC_ON_LOAD;
+	if (settings.autoSave) flags |= AUTO_SAVE;
+	if (settings.saveOnlyWhenDirty) flags |= SAVE_ONLY_WHEN_DIRTY;
+	if (settings.streamed)
+	{
+		AZ_Error("PLY", settings.details.positionColumnName != "", "Streamed object has no position column name set. It will be loaded on start instead.");
+		if (settings.details.positionColumnName != "") flags |= STREAMED;
+	}
+
+	m_entitySlots[entityID] = m_entityIDs.size();
+	AddObjectSlot(settings.objectID, m_entityIDs.size());
+	m_entityIDs.push_back(entityID);
+	m_objectIDs.push_back(settings.objectID);
+	m_tableIndices.push_back(t->second);
+	m_flags.push_back(flags);
+	//Start each entity at a different point in its save interval. Successive multiples of the golden ratio spread any number
+	//of entities evenly across the interval, so entities spawned in the same frame don't all save in the same frame.
+	static const double GOLDEN_RATIO_FRACTION = 0.6180339887498949;
+	double phase = std::fmod(static_cast<double>(m_registrations++) * GOLDEN_RATIO_FRACTION, 1.0);
+	m_timers.push_back(static_cast<float>(phase) * static_cast<float>(std::max(0, settings.saveIntervalMS)) / 1000.0f);
+	//Convert milliseconds to seconds.
+	m_saveIntervals.push_back(static_cast<float>(std::max(0, settings.saveIntervalMS)) / 1000.0f);
+	m_lastSavedHashes.push_back(0);
+	m_loadedDataStrings.emplace_back();
+	m_decodedStates.emplace_back();
+	m_cellKeys.push_back(0);
+}
+
+void PLY::ObjectSyncManager::UnregisterEntity(const AZ::EntityId entityID)
+{
+	size_t slot = 0;
+	if (!GetSlot(entityID, slot)) return;
+
+	if (m_flags[slot] & EVICT_SAVING) EndEvictSave(slot);
+
+	RemoveObjectSlot(m_objectIDs[slot], slot);
+
+	//Move the last entity into the removed slot, so the arrays stay contiguous.
+	size_t last = m_entityIDs.size() - 1;
+	if (slot != last)
+	{
+		RemoveObjectSlot(m_objectIDs[last], last);
+		AddObjectSlot(m_objectIDs[last], slot);
+
+		m_entityIDs[slot] = m_entityIDs[last];
+		m_objectIDs[slot] = m_objectIDs[last];
+		m_tableIndices[slot] = m_tableIndices[last];
+		m_flags[slot] = m_flags[last];
+		m_timers[slot] = m_timers[last];
+		m_saveIntervals[slot] = m_saveIntervals[last];
+		m_lastSavedHashes[slot] = m_lastSavedHashes[last];
+		m_loadedDataStrings[slot] = std::move(m_loadedDataStrings[last]);
+		m_decodedStates[slot] = std::move(m_decodedStates[last]);
+		m_cellKeys[slot] = m_cellKeys[last];
+
+		m_entitySlots[m_entityIDs[slot]] = slot;
+	}
+
+	m_entityIDs.pop_back();
+	m_objectIDs.pop_back();
+	m_tableIndices.pop_back();
+	m_flags.pop_back();
+	m_timers.pop_back();
+	m_saveIntervals.pop_back();
+	m_lastSavedHashes.pop_back();
+	m_loadedDataStrings.pop_back();
+	m_decodedStates.pop_back();
+	m_cellKeys.pop_back();
+
+	m_entitySlots.erase(entityID);
+}
+
+void PLY::ObjectSyncManager::SetEntityObjectID(const AZ::EntityId entityID, const int objectID)
+{
+	size_t slot = 0;
+	if (!GetSlot(entityID, slot)) return;
+
+	RemoveObjectSlot(m_objectIDs[slot], slot);
+	m_objectIDs[slot] = objectID;
+	AddObjectSlot(objectID, slot);
+
+	//The stored state of the new object is unknown.
+	m_flags[slot] &= ~HAS_SAVED_HASH;
+}
+
+void PLY::ObjectSyncManager::SaveEntity(const AZ::EntityId entityID)
+{
+	std::string dataString = "";
+	if (GetEntityData(entityID, dataString)) SaveEntityDataString(entityID, dataString);
+}
+
+bool PLY::ObjectSyncManager::GetEntityData(const AZ::EntityId entityID, std::string &dataString)
+{
+	size_t slot = 0;
+	if (!GetSlot(entityID, slot)) return false;
+
+	//Broadcast on bus to request the JSON string or binary blob from object.
+	if (m_tables[m_tableIndices[slot]].dataFormat == PLYObjectSyncSaveLoad::BINARY)
+	{
+		PLYObjectSyncDataStringBus::EventResult(dataString, entityID, &PLYObjectSyncDataStringBus::Events::GetDataBlob);
+
+		AZ_Error("PLY", dataString != "", "Data blob for object sync is blank. Does the object have a "
+			"custom script attached that implements GetDataBlob on the Ebus \"PLYObjectSyncDataStringBus?\"");
+	}
+	else
+	{
+		PLYObjectSyncDataStringBus::EventResult(dataString, entityID, &PLYObjectSyncDataStringBus::Events::GetDataString);
+
+		AZ_Error("PLY", dataString != "", "Data string for object sync is blank. Does the object have a "
+			"custom script attached that answers to requests on the Ebus \"PLYObjectSyncDataStringBus?\"");
+	}
+
+	return dataString != "";
+}
+
+bool PLY::ObjectSyncManager::AutoSaveEntity(const AZ::EntityId entityID)
+{
+	size_t slot = 0;
+	if (!GetSlot(entityID, slot)) return false;
+
+	//Objects using change-driven saving are not serialised at all until they report a change.
+	if ((m_flags[slot] & SAVE_ONLY_WHEN_DIRTY) && !(m_flags[slot] & DIRTY)) return false;
+
+	std::string dataString = "";
+	if (!GetEntityData(entityID, dataString)) return false;
+
+	//The entity may have been unregistered by its own handler.
+	if (!GetSlot(entityID, slot)) return false;
+
+	m_flags[slot] &= ~DIRTY;
+
+	//Skip the database round trip if the object state is identical to what is already stored.
+	if ((m_flags[slot] & HAS_SAVED_HASH) && std::hash<std::string>()(dataString) == m_lastSavedHashes[slot]) return false;
+
+	SaveEntityDataString(entityID, dataString);
+
+	return true;
+}
+
+void PLY::ObjectSyncManager::SaveEntityDataString(const AZ::EntityId entityID, const std::string dataString)
+{
+	size_t slot = 0;
+	if (!GetSlot(entityID, slot)) return;
+
+	const int objectID = m_objectIDs[slot];
+	const PLYObjectSyncSaveLoad::DataBaseDetails &details = m_tables[m_tableIndices[slot]];
+
+	AZ_Error("PLY", objectID != 0, "Object ID is not set.");
+	AZ_Error("PLY", details.tableName != "", "Object table name is not set.");
+	AZ_Error("PLY", details.IDColumnName != "", "Object ID column name is not set.");
+	AZ_Error("PLY", details.dataColumnName != "", "Object data column name is not set.");
+
+	AZ_Error("PLY", dataString != "", "Data string for object sync is blank.");
+
+	if (objectID == 0 || details.tableName == "" || details.IDColumnName == "" || details.dataColumnName == "" || dataString == "") return;
+
+	if (details.dataFormat == PLYObjectSyncSaveLoad::BINARY && !PLYObjectSyncBinary::IsValid(dataString))
+	{
+		AZ_Error("PLY", false, "Data blob for object sync does not have a valid header. Use PLYObjectSyncBinary to create blobs.");
+		return;
+	}
+
+	AZ::Vector3 position = AZ::Vector3::CreateZero();
+	if (details.positionColumnName != "")
+	{
+		AZ::TransformBus::EventResult(position, entityID, &AZ::TransformBus::Events::GetWorldTranslation);
+
+		//A position that isn't a finite number can't be written to the database, and would fail every save in its batch.
+		if (!std::isfinite(position.GetX()) || !std::isfinite(position.GetY()) || !std::isfinite(position.GetZ()))
+		{
+			AZ_Error("PLY", false, "Object %d has a position that isn't a finite number. It won't be saved.", objectID);
+			return;
+		}
+	}
+
+	SaveBatch &batch = m_pendingSaves[GetBatchKey(details)];
+	batch.details = details;
+
+	//A newer data string for the same object replaces the pending one. Every entity that asked is still told the outcome.
+	PendingSave &save = batch.saves[objectID];
+	save.dataString = dataString;
+	save.hash = std::hash<std::string>()(dataString);
+
+	if (details.positionColumnName != "")
+	{
+		save.position = position;
+
+		//A streamed object that has moved now belongs to the cell it was saved in.
+		if ((m_flags[slot] & STREAMED) && !(m_flags[slot] & EVICT_SAVING))
+		{
+			m_cellKeys[slot] = RegionStreamer::GetCellKey(position.GetX(), position.GetY(), PLYCONF->GetObjectSyncSettings().streamingCellSize);
+			m_flags[slot] |= IN_CELL;
+		}
+	}
+	if (std::find(save.entityIDs.begin(), save.entityIDs.end(), entityID) == save.entityIDs.end())
+	{
+		save.entityIDs.push_back(entityID);
+	}
+}
+
+void PLY::ObjectSyncManager::MarkEntityDirty(const AZ::EntityId entityID)
+{
+	size_t slot = 0;
+	if (GetSlot(entityID, slot)) m_flags[slot] |= DIRTY;
+}
+
+void PLY::ObjectSyncManager::FlushSaves()
+{
+	if (m_pendingSaves.empty()) return;
+
+	if (m_journal != nullptr) JournalSaves();
+
+	size_t maxBatchSize = static_cast<size_t>(std::max(1, PLYCONF->GetObjectSyncSettings().maxSaveBatchSize));
+
+	for (std::map<AZStd::string, SaveBatch>::iterator b = m_pendingSaves.begin(); b != m_pendingSaves.end();)
+	{
+		//Objects that already have a save in flight, or in the journal, keep their newest save pending until it completes.
+		std::map<int, PendingSave> ready;
+		std::map<AZStd::string, std::set<int>>::const_iterator saving = m_savingObjects.find(b->first);
+		std::map<AZStd::string, std::map<int, unsigned long long>>::const_iterator journaled = m_journaledObjects.find(b->first);
+		for (std::map<int, PendingSave>::iterator it = b->second.saves.begin(); it != b->second.saves.end();)
+		{
+			if ((saving != m_savingObjects.end() && saving->second.count(it->first) != 0) ||
+				(journaled != m_journaledObjects.end() && journaled->second.count(it->first) != 0))
+			{
+				++it;
+				continue;
+			}
+
+			ready.emplace_hint(ready.end(), it->first, std::move(it->second));
+			it = b->second.saves.erase(it);
+		}
+
+		//PostgreSQL allows at most 65535 parameters per query, and binary saves use one per object.
+		size_t batchSize = b->second.details.dataFormat == PLYObjectSyncSaveLoad::BINARY ? std::min(maxBatchSize, static_cast<size_t>(65535)) : maxBatchSize;
+
+		std::map<int, PendingSave>::const_iterator begin = ready.begin();
+		while (begin != ready.end())
+		{
+			std::map<int, PendingSave>::const_iterator end = begin;
+			for (size_t i = 0; i < batchSize && end != ready.end(); ++i) ++end;
+
+			SendSaveBatch(b->first, b->second.details, begin, end);
+
+			begin = end;
+		}
+
+		if (b->second.saves.empty()) b = m_pendingSaves.erase(b);
+		else ++b;
+	}
+}
+
+std::vector<int> PLY::ObjectSyncManager::GetAllObjectIDs()
+{
+	return m_objectIDs;
+}
+
+std::vector<AZ::EntityId> PLY::ObjectSyncManager::GetAllEntityIDs()
+{
+	return m_entityIDs;
+}
+
+std::vector<std::pair<AZ::EntityId, int>> PLY::ObjectSyncManager::GetAllEntityIDandObjectIDs()
+{
+	std::vector<std::pair<AZ::EntityId, int>> ids;
+	ids.reserve(m_entityIDs.size());
+	for (size_t i = 0; i < m_entityIDs.size(); ++i)
+	{
+		ids.emplace_back(m_entityIDs[i], m_objectIDs[i]);
+	}
+	return ids;
+}
+
+int PLY::ObjectSyncManager::GetEntityObjectID(const AZ::EntityId entityID)
+{
+	size_t slot = 0;
+	return GetSlot(entityID, slot) ? m_objectIDs[slot] : 0;
+}
+
+std::vector<AZ::EntityId> PLY::ObjectSyncManager::GetEntitiesForObjectID(const int objectID)
+{
+	std::vector<AZ::EntityId> entityIDs;
+
+	std::unordered_map<int, std::vector<size_t>>::const_iterator o = m_objectSlots.find(objectID);
+	if (o == m_objectSlots.end()) return entityIDs;
+
+	for (const size_t slot : o->second) entityIDs.push_back(m_entityIDs[slot]);
+	return entityIDs;
+}
+
+void PLY::ObjectSyncManager::SaveAllEntities()
+{
+	//Work from a copy, as entities may register or unregister entities while serialising.
+	std::vector<AZ::EntityId> entityIDs = m_entityIDs;
+	for (const AZ::EntityId &e : entityIDs)
+	{
+		SaveEntity(e);
+	}
+}
+
+void PLY::ObjectSyncManager::LoadAllEntities()
+{
+	for (size_t i = 0; i < m_entityIDs.size(); ++i)
+	{
+		//Streamed objects are only loaded when their cell is.
+		if (m_flags[i] & STREAMED) continue;
+
+		LoadEntity(m_entityIDs[i]);
+	}
+}
+
+void PLY::ObjectSyncManager::ResetAllEntities()
+{
+	std::vector<AZ::EntityId> entityIDs = m_entityIDs;
+	for (const AZ::EntityId &e : entityIDs)
+	{
+		PLYObjectSyncDataStringBus::Event(e, &PLYObjectSyncDataStringBus::Events::Reset);
+	}
+}
+
+void PLY::ObjectSyncManager::OpenJournal()
+{
+	const ObjectSyncSettings &settings = PLYCONF->GetObjectSyncSettings();
+
+	if (!settings.journalEnabled || m_journal != nullptr) return;
+
+	m_journal = std::make_unique<SaveJournal>();
+
+	if (!m_journal->Open(settings.journalFileName, settings.journalSizeMB, settings.journalFlushInterval, PLYCONF->GetConnectionString()))
+	{
+		m_journal = nullptr;
+	}
+}
+
+void PLY::ObjectSyncManager::CloseJournal()
+{
+	if (m_journal == nullptr) return;
+
+	m_journal->Close();
+	m_journal = nullptr;
+	m_journaledObjects.clear();
+	m_journalPrunedSequence = 0;
+
+	//Saves still in the journal are replayed when it is next opened, so evicted objects waiting on them can be released.
+	for (const std::pair<unsigned long long, SavedEntities> &w : m_journalWaits)
+	{
+		ReportSave(w.second, true);
+	}
+	m_journalWaits.clear();
+}
+
+void PLY::ObjectSyncManager::JournalSaves()
+{
+	SavedEntities saved;
+
+	for (auto &b : m_pendingSaves)
+	{
+		std::map<int, PendingSave> &saves = b.second.saves;
+		std::map<AZStd::string, std::set<int>>::const_iterator saving = m_savingObjects.find(b.first);
+
+		for (std::map<int, PendingSave>::iterator it = saves.begin(); it != saves.end();)
+		{
+			//Objects with a direct save in flight wait for it to complete, as the journal could write over it with an older save.
+			if (saving != m_savingObjects.end() && saving->second.count(it->first) != 0)
+			{
+				++it;
+				continue;
+			}
+
+			unsigned long long sequence = 0;
+
+			//Saves the journal has no room for are sent to the database directly.
+			if (!m_journal->Append(b.second.details, it->first, it->second.dataString, it->second.position, sequence))
+			{
+				++it;
+				continue;
+			}
+
+			m_journaledObjects[b.first][it->first] = sequence;
+
+			//Evicted objects are reset once saved, so they must not be reloaded before their state reaches the database.
+			SavedEntities evicting;
+			size_t slot = 0;
+			for (const AZ::EntityId &e : it->second.entityIDs)
+			{
+				if (GetSlot(e, slot) && (m_flags[slot] & EVICT_SAVING)) evicting.emplace_back(e, it->second.hash);
+				else saved.emplace_back(e, it->second.hash);
+			}
+			if (!evicting.empty()) m_journalWaits.emplace_back(sequence, std::move(evicting));
+
+			it = saves.erase(it);
+		}
+	}
+
+	for (std::map<AZStd::string, SaveBatch>::iterator b = m_pendingSaves.begin(); b != m_pendingSaves.end();)
+	{
+		if (b->second.saves.empty()) b = m_pendingSaves.erase(b);
+		else ++b;
+	}
+
+	if (!m_journalWaits.empty()) m_journal->Notify();
+
+	ReportSave(saved, true);
+}
+
+void PLY::ObjectSyncManager::ReleaseJournalWaits()
+{
+	if (m_journal == nullptr) return;
+
+	//Check for failure first, so every save written before the journal failed is counted as flushed.
+	const bool failed = m_journal->HasFailed();
+	const unsigned long long flushed = m_journal->GetFlushedSequence();
+
+	if (flushed != m_journalPrunedSequence)
+	{
+		m_journalPrunedSequence = flushed;
+
+		std::vector<int> written;
+		for (std::map<AZStd::string, std::map<int, unsigned long long>>::iterator b = m_journaledObjects.begin(); b != m_journaledObjects.end();)
+		{
+			written.clear();
+			for (std::map<int, unsigned long long>::iterator it = b->second.begin(); it != b->second.end();)
+			{
+				if (it->second < flushed)
+				{
+					written.push_back(it->first);
+					it = b->second.erase(it);
+				}
+				else
+				{
+					++it;
+				}
+			}
+
+			SkipInRefreshes(b->first, written);
+
+			if (b->second.empty()) b = m_journaledObjects.erase(b);
+			else ++b;
+		}
+	}
+
+	SavedEntities released;
+	size_t i = 0;
+	for (; i < m_journalWaits.size() && m_journalWaits[i].first < flushed; ++i)
+	{
+		released.insert(released.end(), m_journalWaits[i].second.begin(), m_journalWaits[i].second.end());
+	}
+
+	if (i > 0)
+	{
+		m_journalWaits.erase(m_journalWaits.begin(), m_journalWaits.begin() + i);
+
+		ReportSave(released, true);
+	}
+
+	if (!failed) return;
+
+	//The saves left in the failed journal will never be written. Their objects were told the saves succeeded, so they
+	//are flagged to be saved again, and evicted objects still waiting on them stay loaded.
+	PLYLOG(PLYLog::PLY_ERROR, "Object sync save journal failed. Saves will be sent to the database directly.");
+
+	for (const auto &b : m_journaledObjects)
+	{
+		for (const auto &o : b.second)
+		{
+			std::unordered_map<int, std::vector<size_t>>::const_iterator slots = m_objectSlots.find(o.first);
+			if (slots == m_objectSlots.end()) continue;
+
+			for (const size_t slot : slots->second)
+			{
+				m_flags[slot] &= ~HAS_SAVED_HASH;
+				m_flags[slot] |= DIRTY;
+			}
+		}
+	}
+
+	std::vector<std::pair<unsigned long long, SavedEntities>> lost = std::move(m_journalWaits);
+
+	m_journal->Close();
+	m_journal = nullptr;
+	m_journalWaits.clear();
+	m_journaledObjects.clear();
+	m_journalPrunedSequence = 0;
+
+	for (const std::pair<unsigned long long, SavedEntities> &w : lost)
+	{
+		ReportSave(w.second, false);
+	}
+}
+
+void PLY::ObjectSyncManager::UpdateSaveIntervalScale(float deltaTime)
+{
+	const ObjectSyncSettings &settings = PLYCONF->GetObjectSyncSettings();
+
+	if (settings.saveLatencyTarget <= 0)
+	{
+		m_saveIntervalScale = 1.0f;
+		return;
+	}
+
+	//A save still outstanding for longer than the smoothed latency counts as a new sample, so a stalled database is noticed
+	//before its saves complete.
+	float latency = m_saveLatency;
+	if (!m_saveQuerySentTimes.empty())
+	{
+		double oldest = m_time;
+		for (const auto &s : m_saveQuerySentTimes) oldest = std::min(oldest, s.second);
+		latency = std::max(latency, static_cast<float>(m_time - oldest));
+	}
+
+	//Convert milliseconds to seconds.
+	float target = static_cast<float>(settings.saveLatencyTarget) / 1000.0f;
+	float maxScale = std::max(1.0f, settings.maxSaveIntervalScale);
+
+	//Stretch intervals quickly while saves are slower than the target, and relax them back slowly once they recover.
+	if (latency > target) m_saveIntervalScale = std::min(maxScale, m_saveIntervalScale * (1.0f + deltaTime));
+	else m_saveIntervalScale = std::max(1.0f, m_saveIntervalScale * (1.0f - 0.25f * deltaTime));
+}
+
+void PLY::ObjectSyncManager::SetFocusPoint(const int focusID, const AZ::Vector3 position)
+{
+	m_streamer.SetFocusPoint(focusID, position);
+}
+
+void PLY::ObjectSyncManager::RemoveFocusPoint(const int focusID)
+{
+	m_streamer.RemoveFocusPoint(focusID);
+}
+
+void PLY::ObjectSyncManager::RegisterDecoder(const AZStd::string tableName, const PLYObjectSyncDecoder decoder)
+{
+	if (decoder == nullptr)
+	{
+		UnregisterDecoder(tableName);
+		return;
+	}
+
+	m_decoders[tableName] = decoder;
+}
+
+void PLY::ObjectSyncManager::UnregisterDecoder(const AZStd::string tableName)
+{
+	m_decoders.erase(tableName);
+}
+
+void PLY::ObjectSyncManager::SendSaveBatch(const AZStd::string &batchKey, const PLYObjectSyncSaveLoad::DataBaseDetails &details,
+	std::map<int, PendingSave>::const_iterator begin, std::map<int, PendingSave>::const_iterator end)
+{
+	SaveQuery saveQuery;
+	saveQuery.batchKey = batchKey;
+
+	for (std::map<int, PendingSave>::const_iterator it = begin; it != end; ++it)
+	{
+		saveQuery.objectIDs.push_back(it->first);
+		for (const AZ::EntityId &e : it->second.entityIDs) saveQuery.entities.emplace_back(e, it->second.hash);
+	}
+
+	std::vector<std::string> binaryParams;
+	std::string qString = GetSaveQuery(details, begin, end, binaryParams);
+
+	unsigned long long queryID = 0;
+
+	if (details.dataFormat == PLYObjectSyncSaveLoad::BINARY)
+	{
+		PLY::PLYRequestBus::BroadcastResult(queryID, &PLY::PLYRequestBus::Events::SendQueryWithBinaryParams, AZStd::string(qString.c_str()),
+			binaryParams, QuerySettings());
+	}
+	else
+	{
+		PLY::PLYRequestBus::BroadcastResult(queryID, &PLY::PLYRequestBus::Events::SendQuery, AZStd::string(qString.c_str()));
+	}
+
+	if (queryID == 0)
+	{
+		PLYLOG(PLYLog::PLY_ERROR, "Object sync batch save failed. Couldn't send query.");
+		ReportSave(saveQuery.entities, false);
+		return;
+	}
+
+	PLYLOG(PLYLog::PLY_DEBUG, "Sent object sync batch save of " + AZStd::string::format("%u", static_cast<unsigned int>(std::distance(begin, end))) +
+		" objects to table " + details.tableName);
+
+	m_savingObjects[batchKey].insert(saveQuery.objectIDs.begin(), saveQuery.objectIDs.end());
+
+	m_saveQueries[queryID] = std::move(saveQuery);
+	m_saveQuerySentTimes[queryID] = m_time;
+}
+
+std::string PLY::ObjectSyncManager::GetPositionSRID(const PLYObjectSyncSaveLoad::DataBaseDetails &details)
+{
+	//A blank schema name lets the table name include its schema, or be found on the search path.
+	return "Find_SRID('', '" + EscapeString(details.tableName.c_str()) + "', '" + EscapeString(details.positionColumnName.c_str()) + "')";
+}
+
+std::string PLY::ObjectSyncManager::GetSaveQuery(const PLYObjectSyncSaveLoad::DataBaseDetails &details,
+	std::map<int, PendingSave>::const_iterator begin, std::map<int, PendingSave>::const_iterator end, std::vector<std::string> &binaryParams)
+{
+	//Save data to database using a single multi-row UPSERT.
+	//Objects in tables with a position column also save their world position, so they can be streamed by region.
+	const bool hasPosition = details.positionColumnName != "";
+
+	const bool hasUpdatedAt = details.updatedAtColumnName != "";
+
+	std::string qString = "";
+
+	//Positions are given the position column's SRID, which is looked up once for the whole query. The rows are still
+	//inserted straight from the VALUES list, so their values take the types of the columns they are inserted into.
+	if (hasPosition) qString += "with s as (select " + GetPositionSRID(details) + " as srid) ";
+
+	qString += "insert into " + std::string(details.tableName.c_str()) + " (" + details.IDColumnName.c_str() + ", " +
+		details.dataColumnName.c_str() + (hasPosition ? std::string(", ") + details.positionColumnName.c_str() : std::string("")) +
+		(hasUpdatedAt ? std::string(", ") + details.updatedAtColumnName.c_str() : std::string("")) + ") VALUES ";
+
+	//Binary blobs are sent as binary parameters, so they need no escaping.
+	const bool binary = details.dataFormat == PLYObjectSyncSaveLoad::BINARY;
+
+	for (std::map<int, PendingSave>::const_iterator it = begin; it != end; ++it)
+	{
+		if (it != begin) qString += ", ";
+		if (binary)
+		{
+			binaryParams.push_back(it->second.dataString);
+			qString += "(" + std::to_string(it->first) + ", $" + std::to_string(binaryParams.size());
+		}
+		else
+		{
+			qString += "(" + std::to_string(it->first) + ", '" + EscapeString(it->second.dataString) + "'";
+		}
+		if (hasPosition)
+		{
+			qString += ", ST_SetSRID(ST_MakePoint(" + FormatCoordinate(it->second.position.GetX()) + ", " +
+				FormatCoordinate(it->second.position.GetY()) + ", " + FormatCoordinate(it->second.position.GetZ()) + "), (select srid from s))";
+		}
+		if (hasUpdatedAt) qString += ", now()";
+		qString += ")";
+	}
+
+	qString += std::string(" on conflict (") + details.IDColumnName.c_str() + ") do update set " + details.dataColumnName.c_str() +
+		" = EXCLUDED." + details.dataColumnName.c_str();
+	if (hasPosition)
+	{
+		qString += std::string(", ") + details.positionColumnName.c_str() + " = EXCLUDED." + details.positionColumnName.c_str();
+	}
+
+	//Tables with an updated at column have it set on every save, so other processes can refresh the objects that changed.
+	if (details.updatedAtColumnName != "")
+	{
+		qString += std::string(", ") + details.updatedAtColumnName.c_str() + " = now()";
+	}
+
+	return qString;
+}
+
+void PLY::ObjectSyncManager::LoadEntity(const AZ::EntityId entityID)
+{
+	size_t slot = 0;
+	if (!GetSlot(entityID, slot)) return;
+
+	const int objectID = m_objectIDs[slot];
+	const PLYObjectSyncSaveLoad::DataBaseDetails &details = m_tables[m_tableIndices[slot]];
+
+	AZ_Error("PLY", objectID != 0, "Object ID is not set.");
+	AZ_Error("PLY", details.tableName != "", "Object table name is not set.");
+	AZ_Error("PLY", details.IDColumnName != "", "Object ID column name is not set.");
+	AZ_Error("PLY", details.dataColumnName != "", "Object data column name is not set.");
+
+	if (objectID == 0 || details.tableName == "" || details.IDColumnName == "" || details.dataColumnName == "") return;
+
+	m_flags[slot] |= LOADING;
+
+	LoadBatch &batch = m_pendingLoads[GetBatchKey(details)];
+	batch.details = details;
+
+	std::vector<AZ::EntityId> &entityIDs = batch.loads[objectID];
+	if (std::find(entityIDs.begin(), entityIDs.end(), entityID) == entityIDs.end())
+	{
+		entityIDs.push_back(entityID);
+	}
+}
+
+void PLY::ObjectSyncManager::UpdateRefresh(float deltaTime)
+{
+	const int refreshInterval = PLYCONF->GetObjectSyncSettings().refreshInterval;
+	if (refreshInterval <= 0) return;
+
+	//Convert milliseconds to seconds.
+	float interval = static_cast<float>(refreshInterval) / 1000.0f;
+
+	for (size_t t = 0; t < m_tables.size(); ++t)
+	{
+		TableRefresh &r = m_refreshes[t];
+
+		//Only one refresh per table at a time, so a slow database isn't sent overlapping refreshes.
+		if (r.queryID != 0) continue;
+
+		r.timer += deltaTime;
+		if (r.timer < interval) continue;
+		r.timer = 0;
+
+		SendRefresh(t);
+	}
+}
+
+void PLY::ObjectSyncManager::SendRefresh(const size_t tableIndex)
+{
+	//Tables are kept after their last entity is removed, but have nothing to refresh.
+	if (std::find(m_tableIndices.begin(), m_tableIndices.end(), tableIndex) == m_tableIndices.end()) return;
+
+	const PLYObjectSyncSaveLoad::DataBaseDetails &details = m_tables[tableIndex];
+	TableRefresh &r = m_refreshes[tableIndex];
+
+	const std::string tableName = details.tableName.c_str();
+	const std::string updatedAt = details.updatedAtColumnName.c_str();
+
+	//Tables without an updated at column use the transaction ID of each row's last write. The watermark is the lowest
+	//transaction ID still running, so rows written by transactions that commit late are not missed. Transaction IDs are
+	//32 bits, so a refresh that spans a transaction ID wraparound misses the rows changed across it.
+	const std::string xminWatermark = "(txid_snapshot_xmin(txid_current_snapshot()) % 4294967296)::text";
+
+	std::string qString;
+	PLY::QuerySettings qs;
+
+	if (r.watermark == "")
+	{
+		//Start from the table's current state. Entities load their own state on start, so only later changes are needed.
+		qString = updatedAt == "" ? "select " + xminWatermark :
+			"select coalesce(max(" + updatedAt + "), '-infinity')::text from " + tableName;
+	}
+	else
+	{
+		std::string columns = std::string("select ") + details.IDColumnName.c_str() + ", " + details.dataColumnName.c_str() + ", ";
+
+		if (updatedAt == "")
+		{
+			qString = columns + xminWatermark + " from " + tableName + " where xmin::text::bigint >= " + r.watermark;
+		}
+		else
+		{
+			//Saves are timestamped when their transaction starts, not when it commits, so go back "Refresh Overlap" before the
+			//watermark to catch saves that committed after a later one. Rows fetched again are skipped if unchanged.
+			std::string watermark = "'" + EscapeString(r.watermark) + "'::timestamptz";
+			qString = columns + "greatest(max(" + updatedAt + ") over (), " + watermark + ")::text from " + tableName + " where " +
+				updatedAt + " > " + watermark + " - interval '" + std::to_string(std::max(0, PLYCONF->GetObjectSyncSettings().refreshOverlap)) +
+				" milliseconds'";
+		}
+
+		std::map<AZStd::string, PLYObjectSyncDecoder>::const_iterator d = m_decoders.find(details.tableName);
+		if (d != m_decoders.end()) qs.resultProcessor = GetRowProcessor(details, d->second);
+	}
+
+	unsigned long long queryID = 0;
+
+	PLY::PLYRequestBus::BroadcastResult(queryID, &PLY::PLYRequestBus::Events::SendQueryWithOptions, AZStd::string(qString.c_str()), qs);
+
+	if (queryID == 0)
+	{
+		PLYLOG(PLYLog::PLY_ERROR, "Object sync refresh failed for table " + details.tableName + ". Couldn't send query.");
+		return;
+	}
+
+	r.queryID = queryID;
+	m_refreshQueries[queryID] = tableIndex;
+}
+
+void PLY::ObjectSyncManager::RefreshResultReady(const unsigned long long queryID, const std::shared_ptr<PLYResult> &result)
+{
+	std::map<unsigned long long, size_t>::iterator q = m_refreshQueries.find(queryID);
+	const size_t tableIndex = q->second;
+	m_refreshQueries.erase(q);
+
+	TableRefresh &r = m_refreshes[tableIndex];
+	r.queryID = 0;
+
+	const std::unordered_set<int> savedObjects = std::move(r.savedObjects);
+	r.savedObjects.clear();
+
+	const PLYObjectSyncSaveLoad::DataBaseDetails details = m_tables[tableIndex];
+
+	//Check query completed ok.
+	if (result == nullptr || result->errorType != PLY::PLYResult::NONE || result->errorMessage != "")
+	{
+		PLYLOG(PLYLog::PLY_ERROR, "Object sync refresh failed for table " + details.tableName + ". " +
+			(result != nullptr ? result->errorMessage : AZStd::string("")));
+		PLY::PLYRequestBus::Broadcast(&PLY::PLYRequestBus::Events::RemoveResult, queryID);
+		return;
+	}
+
+	const bool primed = r.watermark != "";
+
+	//Every row carries the new watermark. If there are no rows, nothing has changed and the watermark stays as it is.
+	if (result->resultSet.size() > 0)
+	{
+		const pqxx::row &first = result->resultSet[0];
+		const pqxx::row::size_type column = primed ? 2 : 0;
+		if (!first[column].is_null()) r.watermark = first[column].c_str();
+	}
+
+	if (!primed || result->resultSet.size() == 0)
+	{
+		PLY::PLYRequestBus::Broadcast(&PLY::PLYRequestBus::Events::RemoveResult, queryID);
+		return;
+	}
+
+	//Find the entities each changed object should be routed to. Only objects that are loaded are refreshed. Objects with a
+	//save pending, in flight, or not yet written from the journal keep their newer local state, as do objects whose save
+	//reached the database after the refresh query may have read their row.
+	const AZStd::string batchKey = GetBatchKey(details);
+	std::map<AZStd::string, SaveBatch>::const_iterator pending = m_pendingSaves.find(batchKey);
+	std::map<AZStd::string, std::set<int>>::const_iterator saving = m_savingObjects.find(batchKey);
+	std::map<AZStd::string, std::map<int, unsigned long long>>::const_iterator journaled = m_journaledObjects.find(batchKey);
+
+	//Get the entities that need a changed row. Entities that already have the row's state, such as those that saved it, are skipped.
+	auto changedEntities = [&, tableIndex](const int objectID, const size_t hash, std::vector<AZ::EntityId> &entityIDs)
+	{
+		entityIDs.clear();
+
+		std::unordered_map<int, std::vector<size_t>>::const_iterator o = m_objectSlots.find(objectID);
+		if (o == m_objectSlots.end()) return;
+
+		if (pending != m_pendingSaves.end() && pending->second.saves.count(objectID) != 0) return;
+		if (saving != m_savingObjects.end() && saving->second.count(objectID) != 0) return;
+		if (journaled != m_journaledObjects.end() && journaled->second.count(objectID) != 0) return;
+		if (savedObjects.count(objectID) != 0) return;
+
+		for (const size_t slot : o->second)
+		{
+			if (m_tableIndices[slot] != tableIndex || !(m_flags[slot] & LOADED) || (m_flags[slot] & (LOADING | EVICT_SAVING))) continue;
+			if ((m_flags[slot] & HAS_SAVED_HASH) && m_lastSavedHashes[slot] == hash) continue;
+			entityIDs.push_back(m_entityIDs[slot]);
+		}
+	};
+
+	std::vector<AZ::EntityId> entityIDs;
+	size_t refreshed = 0;
+
+	if (result->processedData != nullptr)
+	{
+		//Rows were decoded by the query worker thread.
+		std::shared_ptr<DecodedRows> rows = std::static_pointer_cast<DecodedRows>(result->processedData);
+
+		for (const std::pair<const int, DecodedRow> &row : *rows)
+		{
+			if (row.second.state == nullptr && row.second.dataString == "") continue;
+
+			changedEntities(row.first, row.second.hash, entityIDs);
+			if (entityIDs.empty()) continue;
+
+			ReportDecodedLoad(entityIDs, row.second);
+			refreshed += entityIDs.size();
+		}
+	}
+	else
+	{
+		for (const pqxx::row &row : result->resultSet)
+		{
+			if (row[1].is_null()) continue;
+
+			//BYTEA values arrive escaped in the text result format.
+			std::string dataString = details.dataFormat == PLYObjectSyncSaveLoad::BINARY ? pqxx::binarystring(row[1]).str() : row[1].c_str();
+			if (dataString == "") continue;
+
+			changedEntities(row[0].as<int>(), std::hash<std::string>()(dataString), entityIDs);
+			if (entityIDs.empty()) continue;
+
+			ReportLoad(entityIDs, true, dataString);
+			refreshed += entityIDs.size();
+		}
+	}
+
+	if (refreshed > 0)
+	{
+		PLYLOG(PLYLog::PLY_DEBUG, "Refreshed " + AZStd::string::format("%u", static_cast<unsigned int>(refreshed)) +
+			" object sync entities from table " + details.tableName);
+	}
+
+	PLY::PLYRequestBus::Broadcast(&PLY::PLYRequestBus::Events::RemoveResult, queryID);
+}
+
+void PLY::ObjectSyncManager::FlushLoads()
+{
+	if (m_pendingLoads.empty()) return;
+
+	size_t maxBatchSize = static_cast<size_t>(std::max(1, PLYCONF->GetObjectSyncSettings().maxLoadBatchSize));
+
+	for (auto &b : m_pendingLoads)
+	{
+		std::map<int, std::vector<AZ::EntityId>>::const_iterator begin = b.second.loads.begin();
+		while (begin != b.second.loads.end())
+		{
+			std::map<int, std::vector<AZ::EntityId>>::const_iterator end = begin;
+			for (size_t i = 0; i < maxBatchSize && end != b.second.loads.end(); ++i) ++end;
+
+			SendLoadBatch(b.second.details, begin, end);
+
+			begin = end;
+		}
+	}
+
+	m_pendingLoads.clear();
+}
+
+void PLY::ObjectSyncManager::SendLoadBatch(const PLYObjectSyncSaveLoad::DataBaseDetails &details,
+	std::map<int, std::vector<AZ::EntityId>>::const_iterator begin, std::map<int, std::vector<AZ::EntityId>>::const_iterator end)
+{
+	//Load data for all objects in the batch with a single query, passing the object IDs as one integer array.
+	std::string qString = std::string("select ") + details.IDColumnName.c_str() + ", " + details.dataColumnName.c_str() +
+		" from " + details.tableName.c_str() + " where " + details.IDColumnName.c_str() + " = ANY('{";
+
+	for (std::map<int, std::vector<AZ::EntityId>>::const_iterator it = begin; it != end; ++it)
+	{
+		if (it != begin) qString += ",";
+		qString += std::to_string(it->first);
+	}
+
+	qString += "}'::int[])";
+
+	PLY::QuerySettings qs;
+
+	//If the table has a decoder, decode the rows on the query worker thread rather than the main thread.
+	std::map<AZStd::string, PLYObjectSyncDecoder>::const_iterator d = m_decoders.find(details.tableName);
+	if (d != m_decoders.end()) qs.resultProcessor = GetRowProcessor(details, d->second);
+
+	unsigned long long queryID = 0;
+
+	PLY::PLYRequestBus::BroadcastResult(queryID, &PLY::PLYRequestBus::Events::SendQueryWithOptions, AZStd::string(qString.c_str()), qs);
+
+	if (queryID == 0)
+	{
+		PLYLOG(PLYLog::PLY_ERROR, "Object sync batch load failed. Couldn't send query.");
+		for (std::map<int, std::vector<AZ::EntityId>>::const_iterator it = begin; it != end; ++it)
+		{
+			ReportLoad(it->second, false, "");
+		}
+		return;
+	}
+
+	PLYLOG(PLYLog::PLY_DEBUG, "Sent object sync batch load of " + AZStd::string::format("%u", static_cast<unsigned int>(std::distance(begin, end))) +
+		" objects from table " + details.tableName);
+
+	LoadBatch &batch = m_loadQueryEntities[queryID];
+	batch.details = details;
+	batch.loads = std::map<int, std::vector<AZ::EntityId>>(begin, end);
+}
+
+void PLY::ObjectSyncManager::ResultReady(const unsigned long long queryID)
+{
+	//Only results of object sync queries are handled.
+	if (m_saveQueries.count(queryID) == 0 && m_loadQueryEntities.count(queryID) == 0 && m_cellQueries.count(queryID) == 0 &&
+		m_refreshQueries.count(queryID) == 0) return;
+
+	std::shared_ptr<PLY::PLYResult> result;
+	PLY::PLYRequestBus::BroadcastResult(result, &PLY::PLYRequestBus::Events::GetResult, queryID);
+
+	HandleResult(queryID, result);
+}
+
+void PLY::ObjectSyncManager::HandleResult(const unsigned long long queryID, const std::shared_ptr<PLYResult> &result)
+{
+	if (m_saveQueries.count(queryID) != 0) SaveResultReady(queryID, result);
+	if (m_loadQueryEntities.count(queryID) != 0) LoadResultReady(queryID, result);
+	if (m_cellQueries.count(queryID) != 0) CellResultReady(queryID, result);
+	if (m_refreshQueries.count(queryID) != 0) RefreshResultReady(queryID, result);
+}
+
+void PLY::ObjectSyncManager::AbandonQueries()
+{
+	//Take the query IDs first, as entities may queue saves and loads in response to their queries failing.
+	std::vector<unsigned long long> queryIDs;
+	for (const std::pair<const unsigned long long, SaveQuery> &q : m_saveQueries) queryIDs.push_back(q.first);
+	for (const std::pair<const unsigned long long, LoadBatch> &q : m_loadQueryEntities) queryIDs.push_back(q.first);
+	for (const std::pair<const unsigned long long, CellLoad> &q : m_cellQueries) queryIDs.push_back(q.first);
+	for (const std::pair<const unsigned long long, size_t> &q : m_refreshQueries) queryIDs.push_back(q.first);
+
+	if (queryIDs.empty()) return;
+
+	PLYLOG(PLYLog::PLY_WARNING, "Query engine stopped with " + AZStd::string::format("%u", static_cast<unsigned int>(queryIDs.size())) +
+		" object sync queries in flight. They have failed.");
+
+	//Every abandoned query gets the same failed result, so it is handled exactly like a query that failed in the database.
+	std::shared_ptr<PLY::PLYResult> result = std::make_shared<PLY::PLYResult>();
+	result->errorType = PLY::PLYResult::PROCESSOR_ERROR;
+	result->errorMessage = "The query engine was stopped.";
+
+	for (const unsigned long long queryID : queryIDs) HandleResult(queryID, result);
+}
+
+void PLY::ObjectSyncManager::SaveResultReady(const unsigned long long queryID, const std::shared_ptr<PLYResult> &result)
+{
+	std::map<unsigned long long, SaveQuery>::iterator it = m_saveQueries.find(queryID);
+
+	//Check query completed ok.
+	bool success = !(result == nullptr || result->errorType != PLY::PLYResult::NONE || result->errorMessage != "");
+
+	if (!success)
+	{
+		PLYLOG(PLYLog::PLY_ERROR, "Object sync batch save failed for " + AZStd::string::format("%u", static_cast<unsigned int>(it->second.entities.size())) +
+			" entities. " + (result != nullptr ? result->errorMessage : AZStd::string("")));
+	}
+
+	//The objects' held back saves can now be sent.
+	std::map<AZStd::string, std::set<int>>::iterator saving = m_savingObjects.find(it->second.batchKey);
+	if (saving != m_savingObjects.end())
+	{
+		for (const int objectID : it->second.objectIDs) saving->second.erase(objectID);
+		if (saving->second.empty()) m_savingObjects.erase(saving);
+	}
+
+	//Even a failed save may have been written before it failed, so refreshes in progress can't trust these objects' rows.
+	SkipInRefreshes(it->second.batchKey, it->second.objectIDs);
+
+	//Take the entity list before reporting, as entities may queue further saves in response.
+	SavedEntities entities = std::move(it->second.entities);
+	m_saveQueries.erase(it);
+
+	std::map<unsigned long long, double>::iterator sent = m_saveQuerySentTimes.find(queryID);
+	if (sent != m_saveQuerySentTimes.end())
+	{
+		//Smooth the latency, so a single slow save doesn't stretch every entity's interval.
+		float latency = static_cast<float>(m_time - sent->second);
+		m_saveLatency = m_saveLatency * 0.8f + latency * 0.2f;
+		m_saveQuerySentTimes.erase(sent);
+	}
+
+	PLY::PLYRequestBus::Broadcast(&PLY::PLYRequestBus::Events::RemoveResult, queryID);
+
+	ReportSave(entities, success);
+}
+
+std::function<void(PLY::PLYResult &result)> PLY::ObjectSyncManager::GetRowProcessor(const PLYObjectSyncSaveLoad::DataBaseDetails &details,
+	const PLYObjectSyncDecoder decoder)
+{
+	bool binary = details.dataFormat == PLYObjectSyncSaveLoad::BINARY;
+
+	return [decoder, binary](PLY::PLYResult &result)
+	{
+		std::shared_ptr<DecodedRows> rows = std::make_shared<DecodedRows>();
+
+		for (const pqxx::row &row : result.resultSet)
+		{
+			DecodedRow &decoded = (*rows)[row[0].as<int>()];
+
+			if (row.size() >= 4 && !row[2].is_null() && !row[3].is_null())
+			{
+				decoded.hasPosition = true;
+				decoded.x = row[2].as<float>();
+				decoded.y = row[3].as<float>();
+			}
+
+			if (row[1].is_null()) continue;
+
+			//BYTEA values arrive escaped in the text result format.
+			std::string dataString = binary ? pqxx::binarystring(row[1]).str() : row[1].c_str();
+			if (dataString == "") continue;
+
+			decoded.hash = std::hash<std::string>()(dataString);
+			if (decoder != nullptr) decoded.state = decoder(dataString);
+			if (decoded.state == nullptr) decoded.dataString = std::move(dataString);
+		}
+
+		result.processedData = rows;
+	};
+}
+
+void PLY::ObjectSyncManager::UpdateStreaming(float deltaTime)
+{
+	const ObjectSyncSettings os = PLYCONF->GetObjectSyncSettings();
+
+	std::vector<RegionStreamer::CellKey> load;
+	std::vector<RegionStreamer::CellKey> evict;
+
+	m_streamer.Update(deltaTime, os.streamingCellSize, os.streamingRadius, os.streamingPrefetchTime,
+		static_cast<size_t>(std::max(1, os.maxStreamedCells)), load, evict);
+
+	//Evict first, so evicted objects' saves are sent before any new loads.
+	if (!evict.empty()) EvictCells(evict);
+	if (!load.empty()) SendCellLoads(load, os.streamingCellSize);
+}
+
+void PLY::ObjectSyncManager::SendCellLoads(const std::vector<RegionStreamer::CellKey> &cells, const float cellSize)
+{
+	//Cells with evicted objects still saving are put back, and requested again shortly.
+	std::vector<RegionStreamer::CellKey> ready;
+	for (const RegionStreamer::CellKey key : cells)
+	{
+		if (m_evictSavesByCell.count(key) != 0) m_streamer.SetCellLoaded(key, false);
+		else ready.push_back(key);
+	}
+
+	if (ready.empty()) return;
+
+	std::unordered_set<RegionStreamer::CellKey> readySet(ready.begin(), ready.end());
+
+	//Find the tables used by streamed entities, and the objects in each cell that are waiting for their state.
+	std::map<size_t, std::unordered_map<RegionStreamer::CellKey, std::vector<int>>> expected;
+	for (size_t i = 0; i < m_entityIDs.size(); ++i)
+	{
+		if (!(m_flags[i] & STREAMED)) continue;
+
+		std::unordered_map<RegionStreamer::CellKey, std::vector<int>> &tableCells = expected[m_tableIndices[i]];
+
+		if ((m_flags[i] & IN_CELL) && !(m_flags[i] & (LOADED | LOADING)) && readySet.count(m_cellKeys[i]) != 0)
+		{
+			tableCells[m_cellKeys[i]].push_back(m_objectIDs[i]);
+		}
+	}
+
+	//Nothing is streamed, so there is nothing to load.
+	if (expected.empty())
+	{
+		for (const RegionStreamer::CellKey key : ready) m_streamer.SetCellLoaded(key, true);
+		return;
+	}
+
+	for (auto &t : expected)
+	{
+		const PLYObjectSyncSaveLoad::DataBaseDetails &details = m_tables[t.first];
+
+		std::map<AZStd::string, PLYObjectSyncDecoder>::const_iterator d = m_decoders.find(details.tableName);
+
+		//The cell bounds must have the position column's SRID to be compared with it. Find_SRID is stable, so the database
+		//only looks it up once per query.
+		const std::string srid = GetPositionSRID(details);
+
+		for (size_t begin = 0; begin < ready.size(); begin += MAX_CELLS_PER_QUERY)
+		{
+			size_t end = std::min(begin + MAX_CELLS_PER_QUERY, ready.size());
+
+			CellLoad load;
+			load.tableIndex = t.first;
+			load.cellSize = cellSize;
+
+			//Load every object whose stored position is inside one of the cells, using the position column's spatial index.
+			std::string qString = std::string("select ") + details.IDColumnName.c_str() + ", " + details.dataColumnName.c_str() +
+				", ST_X(" + details.positionColumnName.c_str() + "), ST_Y(" + details.positionColumnName.c_str() + ") from " +
+				details.tableName.c_str() + " where ";
+
+			for (size_t i = begin; i < end; ++i)
+			{
+				float minX = 0, minY = 0, maxX = 0, maxY = 0;
+				RegionStreamer::GetCellBounds(ready[i], cellSize, minX, minY, maxX, maxY);
+
+				if (i != begin) qString += " or ";
+				qString += std::string(details.positionColumnName.c_str()) + " && ST_MakeEnvelope(" + FormatCoordinate(minX) + ", " +
+					FormatCoordinate(minY) + ", " + FormatCoordinate(maxX) + ", " + FormatCoordinate(maxY) + ", " + srid + ")";
+
+				load.cells.insert(ready[i]);
+
+				std::unordered_map<RegionStreamer::CellKey, std::vector<int>>::const_iterator c = t.second.find(ready[i]);
+				if (c != t.second.end()) load.objectIDs.insert(c->second.begin(), c->second.end());
+
+				m_cellLoadsPending[ready[i]].first++;
+			}
+
+			//Also load the objects placed in the cells by ID, as they may not have a saved position yet, or may have been
+			//saved somewhere else.
+			if (!load.objectIDs.empty())
+			{
+				qString += std::string(" or ") + details.IDColumnName.c_str() + " = ANY('{";
+				bool first = true;
+				for (const int objectID : load.objectIDs)
+				{
+					if (!first) qString += ",";
+					qString += std::to_string(objectID);
+					first = false;
+				}
+				qString += "}'::int[])";
+			}
+
+			PLY::QuerySettings qs;
+			qs.resultProcessor = GetRowProcessor(details, d != m_decoders.end() ? d->second : nullptr);
+
+			unsigned long long queryID = 0;
+
+			PLY::PLYRequestBus::BroadcastResult(queryID, &PLY::PLYRequestBus::Events::SendQueryWithOptions, AZStd::string(qString.c_str()), qs);
+
+			if (queryID == 0)
+			{
+				PLYLOG(PLYLog::PLY_ERROR, "Object sync streaming load failed. Couldn't send query.");
+				for (size_t i = begin; i < end; ++i) ReportCellLoad(ready[i], false);
+				continue;
+			}
+
+			PLYLOG(PLYLog::PLY_DEBUG, "Sent object sync streaming load of " + AZStd::string::format("%u", static_cast<unsigned int>(end - begin)) +
+				" cells from table " + details.tableName);
+
+			m_cellQueries[queryID] = std::move(load);
+		}
+	}
+}
+
+void PLY::ObjectSyncManager::CellResultReady(const unsigned long long queryID, const std::shared_ptr<PLYResult> &result)
+{
+	std::map<unsigned long long, CellLoad>::iterator it = m_cellQueries.find(queryID);
+	CellLoad load = std::move(it->second);
+	m_cellQueries.erase(it);
+
+	//Check query completed ok.
+	if (result == nullptr || result->errorType != PLY::PLYResult::NONE || result->errorMessage != "")
+	{
+		PLYLOG(PLYLog::PLY_ERROR, "Object sync streaming load failed for " + AZStd::string::format("%u", static_cast<unsigned int>(load.cells.size())) +
+			" cells. " + (result != nullptr ? result->errorMessage : AZStd::string("")));
+
+		for (const RegionStreamer::CellKey key : load.cells) ReportCellLoad(key, false);
+
+		PLY::PLYRequestBus::Broadcast(&PLY::PLYRequestBus::Events::RemoveResult, queryID);
+		return;
+	}
+
+	//Streamed entities using this table that are still waiting for their state, keyed by object ID.
+	std::unordered_map<int, std::vector<AZ::EntityId>> waiting;
+	for (size_t i = 0; i < m_entityIDs.size(); ++i)
+	{
+		if ((m_flags[i] & STREAMED) && m_tableIndices[i] == load.tableIndex && !(m_flags[i] & (LOADED | LOADING)))
+		{
+			waiting[m_objectIDs[i]].push_back(m_entityIDs[i]);
+		}
+	}
+
+	std::shared_ptr<DecodedRows> rows = std::static_pointer_cast<DecodedRows>(result->processedData);
+
+	if (rows != nullptr)
+	{
+		for (const std::pair<const int, DecodedRow> &row : *rows)
+		{
+			std::unordered_map<int, std::vector<AZ::EntityId>>::iterator w = waiting.find(row.first);
+			if (w == waiting.end()) continue;
+
+			//Objects without a saved position stay in the cell they were placed in.
+			bool inCells = true;
+			if (row.second.hasPosition)
+			{
+				RegionStreamer::CellKey key = RegionStreamer::GetCellKey(row.second.x, row.second.y, load.cellSize);
+				inCells = load.cells.count(key) != 0;
+
+				size_t slot = 0;
+				for (const AZ::EntityId &e : w->second)
+				{
+					if (!GetSlot(e, slot)) continue;
+					m_cellKeys[slot] = key;
+					m_flags[slot] |= IN_CELL;
+				}
+			}
+
+			//Objects saved in another cell are loaded with that cell.
+			if (inCells) ReportDecodedLoad(w->second, row.second);
+
+			waiting.erase(w);
+		}
+	}
+
+	//Objects placed in these cells that have never been saved are ready as they are.
+	for (const int objectID : load.objectIDs)
+	{
+		std::unordered_map<int, std::vector<AZ::EntityId>>::iterator w = waiting.find(objectID);
+		if (w != waiting.end()) ReportLoad(w->second, true, "");
+	}
+
+	for (const RegionStreamer::CellKey key : load.cells) ReportCellLoad(key, true);
+
+	PLY::PLYRequestBus::Broadcast(&PLY::PLYRequestBus::Events::RemoveResult, queryID);
+}
+
+void PLY::ObjectSyncManager::ReportCellLoad(const RegionStreamer::CellKey key, const bool success)
+{
+	std::unordered_map<RegionStreamer::CellKey, std::pair<int, bool>>::iterator c = m_cellLoadsPending.find(key);
+	if (c == m_cellLoadsPending.end()) return;
+
+	if (!success) c->second.second = true;
+
+	//The cell is only loaded once the queries for every streamed table have finished.
+	if (--c->second.first > 0) return;
+
+	bool failed = c->second.second;
+	m_cellLoadsPending.erase(c);
+
+	m_streamer.SetCellLoaded(key, !failed);
+}
+
+void PLY::ObjectSyncManager::EvictCells(const std::vector<RegionStreamer::CellKey> &cells)
+{
+	std::unordered_set<RegionStreamer::CellKey> evictedCells(cells.begin(), cells.end());
+
+	std::vector<AZ::EntityId> entityIDs;
+	for (size_t i = 0; i < m_entityIDs.size(); ++i)
+	{
+		const unsigned short required = STREAMED | IN_CELL | LOADED;
+		if ((m_flags[i] & required) == required && evictedCells.count(m_cellKeys[i]) != 0) entityIDs.push_back(m_entityIDs[i]);
+	}
+
+	if (entityIDs.empty()) return;
+
+	std::vector<AZ::EntityId> reset;
+
+	for (const AZ::EntityId &e : entityIDs)
+	{
+		size_t slot = 0;
+		if (!GetSlot(e, slot)) continue;
+
+		//Save the object's final state if it has changed. Objects that are not saved automatically are only saved if they have
+		//been marked dirty. Objects whose loaded state hasn't been applied yet have nothing new to save.
+		bool saving = false;
+		if (!(m_flags[slot] & APPLY_PENDING) && ((m_flags[slot] & AUTO_SAVE) || (m_flags[slot] & DIRTY)))
+		{
+			saving = AutoSaveEntity(e);
+			if (!GetSlot(e, slot)) continue;
+		}
+
+		m_flags[slot] &= ~(LOADED | APPLY_PENDING);
+		m_loadedDataStrings[slot].clear();
+		m_decodedStates[slot] = nullptr;
+
+		if (saving)
+		{
+			m_flags[slot] |= EVICT_SAVING;
+			m_evictSavesByCell[m_cellKeys[slot]]++;
+		}
+		else
+		{
+			reset.push_back(e);
+		}
+	}
+
+	//Write the evicted objects' saves together.
+	FlushSaves();
+
+	for (const AZ::EntityId &e : entityIDs)
+	{
+		PLYObjectSyncDataStringBus::Event(e, &PLYObjectSyncDataStringBus::Events::SetObjectInvisible);
+	}
+
+	for (const AZ::EntityId &e : reset)
+	{
+		PLYObjectSyncDataStringBus::Event(e, &PLYObjectSyncDataStringBus::Events::Reset);
+	}
+
+	PLYLOG(PLYLog::PLY_DEBUG, "Evicted " + AZStd::string::format("%u", static_cast<unsigned int>(entityIDs.size())) + " streamed objects in " +
+		AZStd::string::format("%u", static_cast<unsigned int>(cells.size())) + " cells.");
+}
+
+void PLY::ObjectSyncManager::LoadResultReady(const unsigned long long queryID, const std::shared_ptr<PLYResult> &result)
+{
+	//Take the entity map before reporting, as entities may queue further loads in response.
+	std::map<unsigned long long, LoadBatch>::iterator it = m_loadQueryEntities.find(queryID);
+	PLYObjectSyncSaveLoad::DataBaseDetails details = it->second.details;
+	std::map<int, std::vector<AZ::EntityId>> objects = std::move(it->second.loads);
+	m_loadQueryEntities.erase(it);
+
+	//Check query completed ok.
+	if (result == nullptr || result->errorType != PLY::PLYResult::NONE || result->errorMessage != "")
+	{
+		PLYLOG(PLYLog::PLY_ERROR, "Object sync batch load failed for " + AZStd::string::format("%u", static_cast<unsigned int>(objects.size())) +
+			" objects. " + (result != nullptr ? result->errorMessage : AZStd::string("")));
+
+		for (auto &o : objects)
+		{
+			ReportLoad(o.second, false, "");
+		}
+	}
+	else if (result->processedData != nullptr)
+	{
+		//Rows were decoded by the query worker thread.
+		std::shared_ptr<DecodedRows> rows = std::static_pointer_cast<DecodedRows>(result->processedData);
+
+		for (const std::pair<const int, DecodedRow> &row : *rows)
+		{
+			std::map<int, std::vector<AZ::EntityId>>::iterator o = objects.find(row.first);
+			if (o == objects.end()) continue;
+
+			ReportDecodedLoad(o->second, row.second);
+
+			objects.erase(o);
+		}
+
+		//Objects without a row have not been saved yet, which is normal.
+		for (auto &o : objects)
+		{
+			ReportLoad(o.second, true, "");
+		}
+	}
+	else
+	{
+		//Hand each row to the entities that own its object ID.
+		for (const pqxx::row &row : result->resultSet)
+		{
+			int objectID = row[0].as<int>();
+
+			std::map<int, std::vector<AZ::EntityId>>::iterator o = objects.find(objectID);
+			if (o == objects.end()) continue;
+
+			std::string dataString = "";
+			if (!row[1].is_null())
+			{
+				//BYTEA values arrive escaped in the text result format.
+				dataString = details.dataFormat == PLYObjectSyncSaveLoad::BINARY ? pqxx::binarystring(row[1]).str() : row[1].c_str();
+			}
+
+			ReportLoad(o->second, true, dataString);
+
+			objects.erase(o);
+		}
+
+		//Objects without a row have not been saved yet, which is normal.
+		for (auto &o : objects)
+		{
+			ReportLoad(o.second, true, "");
+		}
+	}
+
+	PLY::PLYRequestBus::Broadcast(&PLY::PLYRequestBus::Events::RemoveResult, queryID);
+}
+
+void PLY::ObjectSyncManager::ReportSave(const SavedEntities &entities, const bool success)
+{
+	std::vector<AZ::EntityId> finished;
+	std::vector<AZ::EntityId> evicted;
+	std::vector<AZ::EntityId> restored;
+
+	size_t slot = 0;
+	for (const std::pair<AZ::EntityId, size_t> &saved : entities)
+	{
+		const AZ::EntityId &e = saved.first;
+
+		//Entities removed since the save was queued have nothing to update.
+		if (!GetSlot(e, slot)) continue;
+
+		finished.push_back(e);
+
+		//Evicted objects keep their state until their final save completes. If it fails, the object stays loaded instead,
+		//so its state is not lost.
+		if (m_flags[slot] & EVICT_SAVING)
+		{
+			EndEvictSave(slot);
+
+			if (success)
+			{
+				evicted.push_back(e);
+			}
+			else
+			{
+				m_flags[slot] |= LOADED;
+				restored.push_back(e);
+			}
+		}
+
+		if (!success)
+		{
+			//The stored state is now unknown, so make sure the next automatic save goes ahead.
+			m_flags[slot] &= ~HAS_SAVED_HASH;
+			m_flags[slot] |= DIRTY;
+			continue;
+		}
+
+		m_lastSavedHashes[slot] = saved.second;
+		m_flags[slot] |= HAS_SAVED_HASH;
+	}
+
+	//Tell the entities once their state is up to date, as handlers may register or unregister entities in response.
+	for (const AZ::EntityId &e : finished)
+	{
+		PLYObjectSyncNotificationBus::Event(e, &PLYObjectSyncNotificationBus::Events::SaveFinished, success);
+	}
+
+	for (const AZ::EntityId &e : evicted)
+	{
+		PLYObjectSyncDataStringBus::Event(e, &PLYObjectSyncDataStringBus::Events::Reset);
+	}
+
+	for (const AZ::EntityId &e : restored)
+	{
+		PLYLOG(PLYLog::PLY_ERROR, "Couldn't save evicted object sync entity. The object will stay loaded.");
+		PLYObjectSyncDataStringBus::Event(e, &PLYObjectSyncDataStringBus::Events::SetObjectVisible);
+	}
+}
+
+void PLY::ObjectSyncManager::SkipInRefreshes(const AZStd::string &batchKey, const std::vector<int> &objectIDs)
+{
+	for (size_t i = 0; i < m_refreshes.size(); ++i)
+	{
+		if (m_refreshes[i].queryID == 0 || GetBatchKey(m_tables[i]) != batchKey) continue;
+		m_refreshes[i].savedObjects.insert(objectIDs.begin(), objectIDs.end());
+	}
+}
+
+void PLY::ObjectSyncManager::EndEvictSave(const size_t slot)
+{
+	m_flags[slot] &= ~EVICT_SAVING;
+
+	std::unordered_map<RegionStreamer::CellKey, int>::iterator c = m_evictSavesByCell.find(m_cellKeys[slot]);
+	if (c != m_evictSavesByCell.end() && --c->second <= 0) m_evictSavesByCell.erase(c);
+}
+
+void PLY::ObjectSyncManager::ReportLoad(const std::vector<AZ::EntityId> &entityIDs, const bool success, const std::string &dataString)
+{
+	std::vector<AZ::EntityId> finished;
+
+	size_t slot = 0;
+	for (const AZ::EntityId &e : entityIDs)
+	{
+		if (!GetSlot(e, slot)) continue;
+
+		finished.push_back(e);
+
+		m_flags[slot] &= ~LOADING;
+
+		if (!success)
+		{
+			m_flags[slot] &= ~LOADED;
+			continue;
+		}
+
+		//Even if result was blank, a successful load query means an attempt was made to load object data at least once.
+		m_flags[slot] |= LOADED | APPLY_PENDING;
+		m_loadedDataStrings[slot] = dataString;
+		m_decodedStates[slot] = nullptr;
+
+		if (dataString != "")
+		{
+			//The loaded state is what is stored in the database, so there is no need to save it back unchanged.
+			m_lastSavedHashes[slot] = std::hash<std::string>()(dataString);
+			m_flags[slot] |= HAS_SAVED_HASH;
+		}
+	}
+
+	for (const AZ::EntityId &e : finished)
+	{
+		PLYObjectSyncNotificationBus::Event(e, &PLYObjectSyncNotificationBus::Events::LoadFinished, success, dataString);
+	}
+}
+
+void PLY::ObjectSyncManager::ReportDecodedLoad(const std::vector<AZ::EntityId> &entityIDs, const DecodedRow &row)
+{
+	//Rows the decoder rejected are handed to the object as a data string instead.
+	if (row.state == nullptr)
+	{
+		ReportLoad(entityIDs, true, row.dataString);
+		return;
+	}
+
+	std::vector<AZ::EntityId> finished;
+
+	size_t slot = 0;
+	for (const AZ::EntityId &e : entityIDs)
+	{
+		if (!GetSlot(e, slot)) continue;
+
+		finished.push_back(e);
+
+		m_flags[slot] &= ~LOADING;
+		m_flags[slot] |= LOADED | APPLY_PENDING | HAS_SAVED_HASH;
+		m_loadedDataStrings[slot] = "";
+		m_decodedStates[slot] = row.state;
+		m_lastSavedHashes[slot] = row.hash;
+	}
+
+	for (const AZ::EntityId &e : finished)
+	{
+		PLYObjectSyncNotificationBus::Event(e, &PLYObjectSyncNotificationBus::Events::LoadFinished, true, std::string(""));
+	}
+}
+
+bool PLY::ObjectSyncManager::GetSlot(const AZ::EntityId entityID, size_t &slot) const
+{
+	AZStd::unordered_map<AZ::EntityId, size_t>::const_iterator it = m_entitySlots.find(entityID);
+	if (it == m_entitySlots.end()) return false;
+	slot = it->second;
+	return true;
+}
+
+void PLY::ObjectSyncManager::AddObjectSlot(const int objectID, const size_t slot)
+{
+	m_objectSlots[objectID].push_back(slot);
+}
+
+void PLY::ObjectSyncManager::RemoveObjectSlot(const int objectID, const size_t slot)
+{
+	std::unordered_map<int, std::vector<size_t>>::iterator o = m_objectSlots.find(objectID);
+	if (o == m_objectSlots.end()) return;
+
+	std::vector<size_t>::iterator s = std::find(o->second.begin(), o->second.end(), slot);
+	if (s != o->second.end())
+	{
+		*s = o->second.back();
+		o->second.pop_back();
+	}
+
+	if (o->second.empty()) m_objectSlots.erase(o);
+}
+
+AZStd::string PLY::ObjectSyncManager::GetBatchKey(const PLYObjectSyncSaveLoad::DataBaseDetails &details)
+{
+	return details.tableName + "|" + details.IDColumnName + "|" + details.dataColumnName + AZStd::string::format("|%d|", static_cast<int>(details.dataFormat)) +
+		details.positionColumnName + "|" + details.updatedAtColumnName;
+}
+
+std::string PLY::ObjectSyncManager::FormatCoordinate(const float value)
+{
+	//Nine significant digits are enough for any float to read back as the same value. The classic locale always uses a
+	//decimal point, whatever locale the game runs in.
+	std::ostringstream out;
+	out.imbue(std::locale::classic());
+	out << std::setprecision(9) << value;
+	return out.str();
+}
+
+std::string PLY::ObjectSyncManager::EscapeString(const std::string &s)
+{
+	//Double all single quotes so the string can be embedded in a standard SQL string literal.
+	std::string escaped;
+	escaped.reserve(s.size());
+	for (char c : s)
+	{
+		if (c == '\'') escaped += '\'';
+		escaped += c;
+	}
+	return escaped;
+}
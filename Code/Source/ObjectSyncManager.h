@@ -0,0 +1,536 @@
+// Object sync manager. Keeps the state of all entities enabled for automatic object and database synchronisation in
+// contiguous arrays, and updates them all in a single pass each frame. Visibility changes and data string updates are
+// dispatched to entities in batches. Save and load requests are sent to the database in batches grouped by table,
+// ID column and data column. Streamed entities are loaded and evicted by region around focus points instead.
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <vector>
+#include <unordered_set>
+
+#include <AzCore/std/containers/unordered_map.h>
+#include <AzCore/Math/Vector3.h>
+
+#include <PLY/PLYTools.h>
+#include <PLY/PLYTypes.h>
+#include <PLY/PLYResultBus.h>
+#include <PLY/PLYObjectSyncSystemBus.h>
+
+#include "RegionStreamer.h"
+#include "SaveJournal.h"
+
+class PLYTest_ObjectSyncDirtyAndHashSkipSaves_Test;
+class PLYTest_ObjectSyncFullJournalHoldsSaves_Test;
+class PLYTest_ObjectSyncSaveStaggerAndJitter_Test;
+class PLYTest_ObjectSyncSavedHashFollowsSave_Test;
+
+namespace PLY
+{
+	class ObjectSyncManager :
+		protected PLY::PLYObjectSyncSystemBus::Handler,
+		protected PLY::PLYResultBus::Handler
+	{
+
+	friend PLYTest_ObjectSyncDirtyAndHashSkipSaves_Test;
+	friend PLYTest_ObjectSyncFullJournalHoldsSaves_Test;
+	friend PLYTest_ObjectSyncSaveStaggerAndJitter_Test;
+	friend PLYTest_ObjectSyncSavedHashFollowsSave_Test;
+
+	public:
+
+		ObjectSyncManager();
+		~ObjectSyncManager();
+
+		//Tick handler. Called by the PLY system component on the main thread.
+		void OnTick(float deltaTime, AZ::ScriptTimePoint time);
+
+		//Fail every object sync query still in flight, as if each had returned an error, so entities waiting on them are told,
+		//and held back saves can be sent. Called by the PLY system component when it stops the query engine, which drops
+		//every query and result.
+		void AbandonQueries();
+
+		//Are any entities registered, or object sync queries in flight?
+		inline bool IsActive() const
+		{
+			return !m_entityIDs.empty() || !m_saveQueries.empty() || !m_loadQueryEntities.empty() || !m_cellQueries.empty() ||
+				!m_refreshQueries.empty();
+		};
+
+		//Open the save journal, if enabled in the object sync settings. Saves left in the journal from a previous session are
+		//replayed to the database. Called by the PLY system component when the query worker pool is initialised.
+		void OpenJournal();
+
+		//Close the save journal. Saves not yet written to the database stay in the journal file.
+		void CloseJournal();
+
+		//A pending save for a single object. Only the most recent data string queued for an object is kept.
+		struct PendingSave
+		{
+			PendingSave() : hash(0), position(AZ::Vector3::CreateZero()) {};
+			std::string dataString;
+			//Hash of the data string. Recorded as the object's saved hash once the save completes.
+			size_t hash;
+			//World position of the object. Only saved if the table has a position column.
+			AZ::Vector3 position;
+			std::vector<AZ::EntityId> entityIDs;
+		};
+
+		//Get a multi-row UPSERT query for a set of saves to the same table.
+		//@param details The database configuration details shared by all saves.
+		//@param begin The first save to include.
+		//@param end One past the last save to include.
+		//@param binaryParams Binary data strings are added here, to be sent as query parameters.
+		static std::string GetSaveQuery(const PLYObjectSyncSaveLoad::DataBaseDetails &details,
+			std::map<int, PendingSave>::const_iterator begin, std::map<int, PendingSave>::const_iterator end, std::vector<std::string> &binaryParams);
+
+	protected:
+
+		//Register an entity for automatic object and database synchronisation.
+		//@param entityID The entity to register.
+		//@param settings The entity's synchronisation settings.
+		void RegisterEntity(const AZ::EntityId entityID, const EntitySettings settings) override;
+
+		//Remove an entity from automatic object and database synchronisation.
+		//@param entityID The entity to remove.
+		void UnregisterEntity(const AZ::EntityId entityID) override;
+
+		//Change the unique database ID of a registered entity's object.
+		//@param entityID The registered entity.
+		//@param objectID The new object ID.
+		void SetEntityObjectID(const AZ::EntityId entityID, const int objectID) override;
+
+		//Serialise a registered entity's object state and queue it to be saved.
+		//@param entityID The registered entity.
+		void SaveEntity(const AZ::EntityId entityID) override;
+
+		//Queue a data string to be saved for a registered entity's object.
+		//@param entityID The registered entity.
+		//@param dataString The data string to save to the database.
+		void SaveEntityDataString(const AZ::EntityId entityID, const std::string dataString) override;
+
+		//Queue a registered entity's object state to be loaded.
+		//@param entityID The registered entity.
+		void LoadEntity(const AZ::EntityId entityID) override;
+
+		//Flag a registered entity's object state as changed since it was last saved.
+		//@param entityID The registered entity.
+		void MarkEntityDirty(const AZ::EntityId entityID) override;
+
+		//Write all pending saves to the database immediately.
+		void FlushSaves() override;
+
+		//Set the position of a streaming focus point, adding it if it doesn't exist.
+		//@param focusID Unique ID of the focus point.
+		//@param position The focus point's world position.
+		void SetFocusPoint(const int focusID, const AZ::Vector3 position) override;
+
+		//Remove a streaming focus point.
+		//@param focusID Unique ID of the focus point.
+		void RemoveFocusPoint(const int focusID) override;
+
+		//Register a decoder for objects loaded from a table.
+		//@param tableName The table the decoder applies to.
+		//@param decoder The decoder. Must be thread safe.
+		void RegisterDecoder(const AZStd::string tableName, const PLYObjectSyncDecoder decoder) override;
+
+		//Remove the decoder registered for a table.
+		//@param tableName The table.
+		void UnregisterDecoder(const AZStd::string tableName) override;
+
+		//Get the unique database IDs of all registered entities' objects, in registration order.
+		std::vector<int> GetAllObjectIDs() override;
+
+		//Get all registered entities, in the same order as GetAllObjectIDs.
+		std::vector<AZ::EntityId> GetAllEntityIDs() override;
+
+		//Get pairs of entity ID and object ID for all registered entities.
+		std::vector<std::pair<AZ::EntityId, int>> GetAllEntityIDandObjectIDs() override;
+
+		//Get the unique database ID of a registered entity's object.
+		//@param entityID The registered entity.
+		int GetEntityObjectID(const AZ::EntityId entityID) override;
+
+		//Get the registered entities that use an object ID.
+		//@param objectID The object ID.
+		std::vector<AZ::EntityId> GetEntitiesForObjectID(const int objectID) override;
+
+		//Queue every registered entity's object state to be saved.
+		void SaveAllEntities() override;
+
+		//Queue every registered entity's object state to be loaded.
+		void LoadAllEntities() override;
+
+		//Reset the state of every registered entity's object.
+		void ResetAllEntities() override;
+
+		//Advertises a result ID is ready.
+		//@param queryID The ID of the ready result.
+		void ResultReady(const unsigned long long queryID) override;
+
+	private:
+
+		//Per-entity state flags.
+		enum EntityFlags : unsigned short
+		{
+			SYNC_ON_LOAD = 1 << 0, //Load object data from the database on start.
+			AUTO_SAVE = 1 << 1, //Save automatically at the entity's save interval.
+			SAVE_ONLY_WHEN_DIRTY = 1 << 2, //Automatic saves only happen after the object has been marked dirty.
+			INVISIBLE_SET = 1 << 3, //The object has been set invisible on startup.
+			VISIBLE_SET = 1 << 4, //The object has been set visible after its initial load.
+			LOADING = 1 << 5, //A load is in progress.
+			LOADED = 1 << 6, //The object has loaded its initial data.
+			DIRTY = 1 << 7, //The object state has changed since it was last saved.
+			HAS_SAVED_HASH = 1 << 8, //The last saved hash is valid.
+			APPLY_PENDING = 1 << 9, //A loaded data string or decoded state is waiting to be applied to the object.
+			STREAMED = 1 << 10, //The object is loaded and evicted by region, instead of loaded on start.
+			IN_CELL = 1 << 11, //The object's streaming cell is known.
+			EVICT_SAVING = 1 << 12 //The object was evicted, and its final save has not completed yet.
+		};
+
+		//Registered entity state, stored as parallel arrays indexed by entity slot.
+		//Entities are removed by swapping the last slot into the removed one, so slots are not stable across frames.
+		std::vector<AZ::EntityId> m_entityIDs;
+		std::vector<int> m_objectIDs;
+		std::vector<size_t> m_tableIndices; //Index into m_tables.
+		std::vector<unsigned short> m_flags;
+		std::vector<float> m_timers; //Seconds since the object was last saved automatically.
+		std::vector<float> m_saveIntervals; //Seconds. 0 disables automatic saving.
+		std::vector<size_t> m_lastSavedHashes; //Hash of the data string last known to be stored in the database.
+		std::vector<std::string> m_loadedDataStrings; //Loaded data strings waiting to be applied to the object.
+		std::vector<std::shared_ptr<PLYObjectSyncDecodedState>> m_decodedStates; //Decoded states waiting to be applied to the object.
+		std::vector<RegionStreamer::CellKey> m_cellKeys; //Streaming cell the object is in. Only valid if IN_CELL is set.
+
+		//Slot of each registered entity.
+		AZStd::unordered_map<AZ::EntityId, size_t> m_entitySlots;
+
+		//Slots of the registered entities using each object ID.
+		std::unordered_map<int, std::vector<size_t>> m_objectSlots;
+
+		//Database details used by registered entities. Entities that share a table share an entry.
+		std::vector<PLYObjectSyncSaveLoad::DataBaseDetails> m_tables;
+
+		//Index into m_tables, keyed by table, ID column and data column.
+		std::map<AZStd::string, size_t> m_tableIndexByKey;
+
+		//Entities waiting on a save, each with the hash of the data string saved for its object.
+		using SavedEntities = std::vector<std::pair<AZ::EntityId, size_t>>;
+
+		//Pending saves that share the same table, ID column and data column.
+		struct SaveBatch
+		{
+			PLYObjectSyncSaveLoad::DataBaseDetails details;
+			//Pending saves, keyed and ordered by object ID.
+			std::map<int, PendingSave> saves;
+		};
+
+		//Pending loads that share the same table, ID column and data column.
+		struct LoadBatch
+		{
+			PLYObjectSyncSaveLoad::DataBaseDetails details;
+			//Entities waiting to load each object, keyed and ordered by object ID.
+			std::map<int, std::vector<AZ::EntityId>> loads;
+		};
+
+		//Pending saves, keyed by table, ID column and data column.
+		std::map<AZStd::string, SaveBatch> m_pendingSaves;
+
+		//A batched save query that has been sent.
+		struct SaveQuery
+		{
+			//Table, ID column and data column the query writes to.
+			AZStd::string batchKey;
+			//Objects written by the query.
+			std::vector<int> objectIDs;
+			//Entities waiting on the outcome of the query.
+			SavedEntities entities;
+		};
+
+		//Outstanding batched save queries, keyed by query ID.
+		std::map<unsigned long long, SaveQuery> m_saveQueries;
+
+		//Objects with a save query outstanding, keyed by table, ID column and data column. Newer saves for these objects stay
+		//pending until the outstanding save completes, so each object has at most one save in flight, and its saves reach
+		//the database in order. Saves that queue up behind it replace each other, so only the latest is written.
+		std::map<AZStd::string, std::set<int>> m_savingObjects;
+
+		//Time (seconds, from m_time) each outstanding save query was sent.
+		std::map<unsigned long long, double> m_saveQuerySentTimes;
+
+		//Pending loads, keyed by table, ID column and data column.
+		std::map<AZStd::string, LoadBatch> m_pendingLoads;
+
+		//Entities waiting on each batched load query, keyed by query ID.
+		std::map<unsigned long long, LoadBatch> m_loadQueryEntities;
+
+		//A loaded row, decoded on the query worker thread.
+		struct DecodedRow
+		{
+			DecodedRow() : hash(0), hasPosition(false), x(0), y(0) {};
+			//The decoded state. Null if the decoder rejected the row, or the row was blank.
+			std::shared_ptr<PLYObjectSyncDecodedState> state;
+			//The raw data string. Only kept if there is no decoded state, so the object can still parse it itself.
+			std::string dataString;
+			//Hash of the raw data string.
+			size_t hash;
+			//Stored world position of the object, if the query returned one.
+			bool hasPosition;
+			float x, y;
+		};
+
+		//Decoded rows of a batched load query, keyed by object ID. Stored in PLYResult processedData.
+		using DecodedRows = std::map<int, DecodedRow>;
+
+		//Registered decoders, keyed by table name.
+		std::map<AZStd::string, PLYObjectSyncDecoder> m_decoders;
+
+		//Incremental refresh state of a table, for picking up objects changed by other processes.
+		struct TableRefresh
+		{
+			TableRefresh() : timer(0), queryID(0) {};
+			//Highest updated at value already fetched or, for tables without an updated at column, the lowest transaction ID
+			//still running when the table was last refreshed. Blank until the first refresh query returns.
+			std::string watermark;
+			//Seconds since the table was last refreshed.
+			float timer;
+			//The outstanding refresh query. 0 if none.
+			unsigned long long queryID;
+			//Objects whose saves reached the database while the refresh query was outstanding. The query may have read
+			//their rows from before the save, so they are skipped.
+			std::unordered_set<int> savedObjects;
+		};
+
+		//Refresh state of each table, indexed the same as m_tables.
+		std::vector<TableRefresh> m_refreshes;
+
+		//Table index of each outstanding refresh query.
+		std::map<unsigned long long, size_t> m_refreshQueries;
+
+		//Maximum number of cells loaded by a single streaming query.
+		static const size_t MAX_CELLS_PER_QUERY = 64;
+
+		//Decides which cells to load and evict around the focus points.
+		RegionStreamer m_streamer;
+
+		//A streaming query, loading the objects in a set of cells from one table.
+		struct CellLoad
+		{
+			size_t tableIndex;
+			//Cell size the query was made with.
+			float cellSize;
+			//The cells loaded by the query.
+			std::unordered_set<RegionStreamer::CellKey> cells;
+			//Objects expected in the cells, also loaded by ID in case they have no saved position yet.
+			std::unordered_set<int> objectIDs;
+		};
+
+		//Streaming queries, keyed by query ID.
+		std::map<unsigned long long, CellLoad> m_cellQueries;
+
+		//Number of streaming queries still outstanding for each loading cell, and whether any of them failed.
+		std::unordered_map<RegionStreamer::CellKey, std::pair<int, bool>> m_cellLoadsPending;
+
+		//Number of evicted objects in each cell whose final save has not completed yet. The cell is not loaded again until
+		//they finish, so it can't read back stale state.
+		std::unordered_map<RegionStreamer::CellKey, int> m_evictSavesByCell;
+
+		//Write-behind journal for saves. Null if the journal is disabled.
+		std::unique_ptr<SaveJournal> m_journal;
+
+		//Evicted entities whose final save is in the journal, with the sequence number of the save. They are told the save
+		//is complete once the journal has written it to the database.
+		std::vector<std::pair<unsigned long long, SavedEntities>> m_journalWaits;
+
+		//Objects with saves in the journal not yet written to the database, with the sequence number of their latest journaled
+		//save, keyed by table, ID column and data column. When the journal is full, newer saves for these objects stay pending
+		//rather than being sent directly, so they can't reach the database before the journaled saves and be overwritten by them.
+		std::map<AZStd::string, std::map<int, unsigned long long>> m_journaledObjects;
+
+		//Flushed sequence number of the journal when m_journaledObjects was last pruned.
+		unsigned long long m_journalPrunedSequence;
+
+		//Time (seconds) since pending saves were last written to the database.
+		float m_saveTimer;
+
+		//Time (seconds) since the manager was created.
+		double m_time;
+
+		//Smoothed time (seconds) from sending a save query to its result being ready.
+		float m_saveLatency;
+
+		//Multiplier applied to every automatic save interval. Rises above 1 while saves are slower than the latency target.
+		float m_saveIntervalScale;
+
+		//Number of entities registered so far. Used to give each entity its starting point in its save interval.
+		unsigned long long m_registrations;
+
+		//Random number generator for save interval jitter.
+		std::mt19937 m_rng;
+
+		//Get the slot of a registered entity.
+		//@param entityID The entity.
+		//@param slot Set to the entity's slot, if found.
+		//@return True if the entity is registered.
+		bool GetSlot(const AZ::EntityId entityID, size_t &slot) const;
+
+		//Add a slot to the object ID index.
+		//@param objectID The object ID used by the slot's entity.
+		//@param slot The slot.
+		void AddObjectSlot(const int objectID, const size_t slot);
+
+		//Remove a slot from the object ID index.
+		//@param objectID The object ID used by the slot's entity.
+		//@param slot The slot.
+		void RemoveObjectSlot(const int objectID, const size_t slot);
+
+		//Get a registered entity's serialised object state, in the entity's data format.
+		//@param entityID The registered entity.
+		//@param dataString Set to the serialised object state.
+		//@return True if the object returned a non-blank state.
+		bool GetEntityData(const AZ::EntityId entityID, std::string &dataString);
+
+		//Save a registered entity's object state as part of its automatic save interval.
+		//Skipped if the object is not dirty (when "Save Only When Dirty" is set), or if the data string is unchanged since
+		//it was last saved.
+		//@param entityID The registered entity.
+		//@return True if a save was queued.
+		bool AutoSaveEntity(const AZ::EntityId entityID);
+
+		//Send a batched save query for the given saves, and record the objects and entities waiting on it.
+		//@param batchKey The key of the batch the saves were taken from.
+		//@param details The database configuration details shared by all saves.
+		//@param begin The first save to include.
+		//@param end One past the last save to include.
+		void SendSaveBatch(const AZStd::string &batchKey, const PLYObjectSyncSaveLoad::DataBaseDetails &details,
+			std::map<int, PendingSave>::const_iterator begin, std::map<int, PendingSave>::const_iterator end);
+
+		//Append pending saves to the save journal, and tell the entities the saves are complete. Saves the journal has no
+		//room for are left pending, to be sent to the database directly. Objects with a direct save in flight are skipped,
+		//so their saves reach the database in order.
+		void JournalSaves();
+
+		//Tell evicted entities waiting on the save journal that their saves are complete, once the journal has written them
+		//to the database, and release objects whose journaled saves have all been written. If the journal has failed, the
+		//saves it lost are reported as failed, and the journal is closed.
+		void ReleaseJournalWaits();
+
+		//Stretch or relax automatic save intervals according to how long save queries are taking to complete.
+		//@param deltaTime Seconds since the last frame.
+		void UpdateSaveIntervalScale(float deltaTime);
+
+		//Send refresh queries for tables whose refresh interval has ended.
+		//@param deltaTime Seconds since the last frame.
+		void UpdateRefresh(float deltaTime);
+
+		//Send a refresh query for a table, fetching the objects changed since its watermark. The first query for a table
+		//only fetches the watermark.
+		//@param tableIndex Index of the table in m_tables.
+		void SendRefresh(const size_t tableIndex);
+
+		//Handle the result of a refresh query.
+		//@param queryID The refresh query.
+		//@param result The query's result. Null if the result is missing.
+		void RefreshResultReady(const unsigned long long queryID, const std::shared_ptr<PLYResult> &result);
+
+		//Send all pending loads to the database.
+		void FlushLoads();
+
+		//Send a batched load query for the given objects, and record the entities waiting on it.
+		//@param details The database configuration details shared by all loads.
+		//@param begin The first object to include.
+		//@param end One past the last object to include.
+		void SendLoadBatch(const PLYObjectSyncSaveLoad::DataBaseDetails &details,
+			std::map<int, std::vector<AZ::EntityId>>::const_iterator begin, std::map<int, std::vector<AZ::EntityId>>::const_iterator end);
+
+		//Pass a result to the handler for the kind of object sync query it belongs to.
+		//@param queryID The ID of the query.
+		//@param result The query's result. Null if the result is missing.
+		void HandleResult(const unsigned long long queryID, const std::shared_ptr<PLYResult> &result);
+
+		//Get a function that unescapes, hashes and (if the table has a decoder) decodes loaded rows on the query worker thread.
+		//Rows must be (ID, data) or (ID, data, X, Y).
+		//@param details The database configuration details of the loaded table.
+		//@param decoder The table's decoder. May be null.
+		static std::function<void(PLYResult &result)> GetRowProcessor(const PLYObjectSyncSaveLoad::DataBaseDetails &details,
+			const PLYObjectSyncDecoder decoder);
+
+		//Load and evict streamed objects around the focus points.
+		//@param deltaTime Seconds since the last frame.
+		void UpdateStreaming(float deltaTime);
+
+		//Send streaming queries for a set of cells, for every table used by streamed entities.
+		//@param cells The cells to load.
+		//@param cellSize Width of a cell, in world units.
+		void SendCellLoads(const std::vector<RegionStreamer::CellKey> &cells, const float cellSize);
+
+		//Hand the rows of a streaming query to the streamed entities in its cells.
+		//@param queryID The ID of the streaming query.
+		//@param result The query's result. Null if the result is missing.
+		void CellResultReady(const unsigned long long queryID, const std::shared_ptr<PLYResult> &result);
+
+		//Record that one of a cell's streaming queries has finished.
+		//@param key The cell.
+		//@param success Was the query successful?
+		void ReportCellLoad(const RegionStreamer::CellKey key, const bool success);
+
+		//Save and unload all streamed entities in a set of evicted cells. Their saves are written to the database as a batch.
+		//@param cells The evicted cells.
+		void EvictCells(const std::vector<RegionStreamer::CellKey> &cells);
+
+		//Hand the rows of a batched load query back to the entities waiting on it.
+		//@param queryID The ID of the load query.
+		//@param result The query's result. Null if the result is missing.
+		void LoadResultReady(const unsigned long long queryID, const std::shared_ptr<PLYResult> &result);
+
+		//Hand the outcome of a save query back to the entities waiting on it.
+		//@param queryID The ID of the save query.
+		//@param result The query's result. Null if the result is missing.
+		void SaveResultReady(const unsigned long long queryID, const std::shared_ptr<PLYResult> &result);
+
+		//Record the outcome of a save for a list of entities, and tell them via PLYObjectSyncNotificationBus SaveFinished.
+		//@param entities The entities that asked for the save, with the hash of the data string saved.
+		//@param success Was the save successful?
+		void ReportSave(const SavedEntities &entities, const bool success);
+
+		//Record that saves of a set of objects have reached the database, so outstanding refresh queries of their table skip them.
+		//@param batchKey The key of the batch the saves were taken from.
+		//@param objectIDs The saved objects.
+		void SkipInRefreshes(const AZStd::string &batchKey, const std::vector<int> &objectIDs);
+
+		//Clear an evicted entity's EVICT_SAVING flag, and stop it blocking its cell from loading again.
+		//@param slot The entity's slot.
+		void EndEvictSave(const size_t slot);
+
+		//Record the outcome of a load for a list of entities, and tell them via PLYObjectSyncNotificationBus LoadFinished.
+		//@param entityIDs The entities that asked for the load.
+		//@param success Was the load query successful?
+		//@param dataString The data string read from the database. Blank if no data has been saved for the object yet.
+		void ReportLoad(const std::vector<AZ::EntityId> &entityIDs, const bool success, const std::string &dataString);
+
+		//Record a successful load that was decoded on the query worker thread, for a list of entities, and tell them via
+		//PLYObjectSyncNotificationBus LoadFinished.
+		//@param entityIDs The entities that asked for the load.
+		//@param row The decoded row.
+		void ReportDecodedLoad(const std::vector<AZ::EntityId> &entityIDs, const DecodedRow &row);
+
+		//Get the key used to group saves and loads by table, ID column and data column.
+		//@param details The database configuration details.
+		static AZStd::string GetBatchKey(const PLYObjectSyncSaveLoad::DataBaseDetails &details);
+
+		//Get a SQL expression for the SRID of a table's position column.
+		//@param details The database configuration details of the table.
+		static std::string GetPositionSRID(const PLYObjectSyncSaveLoad::DataBaseDetails &details);
+
+		//Format a coordinate as a SQL number that reads back as the same float, whatever the locale.
+		//@param value The coordinate. Must be finite.
+		static std::string FormatCoordinate(const float value);
+
+		//Escape a string for use as a SQL string literal.
+		//@param s The string to escape.
+		static std::string EscapeString(const std::string &s);
+	};
+}
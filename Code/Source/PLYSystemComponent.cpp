@@ -1,14 +1,19 @@
 // @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
 
 #include <functional>
+#include <typeinfo>
 
 #include <PLYSystemComponent.h>
-#include <Worker.h>
-#include <WorkManager.h>
-#include <Benchmark.h>
+#include <QueryEngine.h>
+#include <BenchmarkRunner.h>
+#include <ObjectSyncBenchmark.h>
+#include <ObjectSyncManager.h>
+#include <MetricsExporter.h>
 #include <PLY/PLYConfiguration.hpp>
 #include <PLY/PLYResultBus.h>
 #include <StatsCollector.h>
+#include <QueryTracer.h>
+#include <FrameProfiler.h>
 
 #include <AzCore/Serialization/SerializeContext.h>
 #include <AzCore/Serialization/EditContext.h>
@@ -19,23 +24,23 @@
 namespace PLY
 {
 	PLYSystemComponent::PLYSystemComponent()
-		: m_nextQueryID(1),
-		m_nextWorkerID(1),
+		: m_engine(std::make_unique<QueryEngine>()),
 		m_poolInitialised(false),
-		m_registeredConsoleCommands(false),
-		m_benchmarkPasses(1),
-		m_benchmarkSequenceRunning(false),
-		m_benchmarkSequenceStep(0)
+		m_benchmarkPasses(0),
+		m_registeredConsoleCommands(false)
 	{
 	}
 
 	PLYSystemComponent::~PLYSystemComponent()
 	{
-		Cleanup();
+		m_benchmark = nullptr;
+		m_engine->Stop();
 	}
 
 	void PLYSystemComponent::Reflect(AZ::ReflectContext* context)
     {
+		ObjectSyncBenchmarkState::Reflect(context);
+
         if (AZ::SerializeContext* serialize = azrtti_cast<AZ::SerializeContext*>(context))
         {
             serialize->Class<PLYSystemComponent, AZ::Component>()
@@ -73,25 +78,6 @@ namespace PLY
     {
         AZ_UNUSED(dependent);
     }
-
-	bool PLYSystemComponent::AddResult(std::shared_ptr <PLY::PLYResult> result)
-	{
-		//Establish lock on queue. Lock is released as it goes out of scope.
-		std::unique_lock<std::mutex> lock(m_resultsQueueMutex);
-
-		//Only record this result if a result for this queryID doesn't already exist.
-		if (m_resultsQueue.find(result->queryID) == m_resultsQueue.end())
-		{
-			m_resultsQueue[result->queryID] = result;
-
-			STATS->CountResult();
-
-			return true;
-		}
-
-		return false;
-	}
-
 	unsigned long long PLYSystemComponent::SendQuery(const AZStd::string query)
 	{
 		//No query settings passed, so use configured defaults.
@@ -110,47 +96,18 @@ namespace PLY
 
 	unsigned long long PLYSystemComponent::SendQueryWithOptions(const AZStd::string query, const PLY::QuerySettings qs)
 	{
-		//Get next query ID.
-		long long queryID = m_nextQueryID;
-
-		//Increment query ID for next request.
-		m_nextQueryID++;
-
-		//Create query object.
-		std::shared_ptr<PLY::PLYQuery> pq = std::make_shared<PLY::PLYQuery>();
-
-		pq->queryID = queryID;
-
-		pq->queryString = query;
-
-		//Override default query settings with chosen values.
-		pq->settings = qs;
-
-		//Establish lock on queue. Lock is released as it goes out of scope.
-		std::unique_lock<std::mutex> lock(m_queryQueueMutex);
-
-		//Set the query creation time to now, so it accurately represents the time it was added to the queue.
-		AZStd::chrono::system_clock::time_point now = AZStd::chrono::system_clock::now();
-		AZ::ScriptTimePoint currentTime = AZ::ScriptTimePoint(now);
-
-		pq->creationTime = currentTime;
-
-		//Add query to queue.
-		m_queryQueue.push_back(pq);
-
-		STATS->CountQuery();
+		return SendQueryWithBinaryParams(query, std::vector<std::string>(), qs);
+	}
 
-		return queryID;
+	unsigned long long PLYSystemComponent::SendQueryWithBinaryParams(const AZStd::string query, const std::vector<std::string> binaryParams,
+		const PLY::QuerySettings qs)
+	{
+		return m_engine->SendQuery(query, binaryParams, qs);
 	}
 
 	std::shared_ptr<PLY::PLYResult> PLYSystemComponent::GetResult(const unsigned long long queryID)
 	{
-		//Establish lock on queue. Lock is released as it goes out of scope.
-		std::unique_lock<std::mutex> lock(m_resultsQueueMutex);
-		
-		if (m_resultsQueue.count(queryID) != 0) return m_resultsQueue[queryID];
-
-		return nullptr;
+		return m_engine->GetResult(queryID);
 	}
 
 	/**
@@ -158,44 +115,74 @@ namespace PLY
 	*/
 	void PLYSystemComponent::RemoveResult(const unsigned long long queryID)
 	{
-		//Establish lock on queue. Lock is released as it goes out of scope.
-		std::unique_lock<std::mutex> lock(m_resultsQueueMutex);
-
-		std::map<unsigned long long, std::shared_ptr<PLY::PLYResult>>::iterator it = m_resultsQueue.find(queryID);
-
-		if (it != m_resultsQueue.end())
-		{
-			PLYLOG(PLYLog::PLY_DEBUG, ("Result removed ID " + AZStd::string::format("%u", queryID)).c_str());
-			PLYLOG(PLYLog::PLY_DEBUG, ("Result queue size " + AZStd::string::format("%u", m_resultsQueue.size())).c_str());
-
-			m_resultsQueue.erase(it);
-		}
+		m_engine->RemoveResult(queryID);
 	}
 
 	void PLYSystemComponent::StartBenchmarkSimple()
 	{
-		m_benchmark = std::make_unique<Benchmark>(this, Benchmark::SIMPLE, m_benchmarkPasses, "benchmark");
-		m_benchmark->Run();
+		StartBenchmarkScenarios("@engroot@/Gems/PLY/Benchmarks/simple.scenario");
 	}
 
 	void PLYSystemComponent::StartBenchmarkStars()
 	{
-		m_benchmark = std::make_unique<Benchmark>(this, Benchmark::STARS, m_benchmarkPasses, "benchmark");
-		m_benchmark->Run();
+		StartBenchmarkScenarios("@engroot@/Gems/PLY/Benchmarks/stars.scenario");
 	}
 
 	void PLYSystemComponent::StartBenchmarkStarsSequence()
 	{
-		if (m_benchmarkSequenceRunning)
+		StartBenchmarkScenarios("@engroot@/Gems/PLY/Benchmarks/stars_sequence.scenario");
+	}
+
+	void PLYSystemComponent::StartBenchmarkScenarios(const AZStd::string &fileName)
+	{
+		if (m_benchmark != nullptr || m_objectSyncBenchmark != nullptr)
 		{
-			PLYLOG(PLYLog::PLY_ERROR, "Benchmark sequence already running.");
+			PLYLOG(PLYLog::PLY_ERROR, "Benchmark already running.");
 			return;
 		}
 
-		m_benchmark = nullptr;
-		m_benchmarkSequenceRunning = true;
-		m_benchmarkSequenceStep = 0;
+		//Settings the scenario file doesn't give come from the current configuration.
+		BenchmarkScenario base;
+		base.connection = PLYCONF->GetDatabaseConnectionDetails();
+		base.pool = PLYCONF->GetPoolSettings();
+
+		std::vector<BenchmarkScenario> scenarios;
+		std::string error;
+		if (!BenchmarkScenario::Load(fileName.c_str(), base, scenarios, error))
+		{
+			PLYLOG(PLYLog::PLY_ERROR, "Couldn't start benchmark. " + AZStd::string(error.c_str()));
+			return;
+		}
+
+		//Each scenario restarts the worker pool, which would fail or drop other systems' queries.
+		if (m_objectSyncManager != nullptr && m_objectSyncManager->IsActive())
+		{
+			PLYLOG(PLYLog::PLY_ERROR, "Couldn't start benchmark. Object sync is in use.");
+			return;
+		}
+		if (m_engine->HasQueriesInProgress())
+		{
+			PLYLOG(PLYLog::PLY_ERROR, "Couldn't start benchmark. Queries are in progress.");
+			return;
+		}
+
+		InitialisePool();
 
+		//Restart the pool through the system component, so the save journal and metrics exporter are closed and reopened too.
+		m_benchmark = std::make_unique<BenchmarkRunner>(m_engine.get(), scenarios, m_benchmarkPasses,
+			[this]() { InitialisePool(); }, [this]() { DeInitialisePool(); });
+	}
+
+	void PLYSystemComponent::StartBenchmarkObjectSync()
+	{
+		if (m_benchmark != nullptr || m_objectSyncBenchmark != nullptr)
+		{
+			PLYLOG(PLYLog::PLY_ERROR, "Benchmark already running.");
+			return;
+		}
+
+		m_objectSyncBenchmark = std::make_unique<ObjectSyncBenchmark>("benchmark.objectsync");
+		m_objectSyncBenchmark->Run();
 	}
 
 	void PLYSystemComponent::StopBenchmark()
@@ -203,22 +190,51 @@ namespace PLY
 		if (m_benchmark != nullptr)
 		{
 			m_benchmark->Stop();
+			m_benchmark->PrintReport();
+		}
+		else if (m_objectSyncBenchmark != nullptr)
+		{
+			m_objectSyncBenchmark->Stop();
 		}
 		else
 		{
 			AZ_Printf("PLY", "%s", "Benchmark object not present. Benchmark has not been started.");
 		}
 		m_benchmark = nullptr;
-		m_benchmarkSequenceRunning = false;
-		m_benchmarkSequenceStep = 0;
+		m_objectSyncBenchmark = nullptr;
 	}
 
 	void PLYSystemComponent::SetBenchmarkPasses(int passes)
 	{
-		AZ_Error("PLY", passes > 0, "Passes must be more than zero");
+		AZ_Error("PLY", passes >= 0, "Passes must not be negative");
 		m_benchmarkPasses = passes;
 	}
 
+	PLY::PLYLatencyStats PLYSystemComponent::GetLatencyStats()
+	{
+		return STATS->GetLatencyStats();
+	}
+
+	void PLYSystemComponent::ResetLatencyStats()
+	{
+		STATS->ResetLatencyStats();
+	}
+
+	PLY::PLYQueryCounters PLYSystemComponent::GetQueryCounters()
+	{
+		return STATS->GetQueryCounters();
+	}
+
+	std::vector<PLY::PLYStatementStats> PLYSystemComponent::GetStatementStats(int limit)
+	{
+		return STATS->GetStatementStats(limit > 0 ? static_cast<size_t>(limit) : 0);
+	}
+
+	void PLYSystemComponent::ResetStatementStats()
+	{
+		STATS->ResetStatementStats();
+	}
+
 	void PLYSystemComponent::Init()
     {
 		
@@ -228,28 +244,32 @@ namespace PLY
     {
         PLYRequestBus::Handler::BusConnect();
 		AZ::TickBus::Handler::BusConnect();
+
+		TRACER->SetThreadName("Main");
+
+		m_objectSyncManager = std::make_unique<ObjectSyncManager>();
     }
 
     void PLYSystemComponent::Deactivate()
     {
+		m_benchmark = nullptr;
+		m_objectSyncManager = nullptr;
+
         PLYRequestBus::Handler::BusDisconnect();
 		AZ::TickBus::Handler::BusDisconnect();
     }
 
-	unsigned long long PLYSystemComponent::GetNextWorkerID()
-	{
-		//Get next worker ID.
-		unsigned long long workerID = m_nextWorkerID;
-		
-		//Increment worker ID.
-		m_nextWorkerID++;
-		
-		return workerID;
-	}
-
 	void PLYSystemComponent::OnTick(float deltaTime, AZ::ScriptTimePoint time)
 	{
 
+		//Apply frame profiling settings, and start timing PLY's share of this frame.
+		FRAMEPROFILER->BeginFrame();
+
+		//Apply trace settings, and dump the trace if the last frame was slow.
+		TRACER->OnTick(deltaTime);
+
+		TraceSpan span("Tick");
+
 		//Execute stats tick.
 		STATS->OnTick(deltaTime, time);
 
@@ -262,26 +282,21 @@ namespace PLY
 			m_consoleCommandManager = std::make_unique<Console>();
 		}
 
+		//Write batched object sync saves that are due.
+		if (m_objectSyncManager != nullptr)
+		{
+			FrameSpan objectSyncSpan("Object Sync");
+			m_objectSyncManager->OnTick(deltaTime, time);
+		}
+
 		//Run query results advertising if pool is initialised.
 		//This is done in OnTick as it has to be performed by the main thread.
 		if (m_poolInitialised)
 		{
 
-			std::vector<std::shared_ptr<PLY::PLYResult>> advertise;
+			TraceSpan advertiseSpan("Advertise");
 
-			//Establish lock on queue. Lock is released as it goes out of scope.
-			std::unique_lock<std::mutex> lock(m_resultsQueueMutex);
-			for (auto &r : m_resultsQueue)
-			{
-				//Find results that need advertising, and haven't yet been advertised.
-				if (r.second->settings.advertiseResult && !r.second->hasBeenAdvertised)
-				{
-					//Collect a list of results that need to be advertised.
-					advertise.push_back(r.second);
-				}
-			}
-			//Unlock ASAP.
-			lock.unlock();
+			std::vector<std::shared_ptr<PLY::PLYResult>> advertise = m_engine->GetResultsToAdvertise();
 
 			//Run advertising of results outside the locked block above, as processes may take 
 			//a long time to do what they need with the advertised result.
@@ -290,248 +305,57 @@ namespace PLY
 				PLYLOG(PLYLog::PLY_DEBUG, "Advertising result");
 
 				r->hasBeenAdvertised = true;
-				PLY::PLYResultBus::Broadcast(&PLY::PLYResultBus::Events::ResultReady, r->queryID);
+				STATS->RecordAdvertise(*r);
+
+				//Handler time, which is where most hitches caused by results are spent.
+				TraceSpan handlerSpan("ResultReady", 0, r->queryID);
+				if (FRAMEPROFILER->IsEnabled())
+				{
+					//Call each handler in turn, so their time can be added up by handler type.
+					PLY::PLYResultBus::EnumerateHandlers([&r](PLY::PLYResults *handler)
+					{
+						unsigned long long start = FrameProfiler::Now();
+						handler->ResultReady(r->queryID);
+						FRAMEPROFILER->Add(std::string("ResultReady: ") + typeid(*handler).name(), FrameProfiler::Now() - start);
+						return true;
+					});
+				}
+				else
+				{
+					PLY::PLYResultBus::Broadcast(&PLY::PLYResultBus::Events::ResultReady, r->queryID);
+				}
 			}
 		}
 
 		//Check if work manager thread died, and restart it if required.
-		if (m_poolInitialised && m_workManager != nullptr && (m_workManager->IsDead() || m_workManager->IsShutDown()))
-		{
-			PLYLOG(PLYLog::PLY_WARNING, "Detected that WorkManager is not running. Restarting WorkManager.");
-
-			//Destroy the old work manager.
-			m_workManager = nullptr;
+		if (m_poolInitialised) m_engine->CheckWorkManager();
 
-			//Start up a new work manager.
-			m_workManager = std::make_unique<WorkManager>(this);
-		}
-
-		BenchmarkSequenceUpdate();
+		BenchmarkUpdate();
 
+		FRAMEPROFILER->EndFrame();
 	}
 
-	void PLYSystemComponent::BenchmarkSequenceUpdate()
+	void PLYSystemComponent::BenchmarkUpdate()
 	{
-		if (m_benchmarkSequenceRunning)
-		{
-			//Run Stars benchmark with selected options.
-			auto f =
-				[this](std::string name = "benchmark",
-					int threads = 8,
-					DatabaseConnectionDetails::SSLMode ssl = DatabaseConnectionDetails::SSLMode::PREFER,
-					PoolSettings::WaitMode wait = PoolSettings::WaitMode::SLEEP,
-					PoolSettings::Priority managerPriority = PoolSettings::Priority::NORMAL,
-					PoolSettings::Priority workerPriority = PoolSettings::Priority::NORMAL)
-			{
-				DeInitialisePool();
-
-				PLY::PoolSettings p = PLYCONF->GetPoolSettings();
-				p.minPoolSize = threads;
-				p.maxPoolSize = threads;
-				p.waitMode = wait;
-				p.managerPriority = managerPriority;
-				p.workerPriority = workerPriority;
-				PLYCONF->SetPoolSettings(p);
-
-				PLY::DatabaseConnectionDetails d = PLYCONF->GetDatabaseConnectionDetails();
-				d.sslMode = ssl;
-				PLYCONF->SetDatabaseConnectionDetails(d);
-
-				InitialisePool();
-
-				m_benchmark = std::make_unique<Benchmark>(this, Benchmark::STARS, m_benchmarkPasses, name.c_str());
-				m_benchmark->Run();
-			};
-
-			if (m_benchmarkSequenceStep == 0)
-			{
-				AZ_Printf("PLY", "%s", "Starting PLY benchmark sequence.");
-
-				m_poolSettingsOriginal = PLYCONF->GetPoolSettings();
-				m_databaseConnectionDetailsOriginal = PLYCONF->GetDatabaseConnectionDetails();
-
-				//Threads [1 .. 9]...
-
-				m_benchmarkSequenceStep = 1;
-
-				f("benchmark.threads1", 1);
-			}
-			else if (m_benchmarkSequenceStep == 1 && (m_benchmark == nullptr || m_benchmark->IsFinished()))
-			{
-				m_benchmarkSequenceStep = 2;
-
-				f("benchmark.threads2", 2);
-			}
-			else if (m_benchmarkSequenceStep == 2 && (m_benchmark == nullptr || m_benchmark->IsFinished()))
-			{
-				m_benchmarkSequenceStep = 3;
-
-				f("benchmark.threads3", 3);
-			}
-			else if (m_benchmarkSequenceStep == 3 && (m_benchmark == nullptr || m_benchmark->IsFinished()))
-			{
-				m_benchmarkSequenceStep = 4;
-
-				f("benchmark.threads4", 4);
-			}
-			else if (m_benchmarkSequenceStep == 4 && (m_benchmark == nullptr || m_benchmark->IsFinished()))
-			{
-				m_benchmarkSequenceStep = 5;
-
-				f("benchmark.threads5", 5);
-			}
-			else if (m_benchmarkSequenceStep == 5 && (m_benchmark == nullptr || m_benchmark->IsFinished()))
-			{
-				m_benchmarkSequenceStep = 6;
-
-				f("benchmark.threads6", 6);
-			}
-			else if (m_benchmarkSequenceStep == 6 && (m_benchmark == nullptr || m_benchmark->IsFinished()))
-			{
-				m_benchmarkSequenceStep = 7;
-
-				f("benchmark.threads7", 7);
-			}
-			else if (m_benchmarkSequenceStep == 7 && (m_benchmark == nullptr || m_benchmark->IsFinished()))
-			{
-				m_benchmarkSequenceStep = 8;
-
-				f("benchmark.threads8", 8);
-			}
-			else if (m_benchmarkSequenceStep == 8 && (m_benchmark == nullptr || m_benchmark->IsFinished()))
-			{
-				m_benchmarkSequenceStep = 9;
-
-				f("benchmark.threads9", 9);
-			}
-			else if (m_benchmarkSequenceStep == 9 && (m_benchmark == nullptr || m_benchmark->IsFinished()))
-			{
-				m_benchmarkSequenceStep = 10;
-
-				//SSL OFF
-
-				//Revert settings to original values.
-				PLYCONF->SetPoolSettings(m_poolSettingsOriginal);
-				PLYCONF->SetDatabaseConnectionDetails(m_databaseConnectionDetailsOriginal);
-
-				f("benchmark.sslOFF", 8, DatabaseConnectionDetails::DISABLE);
-			}
-			else if (m_benchmarkSequenceStep == 10 && (m_benchmark == nullptr || m_benchmark->IsFinished()))
-			{
-				m_benchmarkSequenceStep = 11;
-
-				//Loop mode YIELD
-
-				//Revert settings to original values.
-				PLYCONF->SetPoolSettings(m_poolSettingsOriginal);
-				PLYCONF->SetDatabaseConnectionDetails(m_databaseConnectionDetailsOriginal);
-
-				f("benchmark.modeYIELD", 8, DatabaseConnectionDetails::PREFER, PoolSettings::WaitMode::YIELD);
-			}
-
-			else if (m_benchmarkSequenceStep == 11 && (m_benchmark == nullptr || m_benchmark->IsFinished()))
-			{
-				m_benchmarkSequenceStep = 12;
-
-				//Work manager priority below normal.
-
-				//Revert settings to original values.
-				PLYCONF->SetPoolSettings(m_poolSettingsOriginal);
-				PLYCONF->SetDatabaseConnectionDetails(m_databaseConnectionDetailsOriginal);
-
-				f("benchmark.managerBELOWNORMAL", 8, DatabaseConnectionDetails::PREFER, PoolSettings::SLEEP,
-					PoolSettings::Priority::BELOW_NORMAL,
-					PoolSettings::Priority::NORMAL);
-			}
-			else if (m_benchmarkSequenceStep == 12 && (m_benchmark == nullptr || m_benchmark->IsFinished()))
-			{
-				m_benchmarkSequenceStep = 13;
+		//The object sync benchmark runs on result events, and reports by itself when it is done.
+		if (m_objectSyncBenchmark != nullptr && m_objectSyncBenchmark->IsFinished()) m_objectSyncBenchmark = nullptr;
 
-				//Work manager priority idle.
+		if (m_benchmark == nullptr) return;
 
-				//Revert settings to original values.
-				PLYCONF->SetPoolSettings(m_poolSettingsOriginal);
-				PLYCONF->SetDatabaseConnectionDetails(m_databaseConnectionDetailsOriginal);
+		m_benchmark->Update();
 
-				f("benchmark.managerIDLE", 8, DatabaseConnectionDetails::PREFER, PoolSettings::SLEEP,
-					PoolSettings::Priority::IDLE,
-					PoolSettings::Priority::NORMAL);
-
-			}
-			else if (m_benchmarkSequenceStep == 13 && (m_benchmark == nullptr || m_benchmark->IsFinished()))
-			{
-				m_benchmarkSequenceStep = 14;
-
-				//Worker priority below normal.
-
-				//Revert settings to original values.
-				PLYCONF->SetPoolSettings(m_poolSettingsOriginal);
-				PLYCONF->SetDatabaseConnectionDetails(m_databaseConnectionDetailsOriginal);
-
-				f("benchmark.workerBELOWNORMAL", 8, DatabaseConnectionDetails::PREFER, PoolSettings::SLEEP,
-					PoolSettings::Priority::NORMAL,
-					PoolSettings::Priority::BELOW_NORMAL);
-			}
-			else if (m_benchmarkSequenceStep == 14 && (m_benchmark == nullptr || m_benchmark->IsFinished()))
-			{
-				m_benchmarkSequenceStep = 15;
-
-				//Worker priority below idle.
-
-				//Revert settings to original values.
-				PLYCONF->SetPoolSettings(m_poolSettingsOriginal);
-				PLYCONF->SetDatabaseConnectionDetails(m_databaseConnectionDetailsOriginal);
-
-				f("benchmark.workerIDLE", 8, DatabaseConnectionDetails::PREFER, PoolSettings::SLEEP,
-					PoolSettings::Priority::NORMAL,
-					PoolSettings::Priority::IDLE);
-			}
-
-			else if (m_benchmarkSequenceStep == 15 && (m_benchmark == nullptr || m_benchmark->IsFinished()))
-			{
-				//FINISH
-
-				//Revert settings to original values.
-				PLYCONF->SetPoolSettings(m_poolSettingsOriginal);
-				PLYCONF->SetDatabaseConnectionDetails(m_databaseConnectionDetailsOriginal);
+		if (m_benchmark->IsFinished())
+		{
+			m_benchmark->PrintReport();
 
-				m_benchmarkSequenceRunning = false;
-				m_benchmarkSequenceStep = 0;
-				m_benchmark = nullptr;
+			//Name the report after the current time in milliseconds, so runs don't overwrite each other.
+			long long runID = static_cast<long long>(AZ::ScriptTimePoint(AZStd::chrono::system_clock::now()).GetMilliseconds());
+			m_benchmark->SaveReport("@user@/ply_benchmark." + std::to_string(runID) + ".json");
 
-				AZ_Printf("PLY", "%s", "PLY benchmark sequence finished.");
-			}
+			m_benchmark = nullptr;
 		}
 	}
 
-	void PLYSystemComponent::Cleanup()
-	{
-
-		//Clean up work manager.
-		m_workManager = nullptr;
-
-		//Clean up connections.
-		std::unique_lock<std::mutex> lockC(m_workersMutex);
-		m_workers.clear();
-		lockC.unlock();
-
-		//Clean up query queue.
-		std::unique_lock<std::mutex> lockQ(m_queryQueueMutex);
-		m_queryQueue.clear();
-		lockQ.unlock();
-
-		//Clean up results queue.
-		std::unique_lock<std::mutex> lockR(m_resultsQueueMutex);
-		m_resultsQueue.clear();
-		lockR.unlock();
-
-		//Reset next available query ID.
-		m_nextQueryID = 1;
-
-		//Reset next available worker ID.
-		m_nextWorkerID = 1;
-	}
-
 	bool PLYSystemComponent::GetLibpqThreadsafe()
 	{
 		pqxx::thread_safety_model tsm = pqxx::describe_thread_safety();
@@ -543,22 +367,20 @@ namespace PLY
 		//Only allow initialisation once.
 		if (m_poolInitialised) return;
 
-		//Create worker threads, up to the established minimum number.
-		//Establish lock on queue.
-		std::unique_lock<std::mutex> lock(m_workersMutex);
+		//Start the query workers and work manager.
+		m_engine->Start();
 
-		for (int i = 0; i < PLYCONF->GetPoolSettings().minPoolSize; i++)
-		{
-			m_workers.push_back(std::make_shared<PLY::Worker>(this, GetNextWorkerID(), PLYCONF->GetPoolSettings().workerPriority,
-				PLYCONF->GetPoolSettings().waitMode, PLYCONF->GetDatabaseConnectionDetails().reconnectWaitTime, PLYCONF->GetConnectionString()));
-		}
-		//Unlock ASAP.
-		lock.unlock();
+		m_poolInitialised = true;
 
-		//Create work manager thread.
-		m_workManager = std::make_unique<WorkManager>(this);
+		//Replay any saves left in the object sync journal, now the connection settings are final.
+		if (m_objectSyncManager != nullptr) m_objectSyncManager->OpenJournal();
 
-		m_poolInitialised = true;
+		//Start exporting metrics, if enabled.
+		if (PLYCONF->GetMetricsSettings().exportMode != MetricsSettings::DISABLED)
+		{
+			m_metricsExporter = std::make_unique<MetricsExporter>();
+			if (!m_metricsExporter->Start(PLYCONF->GetMetricsSettings())) m_metricsExporter = nullptr;
+		}
 
 		PLYLOG(PLYLog::PLY_INFO, "PLY system Pool Initialised");
 	}
@@ -568,7 +390,14 @@ namespace PLY
 		//Abort if pool not initialised.
 		if (!m_poolInitialised) return;
 
-		Cleanup();
+		if (m_objectSyncManager != nullptr) m_objectSyncManager->CloseJournal();
+
+		m_metricsExporter = nullptr;
+
+		m_engine->Stop();
+
+		//The stopped engine has dropped every query and result, so object sync queries in flight will never return.
+		if (m_objectSyncManager != nullptr) m_objectSyncManager->AbandonQueries();
 
 		m_poolInitialised = false;
 
@@ -18,10 +18,12 @@ class PLYTest_LibpqThreadSafe_Test;
 namespace PLY
 {
 	//Forward declarations.
-	class Worker;
-	class WorkManager;
-	class Benchmark;
+	class QueryEngine;
+	class BenchmarkRunner;
+	class ObjectSyncBenchmark;
 	class Console;
+	class ObjectSyncManager;
+	class MetricsExporter;
 
     class PLYSystemComponent
         : public AZ::Component,
@@ -31,9 +33,6 @@ namespace PLY
 
 	friend PLYTest;
 	friend PLYTest_LibpqThreadSafe_Test;
-	friend Worker;
-	friend WorkManager;
-	friend Benchmark;
 
     public:
 		
@@ -88,6 +87,13 @@ namespace PLY
 		//@param qs The query settings.
 		unsigned long long SendQueryWithOptions(const AZStd::string query, const PLY::QuerySettings qs) override;
 
+		//Add a query with binary parameters to the query queue, using custom query options.
+		//@param query The SQL string to use for the query.
+		//@param binaryParams The parameter values, in placeholder order.
+		//@param qs The query settings.
+		unsigned long long SendQueryWithBinaryParams(const AZStd::string query, const std::vector<std::string> binaryParams,
+			const PLY::QuerySettings qs) override;
+
 		//Get a query result set from the results queue based on a query ID.
 		//@param queryID The ID of the query used to create the results set.
 		std::shared_ptr<PLY::PLYResult> GetResult(const unsigned long long queryID) override;
@@ -105,13 +111,36 @@ namespace PLY
 		//Star a benchmark sequence of multiple test runs using the GAIA STARS dataset.
 		void StartBenchmarkStarsSequence() override;
 
+		//Start a benchmark comparing the JSON text and binary object sync data formats.
+		void StartBenchmarkObjectSync() override;
+
 		//Stop the benchmark currently in progress.
 		void StopBenchmark() override;
 
+		//Start a benchmark run from a benchmark scenario file.
+		//@param fileName The scenario file name. May use file IO aliases such as @user@.
+		void StartBenchmarkScenarios(const AZStd::string &fileName) override;
+
 		//Set the number of passes to use for the benchmark process.
-		//@param passes The number of benchmark passes.
+		//@param passes The number of benchmark passes. 0 = use the passes set by each benchmark scenario.
 		void SetBenchmarkPasses(int passes) override;
 
+		//Get a snapshot of query latency statistics, for each phase of query processing.
+		PLY::PLYLatencyStats GetLatencyStats() override;
+
+		//Reset query latency statistics.
+		void ResetLatencyStats() override;
+
+		//Get a snapshot of query counters, such as queries sent, queue depth, connections and errors.
+		PLY::PLYQueryCounters GetQueryCounters() override;
+
+		//Get per statement statistics for each query fingerprint, sorted by total time, highest first.
+		//@param limit The most statements to return. 0 = all.
+		std::vector<PLY::PLYStatementStats> GetStatementStats(int limit) override;
+
+		//Reset per statement statistics.
+		void ResetStatementStats() override;
+
         ////////////////////////////////////////////////////////////////////////
         // AZ::Component interface implementation
         void Init() override;
@@ -121,52 +150,26 @@ namespace PLY
 
 	private:
 
-		//Mutex to lock list of query worker threads while it is modified.
-		std::mutex m_workersMutex;
-		//Query worker threads.
-		std::vector<std::shared_ptr<PLY::Worker>> m_workers;
-
-		//Next unqiue connection worker ID.
-		unsigned long long m_nextWorkerID;
-
-		//Mutex to lock query queue while it is modified.
-		std::mutex m_queryQueueMutex;
-		//Query queue.
-		std::list <std::shared_ptr<PLY::PLYQuery>> m_queryQueue;
-
-		//Mutex to lock query queue while it is modified.
-		std::mutex m_resultsQueueMutex;
-		//Results queue.
-		std::map<unsigned long long, std::shared_ptr<PLY::PLYResult>> m_resultsQueue;
-
-		//Unqiue query IDs.
-		unsigned long long m_nextQueryID;
+		//Query engine, which owns the query worker pool and the query and results queues.
+		std::unique_ptr<QueryEngine> m_engine;
 
 		//Has the query worker pool been initialised?
 		bool m_poolInitialised;
 
-		//Work manager.
-		std::unique_ptr<WorkManager> m_workManager;
-
-		//Benchmark object.
-		std::unique_ptr<Benchmark> m_benchmark;
-
-		//Number of benchmark passes to run.
-		int m_benchmarkPasses;
+		//Object sync manager, which batches database work for entities enabled for automatic object synchronisation.
+		std::unique_ptr<ObjectSyncManager> m_objectSyncManager;
 
-		//Is the benchmark sequence running?
-		bool m_benchmarkSequenceRunning;
+		//Metrics exporter. Only exists while the query worker pool is initialised and metrics export is enabled.
+		std::unique_ptr<MetricsExporter> m_metricsExporter;
 
-		//Current benchmark sequence step.
-		int m_benchmarkSequenceStep;
+		//Benchmark runner. Only exists while a benchmark run is in progress.
+		std::unique_ptr<BenchmarkRunner> m_benchmark;
 
-		//Original query worker pool settings before benchmark was run.
-		//Used to restore settings after benchmark run (which may modify settings as part of a benchmark sequence).
-		PLY::PoolSettings m_poolSettingsOriginal;
+		//Object sync data format benchmark object.
+		std::unique_ptr<ObjectSyncBenchmark> m_objectSyncBenchmark;
 
-		//Original database connection settings before benchmark was run.
-		//Used to restore settings after benchmark run (which may modify settings as part of a benchmark sequence).
-		PLY::DatabaseConnectionDetails m_databaseConnectionDetailsOriginal;
+		//Number of benchmark passes to run. 0 = use the passes set by each benchmark scenario.
+		int m_benchmarkPasses;
 
 		//Have console commands been registered?
 		bool m_registeredConsoleCommands;
@@ -174,9 +177,6 @@ namespace PLY
 		//Console command manager.
 		std::unique_ptr<Console> m_consoleCommandManager;
 
-		//Get the next query worker thread ID.
-		unsigned long long GetNextWorkerID();
-
 		//Tick order definition. This value sets where in global tick order this component is called.
 		//TICK_PLACEMENT is fairly early in the tick order.
 		//TICK_DEFAULT is the default position for components.
@@ -188,15 +188,8 @@ namespace PLY
 		//Tick handler.
 		void OnTick(float deltaTime, AZ::ScriptTimePoint time) override;
 
-		//Run benchmark sequence update actions.
-		void BenchmarkSequenceUpdate();
-
-		//Clean up all threads and pools.
-		void Cleanup();
-
-		//Add a result to the results queue.
-		//@param result The result to add to the queue.
-		bool AddResult(std::shared_ptr <PLY::PLYResult> result);
+		//Update the benchmark run, and report it once it finishes.
+		void BenchmarkUpdate();
 
     };
 }
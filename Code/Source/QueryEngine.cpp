@@ -0,0 +1,323 @@
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#include <QueryEngine.h>
+#include <Worker.h>
+#include <WorkManager.h>
+#include <SlowQueryLog.h>
+#include <PLY/PLYConfiguration.hpp>
+#include <StatsCollector.h>
+#include <QueryTracer.h>
+#include <FrameProfiler.h>
+#include "PLYLog.h"
+
+using namespace PLY;
+
+PLY::QueryEngine::QueryEngine()
+	: m_workersMutex("workers"),
+	m_nextWorkerID(1),
+	m_queryQueueMutex("query queue"),
+	m_resultsQueueMutex("results queue"),
+	m_nextQueryID(1),
+	m_started(false)
+{
+}
+
+PLY::QueryEngine::~QueryEngine()
+{
+	Stop();
+}
+
+void PLY::QueryEngine::Start()
+{
+	//Only allow initialisation once.
+	if (m_started) return;
+
+	//Start the slow query log, if enabled, before any worker can run a query.
+	if (PLYCONF->GetSlowQuerySettings().threshold > 0)
+	{
+		m_slowQueryLog = std::make_unique<SlowQueryLog>();
+		if (!m_slowQueryLog->Start(PLYCONF->GetSlowQuerySettings(), PLYCONF->GetConnectionString())) m_slowQueryLog = nullptr;
+	}
+
+	//Create worker threads, up to the established minimum number.
+	//Establish lock on queue.
+	std::unique_lock<PLYMutex> lock(m_workersMutex);
+
+	for (int i = 0; i < PLYCONF->GetPoolSettings().minPoolSize; i++)
+	{
+		m_workers.push_back(std::make_shared<PLY::Worker>(this, GetNextWorkerID(), PLYCONF->GetPoolSettings().workerPriority,
+			PLYCONF->GetPoolSettings().waitMode, PLYCONF->GetDatabaseConnectionDetails().reconnectWaitTime, PLYCONF->GetConnectionString()));
+	}
+	//Unlock ASAP.
+	lock.unlock();
+
+	//Create work manager thread.
+	m_workManager = std::make_unique<WorkManager>(this);
+
+	m_started = true;
+}
+
+void PLY::QueryEngine::Stop()
+{
+	if (!m_started) return;
+
+	Cleanup();
+
+	m_slowQueryLog = nullptr;
+
+	m_started = false;
+}
+
+bool PLY::QueryEngine::AddResult(std::shared_ptr <PLY::PLYResult> result)
+{
+	//Establish lock on queue. Lock is released as it goes out of scope.
+	std::unique_lock<PLYMutex> lock(m_resultsQueueMutex);
+
+	//Only record this result if a result for this queryID doesn't already exist.
+	if (m_resultsQueue.find(result->queryID) == m_resultsQueue.end())
+	{
+		m_resultsQueue[result->queryID] = result;
+
+		//Queries that were coalesced into this one resolve to a copy of its result, under their own query IDs.
+		std::map<unsigned long long, std::vector<unsigned long long>>::iterator it = m_supersededQueries.find(result->queryID);
+		if (it != m_supersededQueries.end())
+		{
+			for (unsigned long long supersededID : it->second)
+			{
+				if (m_resultsQueue.find(supersededID) != m_resultsQueue.end()) continue;
+
+				std::shared_ptr<PLY::PLYResult> alias = std::make_shared<PLY::PLYResult>(*result);
+				alias->queryID = supersededID;
+				m_resultsQueue[supersededID] = alias;
+			}
+			m_supersededQueries.erase(it);
+		}
+
+		STATS->CountResult();
+
+		return true;
+	}
+
+	return false;
+}
+
+bool PLY::QueryEngine::HasQueriesInProgress()
+{
+	std::unique_lock<PLYMutex> lockQ(m_queryQueueMutex);
+	if (!m_queryQueue.empty()) return true;
+	lockQ.unlock();
+
+	std::lock_guard<PLYMutex> lockW(m_workersMutex);
+	for (const std::shared_ptr<Worker> &w : m_workers)
+	{
+		if (w->IsBusy()) return true;
+	}
+
+	return false;
+}
+
+unsigned long long PLY::QueryEngine::SendQuery(const AZStd::string &query, const std::vector<std::string> &binaryParams,
+	const QuerySettings &qs)
+{
+	//Get next query ID, and increment it for the next request.
+	unsigned long long queryID = m_nextQueryID.fetch_add(1);
+
+	TraceSpan span("Enqueue", 0, queryID);
+
+	//Create query object.
+	std::shared_ptr<PLY::PLYQuery> pq = std::make_shared<PLY::PLYQuery>();
+
+	pq->queryID = queryID;
+
+	pq->queryString = query;
+
+	pq->binaryParams = binaryParams;
+
+	//Override default query settings with chosen values.
+	pq->settings = qs;
+
+	//Establish lock on queue. Lock is released as it goes out of scope.
+	std::unique_lock<PLYMutex> lock = FRAMEPROFILER->Lock(m_queryQueueMutex);
+
+	//Set the query creation time to now, so it accurately represents the time it was added to the queue.
+	AZStd::chrono::system_clock::time_point now = AZStd::chrono::system_clock::now();
+	AZ::ScriptTimePoint currentTime = AZ::ScriptTimePoint(now);
+
+	pq->creationTime = currentTime;
+
+	//Replace any waiting query with the same coalescing key. Queries are only given to workers while the query queue is locked,
+	//so a query with no worker assigned is guaranteed not to have started. The new query takes the replaced query's place in
+	//the queue, so a key that is sent again every frame still reaches the front.
+	bool replaced = false;
+	if (qs.coalesceKey != "")
+	{
+		for (std::list <std::shared_ptr<PLY::PLYQuery>>::iterator it = m_queryQueue.begin(); it != m_queryQueue.end(); ++it)
+		{
+			if ((*it)->settings.coalesceKey != qs.coalesceKey || (*it)->workerID != 0 || (*it)->finished) continue;
+
+			std::unique_lock<PLYMutex> lockR(m_resultsQueueMutex);
+			std::vector<unsigned long long> &superseded = m_supersededQueries[queryID];
+			superseded.push_back((*it)->queryID);
+
+			//Queries the replaced query had already superseded now resolve to the new query as well.
+			std::map<unsigned long long, std::vector<unsigned long long>>::iterator chain = m_supersededQueries.find((*it)->queryID);
+			if (chain != m_supersededQueries.end())
+			{
+				superseded.insert(superseded.end(), chain->second.begin(), chain->second.end());
+				m_supersededQueries.erase(chain);
+			}
+			lockR.unlock();
+
+			PLYLOG(PLYLog::PLY_DEBUG, "Query " + AZStd::string::format("%llu", (*it)->queryID) + " coalesced into query " +
+				AZStd::string::format("%llu", queryID));
+
+			*it = pq;
+			replaced = true;
+
+			//Each new query replaces the previous one, so there can only ever be one waiting query per key.
+			break;
+		}
+	}
+
+	//Add query to queue.
+	if (!replaced) m_queryQueue.push_back(pq);
+
+	STATS->CountQuery();
+
+	return queryID;
+}
+
+std::shared_ptr<PLY::PLYResult> PLY::QueryEngine::GetResult(const unsigned long long queryID)
+{
+	//Establish lock on queue. Lock is released as it goes out of scope.
+	std::unique_lock<PLYMutex> lock = FRAMEPROFILER->Lock(m_resultsQueueMutex);
+	
+	if (m_resultsQueue.count(queryID) != 0) return m_resultsQueue[queryID];
+
+	return nullptr;
+}
+
+std::vector<std::shared_ptr<PLY::PLYResult>> PLY::QueryEngine::GetResultsFrom(const unsigned long long firstQueryID)
+{
+	std::vector<std::shared_ptr<PLY::PLYResult>> results;
+
+	//Establish lock on queue. Lock is released as it goes out of scope.
+	std::unique_lock<PLYMutex> lock = FRAMEPROFILER->Lock(m_resultsQueueMutex);
+	for (std::map<unsigned long long, std::shared_ptr<PLY::PLYResult>>::iterator it = m_resultsQueue.lower_bound(firstQueryID);
+		it != m_resultsQueue.end(); ++it)
+	{
+		results.push_back(it->second);
+	}
+
+	return results;
+}
+
+/**
+* Delete the result object and remove it from results list.
+*/
+void PLY::QueryEngine::RemoveResult(const unsigned long long queryID)
+{
+	//Establish lock on queue. Lock is released as it goes out of scope.
+	std::unique_lock<PLYMutex> lock = FRAMEPROFILER->Lock(m_resultsQueueMutex);
+
+	std::map<unsigned long long, std::shared_ptr<PLY::PLYResult>>::iterator it = m_resultsQueue.find(queryID);
+
+	if (it != m_resultsQueue.end())
+	{
+		PLYLOG(PLYLog::PLY_DEBUG, ("Result removed ID " + AZStd::string::format("%u", queryID)).c_str());
+		PLYLOG(PLYLog::PLY_DEBUG, ("Result queue size " + AZStd::string::format("%u", m_resultsQueue.size())).c_str());
+
+		m_resultsQueue.erase(it);
+	}
+}
+
+std::vector<std::shared_ptr<PLY::PLYResult>> PLY::QueryEngine::GetResultsToAdvertise()
+{
+	std::vector<std::shared_ptr<PLY::PLYResult>> advertise;
+
+	//Establish lock on queue. Lock is released as it goes out of scope.
+	std::unique_lock<PLYMutex> lock = FRAMEPROFILER->Lock(m_resultsQueueMutex);
+	for (auto &r : m_resultsQueue)
+	{
+		//Find results that need advertising, and haven't yet been advertised.
+		if (r.second->settings.advertiseResult && !r.second->hasBeenAdvertised)
+		{
+			//Collect a list of results that need to be advertised.
+			advertise.push_back(r.second);
+		}
+	}
+
+	return advertise;
+}
+
+void PLY::QueryEngine::CheckWorkManager()
+{
+	//Check if work manager thread died, and restart it if required.
+	if (m_started && m_workManager != nullptr && (m_workManager->IsDead() || m_workManager->IsShutDown()))
+	{
+		PLYLOG(PLYLog::PLY_WARNING, "Detected that WorkManager is not running. Restarting WorkManager.");
+
+		//Destroy the old work manager.
+		m_workManager = nullptr;
+
+		//Start up a new work manager.
+		m_workManager = std::make_unique<WorkManager>(this);
+	}
+}
+
+void PLY::QueryEngine::SetConnectionFactory(const ConnectionFactory &factory)
+{
+	if (m_started)
+	{
+		PLYLOG(PLYLog::PLY_ERROR, "Can't change the connection factory while the query engine is started.");
+		return;
+	}
+
+	m_connectionFactory = factory;
+}
+
+std::unique_ptr<PLY::DatabaseConnection> PLY::QueryEngine::OpenConnection(const AZStd::string &connectionString)
+{
+	if (m_connectionFactory) return m_connectionFactory(connectionString);
+	return std::make_unique<PostgresConnection>(connectionString);
+}
+
+unsigned long long PLY::QueryEngine::GetNextWorkerID()
+{
+	//Get next worker ID.
+	unsigned long long workerID = m_nextWorkerID;
+	
+	//Increment worker ID.
+	m_nextWorkerID++;
+	
+	return workerID;
+}
+
+void PLY::QueryEngine::Cleanup()
+{
+
+	//Clean up work manager.
+	m_workManager = nullptr;
+
+	//Clean up connections.
+	std::unique_lock<PLYMutex> lockC(m_workersMutex);
+	m_workers.clear();
+	lockC.unlock();
+
+	//Clean up query queue.
+	std::unique_lock<PLYMutex> lockQ(m_queryQueueMutex);
+	m_queryQueue.clear();
+	lockQ.unlock();
+
+	//Clean up results queue.
+	std::unique_lock<PLYMutex> lockR(m_resultsQueueMutex);
+	m_resultsQueue.clear();
+	m_supersededQueries.clear();
+	lockR.unlock();
+
+	//The next available query ID isn't reset, as systems may still hold IDs from before the engine stopped. A reused ID would
+	//be mistaken for one of theirs.
+
+	//Reset next available worker ID.
+	m_nextWorkerID = 1;
+}
@@ -0,0 +1,138 @@
+// Query engine for the PLY Gem. Owns the query worker pool, the work manager, and the query and results queues, and
+// hands queries to workers and results back to callers. It doesn't use EBuses or the TickBus, so it can run outside of
+// Lumberyard, such as in the headless benchmark. The PLY system component owns one, and advertises its results.
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#pragma once
+
+#include <map>
+
+#include <PLY/PLYTools.h>
+#include <PLY/PLYTypes.h>
+#include <PLY/PLYMutex.hpp>
+
+#include "DatabaseConnection.h"
+
+class PLYMicroBench;
+class PLYTest_CoalescedQueryKeepsQueuePosition_Test;
+
+namespace PLY
+{
+	//Forward declarations.
+	class Worker;
+	class WorkManager;
+	class SlowQueryLog;
+
+	class QueryEngine
+	{
+
+	friend Worker;
+	friend WorkManager;
+	friend PLYMicroBench;
+	friend PLYTest_CoalescedQueryKeepsQueuePosition_Test;
+
+	public:
+
+		QueryEngine();
+		~QueryEngine();
+
+		//Start the slow query log (if enabled), the minimum number of query workers, and the work manager, using the
+		//current PLY configuration. Does nothing if already started.
+		void Start();
+
+		//Stop all workers and the work manager, and clear the query and results queues.
+		void Stop();
+
+		//Has the engine been started?
+		inline bool IsStarted() const { return m_started; };
+
+		//Are any queries waiting in the query queue, or being run by a worker? Safe to call from any thread.
+		bool HasQueriesInProgress();
+
+		//Add a query to the query queue. Safe to call from any thread.
+		//@param query The SQL string to use for the query.
+		//@param binaryParams The parameter values, in placeholder order. Empty for a query without parameters.
+		//@param qs The query settings.
+		//@return The query ID.
+		unsigned long long SendQuery(const AZStd::string &query, const std::vector<std::string> &binaryParams, const QuerySettings &qs);
+
+		//Get a query result set from the results queue based on a query ID.
+		//@param queryID The ID of the query used to create the results set.
+		//@return The result, or nullptr if it isn't ready.
+		std::shared_ptr<PLYResult> GetResult(const unsigned long long queryID);
+
+		//Get the results that are ready for queries from a query ID onwards, taking the results queue lock once. Query IDs
+		//increase as queries are sent, so this finds every result ready since that query without looking up each query ID.
+		//@param firstQueryID The ID of the first query.
+		//@return The results that are ready, in query ID order. May include results for other senders' queries.
+		std::vector<std::shared_ptr<PLYResult>> GetResultsFrom(const unsigned long long firstQueryID);
+
+		//Remove a result set from the results queue based on its query ID.
+		//@param queryID The ID of the query used to create the results set.
+		void RemoveResult(const unsigned long long queryID);
+
+		//Get results that should be advertised and haven't been yet.
+		std::vector<std::shared_ptr<PLYResult>> GetResultsToAdvertise();
+
+		//Restart the work manager if its thread has died. Called regularly by the engine's owner.
+		void CheckWorkManager();
+
+		//Set how workers open database connections, such as to use fake connections. Only call while the engine is stopped.
+		//@param factory The connection factory. Empty to open PostgreSQL connections, the default.
+		void SetConnectionFactory(const ConnectionFactory &factory);
+
+	private:
+
+		//Mutex to lock list of query worker threads while it is modified.
+		PLYMutex m_workersMutex;
+		//Query worker threads.
+		std::vector<std::shared_ptr<Worker>> m_workers;
+
+		//Next unqiue connection worker ID.
+		unsigned long long m_nextWorkerID;
+
+		//Mutex to lock query queue while it is modified.
+		PLYMutex m_queryQueueMutex;
+		//Query queue.
+		std::list <std::shared_ptr<PLYQuery>> m_queryQueue;
+
+		//Mutex to lock query queue while it is modified.
+		PLYMutex m_resultsQueueMutex;
+		//Results queue.
+		std::map<unsigned long long, std::shared_ptr<PLYResult>> m_resultsQueue;
+
+		//IDs of queries that were replaced in the query queue by a newer query with the same coalescing key, keyed by the
+		//ID of the query that replaced them. Locked by m_resultsQueueMutex.
+		std::map<unsigned long long, std::vector<unsigned long long>> m_supersededQueries;
+
+		//Unqiue query IDs.
+		std::atomic<unsigned long long> m_nextQueryID;
+
+		//Has the engine been started?
+		bool m_started;
+
+		//Work manager.
+		std::unique_ptr<WorkManager> m_workManager;
+
+		//Slow query log. Only exists while the engine is started and the slow query threshold is set.
+		//Created before the workers and destroyed after them, as the workers hand it slow queries.
+		std::unique_ptr<SlowQueryLog> m_slowQueryLog;
+
+		//Opens worker database connections. Empty to open PostgreSQL connections.
+		ConnectionFactory m_connectionFactory;
+
+		//Get the next query worker thread ID.
+		unsigned long long GetNextWorkerID();
+
+		//Open a database connection for a worker. Throws pqxx::failure if the connection can't be established.
+		//@param connectionString The connection string from the PLY configuration.
+		std::unique_ptr<DatabaseConnection> OpenConnection(const AZStd::string &connectionString);
+
+		//Clean up all threads and pools.
+		void Cleanup();
+
+		//Add a result to the results queue.
+		//@param result The result to add to the queue.
+		bool AddResult(std::shared_ptr <PLYResult> result);
+	};
+}
@@ -0,0 +1,177 @@
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#include "QueryFingerprint.h"
+
+#include <cctype>
+#include <cstdio>
+
+using namespace PLY;
+
+namespace
+{
+	bool IsIdentifierChar(char c)
+	{
+		return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '$';
+	}
+
+	//Replace every occurrence of a pattern, repeating until none are left.
+	void Collapse(std::string &s, const std::string &pattern, const std::string &replacement)
+	{
+		size_t pos = 0;
+		while ((pos = s.find(pattern, pos > 0 ? pos - 1 : 0)) != std::string::npos)
+		{
+			s.replace(pos, pattern.size(), replacement);
+		}
+	}
+}
+
+std::string PLY::QueryFingerprint::Normalise(const std::string &sql)
+{
+	std::string out;
+	out.reserve(sql.size());
+
+	const size_t n = sql.size();
+	size_t i = 0;
+	bool pendingSpace = false;
+
+	while (i < n)
+	{
+		char c = sql[i];
+
+		//Whitespace and comments become a single space.
+		if (std::isspace(static_cast<unsigned char>(c)))
+		{
+			pendingSpace = true;
+			i++;
+			continue;
+		}
+		if (c == '-' && i + 1 < n && sql[i + 1] == '-')
+		{
+			while (i < n && sql[i] != '\n') i++;
+			pendingSpace = true;
+			continue;
+		}
+		if (c == '/' && i + 1 < n && sql[i + 1] == '*')
+		{
+			size_t end = sql.find("*/", i + 2);
+			i = end == std::string::npos ? n : end + 2;
+			pendingSpace = true;
+			continue;
+		}
+
+		if (pendingSpace && !out.empty()) out += ' ';
+		pendingSpace = false;
+
+		if (c == '\'')
+		{
+			//String literal. '' inside the literal is an escaped quote.
+			i++;
+			while (i < n)
+			{
+				if (sql[i] == '\'' && i + 1 < n && sql[i + 1] == '\'') i += 2;
+				else if (sql[i] == '\'') break;
+				else i++;
+			}
+			i++;
+			out += '?';
+		}
+		else if (c == '"')
+		{
+			//Quoted identifier. Kept as written.
+			size_t end = sql.find('"', i + 1);
+			end = end == std::string::npos ? n : end + 1;
+			out.append(sql, i, end - i);
+			i = end;
+		}
+		else if (c == '$' && i + 1 < n && (sql[i + 1] == '$' || std::isalpha(static_cast<unsigned char>(sql[i + 1])) || sql[i + 1] == '_') &&
+			(out.empty() || !IsIdentifierChar(out.back())))
+		{
+			//Dollar quoted string, such as $$...$$ or $tag$...$tag$.
+			size_t tagEnd = sql.find('$', i + 1);
+			if (tagEnd == std::string::npos)
+			{
+				out += c;
+				i++;
+				continue;
+			}
+			std::string tag = sql.substr(i, tagEnd - i + 1);
+			size_t end = sql.find(tag, tagEnd + 1);
+			i = end == std::string::npos ? n : end + tag.size();
+			out += '?';
+		}
+		else if (c == '$' && i + 1 < n && std::isdigit(static_cast<unsigned char>(sql[i + 1])))
+		{
+			//Parameter placeholder.
+			i++;
+			while (i < n && std::isdigit(static_cast<unsigned char>(sql[i]))) i++;
+			out += '?';
+		}
+		else if ((std::isdigit(static_cast<unsigned char>(c)) || (c == '.' && i + 1 < n && std::isdigit(static_cast<unsigned char>(sql[i + 1])))) &&
+			(out.empty() || !IsIdentifierChar(out.back())))
+		{
+			//Number, including decimals and exponents.
+			while (i < n && (std::isalnum(static_cast<unsigned char>(sql[i])) || sql[i] == '.' ||
+				((sql[i] == '+' || sql[i] == '-') && (sql[i - 1] == 'e' || sql[i - 1] == 'E')))) i++;
+			out += '?';
+		}
+		else
+		{
+			out += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+			i++;
+		}
+	}
+
+	//Make list separators consistent, then collapse lists of values and rows of values to a single entry.
+	Collapse(out, " ,", ",");
+	Collapse(out, ",?", ", ?");
+	Collapse(out, "( ", "(");
+	Collapse(out, " )", ")");
+	Collapse(out, "?, ?", "?");
+	Collapse(out, "),(", "), (");
+	Collapse(out, "(?), (?)", "(?)");
+
+	return out;
+}
+
+unsigned long long PLY::QueryFingerprint::Hash(const std::string &normalised)
+{
+	unsigned long long hash = 14695981039346656037ULL;
+	for (char c : normalised)
+	{
+		hash ^= static_cast<unsigned char>(c);
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+std::string PLY::QueryFingerprint::ToHex(unsigned long long id)
+{
+	char buffer[17];
+	snprintf(buffer, sizeof(buffer), "%016llx", id);
+	return buffer;
+}
+
+bool PLY::QueryFingerprint::IsReadOnly(const std::string &normalised)
+{
+	//Only a single statement that starts by reading.
+	if (normalised.compare(0, 7, "select ") != 0 && normalised.compare(0, 5, "with ") != 0 &&
+		normalised.compare(0, 7, "values ") != 0 && normalised.compare(0, 6, "table ") != 0) return false;
+
+	std::string body = normalised;
+	while (!body.empty() && (body.back() == ';' || body.back() == ' ')) body.pop_back();
+	if (body.find(';') != std::string::npos) return false;
+
+	//Data modifying CTEs, locking reads, and SELECT INTO all write, as do sequence functions. Session advisory locks,
+	//signalling other backends and dblink all have effects a rolled back read only transaction doesn't undo. Other functions
+	//with side effects can't be ruled out here, so EXPLAIN ANALYZE is also run in a read only transaction that is always
+	//rolled back.
+	const char *writes[] = { "insert ", "update ", "delete ", "merge ", "truncate ", " into ", "for update", "for share",
+		"for no key update", "for key share", "nextval(", "setval(", "advisory_lock", "pg_terminate_backend(", "pg_cancel_backend(",
+		"dblink" };
+	for (const char *w : writes)
+	{
+		if (body.find(w) != std::string::npos) return false;
+	}
+
+	return true;
+}
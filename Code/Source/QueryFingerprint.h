@@ -0,0 +1,35 @@
+// Query fingerprints. Reduces an SQL statement to its shape, with literals, numbers and parameters replaced by ?, comments
+// removed, whitespace collapsed and keywords lowercased, so statements that only differ in their values share a fingerprint.
+// Lists of values, such as IN lists and the rows of batched inserts, are collapsed to a single entry, so batches of different
+// sizes share a fingerprint too.
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#pragma once
+
+#include <string>
+
+namespace PLY
+{
+	class QueryFingerprint
+	{
+	public:
+
+		//Reduce an SQL statement to its normalised form.
+		//@param sql The SQL statement.
+		//@return The normalised statement.
+		static std::string Normalise(const std::string &sql);
+
+		//Get the fingerprint ID of a normalised statement.
+		//@param normalised The normalised statement, from Normalise.
+		//@return A 64 bit FNV-1a hash of the statement.
+		static unsigned long long Hash(const std::string &normalised);
+
+		//Format a fingerprint ID as 16 hex digits.
+		//@param id The fingerprint ID.
+		static std::string ToHex(unsigned long long id);
+
+		//Does a normalised statement only read data? Used to decide whether a statement is safe to run again.
+		//@param normalised The normalised statement, from Normalise.
+		static bool IsReadOnly(const std::string &normalised);
+	};
+}
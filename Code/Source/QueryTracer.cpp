@@ -0,0 +1,226 @@
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#include <ctime>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+
+#include <AzCore/IO/FileIO.h>
+
+#include "QueryTracer.h"
+#include <PLY/PLYConfiguration.hpp>
+#include <PLYLog.h>
+
+using namespace PLY;
+
+const unsigned long long PLY::QueryTracer::CAPACITY;
+
+namespace
+{
+	//Escape a string for use in JSON.
+	std::string Escape(const std::string &s)
+	{
+		std::string out;
+		out.reserve(s.size());
+		for (char c : s)
+		{
+			if (c == '"' || c == '\\') out += '\\';
+			if (static_cast<unsigned char>(c) < 0x20) continue;
+			out += c;
+		}
+		return out;
+	}
+}
+
+PLY::QueryTracer::QueryTracer()
+	: m_slots(new Slot[CAPACITY]),
+	m_next(0),
+	m_enabled(false),
+	m_epoch(std::chrono::steady_clock::now()),
+	m_timeSinceSlowFrameDump(SLOW_FRAME_DUMP_INTERVAL),
+	m_dumping(false)
+{
+	for (unsigned long long i = 0; i < CAPACITY; ++i) m_slots[i].sequence.store(0, std::memory_order_relaxed);
+}
+
+PLY::QueryTracer::~QueryTracer()
+{
+	if (m_dumpThread.joinable()) m_dumpThread.join();
+}
+
+QueryTracer *PLY::QueryTracer::getInstance()
+{
+	static QueryTracer instance;
+	return &instance;
+}
+
+unsigned int PLY::QueryTracer::GetThreadID()
+{
+	static std::atomic<unsigned int> nextThreadID(1);
+	thread_local unsigned int threadID = nextThreadID.fetch_add(1, std::memory_order_relaxed);
+	return threadID;
+}
+
+void PLY::QueryTracer::SetThreadName(const AZStd::string &name)
+{
+	std::unique_lock<std::mutex> lock(m_threadNamesMutex);
+	m_threadNames[GetThreadID()] = name.c_str();
+}
+
+void PLY::QueryTracer::Record(const char *name, unsigned long long start, unsigned long long end, unsigned long long workerID,
+	unsigned long long queryID)
+{
+	unsigned long long index = m_next.fetch_add(1, std::memory_order_relaxed);
+	Slot &slot = m_slots[index & (CAPACITY - 1)];
+
+	//Mark the slot as being written before touching its fields.
+	slot.sequence.store(index * 2 + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	slot.name.store(name, std::memory_order_relaxed);
+	slot.start.store(start, std::memory_order_relaxed);
+	slot.duration.store(end > start ? end - start : 0, std::memory_order_relaxed);
+	slot.workerID.store(workerID, std::memory_order_relaxed);
+	slot.queryID.store(queryID, std::memory_order_relaxed);
+	slot.threadID.store(GetThreadID(), std::memory_order_relaxed);
+
+	slot.sequence.store(index * 2 + 2, std::memory_order_release);
+}
+
+long long PLY::QueryTracer::Dump(const AZStd::string &fileName) const
+{
+	//Copy complete spans out of the ring first, so the file is written from one consistent set.
+	std::vector<Span> spans = CopySpans();
+
+	std::map<unsigned int, std::string> threadNames;
+	{
+		std::unique_lock<std::mutex> lock(m_threadNamesMutex);
+		threadNames = m_threadNames;
+	}
+
+	return WriteSpans(fileName, spans, threadNames);
+}
+
+std::vector<PLY::QueryTracer::Span> PLY::QueryTracer::CopySpans() const
+{
+	std::vector<Span> spans;
+	spans.reserve(static_cast<size_t>(std::min(CAPACITY, m_next.load(std::memory_order_relaxed))));
+
+	for (unsigned long long i = 0; i < CAPACITY; ++i)
+	{
+		const Slot &slot = m_slots[i];
+
+		unsigned long long before = slot.sequence.load(std::memory_order_acquire);
+		if (before == 0 || before % 2 != 0) continue;
+
+		Span s;
+		s.name = slot.name.load(std::memory_order_relaxed);
+		s.start = slot.start.load(std::memory_order_relaxed);
+		s.duration = slot.duration.load(std::memory_order_relaxed);
+		s.workerID = slot.workerID.load(std::memory_order_relaxed);
+		s.queryID = slot.queryID.load(std::memory_order_relaxed);
+		s.threadID = slot.threadID.load(std::memory_order_relaxed);
+
+		//Skip the slot if it was overwritten while it was being read.
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot.sequence.load(std::memory_order_relaxed) != before) continue;
+
+		spans.push_back(s);
+	}
+
+	std::sort(spans.begin(), spans.end(), [](const Span &a, const Span &b) { return a.start < b.start; });
+
+	return spans;
+}
+
+long long PLY::QueryTracer::WriteSpans(const AZStd::string &fileName, const std::vector<Span> &spans,
+	const std::map<unsigned int, std::string> &threadNames)
+{
+	//Resolve aliases such as @user@ to a full path.
+	char resolved[1024] = { 0 };
+	AZ::IO::FileIOBase *f = AZ::IO::FileIOBase::GetInstance();
+	std::string path = (f != nullptr && f->ResolvePath(fileName.c_str(), resolved, sizeof(resolved))) ? resolved : fileName.c_str();
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		PLYLOG(PLYLog::PLY_ERROR, "Couldn't write trace file " + AZStd::string(path.c_str()));
+		return -1;
+	}
+
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+	bool first = true;
+	for (const std::pair<const unsigned int, std::string> &t : threadNames)
+	{
+		file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t.first
+			<< ",\"args\":{\"name\":\"" << Escape(t.second) << "\"}}";
+		first = false;
+	}
+
+	for (const Span &s : spans)
+	{
+		std::map<unsigned int, std::string>::const_iterator t = threadNames.find(s.threadID);
+
+		file << (first ? "" : ",\n") << "{\"name\":\"" << Escape(s.name) << "\",\"cat\":\"ply\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+			<< s.threadID << ",\"ts\":" << s.start << ",\"dur\":" << s.duration << ",\"args\":{\"thread\":\""
+			<< (t != threadNames.end() ? Escape(t->second) : "") << "\",\"workerID\":" << s.workerID << ",\"queryID\":"
+			<< s.queryID << "}}";
+		first = false;
+	}
+
+	file << "\n]}\n";
+
+	if (!file)
+	{
+		PLYLOG(PLYLog::PLY_ERROR, "Couldn't write trace file " + AZStd::string(path.c_str()));
+		return -1;
+	}
+
+	PLYLOG(PLYLog::PLY_INFO, "Wrote " + AZStd::string::format("%zu", spans.size()) + " trace spans to " + AZStd::string(path.c_str()));
+
+	return static_cast<long long>(spans.size());
+}
+
+void PLY::QueryTracer::OnTick(float deltaTime)
+{
+	TraceSettings ts = PLYCONF->GetTraceSettings();
+
+	m_enabled.store(ts.enabled, std::memory_order_relaxed);
+
+	m_timeSinceSlowFrameDump += deltaTime;
+
+	if (!ts.enabled || ts.slowFrameThreshold <= 0 || deltaTime * 1000.0f <= ts.slowFrameThreshold) return;
+
+	//Don't let a run of slow frames flood the disk, or start a dump while the last one is still being written.
+	if (m_timeSinceSlowFrameDump < SLOW_FRAME_DUMP_INTERVAL || m_dumping) return;
+	m_timeSinceSlowFrameDump = 0;
+
+	PLYLOG(PLYLog::PLY_WARNING, AZStd::string::format("Slow frame took %.1f ms. Dumping query trace.", deltaTime * 1000.0f));
+
+	//Add the time to the file name, before the extension, so each slow frame gets its own file.
+	AZStd::string fileName = ts.fileName;
+	AZStd::string suffix = AZStd::string::format("_slow_%lld", static_cast<long long>(std::time(nullptr)));
+	size_t dot = fileName.find_last_of('.');
+	size_t slash = fileName.find_last_of("/\\");
+	if (dot != AZStd::string::npos && (slash == AZStd::string::npos || dot > slash)) fileName.insert(dot, suffix);
+	else fileName += suffix;
+
+	std::vector<Span> spans = CopySpans();
+
+	std::map<unsigned int, std::string> threadNames;
+	{
+		std::unique_lock<std::mutex> lock(m_threadNamesMutex);
+		threadNames = m_threadNames;
+	}
+
+	//The last dump thread has finished writing, so this doesn't wait.
+	if (m_dumpThread.joinable()) m_dumpThread.join();
+
+	m_dumping = true;
+	m_dumpThread = std::thread([this, fileName, spans = std::move(spans), threadNames = std::move(threadNames)]
+	{
+		WriteSpans(fileName, spans, threadNames);
+		m_dumping = false;
+	});
+}
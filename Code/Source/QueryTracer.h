@@ -0,0 +1,173 @@
+// Timeline tracer for the PLY Gem. Designed to be used as a singleton via the provided macro.
+// Records spans of work done by the main thread, the work manager and the query workers into a fixed size lock-free ring
+// buffer, and dumps the most recent spans as Chrome trace event JSON, which can be opened in chrome://tracing or Perfetto.
+// Each slot in the ring is guarded by a sequence number, so writers never wait for each other or for a dump, and a dump
+// skips any slot that was being overwritten while it was read. While tracing is stopped, recording a span is one branch.
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <string>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include <PLY/PLYTypes.h>
+
+#define TRACER PLY::QueryTracer::getInstance()
+
+namespace PLY
+{
+	class QueryTracer
+	{
+	public:
+
+		//Get a singleton instance.
+		static QueryTracer *getInstance();
+
+		//Is tracing enabled?
+		inline bool IsEnabled() const { return m_enabled.load(std::memory_order_relaxed); };
+
+		//Name the calling thread in dumped traces.
+		//@param name The thread name.
+		void SetThreadName(const AZStd::string &name);
+
+		//Get the current trace time, in microseconds.
+		inline unsigned long long Now() const
+		{
+			return static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now() - m_epoch).count());
+		};
+
+		//Record a span of work done by the calling thread.
+		//@param name Name of the span. Must be a string literal, or otherwise outlive the tracer.
+		//@param start Start time, from Now().
+		//@param end End time, from Now().
+		//@param workerID ID of the worker the span belongs to. 0 if none.
+		//@param queryID ID of the query the span belongs to. 0 if none.
+		void Record(const char *name, unsigned long long start, unsigned long long end, unsigned long long workerID,
+			unsigned long long queryID);
+
+		//Write the spans in the ring buffer to a file as Chrome trace event JSON. Safe to call while spans are being recorded.
+		//@param fileName The file name. May use file IO aliases such as @user@.
+		//@return The number of spans written, or -1 if the file couldn't be written.
+		long long Dump(const AZStd::string &fileName) const;
+
+		//Tick handler. Applies the trace settings, and dumps the ring buffer if the last frame was slow. The spans are copied
+		//on the calling thread, and written to the file on a background thread, so the dump doesn't slow the frame further.
+		//@param deltaTime Time taken by the last frame, in seconds.
+		void OnTick(float deltaTime);
+
+	private:
+
+		//Number of spans kept. Must be a power of two.
+		static const unsigned long long CAPACITY = 1ULL << 16;
+
+		//Minimum time between dumps triggered by slow frames, in seconds.
+		static const int SLOW_FRAME_DUMP_INTERVAL = 10;
+
+		//A recorded span. Fields are atomic so a dump can read a slot while it is being overwritten; the sequence number then
+		//shows the slot is torn, and the dump skips it.
+		struct Slot
+		{
+			//Odd while the slot is being written, even once it holds a complete span. 0 if the slot has never been written.
+			std::atomic<unsigned long long> sequence;
+			std::atomic<const char *> name;
+			std::atomic<unsigned long long> start;
+			std::atomic<unsigned long long> duration;
+			std::atomic<unsigned long long> workerID;
+			std::atomic<unsigned long long> queryID;
+			std::atomic<unsigned int> threadID;
+		};
+
+		//Ring buffer of spans.
+		std::unique_ptr<Slot[]> m_slots;
+
+		//Number of spans ever recorded. The next span is written to slot m_next % CAPACITY.
+		std::atomic<unsigned long long> m_next;
+
+		//Is tracing enabled?
+		std::atomic<bool> m_enabled;
+
+		//Time trace times are measured from.
+		std::chrono::steady_clock::time_point m_epoch;
+
+		//Thread names, by trace thread ID.
+		std::map<unsigned int, std::string> m_threadNames;
+		mutable std::mutex m_threadNamesMutex;
+
+		//Time since the last dump triggered by a slow frame, in seconds.
+		float m_timeSinceSlowFrameDump;
+
+		//Writes the most recent dump triggered by a slow frame.
+		std::thread m_dumpThread;
+
+		//Is the dump thread still writing?
+		std::atomic<bool> m_dumping;
+
+		//A span copied out of the ring buffer.
+		struct Span
+		{
+			const char *name;
+			unsigned long long start;
+			unsigned long long duration;
+			unsigned long long workerID;
+			unsigned long long queryID;
+			unsigned int threadID;
+		};
+
+		//Get the trace thread ID of the calling thread. Each thread is given the next ID the first time it calls this.
+		static unsigned int GetThreadID();
+
+		//Copy the complete spans out of the ring buffer, in start time order.
+		std::vector<Span> CopySpans() const;
+
+		//Write spans to a file as Chrome trace event JSON.
+		//@param fileName The file name. May use file IO aliases such as @user@.
+		//@param spans The spans.
+		//@param threadNames Thread names, by trace thread ID.
+		//@return The number of spans written, or -1 if the file couldn't be written.
+		static long long WriteSpans(const AZStd::string &fileName, const std::vector<Span> &spans,
+			const std::map<unsigned int, std::string> &threadNames);
+
+		QueryTracer();
+		~QueryTracer();
+	};
+
+	//Records a span from its construction to its destruction, if tracing is enabled.
+	class TraceSpan
+	{
+	public:
+
+		//@param name Name of the span. Must be a string literal.
+		//@param workerID ID of the worker the span belongs to. 0 if none.
+		//@param queryID ID of the query the span belongs to. 0 if none.
+		TraceSpan(const char *name, unsigned long long workerID = 0, unsigned long long queryID = 0)
+			: m_name(name),
+			m_workerID(workerID),
+			m_queryID(queryID),
+			m_enabled(TRACER->IsEnabled()),
+			m_start(m_enabled ? TRACER->Now() : 0)
+		{};
+
+		~TraceSpan()
+		{
+			if (m_enabled) TRACER->Record(m_name, m_start, TRACER->Now(), m_workerID, m_queryID);
+		};
+
+		//Set the query the span belongs to, if it wasn't known when the span started.
+		inline void SetQueryID(unsigned long long queryID) { m_queryID = queryID; };
+
+	private:
+
+		const char *m_name;
+		unsigned long long m_workerID;
+		unsigned long long m_queryID;
+		bool m_enabled;
+		unsigned long long m_start;
+	};
+}
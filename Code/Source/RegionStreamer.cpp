@@ -0,0 +1,211 @@
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#include "RegionStreamer.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+using namespace PLY;
+
+PLY::RegionStreamer::RegionStreamer()
+{
+}
+
+PLY::RegionStreamer::~RegionStreamer()
+{
+}
+
+void PLY::RegionStreamer::SetFocusPoint(const int focusID, const AZ::Vector3 &position)
+{
+	m_focusPoints[focusID].position = position;
+}
+
+void PLY::RegionStreamer::RemoveFocusPoint(const int focusID)
+{
+	m_focusPoints.erase(focusID);
+}
+
+void PLY::RegionStreamer::Update(const float deltaTime, const float cellSize, const int radius, const float prefetchSeconds,
+	const size_t maxCells, std::vector<CellKey> &load, std::vector<CellKey> &evict)
+{
+	if (cellSize <= 0) return;
+
+	std::vector<CellKey> wanted;
+	std::unordered_set<CellKey> wantedSet;
+
+	//Cells around the focus points themselves come first, so they are loaded before prefetched cells.
+	for (auto &f : m_focusPoints)
+	{
+		FocusPoint &fp = f.second;
+
+		if (fp.hasLastPosition && deltaTime > 0)
+		{
+			AZ::Vector3 moved = fp.position - fp.lastPosition;
+
+			//A jump of more than the loaded area in one frame is a teleport, not movement, so don't prefetch along it.
+			float maxMove = cellSize * static_cast<float>(radius + 1);
+			if (static_cast<float>(moved.GetLengthSq()) > maxMove * maxMove)
+			{
+				fp.velocity = AZ::Vector3::CreateZero();
+			}
+			else
+			{
+				//Smooth the velocity so that frame time jitter doesn't make the prefetched cells flicker.
+				fp.velocity = fp.velocity * 0.5f + (moved / deltaTime) * 0.5f;
+			}
+		}
+
+		fp.lastPosition = fp.position;
+		fp.hasLastPosition = true;
+
+		AddWantedCells(fp.position.GetX(), fp.position.GetY(), cellSize, radius, wanted, wantedSet);
+	}
+
+	//Prefetch cells along each focus point's direction of movement, one step per cell width.
+	if (prefetchSeconds > 0)
+	{
+		for (auto &f : m_focusPoints)
+		{
+			const FocusPoint &fp = f.second;
+
+			AZ::Vector3 ahead = fp.velocity * prefetchSeconds;
+			float distance = std::sqrt(static_cast<float>(ahead.GetX()) * ahead.GetX() + static_cast<float>(ahead.GetY()) * ahead.GetY());
+			if (distance < cellSize) continue;
+
+			int steps = std::min(static_cast<int>(distance / cellSize), 32);
+			for (int s = 1; s <= steps; ++s)
+			{
+				float t = static_cast<float>(s) / static_cast<float>(steps);
+				AddWantedCells(fp.position.GetX() + ahead.GetX() * t, fp.position.GetY() + ahead.GetY() * t, cellSize, radius, wanted, wantedSet);
+			}
+		}
+	}
+
+	for (const CellKey key : wanted)
+	{
+		std::unordered_map<CellKey, Cell>::iterator c = m_cells.find(key);
+
+		if (c == m_cells.end())
+		{
+			Cell &cell = m_cells[key];
+			cell.state = LOADING;
+			cell.retryTimer = 0;
+			m_lru.push_front(key);
+			cell.lru = m_lru.begin();
+			load.push_back(key);
+			continue;
+		}
+
+		Cell &cell = c->second;
+
+		if (cell.state == FAILED)
+		{
+			cell.retryTimer -= deltaTime;
+			if (cell.retryTimer > 0) continue;
+
+			cell.state = LOADING;
+			m_lru.push_front(key);
+			cell.lru = m_lru.begin();
+			load.push_back(key);
+			continue;
+		}
+
+		//Mark the cell as recently needed.
+		m_lru.splice(m_lru.begin(), m_lru, cell.lru);
+	}
+
+	//Forget failed cells that are no longer wanted, so they are requested straight away if they are wanted again.
+	for (std::unordered_map<CellKey, Cell>::iterator c = m_cells.begin(); c != m_cells.end();)
+	{
+		if (c->second.state == FAILED && wantedSet.count(c->first) == 0) c = m_cells.erase(c);
+		else ++c;
+	}
+
+	//Evict the least recently needed loaded cells until under the cap. Cells that are wanted or still loading are kept, so
+	//the cap may be exceeded if it is smaller than the area around the focus points.
+	std::list<CellKey>::iterator it = m_lru.end();
+	while (m_lru.size() > maxCells && it != m_lru.begin())
+	{
+		--it;
+
+		Cell &cell = m_cells[*it];
+		if (cell.state != LOADED || wantedSet.count(*it) != 0) continue;
+
+		evict.push_back(*it);
+		m_cells.erase(*it);
+		it = m_lru.erase(it);
+	}
+}
+
+void PLY::RegionStreamer::SetCellLoaded(const CellKey key, const bool success)
+{
+	std::unordered_map<CellKey, Cell>::iterator c = m_cells.find(key);
+	if (c == m_cells.end() || c->second.state != LOADING) return;
+
+	if (success)
+	{
+		c->second.state = LOADED;
+		return;
+	}
+
+	c->second.state = FAILED;
+	c->second.retryTimer = RETRY_DELAY;
+	m_lru.erase(c->second.lru);
+}
+
+bool PLY::RegionStreamer::IsCellLoaded(const CellKey key) const
+{
+	std::unordered_map<CellKey, Cell>::const_iterator c = m_cells.find(key);
+	return c != m_cells.end() && c->second.state == LOADED;
+}
+
+void PLY::RegionStreamer::Clear()
+{
+	m_focusPoints.clear();
+	m_cells.clear();
+	m_lru.clear();
+}
+
+void PLY::RegionStreamer::AddWantedCells(const float x, const float y, const float cellSize, const int radius,
+	std::vector<CellKey> &wanted, std::unordered_set<CellKey> &wantedSet) const
+{
+	int cx = static_cast<int>(std::floor(x / cellSize));
+	int cy = static_cast<int>(std::floor(y / cellSize));
+
+	//Walk outwards in square rings, so nearer cells are requested first.
+	for (int r = 0; r <= radius; ++r)
+	{
+		for (int dx = -r; dx <= r; ++dx)
+		{
+			for (int dy = -r; dy <= r; ++dy)
+			{
+				if (std::abs(dx) != r && std::abs(dy) != r) continue;
+
+				CellKey key = MakeKey(cx + dx, cy + dy);
+				if (wantedSet.insert(key).second) wanted.push_back(key);
+			}
+		}
+	}
+}
+
+PLY::RegionStreamer::CellKey PLY::RegionStreamer::GetCellKey(const float x, const float y, const float cellSize)
+{
+	return MakeKey(static_cast<int>(std::floor(x / cellSize)), static_cast<int>(std::floor(y / cellSize)));
+}
+
+void PLY::RegionStreamer::GetCellBounds(const CellKey key, const float cellSize, float &minX, float &minY, float &maxX, float &maxY)
+{
+	int cx = static_cast<int>(static_cast<unsigned int>(static_cast<unsigned long long>(key) >> 32));
+	int cy = static_cast<int>(static_cast<unsigned int>(static_cast<unsigned long long>(key) & 0xFFFFFFFF));
+
+	minX = static_cast<float>(cx) * cellSize;
+	minY = static_cast<float>(cy) * cellSize;
+	maxX = minX + cellSize;
+	maxY = minY + cellSize;
+}
+
+PLY::RegionStreamer::CellKey PLY::RegionStreamer::MakeKey(const int cx, const int cy)
+{
+	return static_cast<CellKey>((static_cast<unsigned long long>(static_cast<unsigned int>(cx)) << 32) | static_cast<unsigned int>(cy));
+}
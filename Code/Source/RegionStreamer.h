@@ -0,0 +1,123 @@
+// Region streamer. Divides the world into a grid of square cells on the X/Y plane, and works out which cells should have
+// their object state loaded around a set of focus points (such as players or cameras). Cells along each focus point's
+// direction of movement are prefetched, and cells no longer needed are evicted in least recently used order once the
+// number of loaded cells exceeds a cap. The cap counts cells rather than bytes, as only the game knows how much memory
+// the objects in a cell take once their state is applied. The streamer only tracks cell state; the object sync manager does the loading.
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#pragma once
+
+#include <map>
+#include <cstddef>
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <AzCore/Math/Vector3.h>
+
+namespace PLY
+{
+	class RegionStreamer
+	{
+
+	public:
+
+		//Unique key of a grid cell, made from its X and Y grid coordinates.
+		typedef long long CellKey;
+
+		//Time (seconds) to wait before requesting a cell again after its load failed.
+		static constexpr float RETRY_DELAY = 1.0f;
+
+		RegionStreamer();
+		~RegionStreamer();
+
+		//Set the position of a focus point, adding it if it doesn't exist.
+		//@param focusID Unique ID of the focus point.
+		//@param position The focus point's world position.
+		void SetFocusPoint(const int focusID, const AZ::Vector3 &position);
+
+		//Remove a focus point. Its cells are evicted once they are no longer needed by another focus point.
+		//@param focusID Unique ID of the focus point.
+		void RemoveFocusPoint(const int focusID);
+
+		//Work out which cells need loading and which can be evicted this frame.
+		//@param deltaTime Seconds since the last update.
+		//@param cellSize Width of a cell, in world units.
+		//@param radius Number of cells loaded in each direction around a focus point.
+		//@param prefetchSeconds How far ahead (seconds of movement at the current velocity) to prefetch cells.
+		//@param maxCells Maximum number of cells to keep loaded. Cells needed by a focus point are never evicted.
+		//@param load Set to the cells that should be loaded now, nearest to a focus point first.
+		//@param evict Set to the cells that should be evicted now.
+		void Update(const float deltaTime, const float cellSize, const int radius, const float prefetchSeconds, const size_t maxCells,
+			std::vector<CellKey> &load, std::vector<CellKey> &evict);
+
+		//Record the outcome of a cell load.
+		//@param key The cell.
+		//@param success Was the cell loaded? Failed cells are requested again after RETRY_DELAY.
+		void SetCellLoaded(const CellKey key, const bool success);
+
+		//Is a cell loaded?
+		//@param key The cell.
+		bool IsCellLoaded(const CellKey key) const;
+
+		//Get the number of cells loaded or loading.
+		inline size_t GetCellCount() const { return m_lru.size(); };
+
+		//Remove all focus points and cells.
+		void Clear();
+
+		//Get the key of the cell containing a world position.
+		//@param x World X position.
+		//@param y World Y position.
+		//@param cellSize Width of a cell, in world units.
+		static CellKey GetCellKey(const float x, const float y, const float cellSize);
+
+		//Get the world bounds of a cell.
+		//@param key The cell.
+		//@param cellSize Width of a cell, in world units.
+		static void GetCellBounds(const CellKey key, const float cellSize, float &minX, float &minY, float &maxX, float &maxY);
+
+	private:
+
+		//A point objects are streamed in around.
+		struct FocusPoint
+		{
+			FocusPoint() :
+				position(AZ::Vector3::CreateZero()),
+				lastPosition(AZ::Vector3::CreateZero()),
+				velocity(AZ::Vector3::CreateZero()),
+				hasLastPosition(false)
+			{};
+			AZ::Vector3 position;
+			AZ::Vector3 lastPosition; //Position at the last update, used to work out velocity.
+			AZ::Vector3 velocity; //Smoothed world units per second.
+			bool hasLastPosition;
+		};
+
+		enum CellState { LOADING, LOADED, FAILED };
+
+		struct Cell
+		{
+			CellState state;
+			float retryTimer; //Seconds until a failed cell can be requested again.
+			std::list<CellKey>::iterator lru; //Position in m_lru. Only valid for LOADING and LOADED cells.
+		};
+
+		//Focus points, keyed by ID.
+		std::map<int, FocusPoint> m_focusPoints;
+
+		//All known cells.
+		std::unordered_map<CellKey, Cell> m_cells;
+
+		//Loading and loaded cells, most recently needed first.
+		std::list<CellKey> m_lru;
+
+		//Add cells within a radius of a world position to the wanted list, nearest first.
+		void AddWantedCells(const float x, const float y, const float cellSize, const int radius,
+			std::vector<CellKey> &wanted, std::unordered_set<CellKey> &wantedSet) const;
+
+		//Make a cell key from grid coordinates.
+		static CellKey MakeKey(const int cx, const int cy);
+	};
+}
@@ -0,0 +1,546 @@
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#define NOMINMAX
+#define _AMD64_
+#include <fileapi.h>
+#include <handleapi.h>
+#include <memoryapi.h>
+#include <stringapiset.h>
+
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+
+#include <AzCore/IO/FileIO.h>
+
+#include "SaveJournal.h"
+#include "ObjectSyncManager.h"
+#include "QueryTracer.h"
+#include <PLY/PLYConfiguration.hpp>
+#include <PLYLog.h>
+
+using namespace PLY;
+
+namespace
+{
+	//Size of the segment header, in bytes. Records start immediately after it.
+	const unsigned long long HEADER_SIZE = 128;
+
+	//Offsets of the two checkpoint slots within the header.
+	const unsigned long long CHECKPOINT_OFFSETS[2] = { 64, 96 };
+
+	//Size of a record header, in bytes.
+	const unsigned long long RECORD_HEADER_SIZE = 24;
+
+	//Segment file format version.
+	const unsigned int VERSION = 2;
+
+	//A checkpoint slot, as stored in the segment header.
+	struct Checkpoint
+	{
+		unsigned long long offset; //Offset of the first record not yet written to the database.
+		unsigned long long sequence; //Sequence number of that record.
+		unsigned long long generation; //Higher generations are more recent.
+		unsigned int checksum; //Checksum of the fields above.
+		unsigned int reserved;
+	};
+
+	//A record header, as stored in the segment.
+	struct RecordHeader
+	{
+		char magic[4]; //"PLYR"
+		unsigned int length; //Payload length, in bytes.
+		unsigned long long sequence;
+		unsigned int checksum; //Checksum of the sequence number and payload.
+		unsigned int reserved;
+	};
+
+	//Round a size up to a multiple of 8 bytes, so records stay aligned.
+	unsigned long long Align(const unsigned long long size)
+	{
+		return (size + 7) & ~static_cast<unsigned long long>(7);
+	}
+
+	//Append a value to a payload, in native byte order.
+	template<typename T>
+	void Put(std::string &payload, const T &value)
+	{
+		payload.append(reinterpret_cast<const char *>(&value), sizeof(T));
+	}
+
+	//Append a length-prefixed string to a payload.
+	void PutString(std::string &payload, const char *s, const size_t length)
+	{
+		Put(payload, static_cast<unsigned int>(length));
+		payload.append(s, length);
+	}
+
+	//Read a value from a payload.
+	template<typename T>
+	bool Get(const char *&p, const char *end, T &value)
+	{
+		if (static_cast<size_t>(end - p) < sizeof(T)) return false;
+		memcpy(&value, p, sizeof(T));
+		p += sizeof(T);
+		return true;
+	}
+
+	//Read a length-prefixed string from a payload.
+	bool GetString(const char *&p, const char *end, std::string &s)
+	{
+		unsigned int length = 0;
+		if (!Get(p, end, length) || static_cast<size_t>(end - p) < length) return false;
+		s.assign(p, length);
+		p += length;
+		return true;
+	}
+}
+
+PLY::SaveJournal::SaveJournal() :
+	m_fileHandle(nullptr),
+	m_mappingHandle(nullptr),
+	m_view(nullptr),
+	m_size(0),
+	m_writeOffset(HEADER_SIZE),
+	m_nextSequence(1),
+	m_flushedOffset(HEADER_SIZE),
+	m_flushedSequence(1),
+	m_checkpointGeneration(0),
+	m_shutdown(false),
+	m_failed(false),
+	m_flushIntervalMS(100),
+	m_connectionString("")
+{
+}
+
+PLY::SaveJournal::~SaveJournal()
+{
+	Close();
+}
+
+bool PLY::SaveJournal::Open(const AZStd::string &fileName, const int sizeMB, const int flushIntervalMS, const AZStd::string &connectionString)
+{
+	if (IsOpen()) return true;
+
+	//Resolve aliases such as @user@ to a full path.
+	char resolved[1024] = { 0 };
+	AZ::IO::FileIOBase *f = AZ::IO::FileIOBase::GetInstance();
+	AZStd::string path = (f != nullptr && f->ResolvePath(fileName.c_str(), resolved, sizeof(resolved))) ? AZStd::string(resolved) : fileName;
+
+	if (!MapFile(path, static_cast<unsigned long long>(std::max(1, sizeMB)) * 1024 * 1024))
+	{
+		PLYLOG(PLYLog::PLY_ERROR, "Couldn't open object sync save journal " + path + ". Saves will be sent to the database directly.");
+		return false;
+	}
+
+	Recover();
+
+	m_flushIntervalMS = std::max(1, flushIntervalMS);
+	m_connectionString = connectionString;
+	m_shutdown = false;
+	m_failed = false;
+	m_flusherThread = std::thread([this] { FlusherLoop(); });
+
+	PLYLOG(PLYLog::PLY_INFO, "Opened object sync save journal " + path + AZStd::string::format(". %llu saves to replay.",
+		m_nextSequence - m_flushedSequence.load()));
+
+	return true;
+}
+
+void PLY::SaveJournal::Close()
+{
+	if (!IsOpen()) return;
+
+	m_shutdown = true;
+	Notify();
+	if (m_flusherThread.joinable()) m_flusherThread.join();
+
+	UnmapFile();
+
+	PLYLOG(PLYLog::PLY_INFO, "Closed object sync save journal.");
+}
+
+bool PLY::SaveJournal::Append(const PLYObjectSyncSaveLoad::DataBaseDetails &details, const int objectID, const std::string &dataString,
+	const AZ::Vector3 &position, unsigned long long &sequence)
+{
+	if (!IsOpen() || m_failed) return false;
+
+	std::string payload;
+	payload.reserve(64 + details.tableName.size() + details.IDColumnName.size() + details.dataColumnName.size() +
+		details.positionColumnName.size() + details.updatedAtColumnName.size() + dataString.size());
+
+	Put(payload, static_cast<int>(details.dataFormat));
+	Put(payload, objectID);
+	Put(payload, static_cast<float>(position.GetX()));
+	Put(payload, static_cast<float>(position.GetY()));
+	Put(payload, static_cast<float>(position.GetZ()));
+	PutString(payload, details.tableName.c_str(), details.tableName.size());
+	PutString(payload, details.IDColumnName.c_str(), details.IDColumnName.size());
+	PutString(payload, details.dataColumnName.c_str(), details.dataColumnName.size());
+	PutString(payload, details.positionColumnName.c_str(), details.positionColumnName.size());
+	PutString(payload, details.updatedAtColumnName.c_str(), details.updatedAtColumnName.size());
+	PutString(payload, dataString.c_str(), dataString.size());
+
+	const unsigned long long recordSize = Align(RECORD_HEADER_SIZE + payload.size());
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	if (m_writeOffset + recordSize > m_size)
+	{
+		//The segment can only start again from the beginning once everything in it has been written to the database.
+		if (m_flushedOffset != m_writeOffset || HEADER_SIZE + recordSize > m_size) return false;
+
+		m_writeOffset = HEADER_SIZE;
+		m_flushedOffset = HEADER_SIZE;
+		WriteCheckpoint();
+	}
+
+	RecordHeader header;
+	memcpy(header.magic, "PLYR", 4);
+	header.length = static_cast<unsigned int>(payload.size());
+	header.sequence = m_nextSequence;
+	header.reserved = 0;
+
+	std::string checked(reinterpret_cast<const char *>(&header.sequence), sizeof(header.sequence));
+	checked += payload;
+	header.checksum = Checksum(checked.data(), checked.size());
+
+	memcpy(m_view + m_writeOffset + RECORD_HEADER_SIZE, payload.data(), payload.size());
+	memcpy(m_view + m_writeOffset, &header, sizeof(header));
+
+	sequence = m_nextSequence++;
+	m_writeOffset += recordSize;
+
+	return true;
+}
+
+void PLY::SaveJournal::Notify()
+{
+	m_flusherCV.notify_one();
+}
+
+void PLY::SaveJournal::FlusherLoop()
+{
+	TRACER->SetThreadName("Journal Flusher");
+
+	//The flusher has its own connection, so it keeps draining the journal when the query worker pool is busy.
+	std::unique_ptr<pqxx::connection> c = nullptr;
+
+	while (!m_shutdown)
+	{
+		unsigned long long begin = 0;
+		unsigned long long end = 0;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_flusherCV.wait_for(lock, std::chrono::milliseconds(m_flushIntervalMS));
+			begin = m_flushedOffset;
+			end = m_writeOffset;
+		}
+
+		if (m_shutdown || begin == end) continue;
+
+		//Make sure saves reach the disk, not just the file cache, in case the whole system goes down. FlushViewOfFile only
+		//starts writing the pages, so the file is flushed too, to wait for them and the file metadata to be written.
+		FlushViewOfFile(m_view + begin, static_cast<SIZE_T>(end - begin));
+		FlushFileBuffers(static_cast<HANDLE>(m_fileHandle));
+
+		unsigned long long stop = begin;
+		unsigned long long count = 0;
+		if (!FlushRange(c, begin, end, stop, count))
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(PLYCONF->GetDatabaseConnectionDetails().reconnectWaitTime));
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_flushedOffset = stop;
+		m_flushedSequence += count;
+		WriteCheckpoint();
+
+		if (stop != end)
+		{
+			//Records after a corrupt one can't be trusted to be in sequence, so the flusher stops at it. The checkpoint points
+			//at the corrupt record, so it is discarded, and overwritten, when the journal is next opened.
+			PLYLOG(PLYLog::PLY_ERROR, AZStd::string::format("Object sync save journal record %llu is corrupt. %llu saves from it on won't be "
+				"written to the database.", m_flushedSequence.load(), m_nextSequence - m_flushedSequence.load()));
+			m_failed = true;
+			break;
+		}
+	}
+}
+
+bool PLY::SaveJournal::FlushRange(std::unique_ptr<pqxx::connection> &c, const unsigned long long begin, const unsigned long long end,
+	unsigned long long &stop, unsigned long long &count)
+{
+	TraceSpan span("JournalFlush");
+
+	//Only the most recent save of each object is written, grouped by table, ID column, data column and position column.
+	std::map<AZStd::string, std::pair<PLYObjectSyncSaveLoad::DataBaseDetails, std::map<int, ObjectSyncManager::PendingSave>>> batches;
+
+	unsigned long long offset = begin;
+	unsigned long long sequence = m_flushedSequence;
+	count = 0;
+
+	Entry entry;
+	while (offset < end)
+	{
+		unsigned long long next = 0;
+		if (!ReadRecord(offset, sequence, &entry, next)) break;
+
+		AZStd::string key = entry.details.tableName + "|" + entry.details.IDColumnName + "|" + entry.details.dataColumnName +
+			AZStd::string::format("|%d|", static_cast<int>(entry.details.dataFormat)) + entry.details.positionColumnName + "|" +
+			entry.details.updatedAtColumnName;
+
+		std::pair<PLYObjectSyncSaveLoad::DataBaseDetails, std::map<int, ObjectSyncManager::PendingSave>> &batch = batches[key];
+		batch.first = entry.details;
+
+		ObjectSyncManager::PendingSave &save = batch.second[entry.objectID];
+		save.dataString = std::move(entry.dataString);
+		save.position = AZ::Vector3(entry.x, entry.y, entry.z);
+
+		offset = next;
+		sequence++;
+		count++;
+	}
+
+	stop = offset;
+
+	size_t maxBatchSize = static_cast<size_t>(std::max(1, PLYCONF->GetObjectSyncSettings().maxSaveBatchSize));
+
+	try
+	{
+		if (c == nullptr) c = std::make_unique<pqxx::connection>(m_connectionString.c_str());
+
+		for (auto &b : batches)
+		{
+			const PLYObjectSyncSaveLoad::DataBaseDetails &details = b.second.first;
+			const bool binary = details.dataFormat == PLYObjectSyncSaveLoad::BINARY;
+
+			//PostgreSQL allows at most 65535 parameters per query, and binary saves use one per object.
+			size_t batchSize = binary ? std::min(maxBatchSize, static_cast<size_t>(65535)) : maxBatchSize;
+
+			std::map<int, ObjectSyncManager::PendingSave>::const_iterator first = b.second.second.begin();
+			while (first != b.second.second.end())
+			{
+				std::map<int, ObjectSyncManager::PendingSave>::const_iterator last = first;
+				for (size_t i = 0; i < batchSize && last != b.second.second.end(); ++i) ++last;
+
+				std::vector<std::string> binaryParams;
+				std::string qString = ObjectSyncManager::GetSaveQuery(details, first, last, binaryParams);
+
+				try
+				{
+					pqxx::nontransaction w(*c);
+					if (binary)
+					{
+						std::vector<pqxx::binarystring> params;
+						params.reserve(binaryParams.size());
+						for (const std::string &p : binaryParams) params.emplace_back(p);
+
+						w.exec_params(qString, pqxx::prepare::make_dynamic_params(params));
+					}
+					else
+					{
+						w.exec(qString);
+					}
+				}
+				catch (const pqxx::sql_error &e)
+				{
+					//Retrying a save the database rejects would stop the journal draining, so it is dropped.
+					PLYLOG(PLYLog::PLY_ERROR, "Dropped " + AZStd::string::format("%u", static_cast<unsigned int>(std::distance(first, last))) +
+						" journaled object sync saves to table " + details.tableName + ". SQL error: " + AZStd::string(e.what()));
+				}
+
+				first = last;
+			}
+		}
+	}
+	catch (const std::exception &e)
+	{
+		//Connection failure. The whole range is retried, which is safe as every save is an UPSERT of the object's latest state.
+		PLYLOG(PLYLog::PLY_ERROR, "Object sync save journal flush failed. Error: " + AZStd::string(e.what()));
+		c = nullptr;
+		return false;
+	}
+
+	return true;
+}
+
+void PLY::SaveJournal::Recover()
+{
+	bool valid = memcmp(m_view, "PLYJ", 4) == 0;
+
+	unsigned int version = 0;
+	unsigned long long size = 0;
+	memcpy(&version, m_view + 4, sizeof(version));
+	memcpy(&size, m_view + 8, sizeof(size));
+	valid = valid && version == VERSION && size == m_size;
+
+	//Use the most recent checkpoint that is intact.
+	bool found = false;
+	for (int i = 0; valid && i < 2; ++i)
+	{
+		Checkpoint cp;
+		memcpy(&cp, m_view + CHECKPOINT_OFFSETS[i], sizeof(cp));
+
+		if (cp.checksum != Checksum(reinterpret_cast<const char *>(&cp), offsetof(Checkpoint, checksum))) continue;
+		if (cp.offset < HEADER_SIZE || cp.offset > m_size) continue;
+		if (found && cp.generation <= m_checkpointGeneration) continue;
+
+		m_flushedOffset = cp.offset;
+		m_flushedSequence = cp.sequence;
+		m_checkpointGeneration = cp.generation;
+		found = true;
+	}
+
+	if (!found)
+	{
+		//New or unreadable segment. Start it again from empty.
+		memset(m_view, 0, static_cast<size_t>(HEADER_SIZE + RECORD_HEADER_SIZE));
+		memcpy(m_view, "PLYJ", 4);
+		memcpy(m_view + 4, &VERSION, sizeof(VERSION));
+		memcpy(m_view + 8, &m_size, sizeof(m_size));
+
+		m_flushedOffset = HEADER_SIZE;
+		m_flushedSequence = 1;
+		m_checkpointGeneration = 0;
+		m_writeOffset = HEADER_SIZE;
+		m_nextSequence = 1;
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		WriteCheckpoint();
+		return;
+	}
+
+	//Every record after the checkpoint that is intact and in sequence still has to be written to the database.
+	m_writeOffset = m_flushedOffset;
+	m_nextSequence = m_flushedSequence;
+
+	unsigned long long next = 0;
+	while (ReadRecord(m_writeOffset, m_nextSequence, nullptr, next))
+	{
+		m_writeOffset = next;
+		m_nextSequence++;
+	}
+}
+
+void PLY::SaveJournal::WriteCheckpoint()
+{
+	Checkpoint cp;
+	cp.offset = m_flushedOffset;
+	cp.sequence = m_flushedSequence;
+	cp.generation = ++m_checkpointGeneration;
+	cp.reserved = 0;
+	cp.checksum = Checksum(reinterpret_cast<const char *>(&cp), offsetof(Checkpoint, checksum));
+
+	//Alternate between the two slots, so the previous checkpoint is still intact if this write is interrupted.
+	memcpy(m_view + CHECKPOINT_OFFSETS[cp.generation % 2], &cp, sizeof(cp));
+}
+
+bool PLY::SaveJournal::ReadRecord(const unsigned long long offset, const unsigned long long expectedSequence, Entry *entry,
+	unsigned long long &next) const
+{
+	if (offset + RECORD_HEADER_SIZE > m_size) return false;
+
+	RecordHeader header;
+	memcpy(&header, m_view + offset, sizeof(header));
+
+	if (memcmp(header.magic, "PLYR", 4) != 0 || header.sequence != expectedSequence) return false;
+	if (offset + RECORD_HEADER_SIZE + header.length > m_size) return false;
+
+	const char *payload = m_view + offset + RECORD_HEADER_SIZE;
+
+	std::string checked(reinterpret_cast<const char *>(&header.sequence), sizeof(header.sequence));
+	checked.append(payload, header.length);
+	if (Checksum(checked.data(), checked.size()) != header.checksum) return false;
+
+	next = offset + Align(RECORD_HEADER_SIZE + header.length);
+
+	if (entry == nullptr) return true;
+
+	const char *p = payload;
+	const char *end = payload + header.length;
+
+	int dataFormat = 0;
+	std::string tableName, IDColumnName, dataColumnName, positionColumnName, updatedAtColumnName;
+
+	bool ok = Get(p, end, dataFormat) && Get(p, end, entry->objectID) &&
+		Get(p, end, entry->x) && Get(p, end, entry->y) && Get(p, end, entry->z) &&
+		GetString(p, end, tableName) && GetString(p, end, IDColumnName) && GetString(p, end, dataColumnName) &&
+		GetString(p, end, positionColumnName) && GetString(p, end, updatedAtColumnName) && GetString(p, end, entry->dataString);
+
+	if (!ok) return false;
+
+	entry->details = PLYObjectSyncSaveLoad::DataBaseDetails(tableName.c_str(), IDColumnName.c_str(), dataColumnName.c_str(),
+		static_cast<PLYObjectSyncSaveLoad::DataFormat>(dataFormat), positionColumnName.c_str(), updatedAtColumnName.c_str());
+	entry->hasPosition = positionColumnName != "";
+
+	return true;
+}
+
+bool PLY::SaveJournal::MapFile(const AZStd::string &path, unsigned long long size)
+{
+	int wideLength = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+	if (wideLength <= 0) return false;
+	std::wstring widePath(static_cast<size_t>(wideLength), L'\0');
+	MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &widePath[0], wideLength);
+
+	HANDLE file = CreateFileW(widePath.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) return false;
+
+	//Existing segments keep their size, so their records stay where they were written.
+	LARGE_INTEGER existingSize;
+	if (GetFileSizeEx(file, &existingSize) && static_cast<unsigned long long>(existingSize.QuadPart) > HEADER_SIZE)
+	{
+		size = static_cast<unsigned long long>(existingSize.QuadPart);
+	}
+
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(size >> 32), static_cast<DWORD>(size & 0xFFFFFFFF), nullptr);
+	if (mapping == nullptr)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	void *view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+	if (view == nullptr)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	m_fileHandle = file;
+	m_mappingHandle = mapping;
+	m_view = static_cast<char *>(view);
+	m_size = size;
+
+	return true;
+}
+
+void PLY::SaveJournal::UnmapFile()
+{
+	FlushViewOfFile(m_view, 0);
+	FlushFileBuffers(static_cast<HANDLE>(m_fileHandle));
+
+	UnmapViewOfFile(m_view);
+	CloseHandle(static_cast<HANDLE>(m_mappingHandle));
+	CloseHandle(static_cast<HANDLE>(m_fileHandle));
+
+	m_view = nullptr;
+	m_mappingHandle = nullptr;
+	m_fileHandle = nullptr;
+	m_size = 0;
+}
+
+unsigned int PLY::SaveJournal::Checksum(const char *data, const size_t length)
+{
+	unsigned int hash = 2166136261u;
+	for (size_t i = 0; i < length; ++i)
+	{
+		hash ^= static_cast<unsigned char>(data[i]);
+		hash *= 16777619u;
+	}
+	return hash;
+}
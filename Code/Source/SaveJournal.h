@@ -0,0 +1,180 @@
+// Write-behind journal for object sync saves. Saves are appended to a memory-mapped segment file, so they survive a crash
+// or the query worker pool shutting down as soon as they are appended, and are acknowledged to the game immediately.
+// A background flusher thread with its own database connection drains the journal to the database in batches, and
+// replays any saves left in the journal when it is next opened.
+//
+// Segment file layout:
+//   Header   Magic "PLYJ", version, segment size, and two checkpoint slots. Each checkpoint holds the offset and sequence
+//            number of the first save not yet written to the database. Slots are written alternately, so a checkpoint torn
+//            by a crash never replaces the last good one.
+//   Records  Appended one after another, each with a checksum and a sequence number one higher than the last. Recovery
+//            stops at the first record that is incomplete or out of sequence, so records left over from before the
+//            segment was last reset are never replayed.
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+
+#include <AzCore/Math/Vector3.h>
+
+#include <PLY/PLYTools.h>
+#include <PLY/PLYTypes.h>
+#include <PLY/PLYObjectSyncSaveLoadBus.h>
+
+class PLYTest_SaveJournalRecovery_Test;
+class PLYTest_SaveJournalDiscardsTornRecord_Test;
+
+namespace PLY
+{
+	class SaveJournal
+	{
+
+	friend PLYTest_SaveJournalRecovery_Test;
+	friend PLYTest_SaveJournalDiscardsTornRecord_Test;
+
+	public:
+
+		SaveJournal();
+		~SaveJournal();
+
+		//Open the segment file, creating it if it doesn't exist, and start the flusher thread. Saves left in the file from a
+		//previous session are replayed to the database by the flusher.
+		//@param fileName The segment file. May use file IO aliases such as @user@.
+		//@param sizeMB Size of a new segment file, in megabytes. Existing files keep their size.
+		//@param flushIntervalMS Time (milliseconds) between flushes to the database.
+		//@param connectionString Database connection string used by the flusher.
+		//@return True if the journal was opened.
+		bool Open(const AZStd::string &fileName, const int sizeMB, const int flushIntervalMS, const AZStd::string &connectionString);
+
+		//Stop the flusher thread and close the segment file. Saves not yet flushed stay in the file, and are replayed when it
+		//is next opened.
+		void Close();
+
+		//Is the journal open?
+		inline bool IsOpen() const { return m_view != nullptr; };
+
+		//Append a save to the journal.
+		//@param details The database configuration details of the object.
+		//@param objectID The object's unique database ID.
+		//@param dataString The data string to save.
+		//@param position The object's world position. Only saved if details has a position column.
+		//@param sequence Set to the save's sequence number.
+		//@return True if the save was appended. False if the journal is full, in which case the save must be sent some other way.
+		bool Append(const PLYObjectSyncSaveLoad::DataBaseDetails &details, const int objectID, const std::string &dataString,
+			const AZ::Vector3 &position, unsigned long long &sequence);
+
+		//Get the sequence number of the first save not yet written to the database. Saves with a lower sequence number are
+		//in the database.
+		inline unsigned long long GetFlushedSequence() const { return m_flushedSequence; };
+
+		//Has the flusher found a corrupt record? The flusher stops at the corrupt record, so it and every save appended after
+		//it will never be written to the database, and no more saves can be appended.
+		inline bool HasFailed() const { return m_failed; };
+
+		//Wake the flusher thread, so pending saves are written without waiting for the flush interval to end.
+		void Notify();
+
+	private:
+
+		//A save read back from the segment.
+		struct Entry
+		{
+			PLYObjectSyncSaveLoad::DataBaseDetails details;
+			int objectID;
+			bool hasPosition;
+			float x, y, z;
+			std::string dataString;
+		};
+
+		//Handle of the segment file.
+		void *m_fileHandle;
+
+		//Handle of the file mapping.
+		void *m_mappingHandle;
+
+		//The mapped segment.
+		char *m_view;
+
+		//Size of the mapped segment, in bytes.
+		unsigned long long m_size;
+
+		//Offset of the next record to append.
+		unsigned long long m_writeOffset;
+
+		//Sequence number of the next record to append.
+		unsigned long long m_nextSequence;
+
+		//Offset of the first record not yet written to the database.
+		unsigned long long m_flushedOffset;
+
+		//Sequence number of the first record not yet written to the database.
+		std::atomic<unsigned long long> m_flushedSequence;
+
+		//Generation of the most recently written checkpoint.
+		unsigned long long m_checkpointGeneration;
+
+		//Protects the offsets, sequence numbers and checkpoints.
+		std::mutex m_mutex;
+
+		//Flusher thread.
+		std::thread m_flusherThread;
+
+		//Wakes the flusher thread.
+		std::condition_variable m_flusherCV;
+
+		//Command the flusher thread to shut down.
+		std::atomic<bool> m_shutdown;
+
+		//Set when the flusher finds a corrupt record.
+		std::atomic<bool> m_failed;
+
+		//Time (milliseconds) between flushes.
+		int m_flushIntervalMS;
+
+		//Database connection string used by the flusher.
+		AZStd::string m_connectionString;
+
+		//Flusher thread loop.
+		void FlusherLoop();
+
+		//Write a range of records to the database. Stops at the first corrupt record, writing only the records before it.
+		//@param c The flusher's database connection.
+		//@param begin Offset of the first record.
+		//@param end Offset one past the last record.
+		//@param stop Set to the offset of the first record not written. This is end, unless a corrupt record was found.
+		//@param count Set to the number of records written.
+		//@return True if the records before stop were handled and can be released. False if the range should be retried.
+		bool FlushRange(std::unique_ptr<pqxx::connection> &c, const unsigned long long begin, const unsigned long long end,
+			unsigned long long &stop, unsigned long long &count);
+
+		//Find the most recent valid checkpoint and the records after it. Called when the segment is opened.
+		void Recover();
+
+		//Write a checkpoint to the inactive checkpoint slot. Must be called with m_mutex locked.
+		void WriteCheckpoint();
+
+		//Read a record from the segment.
+		//@param offset Offset of the record.
+		//@param expectedSequence The sequence number the record must have.
+		//@param entry Set to the record's contents. May be null to only validate the record.
+		//@param next Set to the offset of the following record.
+		//@return True if there is a valid record at the offset.
+		bool ReadRecord(const unsigned long long offset, const unsigned long long expectedSequence, Entry *entry, unsigned long long &next) const;
+
+		//Map the segment file into memory.
+		//@param path Full path of the segment file.
+		//@param size Size of the segment, in bytes.
+		bool MapFile(const AZStd::string &path, unsigned long long size);
+
+		//Unmap and close the segment file.
+		void UnmapFile();
+
+		//FNV-1a checksum.
+		static unsigned int Checksum(const char *data, const size_t length);
+	};
+}
@@ -0,0 +1,33 @@
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#include "ShardedCounter.h"
+
+using namespace PLY;
+
+PLY::ShardedCounter::ShardedCounter()
+{
+	Reset();
+}
+
+PLY::ShardedCounter::~ShardedCounter()
+{
+}
+
+long long PLY::ShardedCounter::Get() const
+{
+	long long total = 0;
+	for (const Shard &s : m_shards) total += s.value.load(std::memory_order_relaxed);
+	return total;
+}
+
+void PLY::ShardedCounter::Reset()
+{
+	for (Shard &s : m_shards) s.value.store(0, std::memory_order_relaxed);
+}
+
+size_t PLY::ShardedCounter::GetShard()
+{
+	static std::atomic<size_t> nextShard(0);
+	thread_local size_t shard = nextShard.fetch_add(1, std::memory_order_relaxed) % SHARD_COUNT;
+	return shard;
+}
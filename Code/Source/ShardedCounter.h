@@ -0,0 +1,49 @@
+// Lock-free counter for statistics updated from many threads. The count is split over several shards, each on its own
+// cache line, and each thread adds to its own shard, so threads never contend for the same cache line. The shards are
+// summed when the count is read, which is much less frequent than adding to it.
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#pragma once
+
+#include <atomic>
+#include <array>
+#include <cstddef>
+
+namespace PLY
+{
+	class ShardedCounter
+	{
+	public:
+
+		ShardedCounter();
+		~ShardedCounter();
+
+		//Add to the count.
+		//@param n The amount to add.
+		inline void Add(long long n = 1) { m_shards[GetShard()].value.fetch_add(n, std::memory_order_relaxed); };
+
+		//Get the count. Amounts added while the count is read may or may not be included.
+		long long Get() const;
+
+		//Set the count to zero.
+		void Reset();
+
+	private:
+
+		//Number of shards. Threads beyond this number share shards, which is still correct, just slower.
+		static const size_t SHARD_COUNT = 32;
+
+		//Size of a cache line on the target platforms.
+		static const size_t CACHE_LINE_SIZE = 64;
+
+		struct alignas(CACHE_LINE_SIZE) Shard
+		{
+			std::atomic<long long> value;
+		};
+
+		std::array<Shard, SHARD_COUNT> m_shards;
+
+		//Get the shard used by the calling thread. Each thread is given the next shard the first time it calls this.
+		static size_t GetShard();
+	};
+}
@@ -0,0 +1,248 @@
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#define NOMINMAX
+#define _AMD64_
+#include <processthreadsapi.h>
+
+#include <fstream>
+#include <algorithm>
+
+#include <AzCore/IO/FileIO.h>
+
+#include "SlowQueryLog.h"
+#include "QueryFingerprint.h"
+#include "QueryTracer.h"
+#include <PLYLog.h>
+
+using namespace PLY;
+
+const int PLY::SlowQueryLog::FINGERPRINT_EXPLAIN_INTERVAL;
+
+PLY::SlowQueryLog::SlowQueryLog()
+	: m_threshold(0),
+	m_dropped(0),
+	m_shutdown(false)
+{
+}
+
+PLY::SlowQueryLog::~SlowQueryLog()
+{
+	Stop();
+}
+
+bool PLY::SlowQueryLog::Start(const SlowQuerySettings &settings, const AZStd::string &connectionString)
+{
+	if (IsRunning()) return true;
+	if (settings.threshold <= 0) return false;
+
+	m_settings = settings;
+	m_connectionString = connectionString;
+
+	//Resolve aliases such as @user@ to a full path.
+	char resolved[1024] = { 0 };
+	AZ::IO::FileIOBase *f = AZ::IO::FileIOBase::GetInstance();
+	m_path = (f != nullptr && f->ResolvePath(m_settings.fileName.c_str(), resolved, sizeof(resolved))) ? resolved : m_settings.fileName.c_str();
+
+	m_shutdown = false;
+	m_loggerThread = std::thread([this] { LoggerLoop(); });
+
+	m_threshold = m_settings.threshold;
+
+	PLYLOG(PLYLog::PLY_INFO, AZStd::string::format("Logging queries slower than %d ms to ", m_settings.threshold) + AZStd::string(m_path.c_str()));
+
+	return true;
+}
+
+void PLY::SlowQueryLog::Stop()
+{
+	if (!IsRunning()) return;
+
+	m_threshold = 0;
+
+	{
+		std::unique_lock<std::mutex> lock(m_pendingMutex);
+		m_shutdown = true;
+	}
+	m_loggerCV.notify_one();
+	m_loggerThread.join();
+}
+
+void PLY::SlowQueryLog::Check(const PLYQuery &query, const PLYResult &result, const unsigned long long workerID)
+{
+	int threshold = m_threshold.load(std::memory_order_relaxed);
+	if (threshold <= 0 || result.errorType == PLYResult::ResultErrorType::SQL_ERROR) return;
+
+	double executionMS = result.queryEndTime.GetMilliseconds() - result.queryStartTime.GetMilliseconds();
+	if (executionMS < threshold) return;
+
+	Entry entry;
+	entry.sql = query.queryString.c_str();
+	entry.binaryParams = query.binaryParams;
+	entry.queryID = query.queryID;
+	entry.workerID = workerID;
+	entry.queueWaitMS = result.queryStartTime.GetMilliseconds() - result.queryCreationTime.GetMilliseconds();
+	entry.executionMS = executionMS;
+	entry.loggedAt = std::time(nullptr);
+
+	{
+		std::unique_lock<std::mutex> lock(m_pendingMutex);
+		if (m_pending.size() >= MAX_PENDING)
+		{
+			m_dropped++;
+			return;
+		}
+		m_pending.push_back(std::move(entry));
+	}
+	m_loggerCV.notify_one();
+}
+
+void PLY::SlowQueryLog::LoggerLoop()
+{
+	TRACER->SetThreadName("Slow Query Log");
+
+	//EXPLAIN ANALYZE runs the query again, so keep it from competing with the game and the query workers.
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+
+	std::unique_ptr<pqxx::connection> c = nullptr;
+
+	while (true)
+	{
+		Entry entry;
+		unsigned long long dropped = 0;
+
+		{
+			std::unique_lock<std::mutex> lock(m_pendingMutex);
+			m_loggerCV.wait(lock, [this] { return m_shutdown || !m_pending.empty(); });
+
+			if (m_pending.empty()) break;
+
+			entry = std::move(m_pending.front());
+			m_pending.pop_front();
+
+			dropped = m_dropped;
+			m_dropped = 0;
+		}
+
+		if (dropped > 0) Append(AZStd::string::format("%llu slow queries were not logged, as too many were waiting.\n\n", dropped).c_str());
+
+		//Slow queries already handed over are still logged on shutdown, but not explained, so shutdown isn't held up.
+		Write(c, entry);
+	}
+}
+
+void PLY::SlowQueryLog::Write(std::unique_ptr<pqxx::connection> &c, const Entry &entry)
+{
+	std::string normalised = QueryFingerprint::Normalise(entry.sql);
+	unsigned long long fingerprint = QueryFingerprint::Hash(normalised);
+
+	char time[32] = { 0 };
+	std::strftime(time, sizeof(time), "%Y-%m-%d %H:%M:%S", std::localtime(&entry.loggedAt));
+
+	std::string text = std::string("==== ") + time + " slow query " + QueryFingerprint::ToHex(fingerprint) + " ====\n";
+	text += AZStd::string::format("query %llu on worker %llu. queue wait %.3f ms. execution %.3f ms.\n", entry.queryID, entry.workerID,
+		entry.queueWaitMS, entry.executionMS).c_str();
+	text += normalised + "\n";
+
+	//Rate limit EXPLAIN runs overall, and for each fingerprint.
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	std::map<unsigned long long, std::chrono::steady_clock::time_point>::iterator last = m_lastExplainByFingerprint.find(fingerprint);
+
+	if (m_settings.explain)
+	{
+		if (m_shutdown)
+		{
+			text += "Not explained: shutting down.\n";
+		}
+		else if (!QueryFingerprint::IsReadOnly(normalised))
+		{
+			text += "Not explained: not a read only statement.\n";
+		}
+		else if (last != m_lastExplainByFingerprint.end() && now - last->second < std::chrono::seconds(FINGERPRINT_EXPLAIN_INTERVAL))
+		{
+			text += "Not explained: explained recently.\n";
+		}
+		else if (m_lastExplain.time_since_epoch().count() != 0 && now - m_lastExplain < std::chrono::milliseconds(m_settings.explainInterval))
+		{
+			text += "Not explained: rate limited.\n";
+		}
+		else
+		{
+			m_lastExplain = now;
+			m_lastExplainByFingerprint[fingerprint] = now;
+			ForgetExplainedFingerprints(now);
+			text += Explain(c, entry);
+		}
+	}
+
+	Append(text + "\n");
+}
+
+void PLY::SlowQueryLog::ForgetExplainedFingerprints(const std::chrono::steady_clock::time_point now)
+{
+	std::map<unsigned long long, std::chrono::steady_clock::time_point>::iterator oldest = m_lastExplainByFingerprint.end();
+
+	for (std::map<unsigned long long, std::chrono::steady_clock::time_point>::iterator it = m_lastExplainByFingerprint.begin();
+		it != m_lastExplainByFingerprint.end();)
+	{
+		if (now - it->second >= std::chrono::seconds(FINGERPRINT_EXPLAIN_INTERVAL))
+		{
+			it = m_lastExplainByFingerprint.erase(it);
+			continue;
+		}
+
+		if (oldest == m_lastExplainByFingerprint.end() || it->second < oldest->second) oldest = it;
+		++it;
+	}
+
+	if (m_lastExplainByFingerprint.size() > MAX_EXPLAINED_FINGERPRINTS) m_lastExplainByFingerprint.erase(oldest);
+}
+
+std::string PLY::SlowQueryLog::Explain(std::unique_ptr<pqxx::connection> &c, const Entry &entry)
+{
+	TraceSpan span("Explain", 0, entry.queryID);
+
+	try
+	{
+		if (c == nullptr) c = std::make_unique<pqxx::connection>(m_connectionString.c_str());
+
+		//A read only transaction that is never committed, in case the statement has side effects after all.
+		pqxx::read_transaction w(*c);
+		w.exec("SET LOCAL statement_timeout = " + std::to_string(EXPLAIN_TIMEOUT));
+
+		std::string explain = "EXPLAIN (ANALYZE, BUFFERS) " + entry.sql;
+		pqxx::result r;
+		if (entry.binaryParams.empty())
+		{
+			r = w.exec(explain);
+		}
+		else
+		{
+			std::vector<pqxx::binarystring> params;
+			params.reserve(entry.binaryParams.size());
+			for (const std::string &p : entry.binaryParams) params.emplace_back(p);
+
+			r = w.exec_params(explain, pqxx::prepare::make_dynamic_params(params));
+		}
+
+		std::string plan;
+		for (const pqxx::row &row : r) plan += std::string(row[0].c_str()) + "\n";
+		return plan;
+	}
+	catch (const pqxx::broken_connection &e)
+	{
+		c = nullptr;
+		return "Not explained: " + std::string(e.what());
+	}
+	catch (const pqxx::pqxx_exception &e)
+	{
+		return "Not explained: " + std::string(e.base().what());
+	}
+}
+
+void PLY::SlowQueryLog::Append(const std::string &text)
+{
+	std::ofstream file(m_path, std::ios::binary | std::ios::app);
+	if (file) file << text;
+
+	if (!file) PLYLOG(PLYLog::PLY_ERROR, "Couldn't write slow query log " + AZStd::string(m_path.c_str()));
+}
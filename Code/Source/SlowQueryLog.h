@@ -0,0 +1,135 @@
+// Slow query log. Query workers hand queries that took longer than a threshold to the log, which appends their fingerprint,
+// timings and worker to a log file from a background thread. Read only statements are also run again with
+// EXPLAIN (ANALYZE, BUFFERS) on the log's own low priority connection, inside a read only transaction that is always rolled
+// back, and their plan is added to the log. EXPLAIN runs are rate limited overall and for each fingerprint, so a query that
+// is slow every time doesn't double the load it puts on the database.
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#pragma once
+
+#include <map>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <vector>
+#include <condition_variable>
+
+#include <PLY/PLYTypes.h>
+
+namespace PLY
+{
+	class SlowQueryLog
+	{
+	public:
+
+		SlowQueryLog();
+		~SlowQueryLog();
+
+		//Start the log. Does nothing if the threshold is 0.
+		//@param settings The slow query log settings.
+		//@param connectionString Database connection string used for EXPLAIN runs.
+		//@return True if the log started.
+		bool Start(const SlowQuerySettings &settings, const AZStd::string &connectionString);
+
+		//Stop the log, writing any slow queries already handed to it, and wait for the logger thread to finish.
+		void Stop();
+
+		//Is the log running?
+		inline bool IsRunning() const { return m_loggerThread.joinable(); };
+
+		//Check whether a query was slow, and hand it to the logger thread if it was. Called by the query worker thread once
+		//the result is ready. Costs a comparison for queries under the threshold.
+		//@param query The query.
+		//@param result The query's result.
+		//@param workerID ID of the worker the query ran on.
+		void Check(const PLYQuery &query, const PLYResult &result, const unsigned long long workerID);
+
+	private:
+
+		//Most slow queries waiting to be logged. Slow queries over the limit are counted, and the count is logged instead.
+		static const size_t MAX_PENDING = 100;
+
+		//Minimum time (seconds) between EXPLAIN runs of queries with the same fingerprint.
+		static const int FINGERPRINT_EXPLAIN_INTERVAL = 600;
+
+		//Most fingerprints whose last EXPLAIN time is kept. Past this, the oldest is forgotten.
+		static const size_t MAX_EXPLAINED_FINGERPRINTS = 1000;
+
+		//Statement timeout (milliseconds) for EXPLAIN runs.
+		static const int EXPLAIN_TIMEOUT = 30000;
+
+		//A slow query waiting to be logged.
+		struct Entry
+		{
+			std::string sql;
+			std::vector<std::string> binaryParams;
+			unsigned long long queryID;
+			unsigned long long workerID;
+			double queueWaitMS;
+			double executionMS;
+			std::time_t loggedAt;
+		};
+
+		//The settings the log was started with.
+		SlowQuerySettings m_settings;
+
+		//Log file name, with aliases resolved.
+		std::string m_path;
+
+		//Database connection string used for EXPLAIN runs.
+		AZStd::string m_connectionString;
+
+		//Execution time (milliseconds) over which a query is logged. Read by the query worker threads.
+		std::atomic<int> m_threshold;
+
+		//Slow queries waiting to be logged.
+		std::deque<Entry> m_pending;
+
+		//Number of slow queries not logged because too many were waiting.
+		unsigned long long m_dropped;
+
+		//Protects the pending slow queries and the dropped count.
+		std::mutex m_pendingMutex;
+
+		//Wakes the logger thread.
+		std::condition_variable m_loggerCV;
+
+		//Logger thread.
+		std::thread m_loggerThread;
+
+		//Command the logger thread to shut down.
+		std::atomic<bool> m_shutdown;
+
+		//Time of the last EXPLAIN run, overall and by fingerprint. Only used by the logger thread. Fingerprints are forgotten
+		//once their interval has passed, as they no longer hold back another EXPLAIN.
+		std::chrono::steady_clock::time_point m_lastExplain;
+		std::map<unsigned long long, std::chrono::steady_clock::time_point> m_lastExplainByFingerprint;
+
+		//Logger thread loop.
+		void LoggerLoop();
+
+		//Write a slow query to the log file, running EXPLAIN on it first if allowed.
+		//@param c The logger's database connection, for EXPLAIN runs.
+		//@param entry The slow query.
+		void Write(std::unique_ptr<pqxx::connection> &c, const Entry &entry);
+
+		//Forget fingerprints explained longer ago than FINGERPRINT_EXPLAIN_INTERVAL, and the oldest one if there are still too many.
+		//@param now The current time.
+		void ForgetExplainedFingerprints(const std::chrono::steady_clock::time_point now);
+
+		//Run a read only statement again with EXPLAIN (ANALYZE, BUFFERS).
+		//@param c The logger's database connection. Opened if null, and reset if the connection is lost.
+		//@param entry The slow query.
+		//@return The plan, or the reason there isn't one.
+		std::string Explain(std::unique_ptr<pqxx::connection> &c, const Entry &entry);
+
+		//Append text to the log file.
+		//@param text The text.
+		void Append(const std::string &text);
+	};
+}
@@ -0,0 +1,184 @@
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#include "StatementStats.h"
+#include "QueryFingerprint.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+using namespace PLY;
+
+PLY::StatementStats::StatementStats()
+	: m_entries(new Entry[TABLE_SIZE]),
+	m_used(0)
+{
+	for (size_t i = 0; i < TABLE_SIZE; ++i)
+	{
+		m_entries[i].fingerprint.store(0, std::memory_order_relaxed);
+		m_entries[i].query.store(nullptr, std::memory_order_relaxed);
+		Clear(m_entries[i]);
+	}
+
+	m_other.fingerprint.store(0, std::memory_order_relaxed);
+	m_other.query.store(new std::string("<other>"), std::memory_order_relaxed);
+	Clear(m_other);
+}
+
+PLY::StatementStats::~StatementStats()
+{
+	for (size_t i = 0; i < TABLE_SIZE; ++i) delete m_entries[i].query.load(std::memory_order_relaxed);
+	delete m_other.query.load(std::memory_order_relaxed);
+}
+
+void PLY::StatementStats::Record(const std::string &sql, const PLYResult &result, unsigned long long totalTime,
+	unsigned long long executionTime, long long bytes)
+{
+	//Fingerprints only depend on the SQL, so each thread remembers the fingerprints of the statements it has seen.
+	thread_local std::unordered_map<std::string, unsigned long long> cache;
+
+	const bool cacheable = sql.size() <= MAX_CACHED_LENGTH;
+	std::unordered_map<std::string, unsigned long long>::const_iterator cached = cacheable ? cache.find(sql) : cache.end();
+
+	std::string normalised;
+	unsigned long long id = 0;
+
+	if (cached != cache.end())
+	{
+		id = cached->second;
+	}
+	else
+	{
+		normalised = QueryFingerprint::Normalise(sql);
+		id = QueryFingerprint::Hash(normalised);
+
+		//Fingerprint 0 is the overflow entry, and marks free entries, so keep real fingerprints away from it.
+		if (id == 0) id = 1;
+
+		if (cacheable)
+		{
+			if (cache.size() >= MAX_CACHED_STATEMENTS) cache.clear();
+			cache.emplace(sql, id);
+		}
+	}
+
+	bool claimed = false;
+	Entry *e = Find(id, claimed);
+
+	if (claimed)
+	{
+		if (normalised.empty()) normalised = QueryFingerprint::Normalise(sql);
+		e->query.store(new std::string(normalised.substr(0, MAX_QUERY_LENGTH)), std::memory_order_release);
+	}
+
+	Add(e != nullptr ? *e : m_other, result, totalTime, executionTime, bytes);
+}
+
+PLY::StatementStats::Entry *PLY::StatementStats::Find(unsigned long long id, bool &claimed)
+{
+	claimed = false;
+
+	size_t index = static_cast<size_t>(id) & (TABLE_SIZE - 1);
+	for (size_t probe = 0; probe < TABLE_SIZE; ++probe, index = (index + 1) & (TABLE_SIZE - 1))
+	{
+		Entry &e = m_entries[index];
+
+		unsigned long long current = e.fingerprint.load(std::memory_order_acquire);
+		if (current == id) return &e;
+		if (current != 0) continue;
+
+		//Entries are never freed, so reaching a free entry means the fingerprint is new.
+		if (m_used.load(std::memory_order_relaxed) >= MAX_FINGERPRINTS) return nullptr;
+
+		if (e.fingerprint.compare_exchange_strong(current, id, std::memory_order_acq_rel))
+		{
+			m_used.fetch_add(1, std::memory_order_relaxed);
+			claimed = true;
+			return &e;
+		}
+
+		//Another thread claimed the entry first, possibly for the same fingerprint.
+		if (current == id) return &e;
+	}
+
+	return nullptr;
+}
+
+void PLY::StatementStats::Add(Entry &e, const PLYResult &result, unsigned long long totalTime, unsigned long long executionTime,
+	long long bytes)
+{
+	e.calls.fetch_add(1, std::memory_order_relaxed);
+	if (result.errorType == PLYResult::ResultErrorType::SQL_ERROR)
+	{
+		e.errors.fetch_add(1, std::memory_order_relaxed);
+	}
+	else
+	{
+		e.rows.fetch_add(static_cast<long long>(result.resultSet.size()), std::memory_order_relaxed);
+		e.bytes.fetch_add(bytes, std::memory_order_relaxed);
+	}
+	e.totalTime.fetch_add(totalTime, std::memory_order_relaxed);
+	e.executionTime.fetch_add(executionTime, std::memory_order_relaxed);
+
+	unsigned long long current = e.maxTime.load(std::memory_order_relaxed);
+	while (totalTime > current && !e.maxTime.compare_exchange_weak(current, totalTime, std::memory_order_relaxed)) {}
+}
+
+void PLY::StatementStats::Read(const Entry &e, PLYStatementStats &s)
+{
+	s.fingerprint = e.fingerprint.load(std::memory_order_acquire);
+	const std::string *query = e.query.load(std::memory_order_acquire);
+	s.query = query != nullptr ? query->c_str() : "";
+	s.calls = e.calls.load(std::memory_order_relaxed);
+	s.errors = e.errors.load(std::memory_order_relaxed);
+	s.rows = e.rows.load(std::memory_order_relaxed);
+	s.bytes = e.bytes.load(std::memory_order_relaxed);
+	s.totalTime = e.totalTime.load(std::memory_order_relaxed);
+	s.executionTime = e.executionTime.load(std::memory_order_relaxed);
+	s.maxTime = e.maxTime.load(std::memory_order_relaxed);
+}
+
+void PLY::StatementStats::Clear(Entry &e)
+{
+	e.calls.store(0, std::memory_order_relaxed);
+	e.errors.store(0, std::memory_order_relaxed);
+	e.rows.store(0, std::memory_order_relaxed);
+	e.bytes.store(0, std::memory_order_relaxed);
+	e.totalTime.store(0, std::memory_order_relaxed);
+	e.executionTime.store(0, std::memory_order_relaxed);
+	e.maxTime.store(0, std::memory_order_relaxed);
+}
+
+std::vector<PLYStatementStats> PLY::StatementStats::GetSnapshot(size_t limit) const
+{
+	std::vector<PLYStatementStats> out;
+
+	PLYStatementStats s;
+	for (size_t i = 0; i < TABLE_SIZE; ++i)
+	{
+		const Entry &e = m_entries[i];
+
+		//Skip free entries, and fingerprints with nothing recorded since the last reset.
+		if (e.fingerprint.load(std::memory_order_acquire) == 0 || e.calls.load(std::memory_order_relaxed) == 0) continue;
+
+		Read(e, s);
+		out.push_back(s);
+	}
+
+	if (m_other.calls.load(std::memory_order_relaxed) > 0)
+	{
+		Read(m_other, s);
+		out.push_back(s);
+	}
+
+	std::sort(out.begin(), out.end(), [](const PLYStatementStats &a, const PLYStatementStats &b) { return a.totalTime > b.totalTime; });
+
+	if (limit > 0 && out.size() > limit) out.resize(limit);
+
+	return out;
+}
+
+void PLY::StatementStats::Reset()
+{
+	for (size_t i = 0; i < TABLE_SIZE; ++i) Clear(m_entries[i]);
+	Clear(m_other);
+}
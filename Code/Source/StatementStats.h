@@ -0,0 +1,100 @@
+// Per statement statistics, like pg_stat_statements but measured by the client. Queries are grouped by their fingerprint
+// (see QueryFingerprint), and calls, errors, rows, bytes and times are added up for each group. Groups are kept in a fixed
+// size open addressing table of atomic counters, so recording never takes a lock, and snapshots read by the console or the
+// metrics exporter never hold up the query worker threads. Each thread caches the fingerprints of statements it has
+// recorded recently, so a statement that is sent over and over is only normalised once.
+// @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <string>
+
+#include <PLY/PLYTypes.h>
+
+namespace PLY
+{
+	class StatementStats
+	{
+	public:
+
+		StatementStats();
+		~StatementStats();
+
+		//Record a query. Safe to call from any thread.
+		//@param sql The query's SQL statement.
+		//@param result The query's result.
+		//@param totalTime Time from the query being sent to its result being ready, in microseconds.
+		//@param executionTime Time spent executing the query, in microseconds.
+		//@param bytes Size of all fields in the result set.
+		void Record(const std::string &sql, const PLYResult &result, unsigned long long totalTime,
+			unsigned long long executionTime, long long bytes);
+
+		//Get statistics for every fingerprint, sorted by total time, highest first. Queries recorded while the snapshot is
+		//taken may be partly included.
+		//@param limit The most fingerprints to return. 0 = all.
+		std::vector<PLYStatementStats> GetSnapshot(size_t limit = 0) const;
+
+		//Set all recorded statistics to zero. Fingerprints keep their place in the table, so the fingerprint limit counts
+		//every fingerprint seen since PLY started.
+		void Reset();
+
+	private:
+
+		//Most fingerprints tracked. Statements with new fingerprints after this are added up under fingerprint 0, so
+		//statements built with literals that don't normalise away can't grow memory use without limit.
+		static const size_t MAX_FINGERPRINTS = 5000;
+
+		//Longest statement text kept for each fingerprint.
+		static const size_t MAX_QUERY_LENGTH = 1024;
+
+		//Number of entries in the fingerprint table. A power of two, well above MAX_FINGERPRINTS, so probes stay short.
+		static const size_t TABLE_SIZE = 8192;
+
+		//Longest statement whose fingerprint is cached. Long statements, such as batched saves, rarely repeat exactly.
+		static const size_t MAX_CACHED_LENGTH = 4096;
+
+		//Most statements in each thread's fingerprint cache. The cache is emptied when it fills.
+		static const size_t MAX_CACHED_STATEMENTS = 256;
+
+		struct Entry
+		{
+			//0 while the entry is free. Set once, when a thread claims the entry for a new fingerprint.
+			std::atomic<unsigned long long> fingerprint;
+			//Normalised statement text. Null until the thread that claimed the entry has set it.
+			std::atomic<const std::string *> query;
+			std::atomic<long long> calls;
+			std::atomic<long long> errors;
+			std::atomic<long long> rows;
+			std::atomic<long long> bytes;
+			std::atomic<unsigned long long> totalTime;
+			std::atomic<unsigned long long> executionTime;
+			std::atomic<unsigned long long> maxTime;
+		};
+
+		std::unique_ptr<Entry[]> m_entries;
+
+		//Statements that arrived after the fingerprint limit was reached.
+		Entry m_other;
+
+		//Number of claimed entries.
+		std::atomic<size_t> m_used;
+
+		//Find a fingerprint's entry, claiming a free one if the fingerprint is new.
+		//@param id The fingerprint ID.
+		//@param claimed Set to true if the entry was claimed, in which case the caller must set its query text.
+		//@return The entry, or null if the fingerprint is new and the limit has been reached.
+		Entry *Find(unsigned long long id, bool &claimed);
+
+		//Add a query to an entry's statistics.
+		static void Add(Entry &e, const PLYResult &result, unsigned long long totalTime, unsigned long long executionTime, long long bytes);
+
+		//Copy an entry's statistics.
+		static void Read(const Entry &e, PLYStatementStats &s);
+
+		//Set an entry's statistics to zero.
+		static void Clear(Entry &e);
+	};
+}
@@ -1,31 +1,35 @@
 // @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
 
 #include "StatsCollector.h"
+#include "QueryFingerprint.h"
+#ifdef PLY_LOCK_PROFILING
+#include "LockProfiler.h"
+#endif
 #include <string>
+#include <cmath>
 
 using namespace PLY;
 
 void PLY::StatsCollector::ResetStats()
 {
-	m_querySentCount = 0;
-	m_resultsReceivedCount = 0;
+	for (size_t i = 0; i < COUNTER_COUNT; ++i) m_lastCounts[i] = m_counters[i].Get();
 
-	int m_busyWorkersStatTEMP = m_busyWorkersStat;
-	m_maxBusyWorkersStat = m_busyWorkersStatTEMP;
+	m_maxBusyWorkersStat.store(m_busyWorkers.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	m_maxQueueDepth.store(m_queueDepth.load(std::memory_order_relaxed), std::memory_order_relaxed);
 }
 
 StatsCollector::StatsCollector()
 	: m_interval(5), //Default stats display interval.
 	m_timer(0),
 	m_showStats(false),
-	m_querySentCount(0),
-	m_resultsReceivedCount(0),
+	m_busyWorkers(0),
 	m_maxBusyWorkersOverallStat(0),
-	m_busyWorkersOverallStat(0),
 	m_maxBusyWorkersStat(0),
-	m_busyWorkersStat(0)
+	m_queueDepth(0),
+	m_maxQueueDepthOverall(0),
+	m_maxQueueDepth(0)
 {
-	
+	m_lastCounts.fill(0);
 }
 
 StatsCollector::~StatsCollector()
@@ -39,26 +43,197 @@ StatsCollector *StatsCollector::getInstance()
 	return &instance;
 }
 
-void PLY::StatsCollector::AdjustBusyWorkersOverallStat(int change)
+void PLY::StatsCollector::UpdateMax(std::atomic<long long> &max, long long value)
 {
-	m_busyWorkersOverallStat += change;
-	m_busyWorkersStat += change;
+	long long current = max.load(std::memory_order_relaxed);
+	while (value > current && !max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+}
 
-	//Temp copy as atomic can't be directly copied to another atomic.
-	int m_busyWorkersOverallStatTEMP = m_busyWorkersOverallStat;
-	if (m_maxBusyWorkersOverallStat < m_busyWorkersOverallStat) m_maxBusyWorkersOverallStat = m_busyWorkersOverallStatTEMP;
+void PLY::StatsCollector::AdjustBusyWorkersOverallStat(int change)
+{
+	//Use the value this change produced, not a fresh read, which another thread may already have changed again.
+	long long busy = m_busyWorkers.fetch_add(change, std::memory_order_relaxed) + change;
 
-	int m_busyWorkersStatTEMP = m_busyWorkersStat;
-	if (m_maxBusyWorkersStat < m_busyWorkersStat) m_maxBusyWorkersStat = m_busyWorkersStatTEMP;
+	UpdateMax(m_maxBusyWorkersOverallStat, busy);
+	UpdateMax(m_maxBusyWorkersStat, busy);
 }
 
 void PLY::StatsCollector::ResetBusyWorkersOverallStat()
 {
-	m_maxBusyWorkersOverallStat = 0;
-	m_busyWorkersOverallStat = 0;
+	m_maxBusyWorkersOverallStat.store(m_busyWorkers.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+void PLY::StatsCollector::SetQueueDepth(long long depth)
+{
+	m_queueDepth.store(depth, std::memory_order_relaxed);
+
+	UpdateMax(m_maxQueueDepthOverall, depth);
+	UpdateMax(m_maxQueueDepth, depth);
+}
+
+PLYQueryCounters PLY::StatsCollector::GetQueryCounters() const
+{
+	PLYQueryCounters c;
+	c.queriesSent = GetCount(QUERIES_SENT);
+	c.resultsReceived = GetCount(RESULTS_RECEIVED);
+	c.queueDepth = m_queueDepth.load(std::memory_order_relaxed);
+	c.maxQueueDepth = m_maxQueueDepthOverall.load(std::memory_order_relaxed);
+	c.busyWorkers = m_busyWorkers.load(std::memory_order_relaxed);
+	c.maxBusyWorkers = m_maxBusyWorkersOverallStat.load(std::memory_order_relaxed);
+	c.connectionsOpened = GetCount(CONNECTIONS_OPENED);
+	c.openConnections = c.connectionsOpened - GetCount(CONNECTIONS_CLOSED);
+	c.connectionFailures = GetCount(CONNECTION_FAILURES);
+	c.reconnects = GetCount(RECONNECTS);
+	c.sqlErrors = GetCount(SQL_ERRORS);
+	c.processorErrors = GetCount(PROCESSOR_ERRORS);
+	c.queryTTLExpiries = GetCount(QUERY_TTL_EXPIRIES);
+	c.resultTTLExpiries = GetCount(RESULT_TTL_EXPIRIES);
+	c.bytesReceived = GetCount(BYTES_RECEIVED);
+	return c;
+}
+
+void PLY::StatsCollector::PrintQueryCounters() const
+{
+	PLYQueryCounters c = GetQueryCounters();
+
+	AZ_Printf("PLY", "PLY COUNTERS: %lld queries sent. %lld results received. %lld bytes received.",
+		c.queriesSent, c.resultsReceived, c.bytesReceived);
+	AZ_Printf("PLY", "PLY COUNTERS: %lld queued (max %lld). %lld busy workers (max %lld).",
+		c.queueDepth, c.maxQueueDepth, c.busyWorkers, c.maxBusyWorkers);
+	AZ_Printf("PLY", "PLY COUNTERS: %lld connections open. %lld opened. %lld failed. %lld reconnects.",
+		c.openConnections, c.connectionsOpened, c.connectionFailures, c.reconnects);
+	AZ_Printf("PLY", "PLY COUNTERS: %lld SQL errors. %lld processor errors. %lld query TTL expiries. %lld result TTL expiries.",
+		c.sqlErrors, c.processorErrors, c.queryTTLExpiries, c.resultTTLExpiries);
+}
+
+void PLY::StatsCollector::RecordExecution(const PLYResult &result)
+{
+	m_queueWaitLatency.Record(GetMicroseconds(result.queryCreationTime, result.queryStartTime));
+	m_executionLatency.Record(GetMicroseconds(result.queryStartTime, result.queryEndTime));
+}
+
+void PLY::StatsCollector::RecordAdvertise(const PLYResult &result)
+{
+	AZ::ScriptTimePoint now = AZ::ScriptTimePoint(AZStd::chrono::system_clock::now());
+
+	m_publishLatency.Record(GetMicroseconds(result.queryEndTime, now));
+	m_totalLatency.Record(GetMicroseconds(result.queryCreationTime, now));
+}
+
+PLYLatencyStats PLY::StatsCollector::GetLatencyStats() const
+{
+	PLYLatencyStats stats;
+	stats.queueWait = m_queueWaitLatency.GetSnapshot();
+	stats.execution = m_executionLatency.GetSnapshot();
+	stats.publish = m_publishLatency.GetSnapshot();
+	stats.total = m_totalLatency.GetSnapshot();
+	return stats;
+}
+
+void PLY::StatsCollector::ResetLatencyStats()
+{
+	m_queueWaitLatency.Reset();
+	m_executionLatency.Reset();
+	m_publishLatency.Reset();
+	m_totalLatency.Reset();
+}
+
+void PLY::StatsCollector::PrintLatencyStats() const
+{
+	PLYLatencyStats stats = GetLatencyStats();
+
+	const std::pair<const char *, const PLYLatencyPhaseStats *> phases[4] = {
+		{ "queue wait", &stats.queueWait },
+		{ "execution ", &stats.execution },
+		{ "publish   ", &stats.publish },
+		{ "total     ", &stats.total }
+	};
+
+	AZ_Printf("PLY", "%s", "PLY LATENCY (ms): phase      count      mean       p50       p90       p99      p999       max");
+
+	for (const std::pair<const char *, const PLYLatencyPhaseStats *> &p : phases)
+	{
+		const PLYLatencyPhaseStats &s = *p.second;
+
+		//Convert microseconds to milliseconds.
+		AZ_Printf("PLY", "PLY LATENCY (ms): %s %9llu %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f", p.first, s.count, s.mean / 1000.0,
+			s.p50 / 1000.0, s.p90 / 1000.0, s.p99 / 1000.0, s.p999 / 1000.0, s.max / 1000.0);
+	}
+}
+
+void PLY::StatsCollector::RecordStatement(const PLYQuery &query, const PLYResult &result, long long bytes)
+{
+	m_statementStats.Record(query.queryString.c_str(), result, GetMicroseconds(result.queryCreationTime, result.queryEndTime),
+		GetMicroseconds(result.queryStartTime, result.queryEndTime), bytes);
+}
+
+void PLY::StatsCollector::PrintStatementStats(size_t limit) const
+{
+	std::vector<PLYStatementStats> stats = GetStatementStats(limit);
+
+	if (stats.empty())
+	{
+		AZ_Printf("PLY", "%s", "PLY STATEMENTS: No statements recorded.");
+		return;
+	}
+
+	AZ_Printf("PLY", "%s", "PLY STATEMENTS (ms): fingerprint          calls   errors      total       mean        max       rows      bytes  query");
+
+	for (const PLYStatementStats &s : stats)
+	{
+		//Long statements are cut short to keep to one line. The full text is available from GetStatementStats.
+		AZStd::string query = s.query;
+		if (query.size() > 80) query = query.substr(0, 77) + "...";
+
+		//Convert microseconds to milliseconds.
+		AZ_Printf("PLY", "PLY STATEMENTS (ms): %s %8lld %8lld %10.1f %10.3f %10.3f %10lld %10lld  %s",
+			QueryFingerprint::ToHex(s.fingerprint).c_str(), s.calls, s.errors, s.totalTime / 1000.0, s.GetMeanTime() / 1000.0,
+			s.maxTime / 1000.0, s.rows, s.bytes, query.c_str());
+	}
+}
+
+std::vector<PLYLockStats> PLY::StatsCollector::GetLockStats() const
+{
+#ifdef PLY_LOCK_PROFILING
+	return LOCKPROFILER->GetSnapshot();
+#else
+	return std::vector<PLYLockStats>();
+#endif
 }
 
-void PLY::StatsCollector::OnTick(float deltaTime, AZ::ScriptTimePoint time)
+void PLY::StatsCollector::ResetLockStats()
+{
+#ifdef PLY_LOCK_PROFILING
+	LOCKPROFILER->Reset();
+#endif
+}
+
+void PLY::StatsCollector::PrintLockStats() const
+{
+#ifdef PLY_LOCK_PROFILING
+	std::vector<PLYLockStats> stats = GetLockStats();
+
+	AZ_Printf("PLY", "%s", "PLY LOCKS (us): lock             acquired  contended   wait p50   wait p99   wait max   hold p50   hold p99   hold max");
+
+	for (const PLYLockStats &s : stats)
+	{
+		//Convert nanoseconds to microseconds.
+		AZ_Printf("PLY", "PLY LOCKS (us): %-16s %9lld %10lld %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f", s.name.c_str(),
+			s.acquisitions, s.contended, s.wait.p50 / 1000.0, s.wait.p99 / 1000.0, s.wait.max / 1000.0,
+			s.hold.p50 / 1000.0, s.hold.p99 / 1000.0, s.hold.max / 1000.0);
+	}
+#else
+	AZ_Printf("PLY", "%s", "PLY LOCKS: Lock profiling is disabled. Build the gem with PLY_LOCK_PROFILING defined to enable it.");
+#endif
+}
+
+unsigned long long PLY::StatsCollector::GetMicroseconds(const AZ::ScriptTimePoint &from, const AZ::ScriptTimePoint &to)
+{
+	double seconds = to.GetSeconds() - from.GetSeconds();
+	return seconds > 0 ? static_cast<unsigned long long>(std::llround(seconds * 1000000.0)) : 0;
+}
+
+void PLY::StatsCollector::OnTick(float deltaTime, AZ::ScriptTimePoint)
 {
 	if (m_showStats)
 	{
@@ -66,12 +241,23 @@ void PLY::StatsCollector::OnTick(float deltaTime, AZ::ScriptTimePoint time)
 		if (m_timer >= m_interval)
 		{
 
-			float qSentPerSec = m_querySentCount > 0 ? (float)m_querySentCount / m_timer : 0;
-			float qResultsPerSec = m_resultsReceivedCount > 0 ? (float)m_resultsReceivedCount / m_timer : 0;
+			long long querySentCount = GetCount(QUERIES_SENT) - m_lastCounts[QUERIES_SENT];
+			long long resultsReceivedCount = GetCount(RESULTS_RECEIVED) - m_lastCounts[RESULTS_RECEIVED];
+			long long errorCount = GetCount(SQL_ERRORS) - m_lastCounts[SQL_ERRORS]
+				+ GetCount(PROCESSOR_ERRORS) - m_lastCounts[PROCESSOR_ERRORS]
+				+ GetCount(QUERY_TTL_EXPIRIES) - m_lastCounts[QUERY_TTL_EXPIRIES];
+			long long bytesReceivedCount = GetCount(BYTES_RECEIVED) - m_lastCounts[BYTES_RECEIVED];
+
+			float qSentPerSec = querySentCount > 0 ? (float)querySentCount / m_timer : 0;
+			float qResultsPerSec = resultsReceivedCount > 0 ? (float)resultsReceivedCount / m_timer : 0;
+			float kbReceivedPerSec = bytesReceivedCount > 0 ? (float)bytesReceivedCount / 1024.0f / m_timer : 0;
 
 			std::string outstr = "PLY STATS: " + std::to_string(qSentPerSec) + " queries sent/sec. "
 				+ std::to_string(qResultsPerSec) + " results received/sec. "
-				+ std::to_string(m_maxBusyWorkersStat) + " max busy workers.";
+				+ std::to_string(kbReceivedPerSec) + " KB received/sec. "
+				+ std::to_string(errorCount) + " failed queries. "
+				+ std::to_string(m_maxQueueDepth.load(std::memory_order_relaxed)) + " max queued. "
+				+ std::to_string(m_maxBusyWorkersStat.load(std::memory_order_relaxed)) + " max busy workers.";
 
 			AZ_Printf("PLY", "%s", outstr.c_str());
 
@@ -1,14 +1,22 @@
 // Statistics collector for the PLY Gem. Designed to be used as a singleton via the provided macro.
-// Collects statistics about the query worker threads, and the queries they are processing.
+// Collects statistics about the query worker threads, and the queries they are processing. Counters are always collected,
+// from any thread, without locks. Each is sharded per thread and summed when read, so counting costs next to nothing.
 // @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
 
 #pragma once
 
 #include <atomic>
+#include <array>
 
 #include <AzCore/Debug/Trace.h>
 #include <AzCore/Component/TickBus.h>
 
+#include <PLY/PLYTypes.h>
+
+#include "LatencyHistogram.h"
+#include "ShardedCounter.h"
+#include "StatementStats.h"
+
 #define STATS PLY::StatsCollector::getInstance()
 
 namespace PLY
@@ -21,7 +29,8 @@ namespace PLY
 		static StatsCollector *getInstance();
 
 		//Start interval display of query stats in the game console.
-		inline void Start() { m_showStats = true; };
+		//The first interval counts from now.
+		inline void Start() { if (!m_showStats) { m_timer = 0; ResetStats(); } m_showStats = true; };
 
 		//Stop interval display of query stats in the game console.
 		inline void Stop() { m_showStats = false; };
@@ -29,25 +38,98 @@ namespace PLY
 		//Set the time interval between display of query stats in the game console.
 		inline void SetInterval(int i) { AZ_Error("PLY", i > 0, "Stats interval must be greater than 0."); m_interval = i; };
 
+		//Counters kept by the collector.
+		enum Counter
+		{
+			QUERIES_SENT, RESULTS_RECEIVED, CONNECTIONS_OPENED, CONNECTIONS_CLOSED, CONNECTION_FAILURES, RECONNECTS,
+			SQL_ERRORS, PROCESSOR_ERRORS, QUERY_TTL_EXPIRIES, RESULT_TTL_EXPIRIES, BYTES_RECEIVED, COUNTER_COUNT
+		};
+
+		//Add to a counter. Safe to call from any thread.
+		//@param counter The counter.
+		//@param n The amount to add.
+		inline void Count(Counter counter, long long n = 1) { m_counters[counter].Add(n); };
+
+		//Get the total of a counter since program start.
+		//@param counter The counter.
+		inline long long GetCount(Counter counter) const { return m_counters[counter].Get(); };
+
 		//Increment the query counter.
-		inline void CountQuery() { if (m_showStats) m_querySentCount++; };
+		inline void CountQuery() { Count(QUERIES_SENT); };
 
 		//Increment the results counter.
-		inline void CountResult() { if (m_showStats) m_resultsReceivedCount++; };
+		inline void CountResult() { Count(RESULTS_RECEIVED); };
+
+		//Set the number of queries in the query queue. Called by the work manager thread.
+		//@param depth The number of queries in the queue.
+		void SetQueueDepth(long long depth);
 
 		//Tick handler.
 		void OnTick(float deltaTime, AZ::ScriptTimePoint time);
 
 		//Get the maxiumum number of busy worker threads reached during program execution.
-		inline int GetMaxBusyThreadsOverall() const { return m_maxBusyWorkersOverallStat; };
+		inline int GetMaxBusyThreadsOverall() const { return static_cast<int>(m_maxBusyWorkersOverallStat.load(std::memory_order_relaxed)); };
 
 		//Adjust the busy worker threads statistic by a set amount.
 		//@param change The amount to change the busy worker threads stat by.
 		void AdjustBusyWorkersOverallStat(int change);
 
-		//Reset the busy worker threads stat to zero.
+		//Reset the maximum busy worker threads stat to the number of workers busy now.
 		void ResetBusyWorkersOverallStat();
 
+		//Get a snapshot of all counters.
+		PLYQueryCounters GetQueryCounters() const;
+
+		//Print all counters to the game console.
+		void PrintQueryCounters() const;
+
+		//Record the queue wait and execution times of a query. Called by the worker thread once the result is ready.
+		//@param result The query's result.
+		void RecordExecution(const PLYResult &result);
+
+		//Record the publish and total times of a query. Called by the main thread as the result is advertised.
+		//@param result The query's result.
+		void RecordAdvertise(const PLYResult &result);
+
+		//Get a snapshot of the query latency statistics.
+		PLYLatencyStats GetLatencyStats() const;
+
+		//Reset the query latency statistics.
+		void ResetLatencyStats();
+
+		//Print the query latency statistics to the game console.
+		void PrintLatencyStats() const;
+
+		//Add a query to the statistics for its fingerprint. Called by the worker thread once the result is ready.
+		//@param query The query.
+		//@param result The query's result.
+		//@param bytes Size of all fields in the result set.
+		void RecordStatement(const PLYQuery &query, const PLYResult &result, long long bytes);
+
+		//Get per statement statistics, sorted by total time, highest first.
+		//@param limit The most statements to return. 0 = all.
+		inline std::vector<PLYStatementStats> GetStatementStats(size_t limit = 0) const { return m_statementStats.GetSnapshot(limit); };
+
+		//Reset per statement statistics.
+		inline void ResetStatementStats() { m_statementStats.Reset(); };
+
+		//Print the statements with the highest total time to the game console.
+		//@param limit The most statements to print.
+		void PrintStatementStats(size_t limit) const;
+
+		//Get statistics for each of PLY's internal locks. Empty unless the gem is built with PLY_LOCK_PROFILING defined.
+		std::vector<PLYLockStats> GetLockStats() const;
+
+		//Reset lock statistics.
+		void ResetLockStats();
+
+		//Print lock statistics to the game console.
+		void PrintLockStats() const;
+
+		//Get the time between two time points in whole microseconds. Negative times, from the system clock being changed,
+		//count as zero.
+		static unsigned long long GetMicroseconds(const AZ::ScriptTimePoint &from, const AZ::ScriptTimePoint &to);
+
 	private:
 
 		//Interval between display of statistics in the console (in seconds).
@@ -59,31 +141,52 @@ namespace PLY
 		//Should stats be printed to the console each time interval?
 		bool m_showStats;
 
-		//Number of queries sent since the last interval start.
-		int m_querySentCount;
+		//Counter totals when stats were last printed to the console. Only used by the main thread.
+		std::array<long long, COUNTER_COUNT> m_lastCounts;
+
+		//Counters, indexed by Counter.
+		std::array<ShardedCounter, COUNTER_COUNT> m_counters;
 
-		//Number of results received since the last interval start.
-		int m_resultsReceivedCount;
-		
 		////
-		//The following properties use ATOMIC to make adjusting and reading these stats thread-safe.
+		//The following gauges are single values that go up and down, so they are plain atomics rather than sharded counters.
+		//Maximums are raised with compare and swap, so a lower value can never overwrite a higher one.
 		////
 
-		//Statistic for max number of workers that were working on queries simultaneously, since program start.
-		std::atomic<int> m_maxBusyWorkersOverallStat;
+		//Number of workers currently working on queries.
+		std::atomic<long long> m_busyWorkers;
+
+		//Max number of workers that were working on queries simultaneously, since program start.
+		std::atomic<long long> m_maxBusyWorkersOverallStat;
+
+		//Max number of workers that were working on queries simultaneously, since last interval start.
+		std::atomic<long long> m_maxBusyWorkersStat;
 
-		//Current number of workers that were working on queries simultaneously, since program start.
-		std::atomic<int> m_busyWorkersOverallStat;
+		//Number of queries in the query queue.
+		std::atomic<long long> m_queueDepth;
 
-		//Statistic for max number of workers that were working on queries simultaneously, since last interval start.
-		std::atomic<int> m_maxBusyWorkersStat;
+		//Max number of queries in the query queue, since program start.
+		std::atomic<long long> m_maxQueueDepthOverall;
 
-		//Current number of workers that were working on queries simultaneously, since last interval start.
-		std::atomic<int> m_busyWorkersStat;
+		//Max number of queries in the query queue, since last interval start.
+		std::atomic<long long> m_maxQueueDepth;
 
-		//Reset all interval statistics to zero.
+		//Query latency for each phase of query processing. Recorded from any thread, whether or not stats are being displayed.
+		LatencyHistogram m_queueWaitLatency;
+		LatencyHistogram m_executionLatency;
+		LatencyHistogram m_publishLatency;
+		LatencyHistogram m_totalLatency;
+
+		//Statistics for each query fingerprint. Recorded from any thread, whether or not stats are being displayed.
+		StatementStats m_statementStats;
+
+		//Start a new interval for the interval statistics.
 		void ResetStats();
 
+		//Raise a maximum to a value, if the value is higher.
+		//@param max The maximum.
+		//@param value The value.
+		static void UpdateMax(std::atomic<long long> &max, long long value);
+
 		StatsCollector();
 		~StatsCollector();
 	};
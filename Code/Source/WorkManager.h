@@ -10,16 +10,20 @@
 #include <PLY/PLYTools.h>
 #include <PLY/PLYTypes.h>
 
+class PLYMicroBench;
+
 namespace PLY
 {
 	//Forward declarations.
-	class PLYSystemComponent;
+	class QueryEngine;
 
 	class WorkManager
 	{
 
+	friend PLYMicroBench;
+
 	public:
-		WorkManager(PLY::PLYSystemComponent *psc);
+		WorkManager(PLY::QueryEngine *engine);
 		~WorkManager();
 
 		bool IsDead() const;
@@ -27,19 +31,32 @@ namespace PLY
 
 	private:
 
+		//Pointer to the query engine that owns the connections and queues.
+		PLY::QueryEngine *m_engine;
+
 		//Command the thread to shut down.
 		std::atomic<bool> m_shutdownThread;
 
 		//Was there an unrecoverable error with the thread?
 		std::atomic<bool> m_workManagerError;
 
-		//Pointer to PLYSystemComponent that owns the connections and queues.
-		PLY::PLYSystemComponent *m_psc;
-
 		//Main thread.
 		std::thread m_workManagerThread;
 
 		//Main thread function.
 		void WorkManagerLoop();
+
+		//Convert queries that have been on the query queue longer than their TTL to results with a timeout error.
+		void ExpireQueries();
+
+		//Remove results that have been on the results queue longer than their TTL.
+		void ExpireResults();
+
+		//Remove dead and shut down workers, and free up the queries they were running to be given to other workers.
+		void RemoveDeadWorkers();
+
+		//Give waiting queries to idle workers, starting new workers up to the maximum pool size, and remove finished
+		//queries from the query queue.
+		void AssignQueries();
 	};
 }
\ No newline at end of file
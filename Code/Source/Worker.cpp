@@ -5,22 +5,26 @@
 #include <processthreadsapi.h>
 
 #include "Worker.h"
-#include <PLYSystemComponent.h>
+#include <DatabaseConnection.h>
+#include <QueryEngine.h>
 #include <StatsCollector.h>
+#include <QueryTracer.h>
+#include <SlowQueryLog.h>
 #include "PLYLog.h"
 
 using namespace PLY;
 
-PLY::Worker::Worker(PLY::PLYSystemComponent *psc, const unsigned long long &workerID, const PoolSettings::Priority &priority,
+PLY::Worker::Worker(PLY::QueryEngine *engine, const unsigned long long &workerID, const PoolSettings::Priority &priority,
 	const PoolSettings::WaitMode &waitMode, const int &reconnectWaitTime, const AZStd::string &connectionString)
 	: m_workerID(workerID),
-	m_psc(psc),
+	m_engine(engine),
 	m_c(nullptr),
 	m_query(nullptr),
 	m_busy(false),
 	m_runQuery(false),
 	m_shutdownThread(false),
 	m_workerError(false),
+	m_reconnecting(false),
 	m_workerPriority(priority),
 	m_waitMode(waitMode),
 	m_reconnectWaitTime(reconnectWaitTime),
@@ -39,6 +43,19 @@ PLY::Worker::~Worker()
 		m_workerThread.join();
 		PLYLOG(PLYLog::PLY_INFO, ("Thread cleaning itself up JOINED. Thread ID " + AZStd::string::format("%u", m_workerID)).c_str());
 	}
+
+	if (m_c != nullptr) STATS->Count(StatsCollector::CONNECTIONS_CLOSED);
+}
+
+long long PLY::Worker::GetResultSize(const pqxx::result &r)
+{
+	//Field lengths are stored by libpq, so this doesn't touch the field data itself.
+	long long size = 0;
+	for (const pqxx::row &row : r)
+	{
+		for (const pqxx::field &f : row) size += static_cast<long long>(f.size());
+	}
+	return size;
 }
 
 bool PLY::Worker::IsBusy() const
@@ -58,6 +75,8 @@ bool PLY::Worker::IsShutDown() const
 
 void PLY::Worker::GiveQuery(std::shared_ptr<PLY::PLYQuery> query)
 {
+	TraceSpan span("Dispatch", m_workerID, query->queryID);
+
 	m_busy = true;
 
 	query->workerID = m_workerID;
@@ -81,6 +100,8 @@ unsigned long long PLY::Worker::GetWorkerID() const
 
 void PLY::Worker::WorkerLoop()
 {
+	TRACER->SetThreadName(AZStd::string::format("Worker %llu", m_workerID));
+
 	try
 	{
 		//Change priority of process. This must be set within the thread as it first starts.
@@ -130,13 +151,21 @@ void PLY::Worker::WorkerLoop()
 				{
 
 					//Establish connection.
-					m_c = std::make_unique<pqxx::connection>(m_connectionString.c_str());
+					TraceSpan span("Connect", m_workerID);
+					m_c = m_engine->OpenConnection(m_connectionString);
 					PLYLOG(PLYLog::PLY_DEBUG, "DB connection established OK.");
+
+					STATS->Count(StatsCollector::CONNECTIONS_OPENED);
+					if (m_reconnecting) STATS->Count(StatsCollector::RECONNECTS);
+					m_reconnecting = false;
 				}
 				catch (const pqxx::failure &e)
 				{
 					PLYLOG(PLYLog::PLY_ERROR, "Connection error: " + AZStd::string(e.what()));
 
+					STATS->Count(StatsCollector::CONNECTION_FAILURES);
+					m_reconnecting = true;
+
 					//Clean up connection object before trying again.
 					m_c = nullptr;
 
@@ -170,19 +199,32 @@ void PLY::Worker::WorkerLoop()
 					result->queryStartTime = AZ::ScriptTimePoint(now);
 
 					//Run query and get results here.
-					//AUTOMATIC TRANSACTIONS DISABLED WHILE A LIPQXX LIBRARY BUG IS BEING RESOLVED
-					//See Github ticket #42 https://github.com/ash-j-f/PLY/issues/42
-					/*if (m_query->settings.useTransaction)
+					unsigned long long execStart = TRACER->IsEnabled() ? TRACER->Now() : 0;
+
+					result->resultSet = m_c->Execute(m_query->queryString.c_str(), m_query->binaryParams);
+
+					if (execStart != 0) TRACER->Record("Exec", execStart, TRACER->Now(), m_workerID, m_query->queryID);
+
+					//Run the query's result processor on this worker thread, so the main thread only has to use its output.
+					if (m_query->settings.resultProcessor)
 					{
-						pqxx::work w(*m_c);
-						result->resultSet = w.exec(m_query->queryString.c_str());
-						w.commit();
-					}*/
-					//else
-					//{
-						pqxx::nontransaction w(*m_c);
-						result->resultSet = w.exec(m_query->queryString.c_str());
-					//}
+						TraceSpan span("Process", m_workerID, m_query->queryID);
+
+						try
+						{
+							m_query->settings.resultProcessor(*result);
+						}
+						catch (const std::exception &e)
+						{
+							result->errorType = PLY::PLYResult::ResultErrorType::PROCESSOR_ERROR;
+							result->errorMessage = e.what();
+							result->processedData = nullptr;
+
+							PLYLOG(PLYLog::PLY_ERROR, "Result processor error: " + AZStd::string(e.what()));
+
+							STATS->Count(StatsCollector::PROCESSOR_ERRORS);
+						}
+					}
 				}
 				catch (const pqxx::broken_connection &e)
 				{
@@ -195,6 +237,9 @@ void PLY::Worker::WorkerLoop()
 					//Clean up connection object.
 					m_c = nullptr;
 
+					STATS->Count(StatsCollector::CONNECTIONS_CLOSED);
+					m_reconnecting = true;
+
 					//Clean up result object.
 					result = nullptr;
 
@@ -206,6 +251,10 @@ void PLY::Worker::WorkerLoop()
 				{
 					//SQL failure.
 
+					//Keep the start time, so failed queries are timed the same as successful ones.
+					AZ::ScriptTimePoint startTime = result != nullptr ? result->queryStartTime :
+						AZ::ScriptTimePoint(AZStd::chrono::system_clock::now());
+
 					//Clean up result object.
 					result = nullptr;
 
@@ -218,11 +267,17 @@ void PLY::Worker::WorkerLoop()
 					//Transfer settings from the query to the result.
 					result->settings = m_query->settings;
 
+					//Record query creation and start times.
+					result->queryCreationTime = m_query->creationTime;
+					result->queryStartTime = startTime;
+
 					result->errorType = PLY::PLYResult::ResultErrorType::SQL_ERROR;
 
 					result->errorMessage = e.base().what();
 					
 					PLYLOG(PLYLog::PLY_ERROR, "SQL error: " + AZStd::string(e.base().what()));
+
+					STATS->Count(StatsCollector::SQL_ERRORS);
 				}
 				catch (const std::exception &e)
 				{
@@ -242,9 +297,20 @@ void PLY::Worker::WorkerLoop()
 					AZStd::chrono::system_clock::time_point now = AZStd::chrono::system_clock::now();
 					result->queryEndTime = AZ::ScriptTimePoint(now);
 
+					long long bytes = result->errorType == PLY::PLYResult::ResultErrorType::NONE ? GetResultSize(result->resultSet) : 0;
+
+					STATS->RecordExecution(*result);
+					STATS->RecordStatement(*m_query, *result, bytes);
+					STATS->Count(StatsCollector::BYTES_RECEIVED, bytes);
+					if (m_engine->m_slowQueryLog != nullptr) m_engine->m_slowQueryLog->Check(*m_query, *result, m_workerID);
+
 					//Try to add result to the results queue.
 					//If a result with the same query ID is already in the queue, we can just abandon the result object.
-					if (m_psc->AddResult(result))
+					unsigned long long addStart = TRACER->IsEnabled() ? TRACER->Now() : 0;
+					bool added = m_engine->AddResult(result);
+					if (addStart != 0) TRACER->Record("AddResult", addStart, TRACER->Now(), m_workerID, result->queryID);
+
+					if (added)
 					{
 						//Mark the query finished if it was added to the queue successfully.
 						m_query->finished = true;
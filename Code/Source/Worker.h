@@ -7,15 +7,21 @@
 #include <PLY/PLYTools.h>
 #include <PLY/PLYTypes.h>
 
+class PLYMicroBench;
+
 namespace PLY
 {
 	//Forward declarations.
-	class PLYSystemComponent;
+	class QueryEngine;
+	class DatabaseConnection;
 
 	class Worker
 	{
+
+	friend PLYMicroBench;
+
 	public:
-		Worker(PLY::PLYSystemComponent *psc, const unsigned long long &workerID, const PoolSettings::Priority &priority,
+		Worker(PLY::QueryEngine *engine, const unsigned long long &workerID, const PoolSettings::Priority &priority,
 			const PoolSettings::WaitMode &waitMode, const int &reconnectWaitTime, const AZStd::string &connectionString);
 		~Worker();
 
@@ -42,6 +48,15 @@ namespace PLY
 		//The worker ID.
 		unsigned long long m_workerID;
 
+		//Pointer to the query engine that owns the connections and queues.
+		PLY::QueryEngine *m_engine;
+
+		//Database connection.
+		std::unique_ptr<DatabaseConnection> m_c;
+
+		//Query.
+		std::shared_ptr<PLY::PLYQuery> m_query;
+
 		//Is this connection busy?
 		std::atomic<bool> m_busy;
 
@@ -54,14 +69,9 @@ namespace PLY
 		//Was there an unrecoverable error with the thread?
 		std::atomic<bool> m_workerError;
 
-		//Query.
-		std::shared_ptr<PLY::PLYQuery> m_query;
-		
-		//Database connection.
-		std::unique_ptr<pqxx::connection> m_c;
-
-		//Pointer to PLYSystemComponent that owns the connections and queues.
-		PLY::PLYSystemComponent *m_psc;
+		//Has the worker's connection failed or been lost? The next connection opened is counted as a reconnect.
+		//Only used by the worker thread.
+		bool m_reconnecting;
 
 		//Thread for the query worker.
 		std::thread m_workerThread;
@@ -80,5 +90,9 @@ namespace PLY
 
 		//Main thread work function.
 		void WorkerLoop();
+
+		//Get the total size in bytes of all fields in a result set.
+		//@param r The result set.
+		static long long GetResultSize(const pqxx::result &r);
 	};
 }
\ No newline at end of file
@@ -1,11 +1,86 @@
 // A simple test to check if the PLY Gem is responding to API requests.
 // @author Ashley Flynn - https://ajflynn.io/ - The Academy of Interactive Entertainment and the Canberra Institute of Technology - 2019
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
 #include <AzTest/AzTest.h>
 
 #include <PLY/PLYTools.h>
+#include <PLY/PLYConfiguration.hpp>
+#include <PLY/PLYObjectSyncBinary.hpp>
+#include <PLY/PLYObjectSyncNotificationBus.h>
+#include <PLY/PLYObjectSyncDataStringBus.h>
 
 #include "PLYSystemComponent.h"
+#include "QueryEngine.h"
+#include "FakeConnection.h"
+#include "ObjectSyncManager.h"
+#include "LatencyHistogram.h"
+#include "QueryFingerprint.h"
+#include "StatementStats.h"
+#include "BenchmarkScenario.h"
+#include "ShardedCounter.h"
+
+//Query handler that records the queries it is sent instead of running them. Every query succeeds with an empty result.
+class RecordingRequests
+	: public PLY::PLYRequestBus::Handler
+{
+public:
+
+	RecordingRequests() { BusConnect(); };
+	~RecordingRequests() { BusDisconnect(); };
+
+	//Queries sent so far. Each query's ID is its position in the list, plus one.
+	std::vector<AZStd::string> queries;
+
+	bool GetLibpqThreadsafe() override { return true; };
+	void InitialisePool() override {};
+	void DeInitialisePool() override {};
+	unsigned long long SendQuery(const AZStd::string query) override { queries.push_back(query); return queries.size(); };
+	unsigned long long SendQueryNoTransaction(const AZStd::string query) override { return SendQuery(query); };
+	unsigned long long SendQueryWithOptions(const AZStd::string query, const PLY::QuerySettings) override { return SendQuery(query); };
+	unsigned long long SendQueryWithBinaryParams(const AZStd::string query, const std::vector<std::string>,
+		const PLY::QuerySettings) override { return SendQuery(query); };
+	std::shared_ptr<PLY::PLYResult> GetResult(const unsigned long long) override { return std::make_shared<PLY::PLYResult>(); };
+	void RemoveResult(const unsigned long long) override {};
+	void StartBenchmarkSimple() override {};
+	void StartBenchmarkStars() override {};
+	void StartBenchmarkStarsSequence() override {};
+	void StartBenchmarkObjectSync() override {};
+	void StopBenchmark() override {};
+	void StartBenchmarkScenarios(const AZStd::string &) override {};
+	void SetBenchmarkPasses(int) override {};
+	PLY::PLYLatencyStats GetLatencyStats() override { return PLY::PLYLatencyStats(); };
+	void ResetLatencyStats() override {};
+	PLY::PLYQueryCounters GetQueryCounters() override { return PLY::PLYQueryCounters(); };
+	std::vector<PLY::PLYStatementStats> GetStatementStats(int) override { return std::vector<PLY::PLYStatementStats>(); };
+	void ResetStatementStats() override {};
+};
+
+//Object sync entity whose state is a data string set by the test. Counts how often its state is asked for.
+class StateObject
+	: public PLY::PLYObjectSyncDataStringBus::Handler
+{
+public:
+
+	StateObject(AZ::EntityId entityID) { BusConnect(entityID); };
+	~StateObject() { BusDisconnect(); };
+
+	//The object's state.
+	std::string state = "state";
+
+	//Number of times the state has been asked for.
+	int gets = 0;
+
+	void SetPropertiesFromDataString(std::string dataString) override { state = dataString; };
+	std::string GetDataString() override { gets++; return state; };
+	void SetObjectInvisible() override {};
+	void SetObjectVisible() override {};
+	void Reset() override {};
+};
 
 class PLYTest
     : public ::testing::Test
@@ -24,6 +99,30 @@ protected:
     {
 		delete TestComponent;
     }
+
+	//Run one query through a query engine using fake connections, and wait up to 10 seconds for its result.
+	//@param settings The fake connection settings.
+	//@return The result, or nullptr if it didn't arrive.
+	std::shared_ptr<PLY::PLYResult> RunFakeQuery(const PLY::FakeConnectionSettings &settings)
+	{
+		PLY::QueryEngine engine;
+		engine.SetConnectionFactory(PLY::FakeConnection::GetFactory(settings));
+		engine.Start();
+
+		PLY::QuerySettings qs;
+		qs.advertiseResult = false;
+		unsigned long long queryID = engine.SendQuery("SELECT 1", std::vector<std::string>(), qs);
+
+		std::shared_ptr<PLY::PLYResult> result = nullptr;
+		for (int i = 0; i < 1000 && result == nullptr; ++i)
+		{
+			result = engine.GetResult(queryID);
+			if (result == nullptr) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+
+		engine.Stop();
+		return result;
+	}
 };
 
 /**
@@ -49,4 +148,1033 @@ TEST_F(PLYTest, ConnectionTest)
 	ASSERT_TRUE(c.protocol_version() > 0);
 }
 
+/**
+* Check that objects loaded in the same frame are read with one query per batch, passing the batch's object IDs as an array,
+* and that an object loaded by several entities is only read once. Doesn't need a database.
+*/
+TEST_F(PLYTest, ObjectSyncBatchedLoads)
+{
+	PLY::ObjectSyncSettings original = PLYCONF->GetObjectSyncSettings();
+	PLY::ObjectSyncSettings os = original;
+	os.maxLoadBatchSize = 2;
+	PLYCONF->SetObjectSyncSettings(os);
+
+	RecordingRequests requests;
+	PLY::ObjectSyncManager manager;
+
+	PLY::PLYObjectSyncSystem::EntitySettings settings;
+	settings.syncOnLoad = false;
+	settings.details = PLY::PLYObjectSyncSaveLoad::DataBaseDetails("objects", "id", "data");
+
+	//Entities 1 to 5 use objects 1 to 5, and entity 6 shares object 5.
+	for (int i = 1; i <= 6; ++i)
+	{
+		settings.objectID = std::min(i, 5);
+		PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::RegisterEntity, AZ::EntityId(i), settings);
+		PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::LoadEntity, AZ::EntityId(i));
+	}
+
+	manager.OnTick(0.0f, AZ::ScriptTimePoint());
+
+	PLYCONF->SetObjectSyncSettings(original);
+
+	ASSERT_EQ(requests.queries.size(), 3);
+	ASSERT_NE(requests.queries[0].find("id = ANY('{1,2}'::int[])"), AZStd::string::npos) << requests.queries[0].c_str();
+	ASSERT_NE(requests.queries[1].find("id = ANY('{3,4}'::int[])"), AZStd::string::npos) << requests.queries[1].c_str();
+	ASSERT_NE(requests.queries[2].find("id = ANY('{5}'::int[])"), AZStd::string::npos) << requests.queries[2].c_str();
+}
+
+/**
+* Check that an object saved only when dirty isn't asked for its state until it is marked dirty, and that a state identical
+* to the one last saved isn't sent to the database. Doesn't need a database.
+*/
+TEST_F(PLYTest, ObjectSyncDirtyAndHashSkipSaves)
+{
+	RecordingRequests requests;
+	PLY::ObjectSyncManager manager;
+
+	PLY::PLYObjectSyncSystem::EntitySettings settings;
+	settings.objectID = 7;
+	settings.syncOnLoad = false;
+	settings.autoSave = true;
+	settings.saveOnlyWhenDirty = true;
+	settings.details = PLY::PLYObjectSyncSaveLoad::DataBaseDetails("objects", "id", "data");
+
+	AZ::EntityId entityID(1);
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::RegisterEntity, entityID, settings);
+	StateObject object(entityID);
+
+	//Not dirty, so not even serialised.
+	ASSERT_FALSE(manager.AutoSaveEntity(entityID));
+	ASSERT_EQ(object.gets, 0);
+
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::MarkEntityDirty, entityID);
+	ASSERT_TRUE(manager.AutoSaveEntity(entityID));
+	ASSERT_EQ(object.gets, 1);
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::FlushSaves);
+	ASSERT_EQ(requests.queries.size(), 1);
+	PLY::PLYResultBus::Broadcast(&PLY::PLYResultBus::Events::ResultReady, 1ULL);
+
+	//Saving cleared the dirty flag.
+	ASSERT_FALSE(manager.AutoSaveEntity(entityID));
+	ASSERT_EQ(object.gets, 1);
+
+	//Dirty, but the state hasn't changed since it was saved.
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::MarkEntityDirty, entityID);
+	ASSERT_FALSE(manager.AutoSaveEntity(entityID));
+	ASSERT_EQ(object.gets, 2);
+
+	object.state = "changed";
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::MarkEntityDirty, entityID);
+	ASSERT_TRUE(manager.AutoSaveEntity(entityID));
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::FlushSaves);
+	ASSERT_EQ(requests.queries.size(), 2);
+	ASSERT_NE(requests.queries[1].find("changed"), AZStd::string::npos);
+}
+
+/**
+* Check that a coalesced query takes the place in the query queue of the query it replaces, so a key that is sent again
+* every frame isn't pushed behind newer queries. Doesn't need a database.
+*/
+TEST_F(PLYTest, CoalescedQueryKeepsQueuePosition)
+{
+	PLY::QueryEngine engine;
+
+	PLY::QuerySettings keyed;
+	keyed.advertiseResult = false;
+	keyed.coalesceKey = "state|1";
+
+	PLY::QuerySettings plain;
+	plain.advertiseResult = false;
+
+	//The engine isn't started, so every query stays in the queue.
+	engine.SendQuery("SELECT 1", std::vector<std::string>(), keyed);
+	unsigned long long other = engine.SendQuery("SELECT 2", std::vector<std::string>(), plain);
+	unsigned long long latest = engine.SendQuery("SELECT 3", std::vector<std::string>(), keyed);
+
+	ASSERT_EQ(engine.m_queryQueue.size(), 2);
+	ASSERT_EQ(engine.m_queryQueue.front()->queryID, latest);
+	ASSERT_EQ(engine.m_queryQueue.front()->queryString, "SELECT 3");
+	ASSERT_EQ(engine.m_queryQueue.back()->queryID, other);
+}
+
+/**
+* Check that an object sync save is not sent while an earlier save of the same object is in flight, and that of the saves
+* queued behind it, only the latest is written. Doesn't need a database.
+*/
+TEST_F(PLYTest, ObjectSyncSupersededSaveDropped)
+{
+	RecordingRequests requests;
+	PLY::ObjectSyncManager manager;
+
+	PLY::PLYObjectSyncSystem::EntitySettings settings;
+	settings.objectID = 7;
+	settings.syncOnLoad = false;
+	settings.details = PLY::PLYObjectSyncSaveLoad::DataBaseDetails("objects", "id", "data");
+
+	AZ::EntityId entityID(1);
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::RegisterEntity, entityID, settings);
+
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::SaveEntityDataString, entityID, std::string("first"));
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::FlushSaves);
+	ASSERT_EQ(requests.queries.size(), 1);
+
+	//The first save is still in flight, so these are held back, and the second is replaced by the third.
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::SaveEntityDataString, entityID, std::string("second"));
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::FlushSaves);
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::SaveEntityDataString, entityID, std::string("third"));
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::FlushSaves);
+	ASSERT_EQ(requests.queries.size(), 1);
+
+	PLY::PLYResultBus::Broadcast(&PLY::PLYResultBus::Events::ResultReady, 1ULL);
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::FlushSaves);
+	ASSERT_EQ(requests.queries.size(), 2);
+	ASSERT_NE(requests.queries[1].find("third"), AZStd::string::npos);
+	ASSERT_EQ(requests.queries[1].find("second"), AZStd::string::npos);
+}
+
+/**
+* Check that query IDs keep increasing when the query engine is stopped and started again, and that object sync queries in
+* flight when it stops fail, so their entities are told and held back saves are sent. Doesn't need a database.
+*/
+TEST_F(PLYTest, ObjectSyncEngineRestartFailsInFlightQueries)
+{
+	//Handler that records the outcome of every save and load.
+	class Listener
+		: public PLY::PLYObjectSyncNotificationBus::Handler
+	{
+	public:
+		std::vector<bool> saves;
+		std::vector<bool> loads;
+		void SaveFinished(bool success) override { saves.push_back(success); };
+		void LoadFinished(bool success, std::string) override { loads.push_back(success); };
+	};
+
+	PLY::QueryEngine engine;
+	engine.SetConnectionFactory(PLY::FakeConnection::GetFactory(PLY::FakeConnectionSettings()));
+
+	PLY::QuerySettings qs;
+	qs.advertiseResult = false;
+
+	engine.Start();
+	unsigned long long before = engine.SendQuery("SELECT 1", std::vector<std::string>(), qs);
+	engine.Stop();
+	engine.Start();
+	unsigned long long after = engine.SendQuery("SELECT 1", std::vector<std::string>(), qs);
+	engine.Stop();
+	ASSERT_GT(after, before);
+
+	RecordingRequests requests;
+	PLY::ObjectSyncManager manager;
+
+	PLY::PLYObjectSyncSystem::EntitySettings settings;
+	settings.objectID = 7;
+	settings.syncOnLoad = false;
+	settings.details = PLY::PLYObjectSyncSaveLoad::DataBaseDetails("objects", "id", "data");
+
+	AZ::EntityId entityID(1);
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::RegisterEntity, entityID, settings);
+
+	Listener listener;
+	listener.BusConnect(entityID);
+
+	//A save and a load in flight, and a second save held back behind the first.
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::SaveEntityDataString, entityID, std::string("first"));
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::FlushSaves);
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::SaveEntityDataString, entityID, std::string("second"));
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::FlushSaves);
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::LoadEntity, entityID);
+	manager.OnTick(0.0f, AZ::ScriptTimePoint());
+	ASSERT_EQ(requests.queries.size(), 2);
+
+	manager.AbandonQueries();
+	ASSERT_EQ(listener.saves, std::vector<bool>({ false }));
+	ASSERT_EQ(listener.loads, std::vector<bool>({ false }));
+
+	//The held back save is no longer waiting on the abandoned one.
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::FlushSaves);
+	ASSERT_EQ(requests.queries.size(), 3);
+	ASSERT_NE(requests.queries[2].find("second"), AZStd::string::npos);
+
+	//Results for the abandoned IDs belong to someone else now, and are left alone.
+	PLY::PLYResultBus::Broadcast(&PLY::PLYResultBus::Events::ResultReady, 1ULL);
+	PLY::PLYResultBus::Broadcast(&PLY::PLYResultBus::Events::ResultReady, 2ULL);
+	ASSERT_EQ(listener.saves.size(), 1);
+	ASSERT_EQ(listener.loads.size(), 1);
+
+	listener.BusDisconnect();
+}
+
+/**
+* Check that every handler connected to an entity on the notification bus is told the outcome of its saves and loads, and
+* that handlers only need to implement the notifications they use. Doesn't need a database.
+*/
+TEST_F(PLYTest, ObjectSyncNotifiesSaveAndLoad)
+{
+	//Handler that only counts saves.
+	class SaveListener
+		: public PLY::PLYObjectSyncNotificationBus::Handler
+	{
+	public:
+		int saved = 0;
+		void SaveFinished(bool success) override { if (success) saved++; };
+	};
+
+	//Handler that only records loads.
+	class LoadListener
+		: public PLY::PLYObjectSyncNotificationBus::Handler
+	{
+	public:
+		std::vector<std::string> loaded;
+		void LoadFinished(bool success, std::string dataString) override { if (success) loaded.push_back(dataString); };
+	};
+
+	RecordingRequests requests;
+	PLY::ObjectSyncManager manager;
+
+	PLY::PLYObjectSyncSystem::EntitySettings settings;
+	settings.objectID = 7;
+	settings.syncOnLoad = false;
+	settings.details = PLY::PLYObjectSyncSaveLoad::DataBaseDetails("objects", "id", "data");
+
+	AZ::EntityId entityID(1);
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::RegisterEntity, entityID, settings);
+
+	SaveListener first;
+	SaveListener second;
+	LoadListener loads;
+	first.BusConnect(entityID);
+	second.BusConnect(entityID);
+	loads.BusConnect(entityID);
+
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::SaveEntityDataString, entityID, std::string("state"));
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::FlushSaves);
+	PLY::PLYResultBus::Broadcast(&PLY::PLYResultBus::Events::ResultReady, 1ULL);
+	ASSERT_EQ(first.saved, 1);
+	ASSERT_EQ(second.saved, 1);
+
+	//The load has no rows, so the object has nothing saved yet, and is told so with a blank data string.
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::LoadEntity, entityID);
+	manager.OnTick(0.0f, AZ::ScriptTimePoint());
+	ASSERT_EQ(requests.queries.size(), 2);
+	PLY::PLYResultBus::Broadcast(&PLY::PLYResultBus::Events::ResultReady, 2ULL);
+	ASSERT_EQ(loads.loaded.size(), 1);
+	ASSERT_EQ(loads.loaded[0], "");
+
+	first.BusDisconnect();
+	second.BusDisconnect();
+	loads.BusDisconnect();
+}
+
+/**
+* Check that binary object sync blobs keep their schema version and payload through Pack and Unpack, including payloads with
+* zero bytes, empty payloads, and schema versions that use both header bytes.
+*/
+TEST_F(PLYTest, ObjectSyncBinaryRoundTrip)
+{
+	const std::string payloads[] = { std::string("state", 5), std::string("\0\xFF\0\x80", 4), std::string(), std::string(70000, 'p') };
+	const uint16_t versions[] = { 0, 1, 0x1234, 0xFFFF };
+
+	for (const std::string &payload : payloads)
+	{
+		for (const uint16_t version : versions)
+		{
+			std::string blob = PLY::PLYObjectSyncBinary::Pack(version, payload.data(), payload.size());
+			ASSERT_EQ(blob.size(), PLY::PLYObjectSyncBinary::HEADER_SIZE + payload.size());
+			ASSERT_TRUE(PLY::PLYObjectSyncBinary::IsValid(blob));
+
+			uint16_t unpackedVersion = 0;
+			const char *unpacked = nullptr;
+			size_t length = 0;
+			ASSERT_TRUE(PLY::PLYObjectSyncBinary::Unpack(blob, unpackedVersion, unpacked, length));
+			ASSERT_EQ(unpackedVersion, version);
+			ASSERT_EQ(std::string(unpacked, length), payload);
+		}
+	}
+}
+
+/**
+* Check that Unpack rejects blobs with a bad magic number, a truncated header, or a payload that doesn't match its stated length.
+*/
+TEST_F(PLYTest, ObjectSyncBinaryRejectsInvalid)
+{
+	std::string blob = PLY::PLYObjectSyncBinary::Pack(1, "state", 5);
+
+	uint16_t version = 0;
+	const char *payload = nullptr;
+	size_t length = 0;
+
+	std::string badMagic = blob;
+	badMagic[0] = 'X';
+	ASSERT_FALSE(PLY::PLYObjectSyncBinary::Unpack(badMagic, version, payload, length));
+
+	ASSERT_FALSE(PLY::PLYObjectSyncBinary::Unpack(blob.substr(0, PLY::PLYObjectSyncBinary::HEADER_SIZE - 1), version, payload, length));
+	ASSERT_FALSE(PLY::PLYObjectSyncBinary::Unpack(blob.substr(0, blob.size() - 1), version, payload, length));
+	ASSERT_FALSE(PLY::PLYObjectSyncBinary::Unpack(blob + "x", version, payload, length));
+	ASSERT_FALSE(PLY::PLYObjectSyncBinary::IsValid("{\"x\": 1}"));
+}
+
+/**
+* Check that saves to a table with a position column insert their data straight from the VALUES list, so it takes the data
+* column's type, and write coordinates that read back as the same floats. Doesn't need a database.
+*/
+TEST_F(PLYTest, ObjectSyncSaveQueryWithPosition)
+{
+	PLY::PLYObjectSyncSaveLoad::DataBaseDetails details("objects", "id", "data", PLY::PLYObjectSyncSaveLoad::JSON_TEXT, "pos", "updated");
+
+	std::map<int, PLY::ObjectSyncManager::PendingSave> saves;
+	saves[3].dataString = "{\"name\": \"O'Brien\"}";
+	saves[3].position = AZ::Vector3(0.1f, -2.5f, 16777216.0f);
+	saves[4].dataString = "{}";
+	saves[4].position = AZ::Vector3(1e-7f, 0.0f, 123456.789f);
+
+	std::vector<std::string> binaryParams;
+	std::string sql = PLY::ObjectSyncManager::GetSaveQuery(details, saves.begin(), saves.end(), binaryParams);
+
+	ASSERT_TRUE(binaryParams.empty());
+	ASSERT_EQ(sql.find("with s as (select Find_SRID('', 'objects', 'pos') as srid) insert into objects (id, data, pos, updated) VALUES "), 0) << sql;
+	ASSERT_NE(sql.find("(3, '{\"name\": \"O''Brien\"}', ST_SetSRID(ST_MakePoint(0.100000001, -2.5, 16777216), (select srid from s)), now())"),
+		std::string::npos) << sql;
+	ASSERT_NE(sql.find("(4, '{}', ST_SetSRID(ST_MakePoint(1.00000001e-07, 0, 123456.789), (select srid from s)), now())"), std::string::npos) << sql;
+	ASSERT_EQ(sql.find("v.data"), std::string::npos) << sql;
+
+	//Binary blobs are parameters, inserted straight into the data column without a cast.
+	details.dataFormat = PLY::PLYObjectSyncSaveLoad::BINARY;
+	sql = PLY::ObjectSyncManager::GetSaveQuery(details, saves.begin(), saves.end(), binaryParams);
+	ASSERT_EQ(binaryParams.size(), 2);
+	ASSERT_NE(sql.find("(3, $1, ST_SetSRID("), std::string::npos) << sql;
+	ASSERT_EQ(sql.find("::bytea"), std::string::npos) << sql;
+}
+
+/**
+* Check that saves appended to the save journal are still there, in order and intact, when the journal is opened again.
+* The flusher never gets to run, so doesn't need a database.
+*/
+TEST_F(PLYTest, SaveJournalRecovery)
+{
+	const char *fileName = "PLYTestJournal.plyj";
+	std::remove(fileName);
+
+	PLY::PLYObjectSyncSaveLoad::DataBaseDetails details("objects", "id", "data", PLY::PLYObjectSyncSaveLoad::JSON_TEXT, "pos", "");
+
+	{
+		PLY::SaveJournal journal;
+		ASSERT_TRUE(journal.Open(fileName, 1, 1000000, ""));
+
+		unsigned long long sequence = 0;
+		for (int i = 1; i <= 3; ++i)
+		{
+			ASSERT_TRUE(journal.Append(details, i, "state " + std::to_string(i), AZ::Vector3(1.0f, 2.0f, static_cast<float>(i)), sequence));
+			ASSERT_EQ(sequence, static_cast<unsigned long long>(i));
+		}
+		journal.Close();
+	}
+
+	PLY::SaveJournal journal;
+	ASSERT_TRUE(journal.Open(fileName, 1, 1000000, ""));
+	ASSERT_EQ(journal.GetFlushedSequence(), 1);
+	ASSERT_EQ(journal.m_nextSequence, 4);
+
+	//Read the saves back as the flusher would replay them.
+	PLY::SaveJournal::Entry entry;
+	unsigned long long offset = journal.m_flushedOffset;
+	for (int i = 1; i <= 3; ++i)
+	{
+		unsigned long long next = 0;
+		ASSERT_TRUE(journal.ReadRecord(offset, static_cast<unsigned long long>(i), &entry, next));
+		ASSERT_EQ(entry.objectID, i);
+		ASSERT_EQ(entry.dataString, "state " + std::to_string(i));
+		ASSERT_EQ(entry.details.tableName, "objects");
+		ASSERT_EQ(entry.details.positionColumnName, "pos");
+		ASSERT_TRUE(entry.hasPosition);
+		ASSERT_EQ(entry.z, static_cast<float>(i));
+		offset = next;
+	}
+	ASSERT_EQ(offset, journal.m_writeOffset);
+
+	journal.Close();
+	std::remove(fileName);
+}
+
+/**
+* Check that a save journal record damaged by a crash part way through writing it is discarded when the journal is opened
+* again, along with everything after it, and that new saves take its place. Doesn't need a database.
+*/
+TEST_F(PLYTest, SaveJournalDiscardsTornRecord)
+{
+	const char *fileName = "PLYTestJournalTorn.plyj";
+	std::remove(fileName);
+
+	PLY::PLYObjectSyncSaveLoad::DataBaseDetails details("objects", "id", "data");
+
+	unsigned long long tornOffset = 0;
+	{
+		PLY::SaveJournal journal;
+		ASSERT_TRUE(journal.Open(fileName, 1, 1000000, ""));
+
+		unsigned long long sequence = 0;
+		ASSERT_TRUE(journal.Append(details, 1, "first", AZ::Vector3::CreateZero(), sequence));
+		tornOffset = journal.m_writeOffset;
+		ASSERT_TRUE(journal.Append(details, 2, "second", AZ::Vector3::CreateZero(), sequence));
+		ASSERT_TRUE(journal.Append(details, 3, "third", AZ::Vector3::CreateZero(), sequence));
+
+		//Clear the second half of the second record, as if the crash interrupted writing it.
+		unsigned long long next = 0;
+		ASSERT_TRUE(journal.ReadRecord(tornOffset, 2, nullptr, next));
+		memset(journal.m_view + tornOffset + (next - tornOffset) / 2, 0, static_cast<size_t>((next - tornOffset) / 2));
+		ASSERT_FALSE(journal.ReadRecord(tornOffset, 2, nullptr, next));
+
+		journal.Close();
+	}
+
+	PLY::SaveJournal journal;
+	ASSERT_TRUE(journal.Open(fileName, 1, 1000000, ""));
+	ASSERT_EQ(journal.m_nextSequence, 2);
+	ASSERT_EQ(journal.m_writeOffset, tornOffset);
+
+	unsigned long long sequence = 0;
+	ASSERT_TRUE(journal.Append(details, 4, "fourth", AZ::Vector3::CreateZero(), sequence));
+	ASSERT_EQ(sequence, 2);
+
+	PLY::SaveJournal::Entry entry;
+	unsigned long long next = 0;
+	ASSERT_TRUE(journal.ReadRecord(tornOffset, 2, &entry, next));
+	ASSERT_EQ(entry.objectID, 4);
+	ASSERT_EQ(entry.dataString, "fourth");
+
+	journal.Close();
+	std::remove(fileName);
+}
+
+/**
+* Check that when the save journal is full, a save is not sent to the database directly while older saves of the same object
+* are still waiting in the journal, but saves of other objects are. Doesn't need a database.
+*/
+TEST_F(PLYTest, ObjectSyncFullJournalHoldsSaves)
+{
+	const char *fileName = "PLYTestJournalFull.plyj";
+	std::remove(fileName);
+
+	RecordingRequests requests;
+	PLY::ObjectSyncManager manager;
+
+	//The flusher never runs, so the journal fills up.
+	manager.m_journal = std::make_unique<PLY::SaveJournal>();
+	ASSERT_TRUE(manager.m_journal->Open(fileName, 1, 1000000, ""));
+
+	PLY::PLYObjectSyncSystem::EntitySettings settings;
+	settings.syncOnLoad = false;
+	settings.details = PLY::PLYObjectSyncSaveLoad::DataBaseDetails("objects", "id", "data");
+
+	AZ::EntityId journaled(1);
+	settings.objectID = 7;
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::RegisterEntity, journaled, settings);
+
+	AZ::EntityId direct(2);
+	settings.objectID = 8;
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::RegisterEntity, direct, settings);
+
+	const std::string big(400 * 1024, 'x');
+
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::SaveEntityDataString, journaled, "a" + big);
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::FlushSaves);
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::SaveEntityDataString, journaled, "b" + big);
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::FlushSaves);
+	ASSERT_EQ(requests.queries.size(), 0);
+
+	//Neither save fits in the journal. Only the object with nothing left in the journal is sent directly.
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::SaveEntityDataString, journaled, "c" + big);
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::SaveEntityDataString, direct, "d" + big);
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::FlushSaves);
+	ASSERT_EQ(requests.queries.size(), 1);
+	ASSERT_EQ(requests.queries[0].find(("c" + big).c_str()), AZStd::string::npos);
+	ASSERT_NE(requests.queries[0].find(("d" + big).c_str()), AZStd::string::npos);
+
+	manager.m_journal->Close();
+	manager.m_journal = nullptr;
+	std::remove(fileName);
+}
+
+/**
+* Check that entities registered together start spread evenly across their save interval, and that each automatic save moves
+* an entity's place in the interval by no more than the configured jitter. Doesn't need a database.
+*/
+TEST_F(PLYTest, ObjectSyncSaveStaggerAndJitter)
+{
+	PLY::ObjectSyncSettings original = PLYCONF->GetObjectSyncSettings();
+	PLY::ObjectSyncSettings os = original;
+	os.saveJitter = 10;
+	os.saveLatencyTarget = 0;
+	PLYCONF->SetObjectSyncSettings(os);
+
+	RecordingRequests requests;
+	PLY::ObjectSyncManager manager;
+
+	PLY::PLYObjectSyncSystem::EntitySettings settings;
+	settings.syncOnLoad = false;
+	settings.autoSave = true;
+	settings.saveIntervalMS = 2000;
+	settings.details = PLY::PLYObjectSyncSaveLoad::DataBaseDetails("objects", "id", "data");
+
+	const int count = 100;
+	const float interval = 2.0f;
+	std::vector<std::unique_ptr<StateObject>> objects;
+	for (int i = 1; i <= count; ++i)
+	{
+		settings.objectID = i;
+		PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::RegisterEntity, AZ::EntityId(i), settings);
+		objects.push_back(std::make_unique<StateObject>(AZ::EntityId(i)));
+	}
+
+	//No two entities start close together, and there are no wide gaps.
+	std::vector<float> starts = manager.m_timers;
+	std::vector<float> sorted = starts;
+	std::sort(sorted.begin(), sorted.end());
+	ASSERT_GE(sorted.front(), 0.0f);
+	ASSERT_LT(sorted.back(), interval);
+	for (size_t i = 0; i < sorted.size(); ++i)
+	{
+		float gap = i + 1 < sorted.size() ? sorted[i + 1] - sorted[i] : sorted[0] + interval - sorted[i];
+		ASSERT_GT(gap, 0.4f * interval / count);
+		ASSERT_LT(gap, 2.0f * interval / count);
+	}
+
+	//A whole interval passes, so every entity saves once, and is moved by up to 10% of the interval.
+	manager.OnTick(interval, AZ::ScriptTimePoint());
+
+	PLYCONF->SetObjectSyncSettings(original);
+
+	bool moved = false;
+	for (size_t i = 0; i < starts.size(); ++i)
+	{
+		ASSERT_LE(std::abs(manager.m_timers[i] - starts[i]), 0.1f * interval + 0.0001f);
+		if (std::abs(manager.m_timers[i] - starts[i]) > 0.0001f) moved = true;
+	}
+	ASSERT_TRUE(moved);
+	for (const std::unique_ptr<StateObject> &o : objects) ASSERT_EQ(o->gets, 1);
+}
+
+/**
+* Check that when a save completes, the object's saved hash is that of the data string the save wrote, not of a newer one
+* queued since. Doesn't need a database.
+*/
+TEST_F(PLYTest, ObjectSyncSavedHashFollowsSave)
+{
+	RecordingRequests requests;
+	PLY::ObjectSyncManager manager;
+
+	PLY::PLYObjectSyncSystem::EntitySettings settings;
+	settings.objectID = 7;
+	settings.syncOnLoad = false;
+	settings.details = PLY::PLYObjectSyncSaveLoad::DataBaseDetails("objects", "id", "data");
+
+	AZ::EntityId entityID(1);
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::RegisterEntity, entityID, settings);
+
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::SaveEntityDataString, entityID, std::string("first"));
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::FlushSaves);
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::SaveEntityDataString, entityID, std::string("second"));
+
+	PLY::PLYResultBus::Broadcast(&PLY::PLYResultBus::Events::ResultReady, 1ULL);
+	ASSERT_EQ(manager.m_lastSavedHashes[0], std::hash<std::string>()("first"));
+
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::FlushSaves);
+	PLY::PLYResultBus::Broadcast(&PLY::PLYResultBus::Events::ResultReady, 2ULL);
+	ASSERT_EQ(manager.m_lastSavedHashes[0], std::hash<std::string>()("second"));
+}
+
+/**
+* Check that when an entity is unregistered and the last entity is moved into its place, both entities' object IDs are still
+* found, and saves still go to the right object. Doesn't need a database.
+*/
+TEST_F(PLYTest, ObjectSyncRegistryAfterUnregister)
+{
+	RecordingRequests requests;
+	PLY::ObjectSyncManager manager;
+
+	PLY::PLYObjectSyncSystem::EntitySettings settings;
+	settings.syncOnLoad = false;
+	settings.details = PLY::PLYObjectSyncSaveLoad::DataBaseDetails("objects", "id", "data");
+
+	//Entities 1 and 2 share object 10, and entity 3 uses object 30.
+	settings.objectID = 10;
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::RegisterEntity, AZ::EntityId(1), settings);
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::RegisterEntity, AZ::EntityId(2), settings);
+	settings.objectID = 30;
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::RegisterEntity, AZ::EntityId(3), settings);
+
+	//Entity 3 moves into entity 1's slot.
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::UnregisterEntity, AZ::EntityId(1));
+
+	int objectID = 0;
+	PLY::PLYObjectSyncSystemBus::BroadcastResult(objectID, &PLY::PLYObjectSyncSystemBus::Events::GetEntityObjectID, AZ::EntityId(1));
+	ASSERT_EQ(objectID, 0);
+	PLY::PLYObjectSyncSystemBus::BroadcastResult(objectID, &PLY::PLYObjectSyncSystemBus::Events::GetEntityObjectID, AZ::EntityId(3));
+	ASSERT_EQ(objectID, 30);
+
+	std::vector<AZ::EntityId> entities;
+	PLY::PLYObjectSyncSystemBus::BroadcastResult(entities, &PLY::PLYObjectSyncSystemBus::Events::GetEntitiesForObjectID, 10);
+	ASSERT_EQ(entities, std::vector<AZ::EntityId>({ AZ::EntityId(2) }));
+	PLY::PLYObjectSyncSystemBus::BroadcastResult(entities, &PLY::PLYObjectSyncSystemBus::Events::GetEntitiesForObjectID, 30);
+	ASSERT_EQ(entities, std::vector<AZ::EntityId>({ AZ::EntityId(3) }));
+
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::SaveEntityDataString, AZ::EntityId(3), std::string("moved"));
+	PLY::PLYObjectSyncSystemBus::Broadcast(&PLY::PLYObjectSyncSystemBus::Events::FlushSaves);
+	ASSERT_EQ(requests.queries.size(), 1);
+	ASSERT_NE(requests.queries[0].find("(30, 'moved'"), AZStd::string::npos) << requests.queries[0].c_str();
+}
+
+/**
+* Check that values below 64 microseconds each get their own latency histogram bucket, that the buckets above them split
+* each power of two into 32, and that every value reads back within 1/64 of itself.
+*/
+TEST_F(PLYTest, LatencyHistogramBuckets)
+{
+	for (unsigned long long v = 0; v < 64; ++v)
+	{
+		ASSERT_EQ(PLY::LatencyHistogram::GetBucket(v), v);
+		ASSERT_EQ(PLY::LatencyHistogram::GetBucketValue(static_cast<size_t>(v)), v);
+	}
+
+	//From 64, each bucket is 2 wide, then 4 wide from 128, and so on.
+	ASSERT_EQ(PLY::LatencyHistogram::GetBucket(64), 64);
+	ASSERT_EQ(PLY::LatencyHistogram::GetBucket(65), 64);
+	ASSERT_EQ(PLY::LatencyHistogram::GetBucket(66), 65);
+	ASSERT_EQ(PLY::LatencyHistogram::GetBucket(127), 95);
+	ASSERT_EQ(PLY::LatencyHistogram::GetBucket(128), 96);
+	ASSERT_EQ(PLY::LatencyHistogram::GetBucket(131), 96);
+	ASSERT_EQ(PLY::LatencyHistogram::GetBucket(132), 97);
+
+	for (unsigned long long v = 64; v < (1ULL << 41); v += v / 7 + 1)
+	{
+		unsigned long long read = PLY::LatencyHistogram::GetBucketValue(PLY::LatencyHistogram::GetBucket(v));
+		ASSERT_LE(read > v ? read - v : v - read, v / 64);
+	}
+
+	//Values beyond the top range all land in the last bucket.
+	ASSERT_EQ(PLY::LatencyHistogram::GetBucket(~0ULL), PLY::LatencyHistogram::BUCKET_COUNT - 1);
+	ASSERT_EQ(PLY::LatencyHistogram::GetBucket(1ULL << 50), PLY::LatencyHistogram::BUCKET_COUNT - 1);
+}
+
+/**
+* Check the latency histogram's count, mean, minimum, maximum and percentiles, and that Reset clears them.
+*/
+TEST_F(PLYTest, LatencyHistogramPercentiles)
+{
+	PLY::LatencyHistogram histogram;
+
+	for (unsigned long long v = 1; v <= 10000; ++v) histogram.Record(v);
+
+	PLY::PLYLatencyPhaseStats stats = histogram.GetSnapshot();
+	ASSERT_EQ(stats.count, 10000);
+	ASSERT_DOUBLE_EQ(stats.mean, 5000.5);
+	ASSERT_EQ(stats.min, 1);
+	ASSERT_EQ(stats.max, 10000);
+
+	//Percentiles are accurate to within about 3%.
+	ASSERT_NEAR(static_cast<double>(stats.p50), 5000.0, 5000.0 * 0.03);
+	ASSERT_NEAR(static_cast<double>(stats.p90), 9000.0, 9000.0 * 0.03);
+	ASSERT_NEAR(static_cast<double>(stats.p99), 9900.0, 9900.0 * 0.03);
+	ASSERT_NEAR(static_cast<double>(stats.p999), 9990.0, 9990.0 * 0.03);
+	ASSERT_LE(stats.p999, stats.max);
+
+	//A single value is reported exactly, as percentiles are kept within the minimum and maximum.
+	histogram.Reset();
+	ASSERT_EQ(histogram.GetSnapshot().count, 0);
+	histogram.Record(12345);
+	stats = histogram.GetSnapshot();
+	ASSERT_EQ(stats.p50, 12345);
+	ASSERT_EQ(stats.p999, 12345);
+}
+
+/**
+* Check that a sharded counter's total includes every amount added from every thread, including threads that share a shard,
+* and that it reads zero after a reset.
+*/
+TEST_F(PLYTest, ShardedCounterTotals)
+{
+	PLY::ShardedCounter counter;
+	ASSERT_EQ(counter.Get(), 0);
+
+	//More threads than shards, so some shards are shared.
+	const int threads = 40;
+	const int adds = 10000;
+	std::vector<std::thread> workers;
+	for (int t = 0; t < threads; ++t)
+	{
+		workers.emplace_back([&counter, t]()
+		{
+			for (int i = 0; i < adds; ++i) counter.Add();
+			counter.Add(t);
+		});
+	}
+	for (std::thread &w : workers) w.join();
+
+	ASSERT_EQ(counter.Get(), static_cast<long long>(threads) * adds + threads * (threads - 1) / 2);
+
+	counter.Reset();
+	ASSERT_EQ(counter.Get(), 0);
+	counter.Add(-3);
+	ASSERT_EQ(counter.Get(), -3);
+}
+
+/**
+* Check that query fingerprints replace literals, numbers and parameters, drop comments, lowercase keywords, keep quoted
+* identifiers, and collapse value lists and batched rows, so statements that only differ in their values match.
+*/
+TEST_F(PLYTest, QueryFingerprintNormalise)
+{
+	using PLY::QueryFingerprint;
+
+	ASSERT_EQ(QueryFingerprint::Normalise("SELECT id, data FROM objects WHERE id IN (1, 2, 3) AND name = 'O''Brien'"),
+		"select id, data from objects where id in (?) and name = ?");
+	ASSERT_EQ(QueryFingerprint::Normalise("SELECT * FROM t1 WHERE x = $1 AND y > 2.5e-3 -- trailing comment\n"),
+		"select * from t1 where x = ? and y > ?");
+	ASSERT_EQ(QueryFingerprint::Normalise("SELECT /* delete from t */ \"MixedCase\" FROM t WHERE s = $tag$it's; insert$tag$"),
+		"select \"MixedCase\" from t where s = ?");
+
+	//Batches of different sizes share a fingerprint.
+	std::string one = QueryFingerprint::Normalise("INSERT INTO t (id, data) VALUES (1, 'a') ON CONFLICT (id) DO UPDATE SET data = EXCLUDED.data");
+	std::string three = QueryFingerprint::Normalise("insert into t (id, data) values (1, 'a'), (2, 'b'),(3, 'c') on conflict (id) do update set data = excluded.data");
+	ASSERT_EQ(one, "insert into t (id, data) values (?) on conflict (id) do update set data = excluded.data");
+	ASSERT_EQ(one, three);
+	ASSERT_EQ(QueryFingerprint::Hash(one), QueryFingerprint::Hash(three));
+	ASSERT_EQ(QueryFingerprint::ToHex(QueryFingerprint::Hash(one)).size(), 16);
+}
+
+/**
+* Check which statements the slow query log treats as read only, and so is willing to run EXPLAIN ANALYZE on. Comments and
+* literals that look like writes don't count, but writable CTEs, locking reads, SELECT INTO and functions known to have
+* side effects do.
+*/
+TEST_F(PLYTest, QueryFingerprintIsReadOnly)
+{
+	auto readOnly = [](const std::string &sql) { return PLY::QueryFingerprint::IsReadOnly(PLY::QueryFingerprint::Normalise(sql)); };
+
+	ASSERT_TRUE(readOnly("SELECT * FROM t WHERE id = 1"));
+	ASSERT_TRUE(readOnly("WITH r AS (SELECT * FROM t) SELECT * FROM r;"));
+	ASSERT_TRUE(readOnly("VALUES (1), (2)"));
+	ASSERT_TRUE(readOnly("SELECT * FROM t WHERE a = 'delete from t; update t set x = 1'"));
+	ASSERT_TRUE(readOnly("SELECT 1 -- insert into t\n"));
+	ASSERT_TRUE(readOnly("SELECT /* for update */ * FROM t"));
+	ASSERT_TRUE(readOnly("SELECT \"update_count\" FROM t"));
+
+	//Writable CTEs.
+	ASSERT_FALSE(readOnly("WITH d AS (DELETE FROM t WHERE id = 1 RETURNING *) SELECT * FROM d"));
+	ASSERT_FALSE(readOnly("WITH u AS (UPDATE t SET x = 1 RETURNING id) SELECT count(*) FROM u"));
+	ASSERT_FALSE(readOnly("with i as (insert into t values (1) returning id) select id from i"));
+
+	//Locking reads.
+	ASSERT_FALSE(readOnly("SELECT * FROM t WHERE id = 1 FOR UPDATE"));
+	ASSERT_FALSE(readOnly("SELECT * FROM t FOR\n  UPDATE SKIP LOCKED"));
+	ASSERT_FALSE(readOnly("SELECT * FROM t FOR NO KEY UPDATE"));
+	ASSERT_FALSE(readOnly("SELECT * FROM t FOR SHARE"));
+
+	//SELECT INTO creates a table.
+	ASSERT_FALSE(readOnly("SELECT * INTO copy FROM t"));
+
+	//Functions with side effects that a rolled back read only transaction doesn't undo or prevent.
+	ASSERT_FALSE(readOnly("SELECT nextval('ids')"));
+	ASSERT_FALSE(readOnly("SELECT setval('ids', 10)"));
+	ASSERT_FALSE(readOnly("SELECT pg_advisory_lock(1)"));
+	ASSERT_FALSE(readOnly("SELECT pg_try_advisory_lock(1)"));
+	ASSERT_FALSE(readOnly("SELECT pg_terminate_backend(123)"));
+	ASSERT_FALSE(readOnly("SELECT dblink_exec('dbname=x', 'delete from t')"));
+
+	//Statements that don't start by reading, and multiple statements.
+	ASSERT_FALSE(readOnly("UPDATE t SET x = 1"));
+	ASSERT_FALSE(readOnly("SELECT 1; DELETE FROM t"));
+	ASSERT_FALSE(readOnly("EXPLAIN ANALYZE DELETE FROM t"));
+}
+
+/**
+* Check that statement statistics add up queries that share a fingerprint, including repeats of the same statement served
+* from the fingerprint cache, and that a reset clears them.
+*/
+TEST_F(PLYTest, StatementStatsGroupByFingerprint)
+{
+	PLY::StatementStats stats;
+	PLY::PLYResult result;
+
+	stats.Record("SELECT * FROM t WHERE id = 1", result, 100, 40, 10);
+	stats.Record("SELECT * FROM t WHERE id = 1", result, 300, 60, 10);
+	stats.Record("select * from t where id = 2", result, 200, 50, 10);
+	result.errorType = PLY::PLYResult::ResultErrorType::SQL_ERROR;
+	stats.Record("DELETE FROM t", result, 50, 50, 0);
+
+	std::vector<PLY::PLYStatementStats> snapshot = stats.GetSnapshot();
+	ASSERT_EQ(snapshot.size(), 2);
+
+	//Sorted by total time.
+	ASSERT_EQ(snapshot[0].query, "select * from t where id = ?");
+	ASSERT_EQ(snapshot[0].fingerprint, PLY::QueryFingerprint::Hash("select * from t where id = ?"));
+	ASSERT_EQ(snapshot[0].calls, 3);
+	ASSERT_EQ(snapshot[0].errors, 0);
+	ASSERT_EQ(snapshot[0].bytes, 30);
+	ASSERT_EQ(snapshot[0].totalTime, 600);
+	ASSERT_EQ(snapshot[0].executionTime, 150);
+	ASSERT_EQ(snapshot[0].maxTime, 300);
+	ASSERT_EQ(snapshot[1].query, "delete from t");
+	ASSERT_EQ(snapshot[1].errors, 1);
+
+	ASSERT_EQ(stats.GetSnapshot(1).size(), 1);
+
+	stats.Reset();
+	ASSERT_TRUE(stats.GetSnapshot().empty());
+
+	stats.Record("DELETE FROM t", result, 70, 70, 0);
+	snapshot = stats.GetSnapshot();
+	ASSERT_EQ(snapshot.size(), 1);
+	ASSERT_EQ(snapshot[0].calls, 1);
+	ASSERT_EQ(snapshot[0].totalTime, 70);
+}
+
+/**
+* Check that a scenario file's defaults, sections and settings are parsed, and that settings it doesn't give keep the base
+* scenario's values.
+*/
+TEST_F(PLYTest, BenchmarkScenarioParse)
+{
+	PLY::BenchmarkScenario base;
+	base.connection.host = "basehost";
+	base.timeout = 5;
+
+	std::string text =
+		"# Defaults for every scenario.\n"
+		"queries = 200\n"
+		"query = select 1\n"
+		"\n"
+		"[closed]\n"
+		"pool = 4\n"
+		"transaction = false\n"
+		"\n"
+		"; Open loop.\n"
+		"[open]\n"
+		"queries = 50\n"
+		"rate = 100\n"
+		"duration = 3\n"
+		"arrival = poisson\n"
+		"query = select \\\n"
+		"  2\n";
+
+	std::vector<PLY::BenchmarkScenario> scenarios;
+	std::string error;
+	ASSERT_TRUE(PLY::BenchmarkScenario::Parse(text, base, scenarios, error)) << error;
+	ASSERT_EQ(scenarios.size(), 2);
+
+	const PLY::BenchmarkScenario &closed = scenarios[0];
+	ASSERT_STREQ(closed.name.c_str(), "closed");
+	ASSERT_STREQ(closed.query.c_str(), "select 1");
+	ASSERT_EQ(closed.queries, 200);
+	ASSERT_EQ(closed.pool.minPoolSize, 4);
+	ASSERT_EQ(closed.pool.maxPoolSize, 4);
+	ASSERT_FALSE(closed.useTransaction);
+	ASSERT_FALSE(closed.IsOpenLoop());
+	ASSERT_EQ(closed.timeout, 5);
+	ASSERT_STREQ(closed.connection.host.c_str(), "basehost");
+
+	const PLY::BenchmarkScenario &open = scenarios[1];
+	ASSERT_STREQ(open.name.c_str(), "open");
+	ASSERT_STREQ(open.query.c_str(), "select \n2");
+	ASSERT_EQ(open.queries, 50);
+	ASSERT_TRUE(open.IsOpenLoop());
+	ASSERT_EQ(open.arrival, PLY::BenchmarkScenario::POISSON);
+	ASSERT_EQ(open.GetQueriesPerPass(), 300);
+	ASSERT_TRUE(open.useTransaction);
+
+	//A file without sections is one scenario, named after the base scenario.
+	scenarios.clear();
+	ASSERT_TRUE(PLY::BenchmarkScenario::Parse("query = select 1", base, scenarios, error)) << error;
+	ASSERT_EQ(scenarios.size(), 1);
+	ASSERT_STREQ(scenarios[0].name.c_str(), "default");
+}
+
+/**
+* Check that settings with lists and ranges expand into one scenario for every combination of values, and that the pool
+* size is applied before max_pool whatever order the file gives them in.
+*/
+TEST_F(PLYTest, BenchmarkScenarioMatrix)
+{
+	std::string text =
+		"[threads]\n"
+		"query = select 1, 2\n"
+		"max_pool = 8\n"
+		"pool = 2, 4\n"
+		"rate = 100..300 step 100\n";
+
+	std::vector<PLY::BenchmarkScenario> scenarios;
+	std::string error;
+	ASSERT_TRUE(PLY::BenchmarkScenario::Parse(text, PLY::BenchmarkScenario(), scenarios, error)) << error;
+	ASSERT_EQ(scenarios.size(), 6);
+
+	ASSERT_STREQ(scenarios[0].name.c_str(), "threads[pool=2,rate=100]");
+	ASSERT_STREQ(scenarios[5].name.c_str(), "threads[pool=4,rate=300]");
+	ASSERT_EQ(scenarios[0].pool.minPoolSize, 2);
+	ASSERT_EQ(scenarios[0].pool.maxPoolSize, 8);
+	ASSERT_EQ(scenarios[4].rate, 200);
+
+	//Free text settings are never split on commas.
+	ASSERT_STREQ(scenarios[0].query.c_str(), "select 1, 2");
+}
+
+/**
+* Check that query placeholders are replaced, and that literal braces are kept.
+*/
+TEST_F(PLYTest, BenchmarkScenarioPlaceholders)
+{
+	std::vector<PLY::BenchmarkScenario> scenarios;
+	std::string error;
+	ASSERT_TRUE(PLY::BenchmarkScenario::Parse("queries = 10\nquery = select {i}, {n}, {pass}, {random:7:7}, '{{}}'",
+		PLY::BenchmarkScenario(), scenarios, error)) << error;
+	ASSERT_EQ(scenarios.size(), 1);
+
+	std::mt19937 random;
+	ASSERT_EQ(scenarios[0].GenerateQuery(3, 2, random), "select 3, 10, 2, 7, '{}'");
+
+	//Random values stay in range.
+	scenarios.clear();
+	ASSERT_TRUE(PLY::BenchmarkScenario::Parse("query = select {random:1:3}", PLY::BenchmarkScenario(), scenarios, error)) << error;
+	for (int i = 0; i < 100; ++i)
+	{
+		std::string sql = scenarios[0].GenerateQuery(i, 1, random);
+		ASSERT_TRUE(sql == "select 1" || sql == "select 2" || sql == "select 3") << sql;
+	}
+}
+
+/**
+* Check that invalid scenario files are rejected, with an error that names the problem and, where there is one, its line.
+*/
+TEST_F(PLYTest, BenchmarkScenarioErrors)
+{
+	//Scenario text, and text the error must contain.
+	std::vector<std::pair<std::string, std::string>> cases = {
+		{ "query = select 1\nthreads = 4", "line 2: Unknown setting threads" },
+		{ "query = select 1\n\npool = many", "line 3: Setting pool must be a whole number of at least 1, not many" },
+		{ "query = select 1\nqueries = 0", "line 2: Setting queries must be a whole number of at least 1, not 0" },
+		{ "query = select 1\nwait_mode = spin", "line 2: Unknown wait_mode spin" },
+		{ "query = select 1\narrival = bursty", "line 2: Unknown arrival bursty" },
+		{ "query = select 1\nsslmode = maybe", "line 2: Unknown sslmode maybe" },
+		{ "query = select 1\ntransaction = sometimes", "line 2: Setting transaction must be true or false" },
+		{ "query = select 1\njust some text", "line 2: Expected key = value" },
+		{ "[]\nquery = select 1", "line 1: Invalid section name []" },
+		{ "[open\nquery = select 1", "line 1: Invalid section name [open" },
+		{ "[empty]\npool = 4", "Scenario empty has no query" },
+		{ "[small]\nquery = select 1\npool = 4\nmax_pool = 2", "Scenario small has a max_pool smaller than its pool" },
+		{ "query = select 1\npool = 1,,2", "line 2: Empty value in list 1,,2" },
+		{ "query = select 1\npool = 4..2", "line 2: Invalid range 4..2" },
+		{ "query = select 1\nrate = 1..9 step 0", "line 2: Invalid range step 1..9 step 0" },
+		{ "[big]\nquery = select 1\nqueries = 1..100\npool = 1..100", "Scenario big expands to more than 1000 scenarios" },
+		{ "[q]\nquery = select {x}", "Scenario q: Unknown placeholder {x}" },
+		{ "[q]\nquery = select {i", "Scenario q: Unclosed placeholder in query" },
+		{ "[q]\nquery = select {random:9:1}", "Scenario q: Invalid placeholder {random:9:1}" }
+	};
+
+	for (const std::pair<std::string, std::string> &c : cases)
+	{
+		std::vector<PLY::BenchmarkScenario> scenarios;
+		std::string error;
+		ASSERT_FALSE(PLY::BenchmarkScenario::Parse(c.first, PLY::BenchmarkScenario(), scenarios, error)) << c.first;
+		ASSERT_NE(error.find(c.second), std::string::npos) << error;
+	}
+
+	//Missing files are reported too.
+	std::vector<PLY::BenchmarkScenario> scenarios;
+	std::string error;
+	ASSERT_FALSE(PLY::BenchmarkScenario::Load("ply_missing_scenarios.ini", PLY::BenchmarkScenario(), scenarios, error));
+	ASSERT_NE(error.find("Couldn't open scenario file"), std::string::npos) << error;
+}
+
+/**
+* Check that queries run through the query engine's scheduler and workers return synthetic result sets from fake connections.
+* Doesn't need a database.
+*/
+TEST_F(PLYTest, FakeConnectionResult)
+{
+	PLY::FakeConnectionSettings settings;
+	settings.rows = 3;
+	settings.columns = 2;
+	settings.fieldSize = 5;
+
+	std::shared_ptr<PLY::PLYResult> result = RunFakeQuery(settings);
+	ASSERT_TRUE(result != nullptr);
+	ASSERT_EQ(result->errorType, PLY::PLYResult::ResultErrorType::NONE);
+	ASSERT_EQ(result->resultSet.size(), 3);
+	ASSERT_EQ(result->resultSet.columns(), 2);
+	ASSERT_EQ(result->resultSet[2][1].size(), 5);
+}
+
+/**
+* Check that SQL errors injected by fake connections are returned as SQL error results.
+* Doesn't need a database.
+*/
+TEST_F(PLYTest, FakeConnectionSQLError)
+{
+	PLY::FakeConnectionSettings settings;
+	settings.errorRate = 1;
+
+	std::shared_ptr<PLY::PLYResult> result = RunFakeQuery(settings);
+	ASSERT_TRUE(result != nullptr);
+	ASSERT_EQ(result->errorType, PLY::PLYResult::ResultErrorType::SQL_ERROR);
+}
+
 AZ_UNIT_TEST_HOOK();